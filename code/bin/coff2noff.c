@@ -78,13 +78,31 @@ WriteOrDie(FILE * f, const char * buffer, size_t numBytes)
         Die("Unable to write file");
 }
 
+/// Pad the output with zeroes up to the next `NOFF_SEGMENT_ALIGN`
+/// boundary, and return the new offset.  Keeping every segment
+/// page-aligned in the file lets the loader fetch pages with aligned,
+/// whole-page reads.
+static int
+PadToAlign(FILE * f, int offset)
+{
+    static const char zeroes[NOFF_SEGMENT_ALIGN];
+
+    assert(f != NULL);
+
+    int pad = offset % NOFF_SEGMENT_ALIGN;
+    if (pad != 0) {
+        pad = NOFF_SEGMENT_ALIGN - pad;
+        WriteOrDie(f, zeroes, pad);
+        offset += pad;
+    }
+    return offset;
+}
+
 void
 main(int argc, char * argv[])
 {
     FILE * in, * out;
     int inNoffFile;
-    unsigned numSections, i;
-    char * buffer;
     noffHeader noffH;
 
     if (argc < 2) {
@@ -116,15 +134,15 @@ main(int argc, char * argv[])
 
     /// Initialize the NOFF header, in case not all the segments are defined
     /// in the COFF file.
-    noffH.noffMagic       = NOFF_MAGIC;
+    noffH.noffMagic       = NOFF_MAGIC2;
     noffH.code.size       = 0;
     noffH.initData.size   = 0;
     noffH.uninitData.size = 0;
 
     /// Copy the segments in.
     CoffSection * sc;
-    inNoffFile = sizeof noffH;
-    fseek(out, inNoffFile, SEEK_SET);
+    fseek(out, sizeof noffH, SEEK_SET);
+    inNoffFile = PadToAlign(out, sizeof noffH);
     printf("Translating COFF sections into NOFF:\n");
     while ((sc = CoffReaderNextSection(&d)) != NULL) {
         CoffSectionPrint(sc);
@@ -138,13 +156,12 @@ main(int argc, char * argv[])
         size_t size = CoffSectionSize(sc);
 
         if (!strcmp(name, ".text")) {
+            inNoffFile = PadToAlign(out, inNoffFile);
             noffH.code.virtualAddr = addr;
             noffH.code.inFileAddr  = inNoffFile;
             noffH.code.size        = size;
-            if ((buffer = CoffSectionRead(sc, in, &errorS)) == NULL)
+            if (!CoffSectionCopy(sc, in, out, &errorS))
                 Die(errorS);
-            WriteOrDie(out, buffer, size);
-            free(buffer);
             inNoffFile += size;
         } else if (!strcmp(name, ".data") ||
           !strcmp(name, ".rdata"))
@@ -153,13 +170,12 @@ main(int argc, char * argv[])
             /// sure one or the other is empty!
             if (noffH.initData.size != 0)
                 Die("Cannot handle both data and rdata");
+            inNoffFile = PadToAlign(out, inNoffFile);
             noffH.initData.virtualAddr = addr;
             noffH.initData.inFileAddr  = inNoffFile;
             noffH.initData.size        = size;
-            if ((buffer = CoffSectionRead(sc, in, &errorS)) == NULL)
+            if (!CoffSectionCopy(sc, in, out, &errorS))
                 Die(errorS);
-            WriteOrDie(out, buffer, size);
-            free(buffer);
             inNoffFile += size;
         } else if (!strcmp(name, ".bss") || !strcmp(name, ".sbss")) {
             /// Need to check if we have both `.bss` and `.sbss` -- make sure
@@ -76,3 +76,27 @@ CoffSectionRead(const coffSectionHeader * sh, FILE * f, char ** error)
         FAIL(NULL, "File is too short");
     return buffer;
 }
+
+#define COPY_BUFFER_SIZE 4096
+
+bool
+CoffSectionCopy(const coffSectionHeader * sh, FILE * in, FILE * out,
+  char ** error)
+{
+    assert(sh != NULL);
+    assert(in != NULL);
+    assert(out != NULL);
+
+    static char buffer[COPY_BUFFER_SIZE];
+
+    fseek(in, sh->sectionPtr, SEEK_SET);
+    for (size_t left = sh->size; left > 0; ) {
+        size_t chunk = left < COPY_BUFFER_SIZE ? left : COPY_BUFFER_SIZE;
+        if (fread(buffer, chunk, 1, in) != 1)
+            FAIL(false, "File is too short");
+        if (fwrite(buffer, chunk, 1, out) != 1)
+            FAIL(false, "Unable to write file");
+        left -= chunk;
+    }
+    return true;
+}
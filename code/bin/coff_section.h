@@ -33,5 +33,12 @@ CoffSectionPrint(const CoffSection * sh);
 char *
 CoffSectionRead(const CoffSection * sh, FILE * f, char ** error);
 
+// Copy the section's contents from `in` to the current position of `out`,
+// streaming through a fixed-size buffer instead of materializing the whole
+// section in memory.
+bool
+CoffSectionCopy(const CoffSection * sh, FILE * in, FILE * out,
+  char ** error);
+
 
 #endif // ifndef NACHOS_BIN_COFF_SECTION__H
@@ -0,0 +1,181 @@
+/// Opcode-indexed descriptor tables for the MIPS instruction set.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2019 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "decode.h"
+
+
+const InstrDesc NORMAL_DESC[64] = {
+    { "special", FMT_NONE        },
+    { "bcond",   FMT_NONE        },
+    { "j",       FMT_TARGET      },
+    { "jal",     FMT_TARGET      },
+    { "beq",     FMT_RS_RT_OFF   },
+    { "bne",     FMT_RS_RT_OFF   },
+    { "blez",    FMT_RS_OFF      },
+    { "bgtz",    FMT_RS_OFF      },
+    { "addi",    FMT_RT_RS_IMM   },
+    { "addiu",   FMT_RT_RS_IMM   },
+    { "slti",    FMT_RT_RS_IMM   },
+    { "sltiu",   FMT_RT_RS_IMM   },
+    { "andi",    FMT_RT_RS_IMM   },
+    { "ori",     FMT_RT_RS_IMM   },
+    { "xori",    FMT_RT_RS_IMM   },
+    { "lui",     FMT_RT_IMM      },
+    { "cop0",    FMT_NONE        },
+    { "cop1",    FMT_NONE        },
+    { "cop2",    FMT_NONE        },
+    { "cop3",    FMT_NONE        },
+    { "024",     FMT_NONE        },
+    { "025",     FMT_NONE        },
+    { "026",     FMT_NONE        },
+    { "027",     FMT_NONE        },
+    { "030",     FMT_NONE        },
+    { "031",     FMT_NONE        },
+    { "032",     FMT_NONE        },
+    { "033",     FMT_NONE        },
+    { "034",     FMT_NONE        },
+    { "035",     FMT_NONE        },
+    { "036",     FMT_NONE        },
+    { "037",     FMT_NONE        },
+    { "lb",      FMT_RT_OFF_RS   },
+    { "lh",      FMT_RT_OFF_RS   },
+    { "lwl",     FMT_RT_OFF_RS   },
+    { "lw",      FMT_RT_OFF_RS   },
+    { "lbu",     FMT_RT_OFF_RS   },
+    { "lhu",     FMT_RT_OFF_RS   },
+    { "lwr",     FMT_RT_OFF_RS   },
+    { "047",     FMT_NONE        },
+    { "sb",      FMT_RT_OFF_RS   },
+    { "sh",      FMT_RT_OFF_RS   },
+    { "swl",     FMT_RT_OFF_RS   },
+    { "sw",      FMT_RT_OFF_RS   },
+    { "054",     FMT_NONE        },
+    { "055",     FMT_NONE        },
+    { "swr",     FMT_RT_OFF_RS   },
+    { "057",     FMT_NONE        },
+    { "lwc0",    FMT_RT_OFF_RS   },
+    { "lwc1",    FMT_RT_OFF_RS   },
+    { "lwc2",    FMT_RT_OFF_RS   },
+    { "lwc3",    FMT_RT_OFF_RS   },
+    { "064",     FMT_NONE        },
+    { "065",     FMT_NONE        },
+    { "066",     FMT_NONE        },
+    { "067",     FMT_NONE        },
+    { "swc0",    FMT_RT_OFF_RS   },
+    { "swc1",    FMT_RT_OFF_RS   },
+    { "swc2",    FMT_RT_OFF_RS   },
+    { "swc3",    FMT_RT_OFF_RS   },
+    { "074",     FMT_NONE        },
+    { "075",     FMT_NONE        },
+    { "076",     FMT_NONE        },
+    { "077",     FMT_NONE        }
+};
+
+const InstrDesc SPECIAL_DESC[64] = {
+    { "sll",     FMT_RD_RT_SHAMT },
+    { "001",     FMT_NONE        },
+    { "srl",     FMT_RD_RT_SHAMT },
+    { "sra",     FMT_RD_RT_SHAMT },
+    { "sllv",    FMT_RD_RT_RS    },
+    { "005",     FMT_NONE        },
+    { "srlv",    FMT_RD_RT_RS    },
+    { "srav",    FMT_RD_RT_RS    },
+    { "jr",      FMT_RS          },
+    { "jalr",    FMT_RS          },
+    { "012",     FMT_NONE        },
+    { "013",     FMT_NONE        },
+    { "syscall", FMT_NONE        },
+    { "break",   FMT_NONE        },
+    { "016",     FMT_NONE        },
+    { "017",     FMT_NONE        },
+    { "mfhi",    FMT_RD          },
+    { "mthi",    FMT_RD          },
+    { "mflo",    FMT_RS          },
+    { "mtlo",    FMT_RS          },
+    { "024",     FMT_NONE        },
+    { "025",     FMT_NONE        },
+    { "026",     FMT_NONE        },
+    { "027",     FMT_NONE        },
+    { "mult",    FMT_RS_RT       },
+    { "multu",   FMT_RS_RT       },
+    { "div",     FMT_RS_RT       },
+    { "divu",    FMT_RS_RT       },
+    { "034",     FMT_NONE        },
+    { "035",     FMT_NONE        },
+    { "036",     FMT_NONE        },
+    { "037",     FMT_NONE        },
+    { "add",     FMT_RD_RS_RT    },
+    { "addu",    FMT_RD_RS_RT    },
+    { "sub",     FMT_RD_RS_RT    },
+    { "subu",    FMT_RD_RS_RT    },
+    { "and",     FMT_RD_RS_RT    },
+    { "or",      FMT_RD_RS_RT    },
+    { "xor",     FMT_RD_RS_RT    },
+    { "nor",     FMT_RD_RS_RT    },
+    { "050",     FMT_NONE        },
+    { "051",     FMT_NONE        },
+    { "slt",     FMT_RD_RS_RT    },
+    { "sltu",    FMT_RD_RS_RT    },
+    { "054",     FMT_NONE        },
+    { "055",     FMT_NONE        },
+    { "056",     FMT_NONE        },
+    { "057",     FMT_NONE        },
+    { "060",     FMT_NONE        },
+    { "061",     FMT_NONE        },
+    { "062",     FMT_NONE        },
+    { "063",     FMT_NONE        },
+    { "064",     FMT_NONE        },
+    { "065",     FMT_NONE        },
+    { "066",     FMT_NONE        },
+    { "067",     FMT_NONE        },
+    { "070",     FMT_NONE        },
+    { "071",     FMT_NONE        },
+    { "072",     FMT_NONE        },
+    { "073",     FMT_NONE        },
+    { "074",     FMT_NONE        },
+    { "075",     FMT_NONE        },
+    { "076",     FMT_NONE        },
+    { "077",     FMT_NONE        }
+};
+
+/// The rt field encodes the operation; unassigned values still print
+/// their branch operands, as the old disassembler did.
+const InstrDesc BCOND_DESC[32] = {
+    { "bltz",   FMT_RS_OFF },
+    { "bgez",   FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "bltzal", FMT_RS_OFF },
+    { "bgezal", FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF },
+    { "BCOND",  FMT_RS_OFF }
+};
@@ -0,0 +1,51 @@
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2019 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_BIN_DECODE__H
+#define NACHOS_BIN_DECODE__H
+
+
+/// One shared, table-driven description of the MIPS instruction set.
+///
+/// The disassembler (`d.c`) and the standalone emulator (`execute.c`)
+/// used to carry their own copies of the decode logic as branch-heavy
+/// switches over `encode.h` constants.  Both now index these arrays
+/// instead: a descriptor gives the mnemonic and the operand format of
+/// each opcode, and unknown slots keep the octal spelling of the opcode
+/// as their name.
+
+/// How the operand fields of an instruction are to be read (and
+/// printed).  The groupings follow the original disassembler output,
+/// quirks included, so the listing format does not change.
+typedef enum {
+    FMT_NONE,         ///< No printable operands (syscall, break, cop*).
+    FMT_RD_RT_SHAMT,  ///< Shifts by a constant.
+    FMT_RD_RT_RS,     ///< Shifts by a register.
+    FMT_RS,           ///< jr, jalr, mflo, mtlo.
+    FMT_RD,           ///< mfhi, mthi.
+    FMT_RS_RT,        ///< mult, div and friends.
+    FMT_RD_RS_RT,     ///< Three-register ALU operations.
+    FMT_TARGET,       ///< 26-bit jump target.
+    FMT_RS_RT_OFF,    ///< beq/bne.
+    FMT_RS_OFF,       ///< bcond branches.
+    FMT_RT_RS_IMM,    ///< Immediate ALU operations.
+    FMT_RT_IMM,       ///< lui.
+    FMT_RT_OFF_RS     ///< Loads and stores.
+} InstrFormat;
+
+typedef struct {
+    const char * name;
+    InstrFormat  format;
+} InstrDesc;
+
+/// Indexed by the main opcode field (bits 31-26), the `special`
+/// function field (bits 5-0), and the `bcond` rt field (bits 20-16),
+/// respectively.
+extern const InstrDesc NORMAL_DESC[64];
+extern const InstrDesc SPECIAL_DESC[64];
+extern const InstrDesc BCOND_DESC[32];
+
+
+#endif // ifndef NACHOS_BIN_DECODE__H
@@ -6,6 +6,7 @@
 
 #include "instr.h"
 #include "encode.h"
+#include "decode.h"
 #include "int.h"
 
 #include <stdio.h>
@@ -19,6 +20,11 @@ extern int TRACE, Regtrace;
 static int Reg[32]; // General purpose registers.
 static int HI, LO;  // mul/div machine registers.
 
+// Program counters.  The fetch loop rotates them; the handlers below
+// only ever touch `npc` (branches and jumps) and read `xpc` (link
+// registers and branch bases).
+static int pc, xpc, npc;
+
 // Condition-code calculations
 
 // Extract bit 31.
@@ -90,19 +96,540 @@ DumpReg(void)
     printf("\n");
 }
 
-/// Unimplemented.
+/// Unimplemented.  The shared descriptor tables know the mnemonic even
+/// when the emulator has no handler for it.
 static void
-Unimplemented(void)
+Unimplemented(int instr)
 {
-    printf("Unimplemented instruction.\n");
+    unsigned opcode = instr >> 26 & 0x3F;
+    const InstrDesc * d = opcode == I_SPECIAL
+      ? &SPECIAL_DESC[instr & 0x3F] : &NORMAL_DESC[opcode];
+
+    printf("Unimplemented instruction `%s`.\n", d->name);
     exit(2);
 }
 
+// One small handler per instruction.  The fetch loop dispatches
+// through the opcode-indexed tables at the bottom of this file; empty
+// slots fall back to `Unimplemented`.
+
+typedef void (* InstrHandler)(int instr);
+
+// `special` handlers (function field).
+
+static void
+DoSll(int instr)
+{
+    Reg[rd(instr)] = Reg[rt(instr)] << shamt(instr);
+}
+
+static void
+DoSrl(int instr)
+{
+    Reg[rd(instr)] = (unsigned) Reg[rt(instr)] >> shamt(instr);
+}
+
+static void
+DoSra(int instr)
+{
+    Reg[rd(instr)] = Reg[rt(instr)] >> shamt(instr);
+}
+
+static void
+DoSllv(int instr)
+{
+    Reg[rd(instr)] = Reg[rt(instr)] << Reg[rs(instr)];
+}
+
+static void
+DoSrlv(int instr)
+{
+    Reg[rd(instr)] = (unsigned) Reg[rt(instr)] >> Reg[rs(instr)];
+}
+
+static void
+DoSrav(int instr)
+{
+    Reg[rd(instr)] = Reg[rt(instr)] >> Reg[rs(instr)];
+}
+
+static void
+DoJr(int instr)
+{
+    npc = Reg[rs(instr)];
+}
+
+static void
+DoJalr(int instr)
+{
+    npc = Reg[rs(instr)];
+    Reg[rd(instr)] = xpc + 8;
+}
+
+static void
+DoSyscall(int instr)
+{
+    SystemTrap();
+}
+
+static void
+DoBreak(int instr)
+{
+    SystemBreak();
+}
+
+static void
+DoMfhi(int instr)
+{
+    Reg[rd(instr)] = HI;
+}
+
+static void
+DoMthi(int instr)
+{
+    HI = Reg[rs(instr)];
+}
+
+static void
+DoMflo(int instr)
+{
+    Reg[rd(instr)] = LO;
+}
+
+static void
+DoMtlo(int instr)
+{
+    LO = Reg[rs(instr)];
+}
+
+static void
+DoMult(int instr)
+{
+    int t1, t2;
+    int t1l, t1h, t2l, t2h;
+    int neg;
+
+    t1  = Reg[rs(instr)];
+    t2  = Reg[rt(instr)];
+    neg = 0;
+    if (t1 < 0) {
+        t1  = -t1;
+        neg = !neg;
+    }
+    if (t2 < 0) {
+        t2  = -t2;
+        neg = !neg;
+    }
+    LO  = t1 * t2;
+    t1l = t1 & 0xFFFF;
+    t1h = (t1 >> 16) & 0xFFFF;
+    t2l = t2 & 0xFFFF;
+    t2h = (t2 >> 16) & 0xFFFF;
+    HI  = t1h * t2h + (t1h * t2l >> 16) + (t2h * t1l >> 16);
+    if (neg) {
+        LO = ~LO;
+        HI = ~HI;
+        LO = LO + 1;
+        if (LO == 0)
+            HI = HI + 1;
+    }
+}
+
+static void
+DoMultu(int instr)
+{
+    int t1, t2;
+    int t1l, t1h, t2l, t2h;
+
+    t1  = Reg[rs(instr)];
+    t2  = Reg[rt(instr)];
+    t1l = t1 & 0xFFFF;
+    t1h = t1 >> 16 & 0xFFFF;
+    t2l = t2 & 0xFFFF;
+    t2h = t2 >> 16 & 0xFFFF;
+    LO  = t1 * t2;
+    HI  = t1h * t2h + (t1h * t2l >> 16) + (t2h * t1l >> 16);
+}
+
+static void
+DoDiv(int instr)
+{
+    LO = Reg[rs(instr)] / Reg[rt(instr)];
+    HI = Reg[rs(instr)] % Reg[rt(instr)];
+}
+
+static void
+DoDivu(int instr)
+{
+    LO = (unsigned) Reg[rs(instr)] / (unsigned) Reg[rt(instr)];
+    HI = (unsigned) Reg[rs(instr)] % (unsigned) Reg[rt(instr)];
+}
+
+static void
+DoAdd(int instr)
+{
+    Reg[rd(instr)] = Reg[rs(instr)] + Reg[rt(instr)];
+}
+
+static void
+DoSub(int instr)
+{
+    Reg[rd(instr)] = Reg[rs(instr)] - Reg[rt(instr)];
+}
+
+static void
+DoAnd(int instr)
+{
+    Reg[rd(instr)] = Reg[rs(instr)] & Reg[rt(instr)];
+}
+
+static void
+DoOr(int instr)
+{
+    Reg[rd(instr)] = Reg[rs(instr)] | Reg[rt(instr)];
+}
+
+static void
+DoXor(int instr)
+{
+    Reg[rd(instr)] = Reg[rs(instr)] ^ Reg[rt(instr)];
+}
+
+static void
+DoNor(int instr)
+{
+    Reg[rd(instr)] = ~(Reg[rs(instr)] | Reg[rt(instr)]);
+}
+
+static void
+DoSlt(int instr)
+{
+    Reg[rd(instr)] = Reg[rs(instr)] < Reg[rt(instr)];
+}
+
+static void
+DoSltu(int instr)
+{
+    Reg[rd(instr)] = (unsigned) Reg[rs(instr)] < (unsigned) Reg[rt(instr)];
+}
+
+// `bcond` handlers (the rt field encodes the op).
+
+static void
+DoBltz(int instr)
+{
+    if (Reg[rs(instr)] < 0)
+        npc = xpc + 4 + off16(instr);
+}
+
+static void
+DoBgez(int instr)
+{
+    if (Reg[rs(instr)] >= 0)
+        npc = xpc + 4 + off16(instr);
+}
+
+static void
+DoBltzal(int instr)
+{
+    Reg[31] = xpc + 8;
+    if (Reg[rs(instr)] < 0)
+        npc = xpc + 4 + off16(instr);
+}
+
+static void
+DoBgezal(int instr)
+{
+    Reg[31] = xpc + 8;
+    if (Reg[rs(instr)] >= 0)
+        npc = xpc + 4 + off16(instr);
+}
+
+// Normal opcode handlers.
+
+static void
+DoJ(int instr)
+{
+    npc = (xpc & 0xF0000000) | (instr & 0x03FFFFFF) << 2;
+}
+
+static void
+DoJal(int instr)
+{
+    Reg[31] = xpc + 8;
+    npc     = (xpc & 0xF0000000) | (instr & 0x03FFFFFF) << 2;
+}
+
+static void
+DoBeq(int instr)
+{
+    if (Reg[rs(instr)] == Reg[rt(instr)])
+        npc = xpc + 4 + off16(instr);
+}
+
+static void
+DoBne(int instr)
+{
+    if (Reg[rs(instr)] != Reg[rt(instr)])
+        npc = xpc + 4 + off16(instr);
+}
+
+static void
+DoBlez(int instr)
+{
+    if (Reg[rs(instr)] <= 0)
+        npc = xpc + 4 + off16(instr);
+}
+
+static void
+DoBgtz(int instr)
+{
+    if (Reg[rs(instr)] > 0)
+        npc = xpc + 4 + off16(instr);
+}
+
+static void
+DoAddi(int instr)
+{
+    Reg[rt(instr)] = Reg[rs(instr)] + immed(instr);
+}
+
+static void
+DoSlti(int instr)
+{
+    Reg[rt(instr)] = Reg[rs(instr)] < immed(instr);
+}
+
+static void
+DoSltiu(int instr)
+{
+    Reg[rt(instr)] = (unsigned) Reg[rs(instr)] < (unsigned) immed(instr);
+}
+
+static void
+DoAndi(int instr)
+{
+    Reg[rt(instr)] = Reg[rs(instr)] & immed(instr);
+}
+
+static void
+DoOri(int instr)
+{
+    Reg[rt(instr)] = Reg[rs(instr)] | immed(instr);
+}
+
+static void
+DoXori(int instr)
+{
+    Reg[rt(instr)] = Reg[rs(instr)] ^ immed(instr);
+}
+
+static void
+DoLui(int instr)
+{
+    Reg[rt(instr)] = instr << 16;
+}
+
+static void
+DoLb(int instr)
+{
+    Reg[rt(instr)] = CFetch(Reg[rs(instr)] + immed(instr));
+}
+
+static void
+DoLh(int instr)
+{
+    Reg[rt(instr)] = SFetch(Reg[rs(instr)] + immed(instr));
+}
+
+static void
+DoLwl(int instr)
+{
+    int i = Reg[rs(instr)] + immed(instr);
+
+    Reg[rt(instr)] &= -1 >> 8 * (-i & 0x03);
+    Reg[rt(instr)] |= Fetch(i & 0xFFFFFFFC) << 8 * (i & 0x03);
+}
+
+static void
+DoLw(int instr)
+{
+    Reg[rt(instr)] = Fetch(Reg[rs(instr)] + immed(instr));
+}
+
+static void
+DoLbu(int instr)
+{
+    Reg[rt(instr)] = UCFetch(Reg[rs(instr)] + immed(instr));
+}
+
+static void
+DoLhu(int instr)
+{
+    Reg[rt(instr)] = USFetch(Reg[rs(instr)] + immed(instr));
+}
+
+static void
+DoLwr(int instr)
+{
+    int i = Reg[rs(instr)] + immed(instr);
+
+    Reg[rt(instr)] &= -1 << 8 * (i & 0x03);
+    if ((i & 0x03) == 0)
+        Reg[rt(instr)] = 0;
+    Reg[rt(instr)] |= Fetch(i & 0xFFFFFFFC) >> 8 * (-i & 0x03);
+}
+
+static void
+DoSb(int instr)
+{
+    CStore(Reg[rs(instr)] + immed(instr), Reg[rt(instr)]);
+}
+
+static void
+DoSh(int instr)
+{
+    SStore(Reg[rs(instr)] + immed(instr), Reg[rt(instr)]);
+}
+
+static void
+DoSwl(int instr)
+{
+    fprintf(stderr, "sorry, no SWL yet.\n");
+    Unimplemented(instr);
+}
+
+static void
+DoSw(int instr)
+{
+    Store(Reg[rs(instr)] + immed(instr), Reg[rt(instr)]);
+}
+
+static void
+DoSwr(int instr)
+{
+    fprintf(stderr, "sorry, no SWR yet.\n");
+    Unimplemented(instr);
+}
+
+static void
+DoCoprocessor(int instr)
+{
+    fprintf(stderr, "Sorry, no coprocessors.\n");
+    exit(2);
+}
+
+// Dispatch tables, indexed like the descriptor tables in `decode.h`.
+// Empty slots stay null and fall back to `Unimplemented`.
+
+static const InstrHandler SPECIAL_HANDLERS[64] = {
+    [I_SLL]     = DoSll,
+    [I_SRL]     = DoSrl,
+    [I_SRA]     = DoSra,
+    [I_SLLV]    = DoSllv,
+    [I_SRLV]    = DoSrlv,
+    [I_SRAV]    = DoSrav,
+    [I_JR]      = DoJr,
+    [I_JALR]    = DoJalr,
+    [I_SYSCALL] = DoSyscall,
+    [I_BREAK]   = DoBreak,
+    [I_MFHI]    = DoMfhi,
+    [I_MTHI]    = DoMthi,
+    [I_MFLO]    = DoMflo,
+    [I_MTLO]    = DoMtlo,
+    [I_MULT]    = DoMult,
+    [I_MULTU]   = DoMultu,
+    [I_DIV]     = DoDiv,
+    [I_DIVU]    = DoDivu,
+    [I_ADD]     = DoAdd,
+    [I_ADDU]    = DoAdd,
+    [I_SUB]     = DoSub,
+    [I_SUBU]    = DoSub,
+    [I_AND]     = DoAnd,
+    [I_OR]      = DoOr,
+    [I_XOR]     = DoXor,
+    [I_NOR]     = DoNor,
+    [I_SLT]     = DoSlt,
+    [I_SLTU]    = DoSltu
+};
+
+static const InstrHandler BCOND_HANDLERS[32] = {
+    [I_BLTZ]   = DoBltz,
+    [I_BGEZ]   = DoBgez,
+    [I_BLTZAL] = DoBltzal,
+    [I_BGEZAL] = DoBgezal
+};
+
+static void
+DoSpecial(int instr)
+{
+    InstrHandler h = SPECIAL_HANDLERS[instr & 0x3F];
+
+    if (h != NULL)
+        h(instr);
+    else
+        Unimplemented(instr);
+}
+
+static void
+DoBcond(int instr)
+{
+    InstrHandler h = BCOND_HANDLERS[rt(instr)];
+
+    if (h != NULL)
+        h(instr);
+    else
+        Unimplemented(instr);
+}
+
+static const InstrHandler NORMAL_HANDLERS[64] = {
+    [I_SPECIAL] = DoSpecial,
+    [I_BCOND]   = DoBcond,
+    [I_J]       = DoJ,
+    [I_JAL]     = DoJal,
+    [I_BEQ]     = DoBeq,
+    [I_BNE]     = DoBne,
+    [I_BLEZ]    = DoBlez,
+    [I_BGTZ]    = DoBgtz,
+    [I_ADDI]    = DoAddi,
+    [I_ADDIU]   = DoAddi,
+    [I_SLTI]    = DoSlti,
+    [I_SLTIU]   = DoSltiu,
+    [I_ANDI]    = DoAndi,
+    [I_ORI]     = DoOri,
+    [I_XORI]    = DoXori,
+    [I_LUI]     = DoLui,
+    [I_COP0]    = DoCoprocessor,
+    [I_COP1]    = DoCoprocessor,
+    [I_COP2]    = DoCoprocessor,
+    [I_COP3]    = DoCoprocessor,
+    [I_LB]      = DoLb,
+    [I_LH]      = DoLh,
+    [I_LWL]     = DoLwl,
+    [I_LW]      = DoLw,
+    [I_LBU]     = DoLbu,
+    [I_LHU]     = DoLhu,
+    [I_LWR]     = DoLwr,
+    [I_SB]      = DoSb,
+    [I_SH]      = DoSh,
+    [I_SWL]     = DoSwl,
+    [I_SW]      = DoSw,
+    [I_SWR]     = DoSwr,
+    [I_LWC0]    = DoCoprocessor,
+    [I_LWC1]    = DoCoprocessor,
+    [I_LWC2]    = DoCoprocessor,
+    [I_LWC3]    = DoCoprocessor,
+    [I_SWC0]    = DoCoprocessor,
+    [I_SWC1]    = DoCoprocessor,
+    [I_SWC2]    = DoCoprocessor,
+    [I_SWC3]    = DoCoprocessor
+};
+
 void
 RunProgram(unsigned startpc, int argc, char * argv[])
 {
     int aci, ai;
-    int instr, pc, xpc, npc;
+    int instr;
     int i; // Temporary for local stuff.
     int icount;
 
@@ -174,291 +701,11 @@ RunProgram(unsigned startpc, int argc, char * argv[])
         Reg[0] = 0; // Force r0 = 0.
 
         if (instr != 0) { // Eliminate no-ops.
-            switch (instr >> 26 & 0x0000003F) {
-                case I_SPECIAL: {
-                    switch (instr & 0x0000003F) {
-                        case I_SLL:
-                            Reg[rd(instr)] = Reg[rt(instr)] << shamt(instr);
-                            break;
-                        case I_SRL:
-                            Reg[rd(instr)] = (unsigned) Reg[rt(instr)]
-                              >> shamt(instr);
-                            break;
-                        case I_SRA:
-                            Reg[rd(instr)] = Reg[rt(instr)] >> shamt(instr);
-                            break;
-                        case I_SLLV:
-                            Reg[rd(instr)] = Reg[rt(instr)]
-                                << Reg[rs(instr)];
-                            break;
-                        case I_SRLV:
-                            Reg[rd(instr)] =
-                              (unsigned) Reg[rt(instr)] >> Reg[rs(instr)];
-                            break;
-                        case I_SRAV:
-                            Reg[rd(instr)] = Reg[rt(instr)]
-                              >> Reg[rs(instr)];
-                            break;
-                        case I_JR:
-                            npc = Reg[rs(instr)];
-                            break;
-                        case I_JALR:
-                            npc = Reg[rs(instr)];
-                            Reg[rd(instr)] = xpc + 8;
-                            break;
-
-                        case I_SYSCALL:
-                            SystemTrap();
-                            break;
-                        case I_BREAK:
-                            SystemBreak();
-                            break;
-
-                        case I_MFHI:
-                            Reg[rd(instr)] = HI;
-                            break;
-                        case I_MTHI:
-                            HI = Reg[rs(instr)];
-                            break;
-                        case I_MFLO:
-                            Reg[rd(instr)] = LO;
-                            break;
-                        case I_MTLO:
-                            LO = Reg[rs(instr)];
-                            break;
-
-                        case I_MULT: {
-                            int t1, t2;
-                            int t1l, t1h, t2l, t2h;
-                            int neg;
-
-                            t1  = Reg[rs(instr)];
-                            t2  = Reg[rt(instr)];
-                            neg = 0;
-                            if (t1 < 0) {
-                                t1  = -t1;
-                                neg = !neg;
-                            }
-                            if (t2 < 0) {
-                                t2  = -t2;
-                                neg = !neg;
-                            }
-                            LO  = t1 * t2;
-                            t1l = t1 & 0xFFFF;
-                            t1h = (t1 >> 16) & 0xFFFF;
-                            t2l = t2 & 0xFFFF;
-                            t2h = (t2 >> 16) & 0xFFFF;
-                            HI  = t1h * t2h
-                              + (t1h * t2l >> 16) + (t2h * t1l >> 16);
-                            if (neg) {
-                                LO = ~LO;
-                                HI = ~HI;
-                                LO = LO + 1;
-                                if (LO == 0)
-                                    HI = HI + 1;
-                            }
-                            break;
-                        }
-                        case I_MULTU: {
-                            int t1, t2;
-                            int t1l, t1h, t2l, t2h;
-
-                            t1  = Reg[rs(instr)];
-                            t2  = Reg[rt(instr)];
-                            t1l = t1 & 0xFFFF;
-                            t1h = t1 >> 16 & 0xFFFF;
-                            t2l = t2 & 0xFFFF;
-                            t2h = t2 >> 16 & 0xFFFF;
-                            LO  = t1 * t2;
-                            HI  = t1h * t2h
-                              + (t1h * t2l >> 16) + (t2h * t1l >> 16);
-                            break;
-                        }
-                        case I_DIV:
-                            LO = Reg[rs(instr)] / Reg[rt(instr)];
-                            HI = Reg[rs(instr)] % Reg[rt(instr)];
-                            break;
-                        case I_DIVU:
-                            LO = (unsigned) Reg[rs(instr)]
-                              / (unsigned) Reg[rt(instr)];
-                            HI = (unsigned) Reg[rs(instr)]
-                              % (unsigned) Reg[rt(instr)];
-                            break;
-
-                        case I_ADD:
-                        case I_ADDU:
-                            Reg[rd(instr)] = Reg[rs(instr)] + Reg[rt(instr)];
-                            break;
-                        case I_SUB:
-                        case I_SUBU:
-                            Reg[rd(instr)] = Reg[rs(instr)] - Reg[rt(instr)];
-                            break;
-                        case I_AND:
-                            Reg[rd(instr)] = Reg[rs(instr)] & Reg[rt(instr)];
-                            break;
-                        case I_OR:
-                            Reg[rd(instr)] = Reg[rs(instr)] | Reg[rt(instr)];
-                            break;
-                        case I_XOR:
-                            Reg[rd(instr)] = Reg[rs(instr)] ^ Reg[rt(instr)];
-                            break;
-                        case I_NOR:
-                            Reg[rd(instr)] = ~(Reg[rs(instr)]
-                              | Reg[rt(instr)]);
-                            break;
-
-                        case I_SLT:
-                            Reg[rd(instr)] = Reg[rs(instr)] < Reg[rt(instr)];
-                            break;
-                        case I_SLTU:
-                            Reg[rd(instr)] = (unsigned) Reg[rs(instr)]
-                              < (unsigned) Reg[rt(instr)];
-                            break;
-                        default:
-                            Unimplemented();
-                            break;
-                    }
-                } break;
-
-                case I_BCOND: {
-                    switch (rt(instr)) { // This field encodes the op.
-                        case I_BLTZ:
-                            if (Reg[rs(instr)] < 0)
-                                npc = xpc + 4 + (immed(instr) << 2);
-                            break;
-                        case I_BGEZ:
-                            if (Reg[rs(instr)] >= 0)
-                                npc = xpc + 4 + (immed(instr) << 2);
-                            break;
-
-                        case I_BLTZAL:
-                            Reg[31] = xpc + 8;
-                            if (Reg[rs(instr)] < 0)
-                                npc = xpc + 4 + (immed(instr) << 2);
-                            break;
-                        case I_BGEZAL:
-                            Reg[31] = xpc + 8;
-                            if (Reg[rs(instr)] >= 0)
-                                npc = xpc + 4 + (immed(instr) << 2);
-                            break;
-                        default:
-                            Unimplemented();
-                            break;
-                    }
-                } break;
-
-                case I_J:
-                    npc = (xpc & 0xF0000000) | (instr & 0x03FFFFFF) << 2;
-                    break;
-                case I_JAL:
-                    Reg[31] = xpc + 8;
-                    npc     = (xpc & 0xF0000000) | (instr & 0x03FFFFFF) << 2;
-                    break;
-                case I_BEQ:
-                    if (Reg[rs(instr)] == Reg[rt(instr)])
-                        npc = xpc + 4 + (immed(instr) << 2);
-                    break;
-                case I_BNE:
-                    if (Reg[rs(instr)] != Reg[rt(instr)])
-                        npc = xpc + 4 + (immed(instr) << 2);
-                    break;
-                case I_BLEZ:
-                    if (Reg[rs(instr)] <= 0)
-                        npc = xpc + 4 + (immed(instr) << 2);
-                    break;
-                case I_BGTZ:
-                    if (Reg[rs(instr)] > 0)
-                        npc = xpc + 4 + (immed(instr) << 2);
-                    break;
-                case I_ADDI:
-                    Reg[rt(instr)] = Reg[rs(instr)] + immed(instr);
-                    break;
-                case I_ADDIU:
-                    Reg[rt(instr)] = Reg[rs(instr)] + immed(instr);
-                    break;
-                case I_SLTI:
-                    Reg[rt(instr)] = Reg[rs(instr)] < immed(instr);
-                    break;
-                case I_SLTIU:
-                    Reg[rt(instr)] = (unsigned) Reg[rs(instr)]
-                      < (unsigned) immed(instr);
-                    break;
-                case I_ANDI:
-                    Reg[rt(instr)] = Reg[rs(instr)] & immed(instr);
-                    break;
-                case I_ORI:
-                    Reg[rt(instr)] = Reg[rs(instr)] | immed(instr);
-                    break;
-                case I_XORI:
-                    Reg[rt(instr)] = Reg[rs(instr)] ^ immed(instr);
-                    break;
-                case I_LUI:
-                    Reg[rt(instr)] = instr << 16;
-                    break;
-
-                case I_LB:
-                    Reg[rt(instr)] = CFetch(Reg[rs(instr)] + immed(instr));
-                    break;
-                case I_LH:
-                    Reg[rt(instr)] = SFetch(Reg[rs(instr)] + immed(instr));
-                    break;
-                case I_LWL:
-                    i = Reg[rs(instr)] + immed(instr);
-                    Reg[rt(instr)] &= -1 >> 8 * (-i & 0x03);
-                    Reg[rt(instr)] |= Fetch(i & 0xFFFFFFFC)
-                        << 8 * (i & 0x03);
-                    break;
-                case I_LW:
-                    Reg[rt(instr)] = Fetch(Reg[rs(instr)] + immed(instr));
-                    break;
-                case I_LBU:
-                    Reg[rt(instr)] = UCFetch(Reg[rs(instr)] + immed(instr));
-                    break;
-                case I_LHU:
-                    Reg[rt(instr)] = USFetch(Reg[rs(instr)] + immed(instr));
-                    break;
-                case I_LWR:
-                    i = Reg[rs(instr)] + immed(instr);
-                    Reg[rt(instr)] &= -1 << 8 * (i & 0x03);
-                    if ((i & 0x03) == 0)
-                        Reg[rt(instr)] = 0;
-                    Reg[rt(instr)] |=
-                      Fetch(i & 0xFFFFFFFC) >> 8 * (-i & 0x03);
-                    break;
-
-                case I_SB:
-                    CStore(Reg[rs(instr)] + immed(instr), Reg[rt(instr)]);
-                    break;
-                case I_SH:
-                    SStore(Reg[rs(instr)] + immed(instr), Reg[rt(instr)]);
-                    break;
-                case I_SWL:
-                    fprintf(stderr, "sorry, no SWL yet.\n");
-                    Unimplemented();
-                    break;
-                case I_SW:
-                    Store(Reg[rs(instr)] + immed(instr), Reg[rt(instr)]);
-                    break;
-
-                case I_SWR:
-                    fprintf(stderr, "sorry, no SWR yet.\n");
-                    Unimplemented();
-                    break;
-
-                case I_LWC0: case I_LWC1:
-                case I_LWC2: case I_LWC3:
-                case I_SWC0: case I_SWC1:
-                case I_SWC2: case I_SWC3:
-                case I_COP0: case I_COP1:
-                case I_COP2: case I_COP3:
-                    fprintf(stderr, "Sorry, no coprocessors.\n");
-                    exit(2);
-                    break;
-
-                default:
-                    Unimplemented();
-                    break;
-            }
+            InstrHandler h = NORMAL_HANDLERS[instr >> 26 & 0x3F];
+            if (h != NULL)
+                h(instr);
+            else
+                Unimplemented(instr);
         }
 
         #ifdef DEBUG
@@ -1,4 +1,4 @@
-/// A FUSE client the Nachos file system.
+/// A FUSE client for the Nachos file system.
 ///
 /// FUSE (Filesystem in Userspace) is a mechanism for integrating custom
 /// file systems from userspace in POSIX operating systems.  This program
@@ -6,15 +6,29 @@
 /// access it using all the standard tools (e.g. commands like `ls` and
 /// `cat`, or graphical file managers).
 ///
-/// For now, only read capabilities are implemented in the FUSE client.
-/// This means that it is yet not possible to create a new file or modify
-/// an existing one through the standard tools.
+/// The client used to spawn a whole `nachos` simulation for every FUSE
+/// operation (`-ls` for a directory listing, `-pr` for each read), so a
+/// single `cp` out of the mount booted the simulator dozens of times and
+/// re-read the same metadata sectors on every call.  It now works on the
+/// `DISK` image directly: the image is loaded into memory once at mount
+/// time (that copy is the sector cache), reads and writes are satisfied
+/// in full extents from it, and path lookups are remembered so repeated
+/// operations on the same file do not re-walk the directory tree.  Dirty
+/// sectors are written back in batched, contiguous runs when the kernel
+/// flushes a file and at unmount.
 ///
-/// Another limitation is that the `DISK` file, which contains the whole
-/// simulated disk content, must be available in the same directory where
-/// the FUSE client is executed.  It is recommended to set up a symbolic
-/// link to the original in the `filesys` directory.  If you launch the
-/// client with `make mount`, the link gets created automatically.
+/// The on-disk structures are mirrored from the kernel sources (see the
+/// comments next to each one); if those layouts change, this file must
+/// follow.  A committed-but-unapplied metadata journal batch is replayed
+/// at mount, just as `Journal::Recover` would, so the image looks the
+/// same here as it would to the simulator.  Do NOT mount an image while
+/// a `nachos` process is using it -- neither side would see the other's
+/// writes.
+///
+/// The `DISK` file must be available in the same directory where the
+/// FUSE client is executed.  It is recommended to set up a symbolic link
+/// to the original in the `filesys` directory.  If you launch the client
+/// with `make mount`, the link gets created automatically.
 ///
 /// Copyright (c) 2018 Docentes de la Universidad Nacional de Rosario.
 /// All rights reserved.  See `copyright.h` for copyright notice and
@@ -25,40 +39,632 @@
 #include <fuse.h>
 #include <unistd.h>
 
+#include <fcntl.h>
+#include <stdint.h>
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
 
+#ifndef DISK_FILE
+# error "The `DISK_FILE` macro is not defined.  Compile with `make`."
+#endif
 
-#ifndef NACHOS
-# error "The `NACHOS` macro is not defined.  Compile with `make`."
+/// Mirrored from `machine/disk.hh` and `machine/disk.cc`.  The sector
+/// size must match the one the image was formatted with (the default,
+/// unless the build overrode `SECTOR_SIZE_BYTES`).
+#ifndef SECTOR_SIZE
+# define SECTOR_SIZE 128
 #endif
-#define NACHOS_LS            NACHOS " -ls"
-#define NACHOS_PR            NACHOS " -pr"
-#define MAX_PATH_LENGTH      1024
-#define MAX_NACHOS_PR_LENGTH (sizeof NACHOS_PR + MAX_PATH_LENGTH + 2)
+#define DISK_MAGIC 0x456789ABu
+#define MAGIC_SIZE 4
+
+/// Mirrored from `filesys/raw_file_header.hh`.
+#define NUM_DIRECT      ((SECTOR_SIZE - 4 * 4) / 4)
+#define PTRS_PER_SECTOR (SECTOR_SIZE / 4)
+#define MAX_SECTORS     (NUM_DIRECT + PTRS_PER_SECTOR * PTRS_PER_SECTOR)
+#define NOT_ASSIGNED    0xFFFFFFFFu
+
+struct raw_file_header {
+    uint32_t unref_sectors; /* First-level indirection table, or hole. */
+    uint32_t link_count;    /* Directory entries pointing here. */
+    uint32_t num_bytes;
+    uint32_t num_sectors;
+    uint32_t data_sectors[NUM_DIRECT];
+};
+
+/// Mirrored from `filesys/directory_entry.hh` and the serialization in
+/// `Directory::FetchFrom`/`WriteBack`: the table size lives at offset 0
+/// of the directory file and the entry table at offset 8.  Entry layout
+/// (two one-byte bools, two bytes of padding, then the sector) matches
+/// what the C++ compiler produces for `DirectoryEntry`.
+#define FILE_NAME_MAX_LEN 40
+#define DIR_TABLE_OFFSET  8
+
+struct dir_entry {
+    uint8_t  in_use;
+    uint8_t  is_dir;
+    uint8_t  pad[2];
+    uint32_t sector;
+    char     name[FILE_NAME_MAX_LEN + 1];
+};
+
+/// Mirrored from `filesys/file_system.cc`.
+#define FREE_MAP_SECTOR  0
+#define DIRECTORY_SECTOR 1
+#define DIR_FILE_SIZE    ((unsigned) sizeof (struct dir_entry))
+
+/// Mirrored from `filesys/journal.hh` and `filesys/journal.cc`: the last
+/// `JOURNAL_SECTORS` sectors hold a header (magic, count, home sectors)
+/// followed by the logged sector images.
+#define JOURNAL_SECTORS 32
+#define JOURNAL_MAGIC   0x4A524E4Cu
+
+struct journal_header {
+    uint32_t magic;
+    uint32_t count;
+    uint32_t sectors[(SECTOR_SIZE - 2 * 4) / 4];
+};
+
+/// The whole image, read once at mount time.  Every lookup after that is
+/// a memory access; the image doubles as a write-back sector cache, with
+/// one dirty flag per sector.
+static uint8_t * image       = NULL;
+static uint8_t * dirty       = NULL;
+static unsigned  num_sectors = 0;
+static int       disk_fd     = -1;
+
+static uint8_t *
+sector_ptr(unsigned sector)
+{
+    return image + MAGIC_SIZE + (size_t) sector * SECTOR_SIZE;
+}
+
+static struct raw_file_header *
+header_ptr(unsigned sector)
+{
+    return (struct raw_file_header *) sector_ptr(sector);
+}
+
+static void
+mark_dirty(unsigned sector)
+{
+    dirty[sector] = 1;
+}
+
+/// Write every dirty sector back to the image file, merging contiguous
+/// runs into single `pwrite` calls, and make them durable.
+static int
+flush_image(void)
+{
+    unsigned i = 0, flushed = 0;
+
+    while (i < num_sectors) {
+        if (!dirty[i]) {
+            i++;
+            continue;
+        }
+        unsigned run = i;
+        while (run < num_sectors && dirty[run])
+            dirty[run++] = 0;
+        ssize_t n = pwrite(disk_fd, sector_ptr(i),
+            (size_t) (run - i) * SECTOR_SIZE,
+            MAGIC_SIZE + (off_t) i * SECTOR_SIZE);
+        if (n < 0) {
+            perror(DISK_FILE);
+            return -EIO;
+        }
+        flushed += run - i;
+        i        = run;
+    }
+    if (flushed > 0 && fsync(disk_fd) < 0)
+        return -EIO;
+    return 0;
+}
+
+/// Replay a committed metadata batch left by a previous `nachos` run, if
+/// any, and clear the journal -- the userspace twin of
+/// `Journal::Recover`.
+static void
+journal_replay(void)
+{
+    unsigned start = num_sectors - JOURNAL_SECTORS;
+    struct journal_header * jh = (struct journal_header *) sector_ptr(start);
+
+    if (jh->magic != JOURNAL_MAGIC || jh->count == 0)
+        return;
+    fprintf(stderr, "[mount] replaying %u journal sectors\n", jh->count);
+    for (unsigned i = 0; i < jh->count; i++) {
+        memcpy(sector_ptr(jh->sectors[i]), sector_ptr(start + 1 + i),
+          SECTOR_SIZE);
+        mark_dirty(jh->sectors[i]);
+    }
+    jh->count = 0;
+    mark_dirty(start);
+}
+
+static int
+load_image(void)
+{
+    disk_fd = open(DISK_FILE, O_RDWR);
+    if (disk_fd < 0) {
+        perror(DISK_FILE);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(disk_fd, &st) < 0 || st.st_size <= MAGIC_SIZE) {
+        fprintf(stderr, "%s: not a disk image\n", DISK_FILE);
+        return -1;
+    }
+    num_sectors = (st.st_size - MAGIC_SIZE) / SECTOR_SIZE;
+    image       = malloc(MAGIC_SIZE + (size_t) num_sectors * SECTOR_SIZE);
+    dirty       = calloc(num_sectors, 1);
+    if (image == NULL || dirty == NULL)
+        return -1;
+    if (pread(disk_fd, image, MAGIC_SIZE + (size_t) num_sectors * SECTOR_SIZE,
+      0) < 0) {
+        perror(DISK_FILE);
+        return -1;
+    }
+    if (*(uint32_t *) image != DISK_MAGIC) {
+        fprintf(stderr, "%s: bad magic number\n", DISK_FILE);
+        return -1;
+    }
+    journal_replay();
+    return 0;
+}
+
+/// Free map access.  The free map is itself a file, with its header at
+/// `FREE_MAP_SECTOR`; bit `i` of the bitmap tells whether sector `i` is
+/// in use (cf. `lib/bitmap.cc` for the word layout).
+
+static unsigned map_sector(const struct raw_file_header * h, unsigned n);
+
+static uint32_t *
+freemap_word(unsigned bit)
+{
+    unsigned offset = bit / 32 * 4;
+    unsigned sector = map_sector(header_ptr(FREE_MAP_SECTOR),
+        offset / SECTOR_SIZE);
+
+    if (sector == NOT_ASSIGNED)
+        return NULL; /* The free map is never sparse; corrupt image. */
+    return (uint32_t *) (sector_ptr(sector) + offset % SECTOR_SIZE);
+}
+
+static void
+freemap_touch(unsigned bit)
+{
+    mark_dirty(map_sector(header_ptr(FREE_MAP_SECTOR),
+      bit / 32 * 4 / SECTOR_SIZE));
+}
+
+/// Find a free sector, mark it used and return it; `NOT_ASSIGNED` if the
+/// disk is full.
+static unsigned
+alloc_sector(void)
+{
+    for (unsigned bit = 0; bit < num_sectors; bit++) {
+        uint32_t * word = freemap_word(bit);
+        if (word == NULL)
+            return NOT_ASSIGNED;
+        if (!(*word & 1u << bit % 32)) {
+            *word |= 1u << bit % 32;
+            freemap_touch(bit);
+            return bit;
+        }
+    }
+    return NOT_ASSIGNED;
+}
+
+static void
+free_sector(unsigned sector)
+{
+    uint32_t * word = freemap_word(sector);
+
+    if (word != NULL) {
+        *word &= ~(1u << sector % 32);
+        freemap_touch(sector);
+    }
+}
+
+/// Translate a logical data-sector number into a disk sector, following
+/// the two levels of indirection (cf. `FileHeader::ByteToSector`).
+/// Holes come back as `NOT_ASSIGNED` and read as zeroes.
+static unsigned
+map_sector(const struct raw_file_header * h, unsigned n)
+{
+    if (n < NUM_DIRECT)
+        return h->data_sectors[n];
+
+    n -= NUM_DIRECT;
+    if (h->unref_sectors == NOT_ASSIGNED)
+        return NOT_ASSIGNED;
+    uint32_t * lv1 = (uint32_t *) sector_ptr(h->unref_sectors);
+    if (lv1[n / PTRS_PER_SECTOR] == NOT_ASSIGNED)
+        return NOT_ASSIGNED;
+    uint32_t * lv2 = (uint32_t *) sector_ptr(lv1[n / PTRS_PER_SECTOR]);
+    return lv2[n % PTRS_PER_SECTOR];
+}
+
+/// Allocate a fresh, zeroed sector and hang it off the header as logical
+/// sector `n`, building the indirection tables on the way (cf.
+/// `FileHeader::AllocSector`).  Returns the new sector or `NOT_ASSIGNED`.
+static unsigned
+materialize_sector(unsigned hdr_sector, unsigned n)
+{
+    struct raw_file_header * h = header_ptr(hdr_sector);
+    unsigned sector = alloc_sector();
+
+    if (sector == NOT_ASSIGNED)
+        return NOT_ASSIGNED;
+    memset(sector_ptr(sector), 0, SECTOR_SIZE);
+    mark_dirty(sector);
+
+    if (n < NUM_DIRECT) {
+        h->data_sectors[n] = sector;
+        mark_dirty(hdr_sector);
+        return sector;
+    }
+
+    n -= NUM_DIRECT;
+    if (h->unref_sectors == NOT_ASSIGNED) {
+        unsigned lv1s = alloc_sector();
+        if (lv1s == NOT_ASSIGNED) {
+            free_sector(sector);
+            return NOT_ASSIGNED;
+        }
+        memset(sector_ptr(lv1s), 0xFF, SECTOR_SIZE);
+        h->unref_sectors = lv1s;
+        mark_dirty(hdr_sector);
+    }
+    uint32_t * lv1 = (uint32_t *) sector_ptr(h->unref_sectors);
+    if (lv1[n / PTRS_PER_SECTOR] == NOT_ASSIGNED) {
+        unsigned lv2s = alloc_sector();
+        if (lv2s == NOT_ASSIGNED) {
+            free_sector(sector);
+            return NOT_ASSIGNED;
+        }
+        memset(sector_ptr(lv2s), 0xFF, SECTOR_SIZE);
+        lv1[n / PTRS_PER_SECTOR] = lv2s;
+        mark_dirty(h->unref_sectors);
+    }
+    uint32_t * lv2 = (uint32_t *) sector_ptr(lv1[n / PTRS_PER_SECTOR]);
+    lv2[n % PTRS_PER_SECTOR] = sector;
+    mark_dirty(lv1[n / PTRS_PER_SECTOR]);
+    return sector;
+}
+
+/// Read an extent out of the in-memory image.  The whole request is
+/// served from here -- no per-sector system calls, no simulator runs.
+static int
+file_read(unsigned hdr_sector, char * buffer, size_t size, off_t offset)
+{
+    const struct raw_file_header * h = header_ptr(hdr_sector);
+    /// Like `OpenFile::ReadAt`, reads are bounded by the allocated
+    /// sectors, not `num_bytes`; `getattr` reports `num_bytes` so normal
+    /// tools never ask past it.
+    off_t length = (off_t) h->num_sectors * SECTOR_SIZE;
+
+    if (offset >= length)
+        return 0;
+    if (offset + (off_t) size > length)
+        size = length - offset;
+
+    size_t done = 0;
+    while (done < size) {
+        unsigned n      = (offset + done) / SECTOR_SIZE;
+        unsigned within = (offset + done) % SECTOR_SIZE;
+        size_t   chunk  = SECTOR_SIZE - within;
+        if (chunk > size - done)
+            chunk = size - done;
+        unsigned sector = map_sector(h, n);
+        if (sector == NOT_ASSIGNED) /* A hole reads as zeroes. */
+            memset(buffer + done, 0, chunk);
+        else
+            memcpy(buffer + done, sector_ptr(sector) + within, chunk);
+        done += chunk;
+    }
+    return done;
+}
+
+/// Write an extent into the image, materializing holes and extending the
+/// file as needed.  Sectors are only marked dirty here; they go back to
+/// the image file in batches on flush.
+static int
+file_write(unsigned hdr_sector, const char * buffer, size_t size,
+  off_t offset)
+{
+    struct raw_file_header * h = header_ptr(hdr_sector);
+    off_t end = offset + size;
+
+    if ((end + SECTOR_SIZE - 1) / SECTOR_SIZE > MAX_SECTORS)
+        return -EFBIG;
+    if (end > h->num_bytes) {
+        h->num_bytes = end;
+        if ((unsigned) ((end + SECTOR_SIZE - 1) / SECTOR_SIZE)
+          > h->num_sectors)
+            h->num_sectors = (end + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        mark_dirty(hdr_sector);
+    }
+
+    size_t done = 0;
+    while (done < size) {
+        unsigned n      = (offset + done) / SECTOR_SIZE;
+        unsigned within = (offset + done) % SECTOR_SIZE;
+        size_t   chunk  = SECTOR_SIZE - within;
+        if (chunk > size - done)
+            chunk = size - done;
+        unsigned sector = map_sector(h, n);
+        if (sector == NOT_ASSIGNED) {
+            sector = materialize_sector(hdr_sector, n);
+            if (sector == NOT_ASSIGNED)
+                return -ENOSPC;
+        }
+        memcpy(sector_ptr(sector) + within, buffer + done, chunk);
+        mark_dirty(sector);
+        done += chunk;
+    }
+    return done;
+}
+
+/// Drop every data and indirection sector of a file and reset its
+/// header; used by truncate-to-zero and by the last unlink.
+static void
+file_free_sectors(unsigned hdr_sector)
+{
+    struct raw_file_header * h = header_ptr(hdr_sector);
+
+    for (unsigned i = 0; i < NUM_DIRECT; i++) {
+        if (h->data_sectors[i] != NOT_ASSIGNED) {
+            free_sector(h->data_sectors[i]);
+            h->data_sectors[i] = NOT_ASSIGNED;
+        }
+    }
+    if (h->unref_sectors != NOT_ASSIGNED) {
+        uint32_t * lv1 = (uint32_t *) sector_ptr(h->unref_sectors);
+        for (unsigned i = 0; i < PTRS_PER_SECTOR; i++) {
+            if (lv1[i] == NOT_ASSIGNED)
+                continue;
+            uint32_t * lv2 = (uint32_t *) sector_ptr(lv1[i]);
+            for (unsigned j = 0; j < PTRS_PER_SECTOR; j++)
+                if (lv2[j] != NOT_ASSIGNED)
+                    free_sector(lv2[j]);
+            free_sector(lv1[i]);
+        }
+        free_sector(h->unref_sectors);
+        h->unref_sectors = NOT_ASSIGNED;
+    }
+    h->num_bytes   = 0;
+    h->num_sectors = 0;
+    mark_dirty(hdr_sector);
+}
+
+/// Directory access.  A directory is a file whose contents are the table
+/// size (at offset 0) followed by the entry table (at offset
+/// `DIR_TABLE_OFFSET`); a table size of 0 is a freshly created,
+/// hole-backed directory, i.e. an empty one.
+
+static unsigned
+dir_table_size(unsigned dir_sector)
+{
+    uint32_t table_size = 0;
+
+    file_read(dir_sector, (char *) &table_size, sizeof table_size, 0);
+    return table_size;
+}
+
+static int
+dir_entry_at(unsigned dir_sector, unsigned index, struct dir_entry * entry)
+{
+    return file_read(dir_sector, (char *) entry, sizeof *entry,
+             DIR_TABLE_OFFSET + (off_t) index * sizeof *entry)
+           == sizeof *entry;
+}
+
+/// Find `name` in the directory whose header is at `dir_sector`; fills
+/// `entry` and returns the entry index, or -1.
+static int
+dir_find(unsigned dir_sector, const char * name, struct dir_entry * entry)
+{
+    unsigned table_size = dir_table_size(dir_sector);
+
+    for (unsigned i = 0; i < table_size; i++) {
+        if (!dir_entry_at(dir_sector, i, entry))
+            break;
+        if (entry->in_use
+          && !strncmp(entry->name, name, FILE_NAME_MAX_LEN))
+            return i;
+    }
+    return -1;
+}
+
+/// Add an entry, reusing a free slot or appending one (growing the
+/// directory file, which the write path handles like any other file).
+static int
+dir_add(unsigned dir_sector, const char * name, unsigned sector,
+  int is_dir)
+{
+    uint32_t table_size = dir_table_size(dir_sector);
+    struct dir_entry entry;
+    unsigned slot = table_size;
+
+    for (unsigned i = 0; i < table_size; i++) {
+        if (!dir_entry_at(dir_sector, i, &entry))
+            break;
+        if (!entry.in_use && slot == table_size)
+            slot = i;
+    }
+
+    memset(&entry, 0, sizeof entry);
+    entry.in_use = 1;
+    entry.is_dir = is_dir;
+    entry.sector = sector;
+    strncpy(entry.name, name, FILE_NAME_MAX_LEN);
+    if (file_write(dir_sector, (const char *) &entry, sizeof entry,
+      DIR_TABLE_OFFSET + (off_t) slot * sizeof entry) < 0)
+        return -ENOSPC;
+    if (slot == table_size) {
+        table_size++;
+        if (file_write(dir_sector, (const char *) &table_size,
+          sizeof table_size, 0) < 0)
+            return -ENOSPC;
+    }
+    return 0;
+}
+
+static int
+dir_remove(unsigned dir_sector, const char * name)
+{
+    struct dir_entry entry;
+    int index = dir_find(dir_sector, name, &entry);
+
+    if (index < 0)
+        return -ENOENT;
+    entry.in_use = 0;
+    file_write(dir_sector, (const char *) &entry, sizeof entry,
+      DIR_TABLE_OFFSET + (off_t) index * sizeof entry);
+    return 0;
+}
+
+/// Path lookup, with a small cache keyed by the whole path so repeated
+/// operations on the same file (the common FUSE pattern: getattr, open,
+/// then many reads) resolve without re-walking the directory tree.  Any
+/// namespace change drops the cache whole; it is tiny and refills on the
+/// next lookup.
+
+#define LOOKUP_CACHE_SIZE 64
+#define MAX_PATH_LENGTH   256
+
+struct lookup_entry {
+    char     path[MAX_PATH_LENGTH];
+    unsigned sector;
+    uint8_t  is_dir;
+    uint8_t  valid;
+};
+
+static struct lookup_entry lookup_cache[LOOKUP_CACHE_SIZE];
+static unsigned lookup_victim = 0;
+
+static void
+lookup_cache_drop(void)
+{
+    for (unsigned i = 0; i < LOOKUP_CACHE_SIZE; i++)
+        lookup_cache[i].valid = 0;
+}
+
+static void
+lookup_cache_add(const char * path, unsigned sector, int is_dir)
+{
+    struct lookup_entry * e = &lookup_cache[lookup_victim];
+
+    if (strlen(path) >= MAX_PATH_LENGTH)
+        return;
+    lookup_victim = (lookup_victim + 1) % LOOKUP_CACHE_SIZE;
+    strcpy(e->path, path);
+    e->sector = sector;
+    e->is_dir = is_dir;
+    e->valid  = 1;
+}
+
+/// Resolve `path` to the sector of its file header.  Returns 0 and fills
+/// `sector`/`is_dir`, or a negative errno.
+static int
+resolve(const char * path, unsigned * sector, int * is_dir)
+{
+    if (!strcmp(path, "/")) {
+        *sector = DIRECTORY_SECTOR;
+        *is_dir = 1;
+        return 0;
+    }
+
+    for (unsigned i = 0; i < LOOKUP_CACHE_SIZE; i++) {
+        if (lookup_cache[i].valid
+          && !strcmp(lookup_cache[i].path, path)) {
+            *sector = lookup_cache[i].sector;
+            *is_dir = lookup_cache[i].is_dir;
+            return 0;
+        }
+    }
+
+    char copy[MAX_PATH_LENGTH];
+    if (strlen(path) >= MAX_PATH_LENGTH)
+        return -ENAMETOOLONG;
+    strcpy(copy, path);
+
+    unsigned current = DIRECTORY_SECTOR;
+    int      dir     = 1;
+    for (char * component = strtok(copy, "/"); component != NULL;
+      component = strtok(NULL, "/")) {
+        struct dir_entry entry;
+        if (!dir)
+            return -ENOTDIR;
+        if (dir_find(current, component, &entry) < 0)
+            return -ENOENT;
+        current = entry.sector;
+        dir     = entry.is_dir;
+    }
+    lookup_cache_add(path, current, dir);
+    *sector = current;
+    *is_dir = dir;
+    return 0;
+}
+
+/// Split `path` into its parent directory (resolved to a header sector)
+/// and the final component, which must fit a directory entry.
+static int
+resolve_parent(const char * path, unsigned * parent, const char ** name)
+{
+    const char * slash = strrchr(path, '/');
+    int is_dir;
+
+    *name = slash + 1;
+    if (strlen(*name) == 0 || strlen(*name) > FILE_NAME_MAX_LEN)
+        return -ENAMETOOLONG;
+    if (slash == path) {
+        *parent = DIRECTORY_SECTOR;
+        return 0;
+    }
+
+    char copy[MAX_PATH_LENGTH];
+    if (slash - path >= MAX_PATH_LENGTH)
+        return -ENAMETOOLONG;
+    memcpy(copy, path, slash - path);
+    copy[slash - path] = '\0';
+    int rv = resolve(copy, parent, &is_dir);
+    if (rv < 0)
+        return rv;
+    return is_dir ? 0 : -ENOTDIR;
+}
+
+/// FUSE operations.  `open`/`create` stash the header sector in
+/// `fi->fh`, so the read and write paths skip the path lookup entirely.
 
 static int
 do_getattr(const char * path, struct stat * st)
 {
-    fprintf(stderr, "[getattr] %s\n", path);
+    unsigned sector;
+    int      is_dir;
+    int rv = resolve(path, &sector, &is_dir);
 
-    time_t t = time(NULL);
+    if (rv < 0)
+        return rv;
 
     st->st_uid   = getuid();
     st->st_gid   = getgid();
-    st->st_atime = t;
-    st->st_mtime = t;
-    if (strcmp(path, "/") == 0) {
+    st->st_atime = st->st_mtime = time(NULL);
+    if (is_dir) {
         st->st_mode  = S_IFDIR | 0755;
         st->st_nlink = 2;
     } else {
+        const struct raw_file_header * h = header_ptr(sector);
         st->st_mode  = S_IFREG | 0644;
-        st->st_nlink = 1;
-        st->st_size  = 1024;
+        st->st_nlink = h->link_count;
+        st->st_size  = h->num_bytes;
+        st->st_blocks = ((off_t) h->num_sectors * SECTOR_SIZE + 511) / 512;
     }
-
     return 0;
 }
 
@@ -66,98 +672,291 @@ static int
 do_readdir(const char * path, void * buffer, fuse_fill_dir_t fill,
   off_t offset, struct fuse_file_info * fi)
 {
-    fprintf(stderr, "[readdir] %s\n", path);
+    unsigned sector;
+    int      is_dir;
+    int rv = resolve(path, &sector, &is_dir);
+
+    if (rv < 0)
+        return rv;
+    if (!is_dir)
+        return -ENOTDIR;
 
     (*fill)(buffer, ".", NULL, 0);
     (*fill)(buffer, "..", NULL, 0);
 
-    if (strcmp(path, "/") != 0)
-        return 0;
-
-    // Invoke Nachos.
-    FILE * f = popen(NACHOS_LS, "r");
-    if (f == NULL) {
-        perror(NACHOS);
-        exit(1);
-    }
-
-    // Read lines.  Each line represents an entry in the directory, until an
-    // empty line is found.
-    char * line = NULL;
-    size_t n, capacity = 0;
-    while (n = getline(&line, &capacity, f)) {
-        if (n == 1 && line[0] == '\n') {
-            // Stop when the first empty line is found.  The directory
-            // listing ends here.  Only messages from the simulated machine
-            // follow.
+    unsigned table_size = dir_table_size(sector);
+    for (unsigned i = 0; i < table_size; i++) {
+        struct dir_entry entry;
+        if (!dir_entry_at(sector, i, &entry))
             break;
-        }
-        line[n - 1] = '\0'; // Replace the delimiter (newline) by a null
-                            // character.
-        fprintf(stderr, "    %s\n", line);
-        (*fill)(buffer, line, NULL, 0);
+        if (entry.in_use)
+            (*fill)(buffer, entry.name, NULL, 0);
     }
-
-    fclose(f);
-    if (line != NULL)
-        free(line);
     return 0;
 } /* do_readdir */
 
+static int
+do_open(const char * path, struct fuse_file_info * fi)
+{
+    unsigned sector;
+    int      is_dir;
+    int rv = resolve(path, &sector, &is_dir);
+
+    if (rv < 0)
+        return rv;
+    if (is_dir)
+        return -EISDIR;
+    fi->fh = sector;
+    return 0;
+}
+
 static int
 do_read(const char * path, char * buffer, size_t size, off_t offset,
   struct fuse_file_info * fi)
 {
-    fprintf(stderr, "[read] %s\n"
-      "    size: %zu, start: %zu\n",
-      path, size, offset);
-
-    // Prepare command string for invoking Nachos.
-    char command[MAX_NACHOS_PR_LENGTH];
-    int rv = snprintf(command, MAX_NACHOS_PR_LENGTH,
-        "%s %s", NACHOS_PR, path + 1);
-    // Discard leading slash in path, because Nachos does not like it.
-    if (rv < 0 || rv >= MAX_NACHOS_PR_LENGTH) {
-        perror(path);
-        return -1;
+    return file_read(fi->fh, buffer, size, offset);
+}
+
+static int
+do_write(const char * path, const char * buffer, size_t size, off_t offset,
+  struct fuse_file_info * fi)
+{
+    return file_write(fi->fh, buffer, size, offset);
+}
+
+/// Initialize a fresh header: no names yet beyond the one being created,
+/// every block a hole (cf. `FileHeader::Allocate`).
+static unsigned
+new_header(void)
+{
+    unsigned sector = alloc_sector();
+
+    if (sector == NOT_ASSIGNED)
+        return NOT_ASSIGNED;
+    struct raw_file_header * h = header_ptr(sector);
+    h->unref_sectors = NOT_ASSIGNED;
+    h->link_count    = 1;
+    h->num_bytes     = 0;
+    h->num_sectors   = 0;
+    for (unsigned i = 0; i < NUM_DIRECT; i++)
+        h->data_sectors[i] = NOT_ASSIGNED;
+    mark_dirty(sector);
+    return sector;
+}
+
+static int
+do_create(const char * path, mode_t mode, struct fuse_file_info * fi)
+{
+    unsigned parent;
+    const char * name;
+    struct dir_entry entry;
+    int rv = resolve_parent(path, &parent, &name);
+
+    if (rv < 0)
+        return rv;
+    if (dir_find(parent, name, &entry) >= 0)
+        return -EEXIST;
+
+    unsigned sector = new_header();
+    if (sector == NOT_ASSIGNED)
+        return -ENOSPC;
+    rv = dir_add(parent, name, sector, 0);
+    if (rv < 0) {
+        free_sector(sector);
+        return rv;
     }
+    lookup_cache_drop();
+    fi->fh = sector;
+    return 0;
+}
+
+static int
+do_mkdir(const char * path, mode_t mode)
+{
+    unsigned parent;
+    const char * name;
+    struct dir_entry entry;
+    int rv = resolve_parent(path, &parent, &name);
 
-    // Invoke Nachos.
-    FILE * f = popen(command, "r");
-    if (f == NULL) {
-        perror(NACHOS);
-        exit(1);
+    if (rv < 0)
+        return rv;
+    if (dir_find(parent, name, &entry) >= 0)
+        return -EEXIST;
+
+    unsigned sector = new_header();
+    if (sector == NOT_ASSIGNED)
+        return -ENOSPC;
+    /// Hole-backed, like `FileSystem::MakeDir`: a table size that reads
+    /// as 0 is an empty directory.
+    struct raw_file_header * h = header_ptr(sector);
+    h->num_bytes   = DIR_FILE_SIZE;
+    h->num_sectors = 1;
+    rv = dir_add(parent, name, sector, 1);
+    if (rv < 0) {
+        free_sector(sector);
+        return rv;
     }
+    lookup_cache_drop();
+    return 0;
+}
 
-    // Read lines.
-    char * line = NULL;
-    size_t i, n, capacity = 0;
-    for (i = 0; n = getline(&line, &capacity, f); i += n) {
-        if (n == 1 && line[0] == '\n') {
-            // Stop when the first empty line is found.  The directory
-            // listing ends here.  Only messages from the simulated machine
-            // follow.
-            break;
+static int
+do_truncate(const char * path, off_t size)
+{
+    unsigned sector;
+    int      is_dir;
+    int rv = resolve(path, &sector, &is_dir);
+
+    if (rv < 0)
+        return rv;
+    if (is_dir)
+        return -EISDIR;
+    if ((size + SECTOR_SIZE - 1) / SECTOR_SIZE > MAX_SECTORS)
+        return -EFBIG;
+
+    /// Shrinking frees everything and rewrites the head; holes make the
+    /// grow side free.  The common caller is `cp`, which truncates to 0.
+    struct raw_file_header * h = header_ptr(sector);
+    if ((off_t) h->num_bytes > size) {
+        size_t keep = size;
+        char * head = NULL;
+        if (keep > 0) {
+            head = malloc(keep);
+            if (head == NULL)
+                return -ENOMEM;
+            file_read(sector, head, keep, 0);
+        }
+        file_free_sectors(sector);
+        if (keep > 0) {
+            file_write(sector, head, keep, 0);
+            free(head);
         }
-        memcpy(buffer + i, line, n);
-        if (n > size)
-            break;
     }
+    h->num_bytes   = size;
+    h->num_sectors = (size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    mark_dirty(sector);
+    return 0;
+} /* do_truncate */
+
+static int
+do_unlink(const char * path)
+{
+    unsigned parent;
+    const char * name;
+    struct dir_entry entry;
+    int rv = resolve_parent(path, &parent, &name);
 
-    fclose(f);
-    if (line != NULL)
-        free(line);
-    return i;
-} /* do_read */
+    if (rv < 0)
+        return rv;
+    if (dir_find(parent, name, &entry) < 0)
+        return -ENOENT;
+    if (entry.is_dir)
+        return -EISDIR;
+
+    rv = dir_remove(parent, name);
+    if (rv < 0)
+        return rv;
+    struct raw_file_header * h = header_ptr(entry.sector);
+    if (--h->link_count == 0) { /* Last name: free the data too. */
+        file_free_sectors(entry.sector);
+        free_sector(entry.sector);
+    }
+    mark_dirty(entry.sector);
+    lookup_cache_drop();
+    return 0;
+}
+
+static int
+do_rmdir(const char * path)
+{
+    unsigned parent;
+    const char * name;
+    struct dir_entry entry;
+    int rv = resolve_parent(path, &parent, &name);
+
+    if (rv < 0)
+        return rv;
+    if (dir_find(parent, name, &entry) < 0)
+        return -ENOENT;
+    if (!entry.is_dir)
+        return -ENOTDIR;
+
+    unsigned table_size = dir_table_size(entry.sector);
+    for (unsigned i = 0; i < table_size; i++) {
+        struct dir_entry child;
+        if (dir_entry_at(entry.sector, i, &child) && child.in_use)
+            return -ENOTEMPTY;
+    }
+
+    rv = dir_remove(parent, name);
+    if (rv < 0)
+        return rv;
+    file_free_sectors(entry.sector);
+    free_sector(entry.sector);
+    lookup_cache_drop();
+    return 0;
+}
+
+static int
+do_flush(const char * path, struct fuse_file_info * fi)
+{
+    return flush_image();
+}
+
+static int
+do_fsync(const char * path, int datasync, struct fuse_file_info * fi)
+{
+    return flush_image();
+}
+
+/// Nachos keeps no timestamps; accept and ignore them so `cp -p` and
+/// `touch` do not fail the whole copy.
+static int
+do_utimens(const char * path, const struct timespec tv[2])
+{
+    return 0;
+}
+
+static void
+do_destroy(void * data)
+{
+    flush_image();
+    close(disk_fd);
+}
 
 static const struct fuse_operations OPERATIONS = {
-    .getattr = do_getattr,
-    .readdir = do_readdir,
-    .read    = do_read,
+    .getattr  = do_getattr,
+    .readdir  = do_readdir,
+    .open     = do_open,
+    .read     = do_read,
+    .write    = do_write,
+    .create   = do_create,
+    .mkdir    = do_mkdir,
+    .truncate = do_truncate,
+    .unlink   = do_unlink,
+    .rmdir    = do_rmdir,
+    .flush    = do_flush,
+    .fsync    = do_fsync,
+    .utimens  = do_utimens,
+    .destroy  = do_destroy,
 };
 
 int
 main(int argc, char * argv[])
 {
-    return fuse_main(argc, argv, &OPERATIONS, NULL);
+    if (sizeof (struct raw_file_header) != SECTOR_SIZE
+      || sizeof (struct dir_entry) != 52) {
+        fprintf(stderr, "mirrored kernel structures out of sync\n");
+        return 1;
+    }
+    if (load_image() < 0)
+        return 1;
+
+    /// Nothing here takes locks, so keep FUSE single-threaded (`-s`).
+    char ** args = malloc((argc + 2) * sizeof (char *));
+    for (int i = 0; i < argc; i++)
+        args[i] = argv[i];
+    args[argc]     = (char *) "-s";
+    args[argc + 1] = NULL;
+    return fuse_main(argc + 1, args, &OPERATIONS, NULL);
 }
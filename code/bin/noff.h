@@ -13,6 +13,15 @@
 #define NOFF_MAGIC 0xBADFAD // Magic number denoting Nachos object code
                             // file.
 
+#define NOFF_MAGIC2 0xBADFAE // Version 2 of the format: same header, but
+                             // every segment starts at a file offset that
+                             // is a multiple of `NOFF_SEGMENT_ALIGN`, so
+                             // loaders can bring pages in with aligned,
+                             // whole-page transfers.
+
+#define NOFF_SEGMENT_ALIGN 128 // Must match the machine page size
+                               // (`PAGE_SIZE` in `machine/mmu.hh`).
+
 typedef struct noffSegment {
     uint32_t virtualAddr; // Location of segment in virtual address space.
     uint32_t inFileAddr;  // Location of segment in this file.
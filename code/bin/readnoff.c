@@ -54,10 +54,14 @@ main(int argc, char *argv[])
         printf("%s: NOFF file\n"
                "    Magic: 0x%X\n",
                path, h.noffMagic);
+    else if (h.noffMagic == NOFF_MAGIC2)
+        printf("%s: NOFF file (version 2, page-aligned segments)\n"
+               "    Magic: 0x%X\n",
+               path, h.noffMagic);
     else
         printf("%s: not a NOFF file\n"
-               "    Magic: 0x%X (should be 0x%X)\n",
-               path, h.noffMagic, NOFF_MAGIC);
+               "    Magic: 0x%X (should be 0x%X or 0x%X)\n",
+               path, h.noffMagic, NOFF_MAGIC, NOFF_MAGIC2);
     PrintSegment(&h.code, "Code");
     PrintSegment(&h.initData, "Initialized data");
     PrintSegment(&h.uninitData, "Uninitialized data");
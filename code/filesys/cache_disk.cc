@@ -1,29 +1,15 @@
 #include "cache_disk.hh"
+#include "machine/statistics.hh"
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
 
 /////////////////////////////////Internal Staff/////////////////////////////////
 
-static unsigned sector_num = 0;
-static unsigned size       = 0;
-
-static bool
-aux_cmp_cache(SectorCache sec)
-{
-    return sec.sector == sector_num;
-}
-
-static void
-aux_get_sz(SectorCache sec)
-{
-    size++;
-}
-
-bool
-operator == (const SectorCache& x, const SectorCache& y)
-{
-    return x.sector == y.sector && x.modified == y.modified;
-}
+/// Hook de captura de trazas (cf. `disk_trace.cc`); no hace nada si la
+/// captura no esta activa.
+void
+DiskTraceRecord(char op, unsigned sector);
 
 /// Disk interrupt handler.  Need this to be a C routine, because C++ cannot
 /// handle pointers to member functions.
@@ -40,98 +26,366 @@ DiskRequestDone(void * arg)
 
 CacheDisk::CacheDisk(const char * name)
 {
-    disk      = new Disk(name, DiskRequestDone, this);
-    cache     = new List<SectorCache>;
-    semaphore = new Semaphore("cache disk sem", 0);
+    disk        = new Disk(name, DiskRequestDone, this, NUM_TRACKS);
+    semaphore   = new Semaphore("cache disk sem", 0);
+    numDirty    = 0;
+    pinnedCount = 0;
+    seqNext     = 0;
+    seqRun      = 0;
+    wSeqNext    = 0;
+    wSeqRun     = 0;
+
+    // All slots start empty, chained together so the LRU tail is always a
+    // valid eviction victim (an empty slot, until the cache fills up).
+    for (unsigned i = 0; i < CACHE_SIZE; i++) {
+        slots[i].valid    = false;
+        slots[i].modified = false;
+        slots[i].pinned   = false;
+        slots[i].prev     = (int) i - 1;
+        slots[i].next     = i + 1 < CACHE_SIZE ? (int) i + 1 : -1;
+    }
+    lruHead = 0;
+    lruTail = CACHE_SIZE - 1;
+
+    slotOf = new int [NUM_SECTORS];
+    for (unsigned i = 0; i < NUM_SECTORS; i++)
+        slotOf[i] = -1;
 }
 
 CacheDisk::~CacheDisk()
 {
     DEBUG('K', "Inside ~CacheDisk()\n");
-    while (!cache->IsEmpty()) {
-        CacheRemove();
-    }
-    delete cache;
+    FlushDirty();
     delete disk;
     delete semaphore;
+    delete [] slotOf;
     DEBUG('K', "Leaving ~CacheDisk()\n");
 }
 
+/// How many sequential reads in a row before read-ahead kicks in, and how
+/// many sectors it then fetches past the current one.
+static const unsigned SEQ_THRESHOLD = 3;
+static const unsigned READ_AHEAD    = 4;
+
+/// Contadores para los snapshots de estadisticas (ver `statistics.hh`).
+static Counter cacheHits("cacheDisk.hits");
+static Counter cacheMisses("cacheDisk.misses");
+static Counter cacheFlushed("cacheDisk.flushed");
+static Counter cacheFlushSweeps("cacheDisk.flushSweeps");
+
 void
 CacheDisk::ReadSector(int sectorNumber, char * data)
 {
     ASSERT(data != nullptr);
-    SectorCache * sec = CacheAdd(sectorNumber);
+    DiskTraceRecord('R', sectorNumber);
+
+    // Deteccion de lecturas secuenciales, antes de insertar: un stream
+    // largo se trata como barrido y sus sectores quedan cerca de la cola
+    // LRU, para que un `cat` grande no desaloje el resto de la cache.
+    if ((unsigned) sectorNumber == seqNext)
+        seqRun++;
+    else
+        seqRun = 1;
+    seqNext = sectorNumber + 1;
+    bool scan = seqRun >= SEQ_THRESHOLD;
+
+    SectorCache * sec = CacheAdd(sectorNumber, scan);
     memcpy(data, sec->data, SECTOR_SIZE);
-    InternalRead(sectorNumber, data);
+
+    // Si los ultimos sectores leidos son consecutivos, traemos de
+    // antemano los que siguen.  Como los sectores son adyacentes el
+    // costo de seek extra es casi nulo, y las proximas lecturas del
+    // stream pegan en cache.
+    if (scan) {
+        for (unsigned s = seqNext;
+          s < seqNext + READ_AHEAD && s < NUM_SECTORS; s++)
+            if (slotOf[s] < 0)
+                CacheAdd(s, true);
+    }
+}
+
+// Variantes vectorizadas: un lote entero de sectores por llamada.  El
+// que llama ya tiene el disco tomado para todo el lote; aca solo se
+// sirven los sectores uno atras del otro (la deteccion secuencial y el
+// read-ahead de `ReadSector` siguen valiendo por sector).
+void
+CacheDisk::ReadSectors(const unsigned * sectors, unsigned count,
+  char * data)
+{
+    ASSERT(data != nullptr);
+    for (unsigned i = 0; i < count; i++)
+        ReadSector(sectors[i], &data[i * SECTOR_SIZE]);
+}
+
+void
+CacheDisk::WriteSectors(const unsigned * sectors, unsigned count,
+  const char * data)
+{
+    ASSERT(data != nullptr);
+    for (unsigned i = 0; i < count; i++)
+        WriteSector(sectors[i], &data[i * SECTOR_SIZE]);
 }
 
 void
 CacheDisk::WriteSector(int sectorNumber, const char * data)
 {
     ASSERT(data != nullptr);
-    SectorCache * sec = CacheAdd(sectorNumber);
+    DiskTraceRecord('W', sectorNumber);
+
+    // Misma clasificacion de barridos que en `ReadSector` (sin
+    // read-ahead): una escritura secuencial grande tampoco deberia
+    // desalojar el working set de metadatos.
+    if ((unsigned) sectorNumber == wSeqNext)
+        wSeqRun++;
+    else
+        wSeqRun = 1;
+    wSeqNext = sectorNumber + 1;
+
+    SectorCache * sec = CacheAdd(sectorNumber, wSeqRun >= SEQ_THRESHOLD);
     memcpy(sec->data, data, SECTOR_SIZE);
-    sec->modified = true;
+    // Escritura diferida: el sector queda sucio en cache y alguien (el
+    // daemon de flush, un desalojo o el destructor) lo baja a disco.
+    if (!sec->modified) {
+        sec->modified = true;
+        numDirty++;
+    }
+}
+
+// Escritura directa a disco, sin pasar por la escritura diferida.  Si el
+// sector estaba en cache se actualiza la copia (y queda limpia: lo que
+// hay en disco es exactamente esto).
+void
+CacheDisk::WriteThrough(int sectorNumber, const char * data)
+{
+    ASSERT(data != nullptr);
+    int slot = slotOf[sectorNumber];
+    if (slot != -1) {
+        SectorCache * sec = &slots[slot];
+        memcpy(sec->data, data, SECTOR_SIZE);
+        if (sec->modified) {
+            sec->modified = false;
+            numDirty--;
+        }
+    }
     InternalWrite(sectorNumber, data);
 }
 
-// Pone una pagina al final de la cache(si no existe la trae de disco)
-SectorCache *
-CacheDisk::CacheAdd(int sectorNumber)
+unsigned
+CacheDisk::DirtyCount()
 {
-    SectorCache * s = NULL;
+    return numDirty;
+}
 
-    DEBUG('K',"Adding %d to cache\n",sectorNumber);
+// Fija un sector en cache: lo carga si hace falta y lo saca de la
+// cadena LRU, asi nunca es victima de un desalojo.  La cuota
+// `PINNED_MAX` evita que los metadatos se coman la cache entera.
+bool
+CacheDisk::Pin(int sectorNumber)
+{
+    if (pinnedCount >= PINNED_MAX)
+        return false;
+    CacheAdd(sectorNumber);
+    int slot = slotOf[sectorNumber];
+    if (!slots[slot].pinned) {
+        LruUnlink(slot);
+        slots[slot].pinned = true;
+        pinnedCount++;
+    }
+    return true;
+}
 
-    if (!IsOnCache(sectorNumber, &s)) {
-        // Check Size
-        size = 0;
-        cache->Apply(aux_get_sz);
-        if (size >= CACHE_SIZE) {
-            CacheRemove();
+void
+CacheDisk::Unpin(int sectorNumber)
+{
+    int slot = slotOf[sectorNumber];
+
+    if (slot < 0 || !slots[slot].pinned)
+        return;
+    slots[slot].pinned = false;
+    pinnedCount--;
+    LruPushFront(slot);
+}
+
+// Baja a disco todos los sectores sucios, en orden creciente de sector
+// (o sea ordenados por pista), para que el flush sea un solo barrido.
+void
+CacheDisk::FlushDirty()
+{
+    int order[CACHE_SIZE];
+    unsigned found = 0;
+
+    for (unsigned i = 0; i < CACHE_SIZE; i++) {
+        if (!slots[i].valid || !slots[i].modified)
+            continue;
+        // Insercion ordenada por numero de sector; son a lo sumo
+        // `CACHE_SIZE` entradas, no hace falta nada mas elaborado.
+        unsigned j = found;
+        while (j > 0 && slots[order[j - 1]].sector > slots[i].sector) {
+            order[j] = order[j - 1];
+            j--;
         }
-        // Add sector
-        s         = new SectorCache;
+        order[j] = i;
+        found++;
+    }
+
+    for (unsigned i = 0; i < found; i++) {
+        SectorCache * s = &slots[order[i]];
+        InternalWrite(s->sector, s->data);
+        s->modified = false;
+        numDirty--;
+    }
+    if (found > 0) {
+        cacheFlushed.Add(found);
+        cacheFlushSweeps.Inc();
+    }
+}
+
+// Igual que `FlushDirty`, pero solo para los sectores de la lista (los
+// de un archivo, tipicamente: ver `SynchDisk::FlushSectors`).  El resto
+// de la cache sigue acumulando escrituras diferidas.
+void
+CacheDisk::FlushSectors(const unsigned * sectors, unsigned count)
+{
+    int order[CACHE_SIZE];
+    unsigned found = 0;
+
+    for (unsigned k = 0; k < count; k++) {
+        int i = slotOf[sectors[k]];
+        if (i < 0 || !slots[i].valid || !slots[i].modified)
+            continue;
+        unsigned j = found;
+        while (j > 0 && slots[order[j - 1]].sector > slots[i].sector) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+        found++;
+    }
+
+    for (unsigned i = 0; i < found; i++) {
+        SectorCache * s = &slots[order[i]];
+        InternalWrite(s->sector, s->data);
+        s->modified = false;
+        numDirty--;
+    }
+    if (found > 0)
+        cacheFlushed.Add(found);
+}
+
+// Saca un slot de la cadena LRU.
+void
+CacheDisk::LruUnlink(int slot)
+{
+    if (slots[slot].prev >= 0)
+        slots[slots[slot].prev].next = slots[slot].next;
+    else
+        lruHead = slots[slot].next;
+    if (slots[slot].next >= 0)
+        slots[slots[slot].next].prev = slots[slot].prev;
+    else
+        lruTail = slots[slot].prev;
+}
+
+// Pone un slot al frente de la cadena LRU (el mas recientemente usado).
+void
+CacheDisk::LruPushFront(int slot)
+{
+    slots[slot].prev = -1;
+    slots[slot].next = lruHead;
+    if (lruHead >= 0)
+        slots[lruHead].prev = slot;
+    lruHead = slot;
+    if (lruTail < 0)
+        lruTail = slot;
+}
+
+// Ventana de barrido: cuantos slots desde la cola LRU puede ocupar un
+// stream secuencial (alcanza para el read-ahead y un poco mas).
+static const unsigned SCAN_WINDOW = 2 * READ_AHEAD;
+
+// Inserta un slot a `SCAN_WINDOW` lugares de la cola LRU: los sectores
+// de un barrido solo compiten entre ellos por esa ventana y el resto de
+// la cache queda intacto.
+void
+CacheDisk::LruPushNearTail(int slot)
+{
+    int pos = lruTail;
+
+    for (unsigned i = 0; i < SCAN_WINDOW && pos >= 0; i++)
+        pos = slots[pos].prev;
+    if (pos < 0) { // Cadena corta: equivale al frente.
+        LruPushFront(slot);
+        return;
+    }
+    slots[slot].prev = pos;
+    slots[slot].next = slots[pos].next;
+    if (slots[pos].next >= 0)
+        slots[slots[pos].next].prev = slot;
+    else
+        lruTail = slot;
+    slots[pos].next = slot;
+}
+
+// Devuelve el slot de una pagina (si no existe la trae de disco),
+// dejandolo al frente de la cadena LRU.  Busqueda y desalojo son O(1).
+SectorCache *
+CacheDisk::CacheAdd(int sectorNumber, bool scan)
+{
+    DEBUG('K', "Adding %d to cache\n", sectorNumber);
+
+    int slot = slotOf[sectorNumber];
+    if (slot < 0) {
+        // Miss: el victim es siempre la cola de la cadena LRU.
+        cacheMisses.Inc();
+        CacheRemove();
+        slot = lruTail;
+        LruUnlink(slot);
+
+        SectorCache * s = &slots[slot];
         s->sector = sectorNumber;
-        s->data   = new char[SECTOR_SIZE];
         InternalRead(s->sector, s->data);
+        s->valid    = true;
         s->modified = false;
-        cache->Append(*s);
-    } else if (s != NULL)     {
-        // Move sector to the end
-        SectorCache cache_item = *s;
-        cache->Remove(*s);
-        cache->Append(cache_item);
+        slotOf[sectorNumber] = slot;
+    } else {
+        cacheHits.Inc();
+        // Los slots fijados viven fuera de la cadena LRU; no hay nada
+        // que promover.
+        if (slots[slot].pinned)
+            return &slots[slot];
+        LruUnlink(slot);
     }
+    // Un hit dentro de un barrido tampoco promueve al frente: el sector
+    // tipico de un stream se usa una sola vez.
+    if (scan)
+        LruPushNearTail(slot);
+    else
+        LruPushFront(slot);
 
-    return s;
+    return &slots[slot];
 }
 
-// Elimina una pagina de cache(y la escribe en disco de ser necesario)
+// Elimina la pagina menos usada de cache (y la escribe en disco de ser
+// necesario), dejando su slot libre en la cola de la cadena.
 void
 CacheDisk::CacheRemove()
 {
-    if (!cache->IsEmpty()) {
-        SectorCache s = cache->Pop();
-        DEBUG('K',"Removing %d from cache\n",s.sector);
+    int slot = lruTail;
+
+    ASSERT(slot >= 0);
+    if (slots[slot].valid) {
+        DEBUG('K', "Removing %d from cache\n", slots[slot].sector);
         // Sincronizo de ser necesario
-        if (s.modified) {
-            InternalWrite(s.sector, s.data);
+        if (slots[slot].modified) {
+            InternalWrite(slots[slot].sector, slots[slot].data);
+            numDirty--;
         }
-        delete[] s.data;
+        slotOf[slots[slot].sector] = -1;
+        slots[slot].valid    = false;
+        slots[slot].modified = false;
     }
 }
 
-// Busca una pagina en cache
-bool
-CacheDisk::IsOnCache(int sectorNumber, SectorCache ** Sec)
-{
-    sector_num = sectorNumber;
-    *Sec       = cache->GetFirst(aux_cmp_cache);
-    return (*Sec != NULL);
-}
-
 // Escriben y leen del disco directamente
 void
 CacheDisk::InternalWrite(int sectorNumber, const char * data)
@@ -5,14 +5,25 @@
 
 #include "machine/disk.hh"
 #include "threads/synch.hh"
-#include "lib/list.hh"
 
 const unsigned CACHE_SIZE = 64;
 
+/// At most this many slots can be pinned (non-evictable) at once, so
+/// bulk data always keeps most of the cache.
+const unsigned PINNED_MAX = 8;
+
+/// One cache slot: a sector image plus its place in the LRU chain.
+///
+/// The chain is intrusive: `prev`/`next` are slot indices, so moving a
+/// slot to the front of the LRU order is a handful of index updates.
 typedef struct {
-    char *   data;
-    bool     modified;
-    unsigned sector;
+    char     data[SECTOR_SIZE];
+    unsigned sector;   ///< Disk sector held in this slot.
+    bool     valid;    ///< Does this slot hold a sector at all?
+    bool     modified; ///< Must it be written back before eviction?
+    bool     pinned;   ///< Out of the LRU chain, never evicted.
+    int      prev;     ///< Towards the most recently used slot.
+    int      next;     ///< Towards the least recently used slot.
 } SectorCache;
 
 class CacheDisk {
@@ -31,9 +42,52 @@ public:
     void
     ReadSector(int sectorNumber, char * data);
 
+    /// Vectored variants: serve `count` sectors (`sectors[i]` goes to or
+    /// from `data[i * SECTOR_SIZE]`) as one batch, for callers that hold
+    /// the disk across a whole logical request (cf. `SynchDisk`).
+    void
+    ReadSectors(const unsigned * sectors, unsigned count, char * data);
+    void
+    WriteSectors(const unsigned * sectors, unsigned count,
+      const char * data);
+
+    /// Writes are delayed: `WriteSector` only updates the cached copy and
+    /// marks the slot dirty.  Dirty sectors reach the disk when they are
+    /// evicted, when `FlushDirty` is called, or in the destructor.
     void
     WriteSector(int sectorNumber, const char * data);
 
+    /// Write a sector to the disk right away, keeping any cached copy
+    /// coherent (and clean).
+    void
+    WriteThrough(int sectorNumber, const char * data);
+
+    /// Write every dirty slot back to disk, in increasing sector (and
+    /// hence track) order so the flush is a single head sweep.
+    void
+    FlushDirty();
+
+    /// Write back just the dirty cached copies of the listed sectors
+    /// (typically one file's sectors, for fsync), also in increasing
+    /// order.  The list must not repeat sectors.  The rest of the cache
+    /// keeps batching.
+    void
+    FlushSectors(const unsigned * sectors, unsigned count);
+
+    /// How many slots are currently dirty.
+    unsigned
+    DirtyCount();
+
+    /// Keep `sectorNumber` cached permanently (out of the LRU chain), up
+    /// to a quota of `PINNED_MAX` slots; for hot metadata like the free
+    /// map and the root directory.  Returns false if the quota is full.
+    bool
+    Pin(int sectorNumber);
+
+    /// Make a pinned sector evictable again.
+    void
+    Unpin(int sectorNumber);
+
     /// Called by the disk device interrupt handler, to signal that the
     /// current disk operation is complete.
     void
@@ -41,17 +95,49 @@ public:
 
 private:
     Disk * disk; ///< Raw disk device.
-    List < SectorCache > *cache;
     Semaphore * semaphore;
 
+    SectorCache slots[CACHE_SIZE]; ///< The cache slots themselves.
+    int * slotOf;                  ///< Sector number -> slot index, or -1;
+    ///< gives O(1) lookup instead of the
+    ///< old linear list scan.  Sized to the
+    ///< geometry chosen at startup.
+    int lruHead; ///< Most recently used slot.
+    int lruTail; ///< Least recently used slot: the eviction victim.
+
+    unsigned numDirty;    ///< Slots waiting to be written back.
+    unsigned pinnedCount; ///< Slots currently pinned.
+
+    unsigned seqNext; ///< Sector that would continue the current stream.
+    unsigned seqRun;  ///< Consecutive sequential reads seen so far.
+
+    unsigned wSeqNext; ///< The same pair, for write streams (used only
+    unsigned wSeqRun;  ///< to classify them as scans, no read-ahead).
+
+    /// Return the slot holding `sectorNumber`, loading it from disk (and
+    /// evicting the LRU slot) if needed.  The slot becomes most recently
+    /// used, unless it belongs to a sequential scan (`scan`), in which
+    /// case it is kept near the LRU tail so one big stream cannot flush
+    /// the rest of the cache.
     SectorCache *
-    CacheAdd(int sectorNumber);
+    CacheAdd(int sectorNumber, bool scan = false);
 
+    /// Write back (if modified) and empty the least recently used slot.
     void
     CacheRemove();
 
-    bool
-    IsOnCache(int sectorNumber, SectorCache ** Sec);
+    /// Take a slot out of the LRU chain / push it on as most recent.
+
+    void
+    LruUnlink(int slot);
+
+    void
+    LruPushFront(int slot);
+
+    /// Insert a slot a few places from the LRU tail (the scan window),
+    /// instead of at the front.
+    void
+    LruPushNearTail(int slot);
 
     void
     InternalWrite(int sectorNumber, const char * data);
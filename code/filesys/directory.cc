@@ -1,9 +1,17 @@
 /// Routines to manage a directory of file names.
 ///
-/// The directory is a table of fixed length entries; each entry represents a
-/// single file, and contains the file name, and the location of the file
-/// header on disk.  The fixed size of each directory entry means that we
-/// have the restriction of a fixed maximum size for file names.
+/// In memory the directory is a table of fixed length entries; each entry
+/// represents a single file, and contains the file name, and the location
+/// of the file header on disk.  The fixed size of each directory entry
+/// means that we have the restriction of a fixed maximum size for file
+/// names.
+///
+/// On disk the table is stored packed: an entry count followed by
+/// variable-length records (name length, flags, header sector, then the
+/// name bytes, with no alignment padding).  Reserving
+/// `FILE_NAME_MAX_LEN` bytes per name on disk would let a sector hold
+/// only a couple of entries; packed, typical directories fit several
+/// times as many entries per sector, so every scan reads fewer sectors.
 ///
 /// The constructor initializes an empty directory of a certain size; we use
 /// ReadFrom/WriteBack to fetch the contents of the directory from disk, and
@@ -25,6 +33,11 @@
 #include "lib/utility.hh"
 #include "threads/system.hh"
 
+/// Bytes fijos de un registro empaquetado en disco: largo del nombre,
+/// flags (por ahora solo `isDir`) y sector del header; el nombre va
+/// detras, sin `'\0'` ni relleno.
+static const unsigned PACKED_ENTRY_HDR = 2 + sizeof(unsigned);
+
 unsigned
 Directory::Extend_Table(unsigned cnt)
 {
@@ -46,9 +59,76 @@ Directory::Extend_Table(unsigned cnt)
     }
     delete raw.table;
     raw.table = newTable;
+    RebuildHash();
+    // Las entradas libres no se serializan: alcanza con marcar que hay
+    // cambios para que el proximo `WriteBack` reempaquete.
+    sizeDirty = true;
     return old_sz;
 }
 
+/// Amplia la region sucia para cubrir la entrada `i`.
+void
+Directory::MarkDirty(unsigned i)
+{
+    if (dirtyLo > dirtyHi) {
+        dirtyLo = dirtyHi = i;
+    } else {
+        if (i < dirtyLo)
+            dirtyLo = i;
+        if (i > dirtyHi)
+            dirtyHi = i;
+    }
+}
+
+/// Hash de un nombre de archivo (djb2 acotado a `FILE_NAME_MAX_LEN`).
+unsigned
+Directory::HashName(const char * name)
+{
+    unsigned h = 5381;
+
+    for (unsigned i = 0; name[i] != '\0' && i < FILE_NAME_MAX_LEN; i++)
+        h = h * 33 + (unsigned char) name[i];
+    return h;
+}
+
+/// Rearma el indice de nombres desde cero; se usa cada vez que la tabla
+/// cambia de tamanio o se recarga de disco.
+void
+Directory::RebuildHash()
+{
+    delete [] hashHeads;
+    delete [] hashNext;
+    hashHeads = new int[raw.tableSize];
+    hashNext  = new int[raw.tableSize];
+    for (unsigned i = 0; i < raw.tableSize; i++)
+        hashHeads[i] = hashNext[i] = -1;
+    for (unsigned i = 0; i < raw.tableSize; i++)
+        if (raw.table[i].inUse)
+            HashInsert(i);
+}
+
+void
+Directory::HashInsert(unsigned i)
+{
+    unsigned b = HashName(raw.table[i].name) % raw.tableSize;
+
+    hashNext[i]  = hashHeads[b];
+    hashHeads[b] = i;
+}
+
+// Debe llamarse antes de pisar el nombre de la entrada `i`.
+void
+Directory::HashRemove(unsigned i)
+{
+    unsigned b = HashName(raw.table[i].name) % raw.tableSize;
+    int * link = &hashHeads[b];
+
+    while (*link != -1 && *link != (int) i)
+        link = &hashNext[*link];
+    if (*link == (int) i)
+        *link = hashNext[i];
+}
+
 void
 Directory::Get_Lock()
 {
@@ -92,42 +172,125 @@ Directory::Directory(unsigned size)
         raw.table[i].isDir  = false;
         raw.table[i].sector = NOT_ASSIGNED;
     }
+    RebuildHash();
+    // Un directorio recien armado en memoria debe escribirse entero.
+    dirtyLo   = 0;
+    dirtyHi   = size - 1;
+    sizeDirty = true;
 }
 
 /// De-allocate directory data structure.
 Directory::~Directory()
 {
     delete [] raw.table;
+    delete [] hashHeads;
+    delete [] hashNext;
     raw.tableSize = 0;
     raw.used      = 0;
 }
 
-/// Read the contents of the directory from disk.
+/// Read the contents of the directory from disk, expanding the packed
+/// records into the in-memory table.
 ///
 /// * `file` is file containing the directory contents.
 void
 Directory::FetchFrom(OpenFile * file)
 {
     ASSERT(file != nullptr);
-    file->ReadAt((char *) &raw.tableSize, sizeof(raw.tableSize), 0);
-    raw.table = new DirectoryEntry[raw.tableSize];
-    file->ReadAt((char *) raw.table, raw.tableSize * sizeof(DirectoryEntry), 8);
+    unsigned count = 0;
+    file->ReadAt((char *) &count, sizeof count, 0);
+    if (count == 0) {
+        // Directorio recien creado, todavia todo agujeros en disco:
+        // equivale a una tabla vacia (cf. el constructor).  Queda toda
+        // sucia para que el primer `WriteBack` la materialice.
+        raw.tableSize = NUM_DIR_ENTRIES;
+        raw.table     = new DirectoryEntry [raw.tableSize];
+        for (unsigned i = 0; i < raw.tableSize; i++) {
+            raw.table[i].inUse  = false;
+            raw.table[i].isDir  = false;
+            raw.table[i].sector = NOT_ASSIGNED;
+        }
+        RebuildHash();
+        dirtyLo   = 0;
+        dirtyHi   = raw.tableSize - 1;
+        sizeDirty = true;
+    } else {
+        // Solo las entradas vivas estan en disco: la tabla en memoria se
+        // arma justa y `Add` la agranda si hace falta.
+        unsigned length = file->Length() - sizeof count;
+        char * buf      = new char[length];
+        file->ReadAt(buf, length, sizeof count);
+        raw.tableSize = count;
+        raw.table     = new DirectoryEntry[count];
+        unsigned off = 0;
+        for (unsigned i = 0; i < count; i++) {
+            ASSERT(off + PACKED_ENTRY_HDR <= length);
+            unsigned len = (unsigned char) buf[off++];
+            ASSERT(len <= FILE_NAME_MAX_LEN);
+            raw.table[i].inUse = true;
+            raw.table[i].isDir = buf[off++] != 0;
+            memcpy(&raw.table[i].sector, &buf[off],
+              sizeof raw.table[i].sector);
+            off += sizeof raw.table[i].sector;
+            ASSERT(off + len <= length);
+            memcpy(raw.table[i].name, &buf[off], len);
+            raw.table[i].name[len] = '\0';
+            off += len;
+        }
+        delete [] buf;
+        RebuildHash();
+        // Recien leido de disco: no hay nada sucio.
+        dirtyLo   = raw.tableSize;
+        dirtyHi   = 0;
+        sizeDirty = false;
+    }
     sectornumber = file->Get_Sector();
     if (filetable->find(sectornumber) == nullptr) {
         filetable->add_file("Dir", sectornumber);
     }
 }
 
-/// Write any modifications to the directory back to disk.
+/// Write any modifications to the directory back to disk, as a packed
+/// image of the live entries.
+///
+/// Reserializing the whole image costs less than it sounds: packed,
+/// a typical directory fits in one or two sectors, so the write still
+/// touches fewer sectors than one fixed-size entry used to.
 ///
 /// * `file` is a file to contain the new directory contents.
 void
 Directory::WriteBack(OpenFile * file)
 {
     ASSERT(file != nullptr);
-    file->WriteAt((const char *) &raw.tableSize, sizeof(raw.tableSize), 0);
-    file->WriteAt((const char *) raw.table,
-      raw.tableSize * sizeof(DirectoryEntry), 8);
+    if (!sizeDirty && dirtyLo > dirtyHi) {
+        return; // Nada cambio desde la ultima bajada.
+    }
+    char * buf = new char[sizeof(unsigned)
+        + raw.tableSize * (PACKED_ENTRY_HDR + FILE_NAME_MAX_LEN)];
+    unsigned off   = sizeof(unsigned);
+    unsigned count = 0;
+    for (unsigned i = 0; i < raw.tableSize; i++) {
+        if (!raw.table[i].inUse) {
+            continue; // Las entradas libres no ocupan disco.
+        }
+        unsigned len = strlen(raw.table[i].name);
+        if (len > FILE_NAME_MAX_LEN) {
+            len = FILE_NAME_MAX_LEN;
+        }
+        buf[off++] = (char) len;
+        buf[off++] = raw.table[i].isDir ? 1 : 0;
+        memcpy(&buf[off], &raw.table[i].sector, sizeof raw.table[i].sector);
+        off += sizeof raw.table[i].sector;
+        memcpy(&buf[off], raw.table[i].name, len);
+        off += len;
+        count++;
+    }
+    memcpy(buf, &count, sizeof count);
+    file->WriteAt(buf, off, 0);
+    delete [] buf;
+    sizeDirty = false;
+    dirtyLo   = raw.tableSize;
+    dirtyHi   = 0;
 }
 
 /// Look up file name in directory, and return its location in the table of
@@ -139,7 +302,9 @@ Directory::FindIndex(const char * name, bool isDir)
 {
     ASSERT(name != nullptr);
 
-    for (unsigned i = 0; i < raw.tableSize; i++)
+    // Solo recorro la cadena del bucket del nombre, no toda la tabla.
+    unsigned b = HashName(name) % raw.tableSize;
+    for (int i = hashHeads[b]; i != -1; i = hashNext[i])
         if (raw.table[i].inUse &&
           raw.table[i].isDir == isDir &&
           !strncmp(raw.table[i].name, name, FILE_NAME_MAX_LEN))
@@ -199,6 +364,8 @@ Directory::Add(const char * name, int newSector, bool isDir)
     raw.table[idx].isDir = isDir;
     strncpy(raw.table[idx].name, name, FILE_NAME_MAX_LEN);
     raw.table[idx].sector = newSector;
+    HashInsert(idx);
+    MarkDirty(idx);
     Release_Lock();
     return true;
 }
@@ -223,9 +390,11 @@ Directory::Remove(const char * name)
 
     Get_Lock();
     unsigned sec = raw.table[i].sector;
+    HashRemove(i);
     raw.table[i].inUse  = false;
     raw.table[i].isDir  = false;
     raw.table[i].sector = NOT_ASSIGNED;
+    MarkDirty(i);
     DEBUG('D', "Delete Index %d - Sector %d\n", i, sec);
     Release_Lock();
     return (sec == NOT_ASSIGNED ? 0 : sec);
@@ -333,6 +502,7 @@ Directory::Clean(Bitmap * freeMap)
                 delete dir;
                 delete dir_file;
                 delete header;
+                fileSystem->EvictHeader(raw.table[i].sector);
                 DEBUG('D', "Liberando Carpeta %u\n", raw.table[i].sector);
             } else {
                 DEBUG('D', "Liberando Archivo %u\n", raw.table[i].sector);
@@ -342,13 +512,23 @@ Directory::Clean(Bitmap * freeMap)
                 } else {
                     FileHeader * header = new FileHeader;
                     header->FetchFrom(raw.table[i].sector);
-                    header->Deallocate(freeMap);
-                    freeMap->Clear(raw.table[i].sector);
+                    if (header->DecLink() > 0) {
+                        // El archivo tiene otro nombre fuera de este
+                        // directorio: solo cae la entrada.
+                        header->WriteBack(raw.table[i].sector);
+                    } else {
+                        header->Deallocate(freeMap);
+                        freeMap->Clear(raw.table[i].sector);
+                    }
+                    delete header;
+                    fileSystem->EvictHeader(raw.table[i].sector);
                 }
             }
+            HashRemove(i);
             raw.table[i].inUse  = false;
             raw.table[i].isDir  = false;
             raw.table[i].sector = NOT_ASSIGNED;
+            MarkDirty(i);
         }
     }
     Release_Lock();
@@ -83,10 +83,40 @@ public:
 private:
     RawDirectory raw;
     unsigned sectornumber = NOT_ASSIGNED;
+
+    /// In-memory hash index over entry names, so `FindIndex` does not
+    /// `strncmp` against the whole table.  One bucket per table slot,
+    /// chained through `hashNext`; rebuilt whenever the table is reloaded
+    /// or resized and maintained incrementally by `Add`/`Remove`.
+    int * hashHeads = nullptr; ///< Bucket -> first entry index, or -1.
+    int * hashNext  = nullptr; ///< Entry -> next entry in its bucket.
+
+    /// Range of entries touched since the last `FetchFrom`/`WriteBack`.
+    /// The packed on-disk format reserializes the whole image, so these
+    /// now only tell `WriteBack` whether there is anything to write.
+    unsigned dirtyLo  = 0;     ///< Lowest modified entry index.
+    unsigned dirtyHi  = 0;     ///< Highest modified entry index.
+    bool     sizeDirty = true; ///< Did the set of live entries change?
+
+    void
+    MarkDirty(unsigned i);
+
     /// Find the index into the directory table corresponding to `name`.
     int
     FindIndex(const char * name, bool isDir);
 
+    void
+    RebuildHash();
+
+    void
+    HashInsert(unsigned i);
+
+    void
+    HashRemove(unsigned i);
+
+    static unsigned
+    HashName(const char * name);
+
     void
     Get_Lock();
 
@@ -0,0 +1,140 @@
+/// Captura y reproduccion de trazas de acceso a disco.
+///
+/// Para evaluar el tamanio de cache (`CACHE_SIZE`), la politica del
+/// elevador o la escritura diferida contra cargas reales no hace falta
+/// correr la aplicacion entera: alcanza con registrar que sectores se
+/// pidieron y cuando, y despues reproducir esa secuencia contra el
+/// disco.
+///
+/// * `-dtc <archivo>` registra cada `ReadSector`/`WriteSector` que llega
+///   a `CacheDisk` como una linea de texto `<tick> <R|W> <sector>` (los
+///   pedidos logicos, antes de hits de cache o read-ahead).  Cada linea
+///   se baja con `fflush`, asi una corrida abortada conserva su traza.
+/// * `-dtr <archivo>` reproduce una traza contra `SynchDisk`,
+///   respetando los intervalos de ticks registrados, e imprime un
+///   resumen al final.
+///
+/// OJO: la reproduccion emite las escrituras con datos de relleno;
+/// corromperia un `DISK` con contenido valioso.  Reproducir siempre
+/// sobre una copia descartable de la imagen.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de
+/// Rosario.  All rights reserved.  See `copyright.h` for copyright
+/// notice and limitation of liability and disclaimer of warranty
+/// provisions.
+
+
+#include "threads/synch.hh"
+#include "threads/system.hh"
+#include "machine/statistics.hh"
+
+#include <stdio.h>
+#include <string.h>
+
+
+static FILE * captureFile = nullptr;
+
+/// Empieza a registrar los pedidos de sector en `name`.
+void
+DiskTraceCapture(const char * name)
+{
+    ASSERT(name != nullptr);
+    captureFile = fopen(name, "w");
+    if (captureFile == nullptr) {
+        printf("Disk trace: cannot open `%s` for capture.\n", name);
+        return;
+    }
+    fprintf(captureFile, "# nachos disk trace: <tick> <R|W> <sector>\n");
+    fflush(captureFile);
+}
+
+/// Hook llamado desde `CacheDisk::ReadSector`/`WriteSector`; no hace
+/// nada si la captura no esta activa.
+void
+DiskTraceRecord(char op, unsigned sector)
+{
+    if (captureFile == nullptr)
+        return;
+    fprintf(captureFile, "%u %c %u\n", stats->totalTicks, op, sector);
+    fflush(captureFile); // Una corrida abortada conserva su traza.
+}
+
+static void
+ReplayWakeUp(void * arg)
+{
+    ASSERT(arg != nullptr);
+    ((Semaphore *) arg)->V();
+}
+
+/// Deja pasar `ticks` de tiempo simulado sin tocar el disco, para
+/// reproducir los intervalos entre pedidos de la traza.
+static void
+WaitTicks(unsigned ticks)
+{
+    if (ticks == 0)
+        return;
+    Semaphore wake("trace replay wake", 0);
+    interrupt->Schedule(ReplayWakeUp, &wake, ticks, TIMER_INT);
+    wake.P();
+}
+
+/// Reproduce la traza `name` contra `SynchDisk`, con los intervalos
+/// registrados.
+void
+DiskTraceReplay(const char * name)
+{
+    ASSERT(name != nullptr);
+    FILE * f = fopen(name, "r");
+
+    if (f == nullptr) {
+        printf("Disk trace: cannot open `%s` for replay.\n", name);
+        return;
+    }
+
+    char buffer[SECTOR_SIZE];
+    memset(buffer, 't', SECTOR_SIZE);
+
+    unsigned reads = 0, writes = 0, skipped = 0;
+    unsigned firstTick = 0, lastTick = 0;
+    bool     haveFirst = false;
+    unsigned startTicks = stats->totalTicks;
+
+    char line[128];
+    while (fgets(line, sizeof line, f) != nullptr) {
+        unsigned tick, sector;
+        char op;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        if (sscanf(line, "%u %c %u", &tick, &op, &sector) != 3
+          || sector >= NUM_SECTORS
+          || (op != 'R' && op != 'W')) {
+            skipped++;
+            continue;
+        }
+        if (!haveFirst) {
+            firstTick = tick;
+            haveFirst = true;
+        }
+        lastTick = tick;
+
+        // Reproduzco el intervalo registrado desde el principio de la
+        // traza; si la reproduccion viene atrasada sigue de largo.
+        unsigned target = startTicks + (tick - firstTick);
+        if (stats->totalTicks < target)
+            WaitTicks(target - stats->totalTicks);
+
+        if (op == 'R') {
+            synchDisk->ReadSector(sector, buffer);
+            reads++;
+        } else {
+            synchDisk->WriteSector(sector, buffer);
+            writes++;
+        }
+    }
+    fclose(f);
+
+    printf("Disk trace replay: %u reads, %u writes, %u skipped lines; "
+      "recorded span %u ticks, replayed in %u ticks.\n",
+      reads, writes, skipped, lastTick - firstTick,
+      stats->totalTicks - startTicks);
+} // DiskTraceReplay
@@ -24,8 +24,57 @@
 
 #include "lib/utility.hh"
 #include "file_header.hh"
+#include "machine/statistics.hh"
 #include "threads/system.hh"
 
+static Counter compGroups("fileSys.comp.groups");
+static Counter compSavedSectors("fileSys.comp.savedSectors");
+
+/// RLE de a pares (cuenta, byte) sobre un grupo de `COMP_GROUP_BYTES`,
+/// igual que el zswap de memoria virtual.  Devuelve el tamanio
+/// comprimido, o `COMP_GROUP_BYTES` si no ahorra ni un sector: un grupo
+/// que no comprime se guarda crudo y no paga nada.
+static unsigned
+CompCompress(const char * src, char * dst)
+{
+    unsigned out = 0;
+
+    for (unsigned i = 0; i < COMP_GROUP_BYTES; ) {
+        unsigned run = 1;
+        while (i + run < COMP_GROUP_BYTES && src[i + run] == src[i]
+          && run < 255)
+        {
+            run++;
+        }
+        if (out + 2 > (COMP_GROUP - 1) * SECTOR_SIZE) {
+            return COMP_GROUP_BYTES;
+        }
+        dst[out++] = (char) run;
+        dst[out++] = src[i];
+        i += run;
+    }
+    return out;
+}
+
+/// Expandir el stream RLE de `src` hasta llenar `COMP_GROUP_BYTES` en
+/// `dst`.  No hace falta guardar el tamanio comprimido: el stream
+/// termina exactamente cuando la salida se llena, y lo que sobre del
+/// ultimo sector del extent es relleno que nunca se mira.
+static void
+CompDecompress(const char * src, char * dst)
+{
+    unsigned out = 0, i = 0;
+
+    while (out < COMP_GROUP_BYTES) {
+        unsigned run = (unsigned char) src[i];
+        ASSERT(run > 0);
+        for (unsigned r = 0; r < run && out < COMP_GROUP_BYTES; r++) {
+            dst[out++] = src[i + 1];
+        }
+        i += 2;
+    }
+}
+
 /// Initialize a fresh file header for a newly created file.  Allocate data
 /// blocks for the file out of the map of free disk blocks.  Return false if
 /// there are not enough free blocks to accomodate the new file.
@@ -62,7 +111,8 @@ FileHeader::Release_Lock()
 }
 
 bool
-FileHeader::Allocate(Bitmap * freeMap, unsigned fileSize)
+FileHeader::Allocate(Bitmap * freeMap, unsigned fileSize, unsigned near,
+  bool compressed)
 {
     ASSERT(freeMap != nullptr);
     DEBUG('f', "Alloque %u bytes\n", fileSize);
@@ -71,6 +121,8 @@ FileHeader::Allocate(Bitmap * freeMap, unsigned fileSize)
         raw.dataSectors[i] = NOT_ASSIGNED;
     }
     raw.unrefSectors = NOT_ASSIGNED;
+    raw.linkCount    = 1; // El nombre con el que nace (cf. hard links).
+    raw.flags        = compressed ? FH_COMPRESSED : 0;
 
     if (fileSize == 0) {
         // Creo que raw_file_header, pero sin bloques
@@ -81,55 +133,217 @@ FileHeader::Allocate(Bitmap * freeMap, unsigned fileSize)
 
     raw.numBytes   = fileSize;
     raw.numSectors = DivRoundUp(fileSize, SECTOR_SIZE);
-    if (freeMap->CountClear() < raw.numSectors) {
-        DEBUG('f', "No hay suficiente espacio en el disco\n");
-        return false; // Not enough space.
+
+    // Archivo ralo: no pido ni un sector de datos todavia.  Todos los
+    // bloques nacen como agujeros (NOT_ASSIGNED), que se leen como ceros
+    // y se materializan recien en la primera escritura (cf.
+    // `AllocSector`).  Crear un archivo grande pre-asignado es O(1), no
+    // gasta sectores en partes que nunca se escriben y se ahorra el
+    // trafico de llenar el disco de ceros.
+    //
+    // Un archivo comprimido usa solo los punteros directos, pero cada
+    // uno cubre un grupo de `COMP_GROUP` sectores logicos (cf.
+    // `WriteGroup`), asi que igual direcciona mas que el esquema
+    // directo comun.
+    unsigned maxSectors = compressed
+      ? NUM_DIRECT * COMP_GROUP
+      : NUM_DIRECT + PTRS_PER_SECTOR * PTRS_PER_SECTOR;
+    if (raw.numSectors > maxSectors) {
+        DEBUG('f', "Archivo demasiado grande para el esquema de bloques\n");
+        return false;
     }
+    DEBUG('f', "raw.numSectors = %u (todos agujeros)\n", raw.numSectors);
 
-    for (unsigned i = 0; i < min(raw.numSectors, NUM_DIRECT); i++) {
-        raw.dataSectors[i] = freeMap->Find();
-        synchDisk->ClearSector(raw.dataSectors[i]);
-        DEBUG('f', "Tomo %u\n", raw.dataSectors[i]);
-    }
-
-    DEBUG('f', "raw.numSectors = %u\n", raw.numSectors);
-
-    if (raw.numSectors > NUM_DIRECT) {
-        // Dos niveles de indireccion (1 * 32 * 32 bytes)
-        raw.unrefSectors = freeMap->Find();
-        unsigned rest_sectors = raw.numSectors - NUM_DIRECT;
-        unsigned * unref_lv1  = new unsigned[32];
-        unsigned * unref_lv2  = new unsigned[32];
-        // Limpio los arreglos
-        for (unsigned k = 0; k < 32; k++)
-            unref_lv1[k] = NOT_ASSIGNED;
-        for (unsigned i = 0; i < 32 && 0 < rest_sectors; i++) {
-            unref_lv1[i] = freeMap->Find();
-            // Limpio el arreglo del segundo nivel
-            for (unsigned k = 0; k < 32; k++)
-                unref_lv2[k] = NOT_ASSIGNED;
-            for (unsigned j = 0; j < 32 && 0 < rest_sectors; j++) {
-                unref_lv2[j] = freeMap->Find();
-                synchDisk->ClearSector(unref_lv2[j]);
-                rest_sectors--;
+    return true;
+} // FileHeader::Allocate
+
+/// Materialize the hole that holds byte `offset`: allocate a real disk
+/// sector for it, creating the indirection tables on the way if they are
+/// missing.  The caller is expected to overwrite the whole sector right
+/// away (cf. `OpenFile::Internal_WriteAt`), so the data sector is not
+/// zeroed here.  Returns false if the disk is full.
+bool
+FileHeader::AllocSector(Bitmap * freeMap, unsigned offset)
+{
+    ASSERT(freeMap != nullptr);
+    // Los archivos comprimidos materializan extents enteros, no
+    // sectores sueltos (cf. `WriteGroup`).
+    ASSERT(!IsCompressed());
+
+    Get_Lock();
+    unsigned near = sectornumber != NOT_ASSIGNED ? sectornumber : 0;
+    unsigned idx  = offset / SECTOR_SIZE;
+    ASSERT(idx < raw.numSectors);
+
+    if (idx < NUM_DIRECT) {
+        if (raw.dataSectors[idx] == NOT_ASSIGNED) {
+            if (freeMap->CountClear() < 1) {
+                Release_Lock();
+                return false;
             }
-            DEBUG('f', "Sector %u\n", unref_lv1[i]);
-            synchDisk->WriteSector(unref_lv1[i], (char *) unref_lv2);
+            raw.dataSectors[idx] = freeMap->FindFrom(near);
+            DEBUG('f', "Materializo el bloque %u en %u\n",
+              idx, raw.dataSectors[idx]);
         }
-        DEBUG('f', "Sector %u\n", raw.unrefSectors);
-        synchDisk->WriteSector(raw.unrefSectors, (char *) unref_lv1);
+        Release_Lock();
+        return true;
+    }
+
+    idx -= NUM_DIRECT;
+    unsigned lv1Idx = idx / PTRS_PER_SECTOR;
+    unsigned lv2Idx = idx % PTRS_PER_SECTOR;
 
-        return rest_sectors == 0;
+    unsigned * unrf_lv1 = new unsigned[PTRS_PER_SECTOR];
+    unsigned * unrf_lv2 = new unsigned[PTRS_PER_SECTOR];
+
+    // Levanto (o estreno) las dos tablas de indireccion.
+    if (raw.unrefSectors == NOT_ASSIGNED) {
+        for (unsigned k = 0; k < PTRS_PER_SECTOR; k++)
+            unrf_lv1[k] = NOT_ASSIGNED;
+    } else {
+        synchDisk->ReadSector(raw.unrefSectors, (char *) unrf_lv1);
+    }
+    if (unrf_lv1[lv1Idx] == NOT_ASSIGNED) {
+        for (unsigned k = 0; k < PTRS_PER_SECTOR; k++)
+            unrf_lv2[k] = NOT_ASSIGNED;
+    } else {
+        synchDisk->ReadSector(unrf_lv1[lv1Idx], (char *) unrf_lv2);
     }
 
-    for (unsigned i = 0; i < NUM_DIRECT; i++) {
-        DEBUG('f', "Direct[%u] = %u\n", i, raw.dataSectors[i]);
+    bool ret = true;
+    if (unrf_lv2[lv2Idx] == NOT_ASSIGNED) {
+        // Puedo necesitar hasta el dato mas las dos tablas.
+        unsigned needed = 1;
+        if (raw.unrefSectors == NOT_ASSIGNED)
+            needed++;
+        if (unrf_lv1[lv1Idx] == NOT_ASSIGNED)
+            needed++;
+        if (freeMap->CountClear() < needed) {
+            ret = false;
+        } else {
+            if (raw.unrefSectors == NOT_ASSIGNED)
+                raw.unrefSectors = freeMap->FindFrom(near);
+            if (unrf_lv1[lv1Idx] == NOT_ASSIGNED)
+                unrf_lv1[lv1Idx] = freeMap->FindFrom(near);
+            unrf_lv2[lv2Idx] = freeMap->FindFrom(near);
+            DEBUG('f', "Materializo el bloque %u en %u\n",
+              NUM_DIRECT + idx, unrf_lv2[lv2Idx]);
+            synchDisk->WriteSector(unrf_lv1[lv1Idx], (char *) unrf_lv2);
+            synchDisk->WriteSector(raw.unrefSectors, (char *) unrf_lv1);
+            InvalidateIndirect(); // Las tablas en disco cambiaron.
+        }
     }
-    DEBUG('f', "Unref = %u\n", raw.unrefSectors);
-    raw.unrefSectors = NOT_ASSIGNED;
 
+    delete [] unrf_lv1;
+    delete [] unrf_lv2;
+    Release_Lock();
+    return ret;
+} // FileHeader::AllocSector
+
+bool
+FileHeader::IsCompressed() const
+{
+    return (raw.flags & FH_COMPRESSED) != 0;
+}
+
+/// Leer el grupo `group` completo: un solo pedido vectorizado por el
+/// extent contiguo (que pasa por la cache de sectores) y despues la
+/// descompresion en memoria.  Un extent de largo `COMP_GROUP` esta
+/// guardado crudo y no se descomprime.
+void
+FileHeader::ReadGroup(unsigned group, char * data)
+{
+    ASSERT(IsCompressed());
+    ASSERT(group < NUM_DIRECT);
+
+    unsigned entry = raw.dataSectors[group];
+    if (entry == NOT_ASSIGNED) {
+        // Agujero: el grupo entero se lee como ceros.
+        memset(data, 0, COMP_GROUP_BYTES);
+        return;
+    }
+
+    unsigned first = CompExtentFirst(entry);
+    unsigned len   = CompExtentLen(entry);
+    unsigned run[COMP_GROUP];
+    for (unsigned k = 0; k < len; k++) {
+        run[k] = first + k;
+    }
+    if (len == COMP_GROUP) {
+        synchDisk->ReadSectors(run, len, data);
+        return;
+    }
+    char * cbuf = new char [len * SECTOR_SIZE];
+    synchDisk->ReadSectors(run, len, cbuf);
+    CompDecompress(cbuf, data);
+    delete [] cbuf;
+}
+
+/// Reescribir el grupo `group`.  Si el tamanio comprimido cambio de
+/// cantidad de sectores, se pide un extent contiguo nuevo antes de
+/// soltar el viejo (para no perder el dato con el disco lleno); si no,
+/// se reescribe en el lugar.
+bool
+FileHeader::WriteGroup(Bitmap * freeMap, unsigned group, const char * data)
+{
+    ASSERT(freeMap != nullptr);
+    ASSERT(IsCompressed());
+    ASSERT(group < NUM_DIRECT);
+
+    Get_Lock();
+    unsigned near = sectornumber != NOT_ASSIGNED ? sectornumber : 0;
+
+    char * cbuf    = new char [COMP_GROUP_BYTES];
+    unsigned csize = CompCompress(data, cbuf);
+    const char * payload = cbuf;
+    unsigned len = DivRoundUp(csize, SECTOR_SIZE);
+    if (csize == COMP_GROUP_BYTES) {
+        // No comprime: el extent guarda los sectores crudos.
+        payload = data;
+        len     = COMP_GROUP;
+    } else {
+        // Relleno del ultimo sector del extent, que la descompresion
+        // nunca mira (cf. `CompDecompress`).
+        memset(&cbuf[csize], 0, len * SECTOR_SIZE - csize);
+    }
+
+    unsigned entry = raw.dataSectors[group];
+    unsigned first = 0, oldLen = 0;
+    if (entry != NOT_ASSIGNED) {
+        first  = CompExtentFirst(entry);
+        oldLen = CompExtentLen(entry);
+    }
+
+    if (len != oldLen) {
+        int newFirst = freeMap->FindRun(len, near);
+        if (newFirst == -1) {
+            delete [] cbuf;
+            Release_Lock();
+            return false;
+        }
+        for (unsigned k = 0; k < oldLen; k++) {
+            freeMap->Clear(first + k);
+        }
+        first = newFirst;
+        raw.dataSectors[group] = CompPackExtent(first, len);
+        DEBUG('f', "Materializo el grupo %u en %u(x%u)\n",
+          group, first, len);
+    }
+
+    // Extent contiguo: un solo pedido vectorizado.
+    unsigned run[COMP_GROUP];
+    for (unsigned k = 0; k < len; k++) {
+        run[k] = first + k;
+    }
+    synchDisk->WriteSectors(run, len, payload);
+    delete [] cbuf;
+
+    compGroups.Inc();
+    compSavedSectors.Add(COMP_GROUP - len);
+
+    Release_Lock();
     return true;
-} // FileHeader::Allocate
+} // FileHeader::WriteGroup
 
 /// De-allocate all the space allocated for data blocks for this file.
 ///
@@ -138,6 +352,30 @@ void
 FileHeader::Deallocate(Bitmap * freeMap)
 {
     ASSERT(freeMap != nullptr);
+
+    if (IsCompressed()) {
+        // Cada entrada directa es un extent de hasta `COMP_GROUP`
+        // sectores contiguos.
+        for (unsigned g = 0; g < DivRoundUp(raw.numSectors, COMP_GROUP);
+          g++)
+        {
+            if (raw.dataSectors[g] == NOT_ASSIGNED) {
+                continue;
+            }
+            unsigned first = CompExtentFirst(raw.dataSectors[g]);
+            unsigned len   = CompExtentLen(raw.dataSectors[g]);
+            for (unsigned k = 0; k < len; k++) {
+                ASSERT(freeMap->Test(first + k));
+                DEBUG('f', "Liberando %u\n", first + k);
+                freeMap->Clear(first + k);
+            }
+            raw.dataSectors[g] = NOT_ASSIGNED;
+        }
+        raw.numBytes   = 0;
+        raw.numSectors = 0;
+        return;
+    }
+
     for (unsigned i = 0; i < NUM_DIRECT; i++) {
         DEBUG('f', "Direct[%u] = %u\n", i, raw.dataSectors[i]);
     }
@@ -153,14 +391,14 @@ FileHeader::Deallocate(Bitmap * freeMap)
 
     if (raw.unrefSectors != NOT_ASSIGNED) {
         // Borro los sectores de doble indireccion
-        unsigned * unrf_lv1 = new unsigned[32];
-        unsigned * unrf_lv2 = new unsigned[32];
+        unsigned * unrf_lv1 = new unsigned[PTRS_PER_SECTOR];
+        unsigned * unrf_lv2 = new unsigned[PTRS_PER_SECTOR];
         synchDisk->ReadSector(raw.unrefSectors, (char *) unrf_lv1);
-        for (unsigned i = 0; i < 32; i++) {
+        for (unsigned i = 0; i < PTRS_PER_SECTOR; i++) {
             DEBUG('f', "Level1[%u] = %u\n", i, unrf_lv1[i]);
             if (unrf_lv1[i] != NOT_ASSIGNED && freeMap->Test(unrf_lv1[i])) {
                 synchDisk->ReadSector(unrf_lv1[i], (char *) unrf_lv2);
-                for (unsigned j = 0; j < 32; j++) {
+                for (unsigned j = 0; j < PTRS_PER_SECTOR; j++) {
                     DEBUG('f', "Level2[%u] = %u\n", j, unrf_lv2[j]);
                     if (unrf_lv2[j] != NOT_ASSIGNED &&
                       freeMap->Test(unrf_lv2[j]))
@@ -178,6 +416,7 @@ FileHeader::Deallocate(Bitmap * freeMap)
     raw.unrefSectors = NOT_ASSIGNED;
     raw.numBytes     = 0;
     raw.numSectors   = 0;
+    InvalidateIndirect();
 } // FileHeader::Deallocate
 
 /// Fetch contents of file header from disk.
@@ -189,6 +428,16 @@ FileHeader::FetchFrom(unsigned sector)
     DEBUG('f', "\tReading %u\n", sector);
     sectornumber = sector;
     synchDisk->ReadSector(sector, (char *) this);
+    InvalidateIndirect();
+}
+
+/// Drop the cached indirection tables; the next `ByteToSector` in the
+/// indirect range re-reads them from disk.
+void
+FileHeader::InvalidateIndirect()
+{
+    lv1Valid = false;
+    lv2Index = NOT_ASSIGNED;
 }
 
 /// Write the modified contents of the file header back to disk.
@@ -213,6 +462,9 @@ FileHeader::ByteToSector(unsigned offset)
 {
     // Retorno el bloque correspondiente(Si no lo tengo, lo creo)
     DEBUG('f', "ByteToSector %u\n", offset);
+    // En un archivo comprimido las entradas del mapa no son sectores
+    // sueltos (cf. `ReadGroup`/`WriteGroup`).
+    ASSERT(!IsCompressed());
     unsigned sector = offset / SECTOR_SIZE;
     // Me fijo si es un sector directo
     if (raw.numSectors < sector) {
@@ -220,24 +472,92 @@ FileHeader::ByteToSector(unsigned offset)
     }
 
     if (sector < NUM_DIRECT) {
+        // Puede ser NOT_ASSIGNED: un agujero, que se lee como ceros.
         sector = raw.dataSectors[sector];
         return sector;
     }
 
     sector -= NUM_DIRECT;
-    unsigned * unrf_lv1 = new unsigned[32];
-    unsigned * unrf_lv2 = new unsigned[32];
-    // Limpio los arreglos
-    for (unsigned i = 0; i < 32; i++) {
-        unrf_lv1[i] = unrf_lv2[i] = NOT_ASSIGNED;
+    // Si las tablas de indireccion todavia no existen, todo el rango
+    // indirecto es un agujero.
+    if (raw.unrefSectors == NOT_ASSIGNED) {
+        return NOT_ASSIGNED;
+    }
+    // Uso las tablas de indireccion cacheadas en memoria; solo toco el
+    // disco la primera vez (o al cambiar de bloque de segundo nivel).
+    if (!lv1Valid) {
+        synchDisk->ReadSector(raw.unrefSectors, (char *) lv1Cache);
+        lv1Valid = true;
+    }
+    if (lv1Cache[sector / PTRS_PER_SECTOR] == NOT_ASSIGNED) {
+        return NOT_ASSIGNED;
+    }
+    if (lv2Index != sector / PTRS_PER_SECTOR) {
+        synchDisk->ReadSector(lv1Cache[sector / PTRS_PER_SECTOR],
+          (char *) lv2Cache);
+        lv2Index = sector / PTRS_PER_SECTOR;
     }
-    synchDisk->ReadSector(raw.unrefSectors, (char *) unrf_lv1);
-    synchDisk->ReadSector(unrf_lv1[sector / 32], (char *) unrf_lv2);
 
-    sector = unrf_lv2[sector % 32];
+    sector = lv2Cache[sector % PTRS_PER_SECTOR];
     return sector;
 } // FileHeader::ByteToSector
 
+/// Junta todos los sectores que respaldan al archivo: el header, las
+/// tablas de indireccion (si existen) y los sectores de datos, sin los
+/// agujeros.  Lo usa el fsync por archivo para bajar a disco solo lo
+/// que le pertenece (cf. `OpenFile::Sync`).
+unsigned
+FileHeader::CollectSectors(unsigned * list, unsigned max)
+{
+    unsigned n = 0;
+
+    if (n < max && sectornumber != NOT_ASSIGNED)
+        list[n++] = sectornumber;
+    if (IsCompressed()) {
+        for (unsigned g = 0; g < DivRoundUp(raw.numSectors, COMP_GROUP);
+          g++)
+        {
+            unsigned entry = raw.dataSectors[g];
+            if (entry == NOT_ASSIGNED)
+                continue;
+            for (unsigned k = 0; k < CompExtentLen(entry) && n < max; k++)
+                list[n++] = CompExtentFirst(entry) + k;
+        }
+        return n;
+    }
+    for (unsigned i = 0; i < raw.numSectors && i < NUM_DIRECT; i++) {
+        if (raw.dataSectors[i] != NOT_ASSIGNED && n < max)
+            list[n++] = raw.dataSectors[i];
+    }
+    if (raw.numSectors <= NUM_DIRECT || raw.unrefSectors == NOT_ASSIGNED)
+        return n;
+
+    if (n < max)
+        list[n++] = raw.unrefSectors;
+    if (!lv1Valid) {
+        synchDisk->ReadSector(raw.unrefSectors, (char *) lv1Cache);
+        lv1Valid = true;
+    }
+    unsigned indirect = raw.numSectors - NUM_DIRECT;
+    for (unsigned t = 0; t * PTRS_PER_SECTOR < indirect; t++) {
+        if (lv1Cache[t] == NOT_ASSIGNED)
+            continue;
+        if (n < max)
+            list[n++] = lv1Cache[t];
+        if (lv2Index != t) {
+            synchDisk->ReadSector(lv1Cache[t], (char *) lv2Cache);
+            lv2Index = t;
+        }
+        for (unsigned k = 0; k < PTRS_PER_SECTOR
+          && t * PTRS_PER_SECTOR + k < indirect; k++)
+        {
+            if (lv2Cache[k] != NOT_ASSIGNED && n < max)
+                list[n++] = lv2Cache[k];
+        }
+    }
+    return n;
+}
+
 /// Return the number of bytes in the file.
 unsigned
 FileHeader::FileLength() const
@@ -245,6 +565,25 @@ FileHeader::FileLength() const
     return raw.numSectors * SECTOR_SIZE;
 }
 
+unsigned
+FileHeader::LinkCount() const
+{
+    return raw.linkCount;
+}
+
+void
+FileHeader::IncLink()
+{
+    raw.linkCount++;
+}
+
+unsigned
+FileHeader::DecLink()
+{
+    ASSERT(raw.linkCount > 0);
+    return --raw.linkCount;
+}
+
 /// Print the contents of the file header, and the contents of all the data
 /// blocks pointed to by the file header.
 void
@@ -259,20 +598,42 @@ FileHeader::Print()
       "    Block numbers: ",
       raw.numBytes);
 
+    if (IsCompressed()) {
+        // Cada entrada es un extent `primero(xlargo)`; el volcado de
+        // contenidos exigiria descomprimir, asi que solo va el mapa.
+        for (unsigned g = 0; g < DivRoundUp(raw.numSectors, COMP_GROUP);
+          g++)
+        {
+            if (raw.dataSectors[g] == NOT_ASSIGNED)
+                printf("- ");
+            else
+                printf("%u(x%u) ", CompExtentFirst(raw.dataSectors[g]),
+                  CompExtentLen(raw.dataSectors[g]));
+        }
+        printf("\n    Contents: (compressed)\n");
+        delete [] data;
+        delete sectors_list;
+        return;
+    }
+
+    // Los agujeros (NOT_ASSIGNED) se imprimen como `-` y se leen como
+    // ceros.
     for (unsigned i = 0; i < min(raw.numSectors, NUM_DIRECT); i++) {
-        printf("%u ", raw.dataSectors[i]);
+        if (raw.dataSectors[i] == NOT_ASSIGNED)
+            printf("- ");
+        else
+            printf("%u ", raw.dataSectors[i]);
         sectors_list->Append(raw.dataSectors[i]);
     }
 
-    if (raw.numSectors > NUM_DIRECT) {
-        ASSERT(raw.unrefSectors != NOT_ASSIGNED);
-        unsigned * unrf_lv1 = new unsigned[32];
-        unsigned * unrf_lv2 = new unsigned[32];
+    if (raw.numSectors > NUM_DIRECT && raw.unrefSectors != NOT_ASSIGNED) {
+        unsigned * unrf_lv1 = new unsigned[PTRS_PER_SECTOR];
+        unsigned * unrf_lv2 = new unsigned[PTRS_PER_SECTOR];
         synchDisk->ReadSector(raw.unrefSectors, (char *) unrf_lv1);
-        for (unsigned i = 0; i < 32; i++) {
+        for (unsigned i = 0; i < PTRS_PER_SECTOR; i++) {
             if (unrf_lv1[i] != NOT_ASSIGNED) {
                 synchDisk->ReadSector(unrf_lv1[i], (char *) unrf_lv2);
-                for (unsigned j = 0; j < 32; j++) {
+                for (unsigned j = 0; j < PTRS_PER_SECTOR; j++) {
                     if (unrf_lv2[j] != NOT_ASSIGNED) {
                         printf("%u ", unrf_lv2[j]);
                         sectors_list->Append(unrf_lv2[j]);
@@ -286,7 +647,10 @@ FileHeader::Print()
     unsigned bytes = 0;
     while (!sectors_list->IsEmpty()) {
         unsigned sector = sectors_list->Pop();
-        synchDisk->ReadSector(sector, data);
+        if (sector == NOT_ASSIGNED)
+            memset(data, 0, SECTOR_SIZE);
+        else
+            synchDisk->ReadSector(sector, data);
         for (unsigned j = 0;
           j < SECTOR_SIZE && bytes < raw.numBytes;
           j++, bytes++)
@@ -312,6 +676,24 @@ bool
 FileHeader::Extend(Bitmap * freeMap, unsigned size)
 {
     Get_Lock();
+
+    if (IsCompressed()) {
+        // Los grupos nuevos nacen como agujeros y recien consumen disco
+        // cuando se escriben (cf. `WriteGroup`): aca solo crece el
+        // tamanio logico.
+        unsigned grow = DivRoundUp(size, SECTOR_SIZE);
+        if (raw.numSectors + grow > NUM_DIRECT * COMP_GROUP) {
+            Release_Lock();
+            return false;
+        }
+        raw.numSectors += grow;
+        Release_Lock();
+        return true;
+    }
+
+    // Uso el sector del header como pista de localidad para los bloques
+    // nuevos.
+    unsigned near = sectornumber != NOT_ASSIGNED ? sectornumber : 0;
     // Retorno el bloque correspondiente(Si no lo tengo, lo creo)
     unsigned new_sectors     = DivRoundUp(size, SECTOR_SIZE);
     unsigned current_sectors = raw.numSectors;
@@ -320,7 +702,7 @@ FileHeader::Extend(Bitmap * freeMap, unsigned size)
     if (current_sectors + new_sectors > NUM_DIRECT) {
         if (raw.unrefSectors == NOT_ASSIGNED)
             total_sectors++;
-        total_sectors += DivRoundUp(new_sectors, (unsigned) 32);
+        total_sectors += DivRoundUp(new_sectors, PTRS_PER_SECTOR);
     }
 
     if (freeMap->CountClear() < total_sectors) {
@@ -331,7 +713,7 @@ FileHeader::Extend(Bitmap * freeMap, unsigned size)
     raw.numSectors += new_sectors;
 
     for (unsigned i = current_sectors; i < NUM_DIRECT && 0 < new_sectors; i++) {
-        raw.dataSectors[i] = freeMap->Find();
+        raw.dataSectors[i] = freeMap->FindFrom(near);
         new_sectors--;
     }
 
@@ -340,42 +722,45 @@ FileHeader::Extend(Bitmap * freeMap, unsigned size)
         return true;
     }
 
-    // raw.unrefSectors -> [p0|p2|...|p31]
-    //                      pN -> [b1|b2|...|b31]
+    // raw.unrefSectors -> [p0|p2|...|pN]
+    //                      pN -> [b1|b2|...|bN]
     //                             bN -> [Sector con informacion del archivo]
     current_sectors -= NUM_DIRECT;
-    unsigned * unrf_lv1 = new unsigned[32];
-    unsigned * unrf_lv2 = new unsigned[32];
+    unsigned * unrf_lv1 = new unsigned[PTRS_PER_SECTOR];
+    unsigned * unrf_lv2 = new unsigned[PTRS_PER_SECTOR];
     // Limpio los arreglos
-    for (unsigned i = 0; i < 32; i++) {
+    for (unsigned i = 0; i < PTRS_PER_SECTOR; i++) {
         unrf_lv1[i] = unrf_lv2[i] = NOT_ASSIGNED;
     }
 
     // Leo raw.unrefSectors -> [p0|p2|...|p31] (si no existe lo creo)
     if (raw.unrefSectors == NOT_ASSIGNED) {
-        raw.unrefSectors = freeMap->Find();
+        raw.unrefSectors = freeMap->FindFrom(near);
     } else {
         synchDisk->ReadSector(raw.unrefSectors, (char *) unrf_lv1);
     }
 
-    for (unsigned i = current_sectors / 32; i < 32 && 0 < new_sectors; i++) {
+    for (unsigned i = current_sectors / PTRS_PER_SECTOR;
+      i < PTRS_PER_SECTOR && 0 < new_sectors; i++)
+    {
         if (unrf_lv1[i] == NOT_ASSIGNED) {
-            unrf_lv1[i] = freeMap->Find();
-            for (unsigned k = 0; k < 32; k++) {
+            unrf_lv1[i] = freeMap->FindFrom(near);
+            for (unsigned k = 0; k < PTRS_PER_SECTOR; k++) {
                 unrf_lv2[k] = NOT_ASSIGNED;
             }
         } else {
             synchDisk->ReadSector(unrf_lv1[i], (char *) unrf_lv2);
         }
-        for (unsigned j = 0; j < 32 && 0 < new_sectors; j++) {
+        for (unsigned j = 0; j < PTRS_PER_SECTOR && 0 < new_sectors; j++) {
             if (unrf_lv2[j] == NOT_ASSIGNED) {
-                unrf_lv2[j] = freeMap->Find();
+                unrf_lv2[j] = freeMap->FindFrom(near);
                 new_sectors--;
             }
         }
         synchDisk->WriteSector(unrf_lv1[i], (char *) unrf_lv2);
     }
     synchDisk->WriteSector(raw.unrefSectors, (char *) unrf_lv1);
+    InvalidateIndirect(); // Las tablas en disco cambiaron.
     Release_Lock();
     return (new_sectors <= 0);
 } // FileHeader::Extend
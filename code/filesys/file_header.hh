@@ -34,9 +34,18 @@ class FileHeader {
 public:
 
     /// Initialize a file header, including allocating space on disk for the
-    /// file data.
+    /// file data.  `near` is a locality hint (typically the header's own
+    /// sector): data blocks are placed at or after it when possible.  With
+    /// `compressed` the file is created in compressed mode (cf.
+    /// `FH_COMPRESSED`).
     bool
-    Allocate(Bitmap * bitMap, unsigned fileSize = 0);
+    Allocate(Bitmap * bitMap, unsigned fileSize = 0, unsigned near = 0,
+      bool compressed = false);
+
+    /// Materialize the hole holding byte `offset`: back it with a real
+    /// disk sector (files start out as all holes, cf. `Allocate`).
+    bool
+    AllocSector(Bitmap * bitMap, unsigned offset);
 
     /// De-allocate this file's data blocks.
     void
@@ -65,6 +74,44 @@ public:
 
     bool
     Extend(Bitmap * bitMap, unsigned size);
+
+    /// Is this a compressed file (cf. `FH_COMPRESSED`)?
+    bool
+    IsCompressed() const;
+
+    /// Read the whole compression group `group` (`COMP_GROUP_BYTES`
+    /// bytes) into `data`, decompressing its extent; holes read as
+    /// zeroes.
+    void
+    ReadGroup(unsigned group, char * data);
+
+    /// Rewrite group `group` with the `COMP_GROUP_BYTES` in `data`:
+    /// compress, allocate a contiguous extent of exactly the needed
+    /// length and release the old one if the size changed.  Returns
+    /// false if the disk is full.
+    bool
+    WriteGroup(Bitmap * bitMap, unsigned group, const char * data);
+
+    /// Hard-link accounting: one count per directory entry pointing at
+    /// this header (cf. `FileSystem::Link`).  The file's sectors are only
+    /// freed when the count drops to zero.
+    unsigned
+    LinkCount() const;
+
+    void
+    IncLink();
+
+    /// Drop one link; return how many remain.
+    unsigned
+    DecLink();
+
+    /// Fill `list` with every disk sector backing this file -- the
+    /// header itself, the indirection tables (if any) and the data
+    /// sectors, skipping holes -- up to `max` entries.  Returns how
+    /// many were written.  Used by fsync to flush one file's sectors.
+    unsigned
+    CollectSectors(unsigned * list, unsigned max);
+
     /// Get the raw file header structure.
     ///
     /// NOTE: this should only be used by routines that operating on the file
@@ -76,6 +123,21 @@ private:
     RawFileHeader raw;
     unsigned sectornumber = NOT_ASSIGNED;
 
+    /// In-memory copies of the indirection sectors, so `ByteToSector` does
+    /// not pay two disk reads per call once a table has been touched.
+    /// These live past the first `SECTOR_SIZE` bytes of the object, so the
+    /// raw `FetchFrom`/`WriteBack` of `this` does not touch them.
+    unsigned lv1Cache[PTRS_PER_SECTOR];
+    unsigned lv2Cache[PTRS_PER_SECTOR];
+    bool     lv1Valid = false;            ///< Is `lv1Cache` loaded?
+    unsigned lv2Index = NOT_ASSIGNED;     ///< Level-1 slot held in
+                                          ///< `lv2Cache`, if any.
+
+    /// Forget the cached indirection tables (after the on-disk ones may
+    /// have changed).
+    void
+    InvalidateIndirect();
+
     void
     Get_Lock();
 
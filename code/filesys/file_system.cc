@@ -59,7 +59,16 @@ static const unsigned DIRECTORY_SECTOR = 1;
 /// Initial file sizes for the bitmap and directory; until the file system
 /// supports extensible files, the directory size sets the maximum number of
 /// files that can be loaded onto the disk.
-static const unsigned FREE_MAP_FILE_SIZE  = NUM_SECTORS / BITS_IN_BYTE;
+///
+/// The free map holds one bit per sector, so its size follows the disk
+/// geometry chosen at startup (`-dg`) and cannot be a compile-time
+/// constant.
+static unsigned
+FreeMapFileSize()
+{
+    return NUM_SECTORS / BITS_IN_BYTE;
+}
+
 static const unsigned DIRECTORY_FILE_SIZE = sizeof(DirectoryEntry)
   * NUM_DIR_ENTRIES;
 
@@ -121,6 +130,9 @@ CheckRoot(const char * _path)
             len++;
         }
         strncpy(path + len, _path, strlen(_path));
+        // `strncpy` con ese largo no copia el terminador, y el buffer
+        // recien alocado trae basura detras.
+        path[len + strlen(_path)] = '\0';
         return path;
     } else {
         return _path;
@@ -138,31 +150,61 @@ FileSystem::OpenPath(const char * __path, int * _sector)
     const char * _path = CheckRoot(__path);
     DEBUG('F', "_path: \"%s\"", _path);
     OpenFile * dir_file = nullptr;
-    int sector = DIRECTORY_SECTOR;
+    int sector  = DIRECTORY_SECTOR;
+    bool loaded = false; ///< ¿`dir` tiene cargado el directorio `sector`?
     Directory * dir = new Directory(NUM_DIR_ENTRIES);
     char * path = new char[PATH_MAX_LEN], * p;
     strncpy(path, _path + 1, strlen(_path) - 1);
+    path[strlen(_path) - 1] = '\0'; // `strncpy` no llega al terminador.
     p = path;
     DEBUG('F', "Abriendo %s\n", path);
 
-    dir->FetchFrom(directoryFile);
     unsigned l = strlen(path);
     for (unsigned i = 0; i < l; i++) {
         if (path[i] == '/') {
             path[i] = '\0';
-            sector  = dir->Find(p, true);
-            if (sector == -1) {
-                DEBUG('F', "No existe %s en %s\n", p, _path);
-                return nullptr;
+            // Con un hit en la cache de nombres el componente se
+            // resuelve sin leer el directorio que lo contiene.
+            int hit = DentryLookup(sector, p);
+            if (hit >= 0) {
+                DEBUG('F', "Dentry hit: %s -> %d\n", p, hit);
+                sector = hit;
+                loaded = false;
             } else {
+                if (!loaded) {
+                    if (sector == DIRECTORY_SECTOR) {
+                        dir->FetchFrom(directoryFile);
+                    } else {
+                        dir_file = new OpenFile(sector);
+                        dir->FetchFrom(dir_file);
+                        delete dir_file;
+                    }
+                    loaded = true;
+                }
+                int child = dir->Find(p, true);
+                if (child == -1) {
+                    DEBUG('F', "No existe %s en %s\n", p, _path);
+                    delete dir;
+                    delete [] path;
+                    return nullptr;
+                }
                 DEBUG('F', "Accediendo a directorio %s\n", p);
-                dir_file = new OpenFile(sector);
-                dir->FetchFrom(dir_file);
-                delete dir_file;
+                DentryInsert(sector, p, child);
+                sector = child;
+                loaded = false;
             }
             p += i + 1;
         }
     }
+    if (!loaded) {
+        if (sector == DIRECTORY_SECTOR) {
+            dir->FetchFrom(directoryFile);
+        } else {
+            dir_file = new OpenFile(sector);
+            dir->FetchFrom(dir_file);
+            delete dir_file;
+        }
+    }
     *_sector = sector;
 
     delete[] path;
@@ -181,6 +223,14 @@ FileSystem::OpenPath(const char * __path, int * _sector)
 FileSystem::FileSystem(bool format)
 {
     DEBUG('F', "Initializing the file system.\n");
+    for (unsigned i = 0; i < DENTRY_CACHE_SIZE; i++)
+        dentryCache[i].valid = false;
+    dentryVictim = 0;
+    headerCache  = new ::List<HeaderNode>;
+    headerLock   = new Lock("header cache lock");
+    headerIdle   = 0;
+    reclaimQueue = new ::List<char *>;
+    reclaimLock  = new Lock("reclaim queue lock");
     if (format) {
         Bitmap * freeMap       = new Bitmap(NUM_SECTORS);
         Directory * directory  = new Directory(NUM_DIR_ENTRIES);
@@ -194,12 +244,32 @@ FileSystem::FileSystem(bool format)
         freeMap->Mark(FREE_MAP_SECTOR);
         freeMap->Mark(DIRECTORY_SECTOR);
 
+        // The tail of the disk belongs to the metadata journal; keep it
+        // out of the allocation pool and leave it formatted (empty).
+        for (unsigned i = JournalStart(); i < NUM_SECTORS; i++)
+            freeMap->Mark(i);
+        journal->Format();
+
         // Second, allocate space for the data blocks containing the contents
         // of the directory and bitmap files.  There better be enough space!
 
-        ASSERT(mapHeader->Allocate(freeMap, FREE_MAP_FILE_SIZE));
+        // The free map itself must fit in one file; with very large
+        // geometries it would outgrow even the double-indirect blocks.
+        ASSERT(DivRoundUp(FreeMapFileSize(), SECTOR_SIZE)
+          <= NUM_DIRECT + PTRS_PER_SECTOR * PTRS_PER_SECTOR);
+        ASSERT(mapHeader->Allocate(freeMap, FreeMapFileSize()));
         ASSERT(dirHeader->Allocate(freeMap, DIRECTORY_FILE_SIZE));
 
+        // Files start out as all holes, but these two cannot: writing a
+        // hole materializes it through the global `fileSystem`, which does
+        // not exist yet, and materializing a free map sector would read
+        // the on-disk map, which right now is garbage.  Back all their
+        // blocks here, while the authoritative map is still in memory.
+        for (unsigned i = 0; i < FreeMapFileSize(); i += SECTOR_SIZE)
+            ASSERT(mapHeader->AllocSector(freeMap, i));
+        for (unsigned i = 0; i < DIRECTORY_FILE_SIZE; i += SECTOR_SIZE)
+            ASSERT(dirHeader->AllocSector(freeMap, i));
+
         // Flush the bitmap and directory `FileHeader`s back to disk.
         // We need to do this before we can `Open` the file, since open reads
         // the file header off of disk (and currently the disk has garbage on
@@ -239,15 +309,262 @@ FileSystem::FileSystem(bool format)
         // If we are not formatting the disk, just open the files
         // representing the bitmap and directory; these are left open while
         // Nachos is running.
+
+        // But first replay whatever metadata batch a crash may have left
+        // committed in the journal, so the sectors read below are
+        // consistent.
+        journal->Recover();
+
         freeMapFile   = new OpenFile(FREE_MAP_SECTOR);
         directoryFile = new OpenFile(DIRECTORY_SECTOR);
     }
+
+    // Casi toda operacion relee estos sectores; fijarlos en la cache de
+    // disco evita que un stream de datos grande los desaloje.
+    PinHotMetadata();
+}
+
+/// Fija en la cache de disco las cabeceras del mapa de libres y del
+/// directorio raiz, y sus primeros bloques de datos, hasta agotar la
+/// cuota de sectores fijos (`PINNED_MAX`).
+void
+FileSystem::PinHotMetadata()
+{
+    static const unsigned HOT[] = { FREE_MAP_SECTOR, DIRECTORY_SECTOR };
+
+    for (unsigned f = 0; f < 2; f++) {
+        if (!synchDisk->PinSector(HOT[f]))
+            return;
+        FileHeader * header = new FileHeader;
+        header->FetchFrom(HOT[f]);
+        const RawFileHeader * raw = header->GetRaw();
+        for (unsigned i = 0; i < raw->numSectors && i < NUM_DIRECT; i++) {
+            if (raw->dataSectors[i] == NOT_ASSIGNED)
+                continue;
+            if (!synchDisk->PinSector(raw->dataSectors[i]))
+                break;
+        }
+        delete header;
+    }
 }
 
 FileSystem::~FileSystem()
 {
+    ReclaimPending(); // No dejar sectores colgados al apagar.
+    delete reclaimQueue;
+    delete reclaimLock;
     delete freeMapFile;
     delete directoryFile;
+    while (!headerCache->IsEmpty()) {
+        HeaderNode node = headerCache->Pop();
+        delete node.header;
+    }
+    delete headerCache;
+    delete headerLock;
+}
+
+/// How many headers with no remaining users the cache keeps for future
+/// opens.
+static const unsigned HEADER_CACHE_IDLE = 8;
+
+static unsigned auxHeaderSector = 0;
+
+static bool
+AuxHeaderBySector(HeaderNode n)
+{
+    return n.sector == auxHeaderSector;
+}
+
+static bool
+AuxHeaderIdle(HeaderNode n)
+{
+    return n.refs == 0;
+}
+
+FileHeader *
+FileSystem::AcquireHeader(unsigned sector)
+{
+    headerLock->Acquire();
+    auxHeaderSector = sector;
+    HeaderNode * node = headerCache->GetFirst(AuxHeaderBySector);
+    if (node == nullptr) {
+        HeaderNode fresh;
+        fresh.sector = sector;
+        fresh.refs   = 0;
+        fresh.header = new FileHeader;
+        fresh.header->FetchFrom(sector);
+        headerCache->Prepend(fresh);
+        node = headerCache->GetFirst(AuxHeaderBySector);
+    } else if (node->refs == 0) {
+        headerIdle--;
+    }
+    node->refs++;
+    headerLock->Release();
+    return node->header;
+}
+
+void
+FileSystem::ReleaseHeader(unsigned sector)
+{
+    headerLock->Acquire();
+    auxHeaderSector = sector;
+    HeaderNode * node = headerCache->GetFirst(AuxHeaderBySector);
+    ASSERT(node != nullptr && node->refs > 0);
+    if (--node->refs == 0) {
+        headerIdle++;
+        // Unos pocos headers sin usuarios quedan como cache para
+        // re-opens; el resto se libera.
+        if (headerIdle > HEADER_CACHE_IDLE) {
+            HeaderNode * idle = headerCache->GetFirst(AuxHeaderIdle);
+            delete idle->header;
+            headerCache->Remove(*idle);
+            headerIdle--;
+        }
+    }
+    headerLock->Release();
+}
+
+void
+FileSystem::EvictHeader(unsigned sector)
+{
+    headerLock->Acquire();
+    auxHeaderSector = sector;
+    HeaderNode * node = headerCache->GetFirst(AuxHeaderBySector);
+    if (node != nullptr && node->refs == 0) {
+        delete node->header;
+        headerCache->Remove(*node);
+        headerIdle--;
+    }
+    headerLock->Release();
+}
+
+void
+FileSystem::ReclaimLater(const char * name)
+{
+    ASSERT(name != nullptr);
+
+    char * copy = new char[PATH_MAX_LEN];
+    strncpy(copy, name, PATH_MAX_LEN);
+    reclaimLock->Acquire();
+    reclaimQueue->Append(copy);
+    reclaimLock->Release();
+    DEBUG('F', "Encolado %s para liberar en background\n", name);
+    KickReclaimDaemon();
+}
+
+void
+FileSystem::ReclaimPending()
+{
+    // Me robo la cola entera; lo encolado de aca en mas es de la
+    // proxima tanda.
+    reclaimLock->Acquire();
+    if (reclaimQueue->IsEmpty()) {
+        reclaimLock->Release();
+        return;
+    }
+    ::List<char *> * batch = reclaimQueue;
+    reclaimQueue = new ::List<char *>;
+    reclaimLock->Release();
+
+    // Un solo fetch y write-back del mapa de libres para toda la tanda,
+    // en lugar de uno por archivo.
+    Bitmap * freeMap = new Bitmap(NUM_SECTORS);
+    freeMap->FetchFrom(freeMapFile);
+    journal->Begin();
+    while (!batch->IsEmpty()) {
+        char * path = batch->Pop();
+        ReclaimOne(path, freeMap);
+        delete [] path;
+    }
+    freeMap->WriteBack(freeMapFile);
+    journal->Commit();
+    delete freeMap;
+    delete batch;
+    DentryFlush();
+}
+
+void
+FileSystem::ReclaimOne(const char * _path, Bitmap * freeMap)
+{
+    const char * path = CheckRoot(_path);
+    int sector, dir_sector;
+    Directory * directory = OpenPath(path, &dir_sector);
+
+    if (directory == nullptr)
+        return; // El directorio padre ya no existe.
+
+    const char * name = getName(path);
+    sector = directory->Find(name);
+    if (sector < 0) {
+        // Ya lo borro otro (o la entrada se recreo y borro); nada que
+        // hacer.
+        delete directory;
+        return;
+    }
+    // Si lo volvieron a abrir mientras esperaba en la cola, se vuelve a
+    // diferir: el ultimo en cerrarlo lo encola de nuevo.
+    Filenode * node = filetable->find(sector);
+    if (node != nullptr && node->users != 0) {
+        node->remove = true;
+        delete directory;
+        return;
+    }
+
+    FileHeader * fileHeader = AcquireHeader(sector);
+    directory->Remove(name);
+    if (fileHeader->DecLink() > 0) {
+        // Hay otro nombre para el archivo: solo cae la entrada.
+        fileHeader->WriteBack(sector);
+    } else {
+        fileHeader->Deallocate(freeMap);
+        freeMap->Clear(sector);
+        filetable->remove(sector);
+    }
+
+    if (dir_sector == DIRECTORY_SECTOR) {
+        directory->WriteBack(directoryFile);
+    } else {
+        OpenFile * f = new OpenFile(dir_sector);
+        directory->WriteBack(f);
+        delete f;
+    }
+
+    ReleaseHeader(sector);
+    EvictHeader(sector);
+
+    delete directory;
+    DEBUG('F', "Liberado en background: %s\n", _path);
+}
+
+int
+FileSystem::DentryLookup(unsigned parent, const char * name)
+{
+    for (unsigned i = 0; i < DENTRY_CACHE_SIZE; i++)
+        if (dentryCache[i].valid && dentryCache[i].parent == parent &&
+          !strncmp(dentryCache[i].name, name, PATH_MAX_LEN))
+            return dentryCache[i].sector;
+
+    return -1;
+}
+
+void
+FileSystem::DentryInsert(unsigned parent, const char * name,
+  unsigned sector)
+{
+    Dentry * d = &dentryCache[dentryVictim];
+
+    dentryVictim = (dentryVictim + 1) % DENTRY_CACHE_SIZE;
+    d->parent = parent;
+    strncpy(d->name, name, PATH_MAX_LEN);
+    d->sector = sector;
+    d->valid  = true;
+}
+
+void
+FileSystem::DentryFlush()
+{
+    for (unsigned i = 0; i < DENTRY_CACHE_SIZE; i++)
+        dentryCache[i].valid = false;
 }
 
 /// Create a file in the Nachos file system (similar to UNIX `create`).
@@ -275,8 +592,11 @@ FileSystem::~FileSystem()
 ///
 /// * `name` is the name of file to be created.
 /// * `initialSize` is the size of file to be created.
+/// * `compressed` makes the file store its data in compressed extents
+///   (cf. `FileHeader::WriteGroup`).
 bool
-FileSystem::Create(const char * _path, unsigned initialSize)
+FileSystem::Create(const char * _path, unsigned initialSize,
+  bool compressed)
 {
     ASSERT(_path != nullptr);
 
@@ -300,18 +620,23 @@ FileSystem::Create(const char * _path, unsigned initialSize)
     } else {
         freeMap = new Bitmap(NUM_SECTORS);
         freeMap->FetchFrom(freeMapFile);
-        sector = freeMap->Find(); // Find a sector to hold the file header.
+        // El header va al grupo (pista) mas vacio, y los datos cerca de el.
+        sector = freeMap->FindSpread(SECTORS_PER_TRACK);
         if (sector == -1) {
             success = false; // No free block for file header.
         } else if (!directory->Add(name, sector)) {
             success = false; // No space in directory.
         } else {
             header = new FileHeader;
-            if (!header->Allocate(freeMap, initialSize)) {
+            if (!header->Allocate(freeMap, initialSize, sector,
+              compressed))
+            {
                 success = false; // No space on disk for data.
             } else {
                 success = true;
-                // Everthing worked, flush all changes back to disk.
+                // Everthing worked, flush all changes back to disk,
+                // journaled as one transaction.
+                journal->Begin();
                 header->WriteBack(sector);
                 freeMap->WriteBack(freeMapFile);
                 if (dir_sector == DIRECTORY_SECTOR) {
@@ -321,6 +646,7 @@ FileSystem::Create(const char * _path, unsigned initialSize)
                     directory->WriteBack(f);
                     delete f;
                 }
+                journal->Commit();
             }
             delete header;
         }
@@ -328,6 +654,7 @@ FileSystem::Create(const char * _path, unsigned initialSize)
     }
     delete directory;
     if (success) {
+        DentryFlush();
         DEBUG('F', "Archivo %s creado\n", path);
     }
 
@@ -349,12 +676,22 @@ FileSystem::Open(const char * _path)
     const char * path = CheckRoot(_path);
 
     int sector, dir_sector;
-    OpenFile * openFile   = nullptr;
+    OpenFile * openFile = nullptr;
+    const char * name   = getName(path);
+
     Directory * directory = OpenPath(path, &dir_sector);
-    const char * name     = getName(path);
+    if (directory == nullptr)
+        return nullptr;
 
     DEBUG('F', "Opening file %s en %s\n", name, path);
-    sector = directory->Find(name);
+    // Un hit en la cache de nombres evita leer el directorio padre.
+    sector = DentryLookup(dir_sector, name);
+    if (sector < 0) {
+        sector = directory->Find(name);
+        if (sector > 1)
+            DentryInsert(dir_sector, name, sector);
+    }
+    delete directory;
     if (sector > 1) {// `name` was found in directory.
         Filenode * node = filetable->find(sector);
         if (node == nullptr)
@@ -364,7 +701,6 @@ FileSystem::Open(const char * _path)
             openFile = new OpenFile(sector);
         }
     }
-    delete directory;
     return openFile; // Return null if not found.
 }
 
@@ -406,17 +742,37 @@ FileSystem::Remove(const char * _path)
         node->remove = true;
     } else {
         Bitmap * freeMap;
-        FileHeader * fileHeader = new FileHeader;
+        FileHeader * fileHeader = AcquireHeader(sector);
 
         directory->Remove(name);
+
+        if (fileHeader->DecLink() > 0) {
+            // Quedan otros nombres apuntando al header: cae solo esta
+            // entrada, los datos siguen vivos.
+            journal->Begin();
+            fileHeader->WriteBack(sector);
+            if (dir_sector == DIRECTORY_SECTOR) {
+                directory->WriteBack(directoryFile);
+            } else {
+                OpenFile * f = new OpenFile(dir_sector);
+                directory->WriteBack(f);
+                delete f;
+            }
+            journal->Commit();
+            ReleaseHeader(sector);
+            delete directory;
+            DentryFlush();
+            return true;
+        }
+
         freeMap = new Bitmap(NUM_SECTORS);
         freeMap->FetchFrom(freeMapFile);
 
         // Aca tira la falla
-        fileHeader->FetchFrom(sector);
         fileHeader->Deallocate(freeMap); // Remove data blocks.
         freeMap->Clear(sector);          // Remove header block.
 
+        journal->Begin();
         freeMap->WriteBack(freeMapFile); // Flush to disk.
 
         if (dir_sector == DIRECTORY_SECTOR) {
@@ -426,19 +782,158 @@ FileSystem::Remove(const char * _path)
             directory->WriteBack(f);
             delete f;
         }
+        journal->Commit();
 
         filetable->remove(sector);
+        ReleaseHeader(sector);
+        EvictHeader(sector); // El sector puede reciclarse en otro archivo.
 
-        delete fileHeader;
         delete freeMap;
     }
     delete directory;
+    DentryFlush(); // El nombre (y quiza su sector) dejan de valer.
 
     DEBUG('F', "Se elimino el archivo\n");
 
     return true;
 } // FileSystem::Remove
 
+bool
+FileSystem::Link(const char * _oldPath, const char * _newPath)
+{
+    ASSERT(_oldPath != nullptr);
+    ASSERT(_newPath != nullptr);
+
+    const char * oldPath = CheckRoot(_oldPath);
+    const char * newPath = CheckRoot(_newPath);
+
+    int old_dir, new_dir;
+    Directory * directory = OpenPath(oldPath, &old_dir);
+    if (directory == nullptr)
+        return false;
+    // Solo archivos: los links duros a directorios armarian ciclos.
+    int sector = directory->Find(getName(oldPath));
+    delete directory;
+    if (sector < 0)
+        return false;
+
+    directory = OpenPath(newPath, &new_dir);
+    if (directory == nullptr)
+        return false;
+    const char * name = getName(newPath);
+    if (directory->Find(name) != -1 || directory->Find(name, true) != -1) {
+        delete directory;
+        return false; // El nombre nuevo ya existe.
+    }
+    if (!directory->Add(name, sector, false)) {
+        delete directory;
+        return false;
+    }
+
+    FileHeader * header = AcquireHeader(sector);
+    header->IncLink();
+    journal->Begin();
+    header->WriteBack(sector);
+    if (new_dir == DIRECTORY_SECTOR) {
+        directory->WriteBack(directoryFile);
+    } else {
+        OpenFile * f = new OpenFile(new_dir);
+        directory->WriteBack(f);
+        delete f;
+    }
+    journal->Commit();
+    ReleaseHeader(sector);
+
+    delete directory;
+    DentryFlush();
+    DEBUG('F', "Link %s -> %s (sector %d)\n", _newPath, _oldPath, sector);
+    return true;
+} // FileSystem::Link
+
+bool
+FileSystem::Rename(const char * _oldPath, const char * _newPath)
+{
+    ASSERT(_oldPath != nullptr);
+    ASSERT(_newPath != nullptr);
+
+    const char * oldPath = CheckRoot(_oldPath);
+    const char * newPath = CheckRoot(_newPath);
+
+    int old_dir, new_dir;
+    Directory * source = OpenPath(oldPath, &old_dir);
+    if (source == nullptr)
+        return false;
+    const char * oldName = getName(oldPath);
+    bool isDir = false;
+    int sector = source->Find(oldName);
+    if (sector < 0) {
+        sector = source->Find(oldName, true);
+        isDir  = true;
+    }
+    if (sector < 0) {
+        delete source;
+        return false;
+    }
+
+    // Con el mismo directorio padre se trabaja sobre un unico objeto;
+    // dos copias en memoria del mismo sector se pisarian entre si.
+    Directory * target = source;
+    new_dir = old_dir;
+    if (strncmp(getParent(oldPath), getParent(newPath),
+      PATH_MAX_LEN) != 0)
+    {
+        target = OpenPath(newPath, &new_dir);
+        if (target == nullptr) {
+            delete source;
+            return false;
+        }
+    }
+
+    const char * newName = getName(newPath);
+    if (target->Find(newName) != -1 || target->Find(newName, true) != -1) {
+        if (target != source)
+            delete target;
+        delete source;
+        return false; // El nombre nuevo ya existe.
+    }
+
+    // Solo se mueve la entrada: ni un bloque de datos se toca, asi que
+    // renombrar un archivo grande cuesta lo mismo que uno chico.  El
+    // alta se baja a disco antes de la baja (cada mutacion de
+    // `Directory` relee su sector), y el journal hace atomico el par.
+    journal->Begin();
+    if (!target->Add(newName, sector, isDir)) {
+        journal->Commit();
+        if (target != source)
+            delete target;
+        delete source;
+        return false;
+    }
+    if (new_dir == DIRECTORY_SECTOR) {
+        target->WriteBack(directoryFile);
+    } else {
+        OpenFile * f = new OpenFile(new_dir);
+        target->WriteBack(f);
+        delete f;
+    }
+    source->Remove(oldName);
+    if (old_dir == DIRECTORY_SECTOR) {
+        source->WriteBack(directoryFile);
+    } else {
+        OpenFile * f = new OpenFile(old_dir);
+        source->WriteBack(f);
+        delete f;
+    }
+    journal->Commit();
+
+    if (target != source)
+        delete target;
+    delete source;
+    DentryFlush();
+    DEBUG('F', "Rename %s -> %s (sector %d)\n", _oldPath, _newPath, sector);
+    return true;
+} // FileSystem::Rename
+
 /// List all the files in the file system directory.
 void
 FileSystem::List(const char * path)
@@ -462,183 +957,252 @@ FileSystem::List(const char * path)
     }
 }
 
+/// Parallel filesystem check ("fsck", flag `-fsck`).
+///
+/// The directory tree is walked sequentially (directories are small) and
+/// every file header sector found goes into a work queue.  Then
+/// `FSCK_WORKERS` kernel threads drain the queue, each validating one
+/// header at a time -- sector numbers in range, no sector owned twice --
+/// and claiming the file's sectors in a shared shadow bitmap.  The
+/// workers read through the sector cache and the disk elevator, so
+/// independent headers overlap their cache hits with each other's disk
+/// waits.  Finally the shadow bitmap is compared against the free map.
+
+static const unsigned FSCK_WORKERS = 4;
+
+static Lock * fsckLock      = nullptr; ///< Guards the queue and the shadow.
+static Semaphore * fsckDone = nullptr; ///< One `V` per finished worker.
+static Bitmap * fsckShadow  = nullptr; ///< Sectors claimed by some owner.
+static unsigned * fsckQueue = nullptr; ///< Header sectors to be checked.
+static unsigned fsckCount, fsckNext;
+static bool fsckOk;
+
+/// Claim `sector` in the shadow bitmap; complain if it is out of range
+/// or somebody claimed it before.  Returns true on error.
 static bool
-AddToShadowBitmap(unsigned sector, Bitmap * map)
+FsckClaimSector(unsigned sector)
 {
-    ASSERT(map != nullptr);
-
-    if (map->Test(sector)) {
-        DEBUG('F', "Sector %u was already marked.\n", sector);
-        return false;
+    if (sector == NOT_ASSIGNED || sector >= NUM_SECTORS) {
+        printf("fsck: bad sector number %u\n", sector);
+        return true;
     }
-    map->Mark(sector);
-    DEBUG('F', "Marked sector %u.\n", sector);
-    return true;
-}
-
-static bool
-CheckForError(bool value, const char * message)
-{
-    if (!value)
-        DEBUG('F', message);
-    return !value;
-}
 
-static bool
-CheckSector(unsigned sector, Bitmap * shadowMap)
-{
-    bool error = false;
+    fsckLock->Acquire();
+    bool claimed = fsckShadow->Test(sector);
+    if (!claimed)
+        fsckShadow->Mark(sector);
+    fsckLock->Release();
 
-    error |= CheckForError(sector < NUM_SECTORS, "Sector number too big.\n");
-    error |= CheckForError(AddToShadowBitmap(sector, shadowMap),
-        "Sector number already used.\n");
-    return error;
+    if (claimed)
+        printf("fsck: sector %u referenced twice\n", sector);
+    return claimed;
 }
 
+/// Validate the file header at `num` and claim every sector it owns:
+/// the data sectors and, for big files, the indirection tables.
+/// Returns true on error.
 static bool
-CheckFileHeader(const RawFileHeader * rh, unsigned num, Bitmap * shadowMap)
+FsckCheckHeader(unsigned num)
 {
-    ASSERT(rh != nullptr);
+    char * buffer = new char [SECTOR_SIZE];
 
+    synchDisk->ReadSector(num, buffer);
+    const RawFileHeader * rh = (const RawFileHeader *) buffer;
     bool error = false;
 
-    DEBUG('F',
-      "Checking file header %u.  File size: %u bytes, number of sectors: %u.\n",
+    DEBUG('F', "Checking file header %u: %u bytes, %u sectors.\n",
       num, rh->numBytes, rh->numSectors);
-    error |= CheckForError(rh->numSectors >= DivRoundUp(rh->numBytes,
-        SECTOR_SIZE),
-        "Sector count not compatible with file size.\n");
-    error |= CheckForError(rh->numSectors < NUM_DIRECT,
-        "Too many blocks.\n");
-    for (unsigned i = 0; i < rh->numSectors; i++) {
-        unsigned s = rh->dataSectors[i];
-        error |= CheckSector(s, shadowMap);
+    if (rh->numSectors < DivRoundUp(rh->numBytes, SECTOR_SIZE)) {
+        printf("fsck: header %u: %u sectors cannot hold %u bytes\n",
+          num, rh->numSectors, rh->numBytes);
+        error = true;
     }
-    return error;
-}
 
-static bool
-CheckBitmaps(const Bitmap * freeMap, const Bitmap * shadowMap)
-{
-    bool error = false;
+    // Holes (`NOT_ASSIGNED` slots, including missing indirection tables)
+    // are legal: files are sparse and sectors only materialize on first
+    // write.
+    if (rh->flags & FH_COMPRESSED) {
+        // Every direct slot is a packed extent of up to `COMP_GROUP`
+        // contiguous sectors; compressed files never use indirection.
+        for (unsigned g = 0; g < DivRoundUp(rh->numSectors, COMP_GROUP);
+          g++)
+        {
+            unsigned entry = rh->dataSectors[g];
+            if (entry == NOT_ASSIGNED)
+                continue;
+            for (unsigned k = 0; k < CompExtentLen(entry); k++)
+                error |= FsckClaimSector(CompExtentFirst(entry) + k);
+        }
+        delete [] buffer;
+        return error;
+    }
 
-    for (unsigned i = 0; i < NUM_SECTORS; i++) {
-        DEBUG('F', "Checking sector %u. Original: %u, shadow: %u.\n",
-          i, freeMap->Test(i), shadowMap->Test(i));
-        error |= CheckForError(freeMap->Test(i) == shadowMap->Test(i),
-            "Inconsistent bitmap.");
+    unsigned direct = rh->numSectors < NUM_DIRECT
+      ? rh->numSectors : NUM_DIRECT;
+    for (unsigned i = 0; i < direct; i++)
+        if (rh->dataSectors[i] != NOT_ASSIGNED)
+            error |= FsckClaimSector(rh->dataSectors[i]);
+
+    if (rh->numSectors > NUM_DIRECT && rh->unrefSectors != NOT_ASSIGNED) {
+        error |= FsckClaimSector(rh->unrefSectors);
+
+        unsigned * lv1 = new unsigned[PTRS_PER_SECTOR];
+        unsigned * lv2 = new unsigned[PTRS_PER_SECTOR];
+        synchDisk->ReadSector(rh->unrefSectors, (char *) lv1);
+        for (unsigned i = 0; i < PTRS_PER_SECTOR; i++) {
+            if (lv1[i] == NOT_ASSIGNED)
+                continue;
+            if (FsckClaimSector(lv1[i])) {
+                error = true;
+                continue;
+            }
+            synchDisk->ReadSector(lv1[i], (char *) lv2);
+            for (unsigned j = 0; j < PTRS_PER_SECTOR; j++)
+                if (lv2[j] != NOT_ASSIGNED)
+                    error |= FsckClaimSector(lv2[j]);
+        }
+        delete [] lv1;
+        delete [] lv2;
     }
+
+    delete [] buffer;
     return error;
-}
+} // FsckCheckHeader
 
-static bool
-CheckDirectory(const RawDirectory * rd, Bitmap * shadowMap)
+/// Claim a header sector and queue it for the workers.
+static void
+FsckEnqueue(unsigned headerSector)
 {
-    ASSERT(rd != nullptr);
-    ASSERT(shadowMap != nullptr);
+    // Un header puede colgar de varias entradas (hard links): si ya lo
+    // reclamo otro nombre y el contador de links lo respalda, no es un
+    // error y no hay que revisarlo dos veces.
+    fsckLock->Acquire();
+    bool claimed = headerSector < NUM_SECTORS
+      && fsckShadow->Test(headerSector);
+    fsckLock->Release();
+    if (claimed) {
+        char * buffer = new char [SECTOR_SIZE];
+        synchDisk->ReadSector(headerSector, buffer);
+        const RawFileHeader * rh = (const RawFileHeader *) buffer;
+        bool linked = rh->linkCount > 1;
+        delete [] buffer;
+        if (linked)
+            return;
+    }
+    if (FsckClaimSector(headerSector))
+        fsckOk = false;
+    fsckQueue[fsckCount++] = headerSector;
+}
 
-    bool error         = false;
-    unsigned nameCount = 0;
-    const char * knownNames[NUM_DIR_ENTRIES];
+/// Walk a directory, queueing every entry and recursing into
+/// subdirectories.
+static void
+FsckCollect(const Directory * dir)
+{
+    const RawDirectory * rd = dir->GetRaw();
 
-    for (unsigned i = 0; i < NUM_DIR_ENTRIES; i++) {
-        DEBUG('F', "Checking direntry: %u.\n", i);
+    for (unsigned i = 0; i < rd->tableSize; i++) {
         const DirectoryEntry * e = &rd->table[i];
+        if (!e->inUse)
+            continue;
+        FsckEnqueue(e->sector);
+        if (e->isDir) {
+            Directory * sub = new Directory(NUM_DIR_ENTRIES);
+            OpenFile * f    = new OpenFile(e->sector);
+            sub->FetchFrom(f);
+            FsckCollect(sub);
+            delete f;
+            delete sub;
+        }
+    }
+}
 
-        if (e->inUse) {
-            if (strlen(e->name) > FILE_NAME_MAX_LEN) {
-                DEBUG('F', "Filename too long.\n");
-                error = true;
-            }
+/// One checker thread: pull header sectors off the queue until it runs
+/// dry.
+static void
+FsckWorker(void * dummy)
+{
+    for (;;) {
+        fsckLock->Acquire();
+        if (fsckNext == fsckCount) {
+            fsckLock->Release();
+            break;
+        }
+        unsigned sector = fsckQueue[fsckNext++];
+        fsckLock->Release();
 
-            // Check for repeated filenames.
-            DEBUG('F', "Checking for repeated names.  Name count: %u.\n",
-              nameCount);
-            bool repeated = false;
-            for (unsigned j = 0; j < nameCount; j++) {
-                DEBUG('F', "Comparing \"%s\" and \"%s\".\n",
-                  knownNames[j], e->name);
-                if (strcmp(knownNames[j], e->name) == 0) {
-                    DEBUG('F', "Repeated filename.\n");
-                    repeated = true;
-                    error    = true;
-                }
-            }
-            if (!repeated) {
-                knownNames[nameCount] = e->name;
-                DEBUG('F', "Added \"%s\" at %u.\n", e->name, nameCount);
-                nameCount++;
-            }
+        if (FsckCheckHeader(sector))
+            fsckOk = false; // Only ever cleared; no lock needed.
+    }
+    fsckDone->V();
+}
 
-            // Check sector.
-            error |= CheckSector(e->sector, shadowMap);
+bool
+FileSystem::Check()
+{
+    DEBUG('F', "Performing filesystem check.\n");
+
+    fsckLock   = new Lock("fsck lock");
+    fsckDone   = new Semaphore("fsck done", 0);
+    fsckShadow = new Bitmap(NUM_SECTORS);
+    // Every header occupies at least one sector, so the queue can never
+    // outgrow the disk.
+    fsckQueue = new unsigned[NUM_SECTORS];
+    fsckCount = fsckNext = 0;
+    fsckOk    = true;
+
+    // The free map and the root directory are files like any other; the
+    // journal region belongs to the journal.
+    FsckEnqueue(FREE_MAP_SECTOR);
+    FsckEnqueue(DIRECTORY_SECTOR);
+    for (unsigned i = JournalStart(); i < NUM_SECTORS; i++)
+        fsckShadow->Mark(i);
+
+    Directory * root = new Directory(NUM_DIR_ENTRIES);
+    root->FetchFrom(directoryFile);
+    FsckCollect(root);
+    delete root;
+
+    for (unsigned i = 0; i < FSCK_WORKERS; i++) {
+        Thread * worker = new Thread("fsck worker");
+        worker->Fork(FsckWorker, nullptr);
+    }
+    for (unsigned i = 0; i < FSCK_WORKERS; i++)
+        fsckDone->P();
 
-            // Check file header.
-            FileHeader * h = new FileHeader;
-            const RawFileHeader * rh = h->GetRaw();
-            h->FetchFrom(e->sector);
-            error |= CheckFileHeader(rh, e->sector, shadowMap);
-            delete h;
+    // Everything claimed must be used in the free map, and vice versa.
+    // A used-but-unclaimed sector is only leaked space, not corruption;
+    // report it separately.
+    Bitmap * freeMap = new Bitmap(NUM_SECTORS);
+    freeMap->FetchFrom(freeMapFile);
+    unsigned leaked = 0;
+    for (unsigned i = 0; i < NUM_SECTORS; i++) {
+        if (fsckShadow->Test(i) && !freeMap->Test(i)) {
+            printf("fsck: sector %u in use but free in the map\n", i);
+            fsckOk = false;
+        } else if (!fsckShadow->Test(i) && freeMap->Test(i)) {
+            leaked++;
         }
     }
-    return error;
-} // CheckDirectory
+    if (leaked > 0)
+        printf("fsck: %u used sectors are unreachable (leaked space)\n",
+          leaked);
 
-bool
-FileSystem::Check() //Obsolete
-{
-    DEBUG('F', "This filesystem check is out of date\n");
-    return false;
-    // DEBUG('F', "Performing filesystem check\n");
-    // bool error = false;
-    //
-    // Bitmap * shadowMap = new Bitmap(NUM_SECTORS);
-    // shadowMap->Mark(FREE_MAP_SECTOR);
-    // shadowMap->Mark(DIRECTORY_SECTOR);
-    //
-    // DEBUG('F', "Checking bitmap's file header.\n");
-    //
-    // FileHeader * bitH = new FileHeader;
-    // const RawFileHeader * bitRH = bitH->GetRaw();
-    // bitH->FetchFrom(FREE_MAP_SECTOR);
-    // DEBUG('F', "  File size: %u bytes, expected %u bytes.\n"
-    //   "  Number of sectors: %u, expected %u.\n",
-    //   bitRH->numBytes, FREE_MAP_FILE_SIZE,
-    //   bitRH->numSectors, FREE_MAP_FILE_SIZE / SECTOR_SIZE);
-    // error |= CheckForError(bitRH->numBytes == FREE_MAP_FILE_SIZE,
-    //     "Bad bitmap header: wrong file size.\n");
-    // error |= CheckForError(
-    //     bitRH->numSectors == FREE_MAP_FILE_SIZE / SECTOR_SIZE,
-    //     "Bad bitmap header: wrong number of sectors.\n");
-    // error |= CheckFileHeader(bitRH, FREE_MAP_SECTOR, shadowMap);
-    // delete bitH;
-    //
-    // DEBUG('F', "Checking directory.\n");
-    //
-    // FileHeader * dirH = new FileHeader;
-    // const RawFileHeader * dirRH = dirH->GetRaw();
-    // dirH->FetchFrom(DIRECTORY_SECTOR);
-    // error |= CheckFileHeader(dirRH, DIRECTORY_SECTOR, shadowMap);
-    // delete dirH;
-    //
-    // Bitmap * freeMap = new Bitmap(NUM_SECTORS);
-    // freeMap->FetchFrom(freeMapFile);
-    // Directory * dir = new Directory(NUM_DIR_ENTRIES);
-    // const RawDirectory * rdir = dir->GetRaw();
-    // dir->FetchFrom(directoryFile);
-    // error |= CheckDirectory(rdir, shadowMap);
-    // delete dir;
-    //
-    // // The two bitmaps should match.
-    // DEBUG('F', "Checking bitmap consistency.\n");
-    // error |= CheckBitmaps(freeMap, shadowMap);
-    // delete shadowMap;
-    // delete freeMap;
-    //
-    // DEBUG('F', error ? "Filesystem check succeeded.\n" :
-    //   "Filesystem check failed.\n");
-    //
-    // return !error;
+    printf("fsck: checked %u headers with %u threads: %s\n",
+      fsckCount, FSCK_WORKERS,
+      fsckOk ? "filesystem is consistent" : "errors found");
+
+    delete freeMap;
+    delete [] fsckQueue;
+    delete fsckShadow;
+    delete fsckDone;
+    delete fsckLock;
+    fsckQueue  = nullptr;
+    fsckShadow = nullptr;
+    fsckDone   = nullptr;
+    fsckLock   = nullptr;
+
+    return fsckOk;
 } // FileSystem::Check
 
 /// Print everything about the file system:
@@ -683,19 +1247,62 @@ FileSystem::Print()
 bool
 FileSystem::Expand(unsigned sector, unsigned size)
 {
-    FileHeader * header = new FileHeader;
+    // Trabajo sobre el header compartido, asi los OpenFile abiertos ven
+    // el nuevo tamano sin releer el sector.
+    FileHeader * header = AcquireHeader(sector);
     Bitmap * freeMap    = new Bitmap(NUM_SECTORS);
     bool ret = false;
 
-    header->FetchFrom(sector);
     freeMap->FetchFrom(freeMapFile);
     if (header->Extend(freeMap, size)) {
+        journal->Begin();
+        freeMap->WriteBack(freeMapFile);
+        header->WriteBack(sector);
+        journal->Commit();
+        ret = true;
+    }
+    delete freeMap;
+    ReleaseHeader(sector);
+    return ret;
+}
+
+bool
+FileSystem::Materialize(unsigned sector, unsigned offset)
+{
+    FileHeader * header = AcquireHeader(sector);
+    Bitmap * freeMap    = new Bitmap(NUM_SECTORS);
+    bool ret = false;
+
+    freeMap->FetchFrom(freeMapFile);
+    if (header->AllocSector(freeMap, offset)) {
+        journal->Begin();
+        freeMap->WriteBack(freeMapFile);
+        header->WriteBack(sector);
+        journal->Commit();
+        ret = true;
+    }
+    delete freeMap;
+    ReleaseHeader(sector);
+    return ret;
+}
+
+bool
+FileSystem::WriteGroup(unsigned sector, unsigned group, const char * data)
+{
+    FileHeader * header = AcquireHeader(sector);
+    Bitmap * freeMap    = new Bitmap(NUM_SECTORS);
+    bool ret = false;
+
+    freeMap->FetchFrom(freeMapFile);
+    if (header->WriteGroup(freeMap, group, data)) {
+        journal->Begin();
         freeMap->WriteBack(freeMapFile);
         header->WriteBack(sector);
+        journal->Commit();
         ret = true;
     }
     delete freeMap;
-    delete header;
+    ReleaseHeader(sector);
     return ret;
 }
 
@@ -735,7 +1342,8 @@ FileSystem::MakeDir(const char * _path)
 
     freeMap = new Bitmap(NUM_SECTORS);
     freeMap->FetchFrom(freeMapFile);
-    sector = freeMap->Find(); // Find a sector to hold the file header.
+    // Igual que para archivos: header en el grupo mas libre.
+    sector = freeMap->FindSpread(SECTORS_PER_TRACK);
     if (sector == -1) {
         DEBUG('F', "No hay sufuciente espacio en el disco\n");
         success = false; // No free block for file header.
@@ -744,7 +1352,7 @@ FileSystem::MakeDir(const char * _path)
     } else {
         DEBUG('F', "Alocando espacio para el directorio\n");
         header = new FileHeader;
-        if (!header->Allocate(freeMap, DIRECTORY_FILE_SIZE)) {
+        if (!header->Allocate(freeMap, DIRECTORY_FILE_SIZE, sector)) {
             success = false; // No space on disk for data.
             directory->Remove(name);
             if (freeMap->Test(sector)) {
@@ -754,6 +1362,7 @@ FileSystem::MakeDir(const char * _path)
         } else {
             success = true;
             DEBUG('F', "Guardo las estructuras en %u\n", sector);
+            journal->Begin();
             synchDisk->ClearSector(sector);
             header->WriteBack(sector);
             freeMap->WriteBack(freeMapFile);
@@ -765,6 +1374,7 @@ FileSystem::MakeDir(const char * _path)
                 directory->WriteBack(f);
                 delete f;
             }
+            journal->Commit();
         }
         delete header;
     }
@@ -806,9 +1416,13 @@ FileSystem::RemoveDir(const char * _path)
         header->Deallocate(freeMap);
         freeMap->Clear(folder_sector);
         delete header;
+        delete folder_file;
+        delete folder;
+        EvictHeader(folder_sector);
     }
 
     // Flush to disk.
+    journal->Begin();
     if (dir_sector == DIRECTORY_SECTOR) {
         directory->WriteBack(directoryFile);
     } else {
@@ -817,9 +1431,11 @@ FileSystem::RemoveDir(const char * _path)
         delete f;
     }
     freeMap->WriteBack(freeMapFile);
+    journal->Commit();
 
     delete freeMap;
     delete directory;
+    DentryFlush(); // Todo lo que colgaba de aca dejo de existir.
 
     return true;
 } // FileSystem::RemoveDir
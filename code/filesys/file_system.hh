@@ -50,8 +50,11 @@ public:
     ~FileSystem(){ }
 
     bool
-    Create(const char * name, unsigned initialSize = 0)
+    Create(const char * name, unsigned initialSize = 0,
+      bool compressed = false)
     {
+        // The stub stores files in the UNIX file system, so there are
+        // no sectors to save: `compressed` is accepted and ignored.
         ASSERT(name != nullptr);
 
         int fileDescriptor = OpenForWrite(name);
@@ -81,14 +84,44 @@ public:
         ASSERT(name != nullptr);
         return Unlink(name) == 0;
     }
+
+    bool
+    Link(const char * oldName, const char * newName)
+    {
+        ASSERT(oldName != nullptr && newName != nullptr);
+        return LinkFile(oldName, newName) == 0;
+    }
+
+    bool
+    Rename(const char * oldName, const char * newName)
+    {
+        ASSERT(oldName != nullptr && newName != nullptr);
+        return RenameFile(oldName, newName) == 0;
+    }
 };
 
 #else // FILESYS
 
+# include "lib/list.hh"
+
+class Bitmap;
 class Directory;
+class FileHeader;
+class Lock;
 
 const unsigned PATH_MAX_LEN = 100;
 
+/// One entry of the in-memory header cache (cf.
+/// `FileSystem::AcquireHeader`).
+struct HeaderNode {
+    unsigned     sector;
+    unsigned     refs;   ///< Active users; 0 = kept only as cache.
+    FileHeader * header;
+    friend bool operator == (const HeaderNode &x, const HeaderNode &y) {
+        return x.sector == y.sector;
+    }
+};
+
 class FileSystem {
 public:
 
@@ -101,9 +134,13 @@ public:
 
     ~FileSystem();
 
-    /// Create a file (UNIX `creat`).
+    /// Create a file (UNIX `creat`).  With `compressed` the file stores
+    /// its data in compressed extents (cf. `FileHeader::WriteGroup`):
+    /// compressible data takes fewer sectors, and so fewer disk
+    /// operations to read back.
     bool
-    Create(const char * path, unsigned initialSize = 32);
+    Create(const char * path, unsigned initialSize = 32,
+      bool compressed = false);
 
     /// Open a file (UNIX `open`).
     OpenFile *
@@ -113,6 +150,18 @@ public:
     bool
     Remove(const char * path);
 
+    /// Add another name for an existing file (UNIX `link`): both entries
+    /// share the header sector, and the data is only freed when the last
+    /// name is removed.
+    bool
+    Link(const char * oldPath, const char * newPath);
+
+    /// Move a file or directory to a new name (UNIX `rename`).  Pure
+    /// directory-entry surgery: no data block is read or written, so the
+    /// cost does not depend on the file size.
+    bool
+    Rename(const char * oldPath, const char * newPath);
+
     /// List all the files in the file system.
     void
     List(const char * path = nullptr);
@@ -128,6 +177,41 @@ public:
     bool
     Expand(unsigned sector, unsigned size);
 
+    /// Back the hole holding byte `offset` of the file whose header is at
+    /// `sector` with a real disk sector (cf. `FileHeader::AllocSector`).
+    bool
+    Materialize(unsigned sector, unsigned offset);
+
+    /// Rewrite compression group `group` of the compressed file whose
+    /// header is at `sector` (cf. `FileHeader::WriteGroup`).
+    bool
+    WriteGroup(unsigned sector, unsigned group, const char * data);
+
+    /// Shared in-memory file headers, refcounted and keyed by header
+    /// sector: every `OpenFile` of the same file (and `Expand`/
+    /// `Materialize`) works on one `FileHeader` object -- including its
+    /// cached indirection tables -- instead of re-reading the header
+    /// sector per operation.
+    FileHeader *
+    AcquireHeader(unsigned sector);
+    void
+    ReleaseHeader(unsigned sector);
+
+    /// Drop a cached header whose sector was deallocated; the sector may
+    /// be reused by an unrelated file.
+    void
+    EvictHeader(unsigned sector);
+
+    /// Deferred reclamation of files removed while open: the last closer
+    /// just queues the name and returns; the reclaim daemon (cf.
+    /// `threads/system.cc`) calls `ReclaimPending`, which frees every
+    /// queued file with a single free-map write-back.
+    void
+    ReclaimLater(const char * name);
+
+    void
+    ReclaimPending();
+
     bool
     MakeDir(const char * path);
 
@@ -139,6 +223,61 @@ private:
     ///< file.
     OpenFile * directoryFile; ///< “Root” directory -- list of file names,
     ///< represented as a file.
+
+    /// A small (parent sector, component name) -> header-sector cache (a
+    /// “dentry cache”).
+    ///
+    /// Keyed per path component rather than per full path: resolving
+    /// `/a/b/c` seeds three entries, so a later `/a/b/d` walks straight
+    /// to `b`'s directory without touching `a` on disk, and any prefix
+    /// shared between paths is resolved once.  A name-space mutation
+    /// flushes the cache.
+    static const unsigned DENTRY_CACHE_SIZE = 32;
+
+    struct Dentry {
+        unsigned parent; ///< Header sector of the containing directory.
+        char     name[PATH_MAX_LEN];
+        unsigned sector;
+        bool     valid;
+    };
+
+    Dentry   dentryCache[DENTRY_CACHE_SIZE];
+    unsigned dentryVictim; ///< Round-robin replacement cursor.
+
+    /// The shared header table (cf. `AcquireHeader`).  A few entries
+    /// with no remaining users are kept around so re-opening a hot file
+    /// costs nothing.
+    ::List < HeaderNode > * headerCache; ///< (`::` -- `List` the method
+                                         ///< shadows `List` the template.)
+    Lock * headerLock;
+    unsigned headerIdle; ///< Entries with `refs == 0` currently kept.
+
+    /// Files removed while open, waiting for the reclaim daemon.
+    ::List < char * > * reclaimQueue;
+    Lock * reclaimLock;
+
+    /// Header sector cached for the entry `name` of the directory whose
+    /// header is at `parent`, or -1.
+    int
+    DentryLookup(unsigned parent, const char * name);
+
+    void
+    DentryInsert(unsigned parent, const char * name, unsigned sector);
+
+    /// Drop every cached translation (after `Create`/`Remove`/etc.).
+    void
+    DentryFlush();
+
+    /// Free one queued file against a shared in-memory free map; the
+    /// caller writes the map back once for the whole batch.
+    void
+    ReclaimOne(const char * path, Bitmap * freeMap);
+
+    /// Pin the free map and root directory sectors (headers and data)
+    /// in the disk cache, so bulk streams cannot evict them.
+    void
+    PinHotMetadata();
+
     Directory *
     OpenPath(const char * path, int * sector);
     ///Borra un directorio
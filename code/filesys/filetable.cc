@@ -39,10 +39,9 @@ FileTable::add_file(const char * _name, int k)
         v.name = new char[strlen(_name) + 2];
         strcpy(v.name, _name);
         v.remove    = false;
-        v.users     = v.lectores = 0;
+        v.users     = 0;
         v.sector    = k;
-        v.Can_Read  = new Semaphore("Can_Read", 1);
-        v.Can_Write = new Semaphore("Can_Write", 1);
+        v.rw        = new RWLock("File_RWLock");
         v.Dir_Lock  = new Lock("Dir_Write");
         v.File_Lock = new Lock("File_Lock");
         listmap->Prepend(v);
@@ -64,8 +63,7 @@ FileTable::remove(int k)
 
     if (node != nullptr) {
         delete [] (node->name);
-        delete (node->Can_Read);
-        delete (node->Can_Write);
+        delete (node->rw);
         delete (node->Dir_Lock);
         delete (node->File_Lock);
         listmap->Remove(*node);
@@ -5,12 +5,13 @@
 #include "threads/synch.hh"
 
 typedef struct Filenode {
-    bool        remove;
-    char *      name;
-    unsigned    users = 0, sector = 0, lectores = 0;
+    bool     remove;
+    char *   name;
+    unsigned users = 0, sector = 0;
     // Para leer y escribir de forma segura
-    Lock *      Dir_Lock, * File_Lock;
-    Semaphore * Can_Write, * Can_Read;
+    Lock *   Dir_Lock, * File_Lock;
+    // Lectores en paralelo, escritores en exclusion (cf. threads/synch.hh)
+    RWLock * rw;
     friend bool operator == (const Filenode &x, const Filenode &y){
         return x.sector == y.sector;
     }
@@ -0,0 +1,316 @@
+/// Benchmark suite for the file system (flag `-bench`).
+///
+/// `PerformanceTest` (cf. `fs_test.cc`) only writes and reads back one
+/// file in tiny chunks; none of the cache, allocator or elevator work
+/// shows up in its numbers.  This suite measures:
+///
+/// * sequential and random read/write throughput, at the sizes of the
+///   host files `test/big` and `test/huge` plus one larger synthetic
+///   size;
+/// * metadata operation rates (create/remove and open/close loops);
+/// * a multi-threaded mix of concurrent readers and writers.
+///
+/// Every result is printed as one machine-readable line:
+///
+///     BENCH <name> bytes=<n> ops=<n> ticks=<n> wall_us=<n>
+///
+/// where `ticks` is simulated time (`stats->totalTicks`) and `wall_us`
+/// is host wall-clock time, so a change can be judged both by what the
+/// simulated disk sees and by what the simulation costs to run.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de
+/// Rosario.  All rights reserved.  See `copyright.h` for copyright notice
+/// and limitation of liability and disclaimer of warranty provisions.
+
+
+#include "file_system.hh"
+#include "machine/disk.hh"
+#include "machine/statistics.hh"
+#include "threads/synch.hh"
+#include "threads/system.hh"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+/// Implemented in `fs_test.cc`.
+void
+Copy(const char * from, const char * to);
+
+
+static unsigned long
+WallMicros()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000ul + tv.tv_usec;
+}
+
+/// Snapshot of both clocks at the start of one measurement.
+struct BenchClock {
+    unsigned      ticks;
+    unsigned long us;
+};
+
+static BenchClock
+BenchStart()
+{
+    BenchClock c;
+
+    c.ticks = stats->totalTicks;
+    c.us    = WallMicros();
+    return c;
+}
+
+static void
+BenchReport(const char * name, unsigned bytes, unsigned ops,
+  const BenchClock &start)
+{
+    printf("BENCH %s bytes=%u ops=%u ticks=%u wall_us=%lu\n",
+      name, bytes, ops, stats->totalTicks - start.ticks,
+      WallMicros() - start.us);
+}
+
+/// Deterministic pseudo-random offsets, so runs are comparable.
+static unsigned benchSeed = 12345;
+
+static unsigned
+BenchRand()
+{
+    benchSeed = benchSeed * 1103515245 + 12345;
+    return (benchSeed >> 16) & 0x7FFF;
+}
+
+/// Size of a host file, or 0 if it cannot be opened.
+static unsigned
+HostFileSize(const char * path)
+{
+    FILE * fp = fopen(path, "r");
+
+    if (fp == nullptr)
+        return 0;
+    fseek(fp, 0, SEEK_END);
+    unsigned size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+static void
+BenchSeqWrite(const char * label, const char * file, unsigned size,
+  unsigned chunk, bool compressed = false)
+{
+    char * buffer = new char [chunk];
+
+    memset(buffer, 'b', chunk);
+    if (!fileSystem->Create(file, size, compressed)) {
+        printf("BENCH %s SKIPPED (create failed)\n", label);
+        delete [] buffer;
+        return;
+    }
+    OpenFile * f = fileSystem->Open(file);
+    ASSERT(f != nullptr);
+
+    BenchClock clock = BenchStart();
+    unsigned ops     = 0;
+    for (unsigned pos = 0; pos < size; pos += chunk) {
+        unsigned n = size - pos < chunk ? size - pos : chunk;
+        f->WriteAt(buffer, n, pos);
+        ops++;
+    }
+    BenchReport(label, size, ops, clock);
+
+    delete f;
+    delete [] buffer;
+}
+
+static void
+BenchSeqRead(const char * label, const char * file, unsigned chunk)
+{
+    OpenFile * f = fileSystem->Open(file);
+
+    ASSERT(f != nullptr);
+    unsigned size  = f->Length();
+    char * buffer  = new char [chunk];
+
+    BenchClock clock = BenchStart();
+    unsigned ops     = 0;
+    for (unsigned pos = 0; pos < size; pos += chunk) {
+        unsigned n = size - pos < chunk ? size - pos : chunk;
+        f->ReadAt(buffer, n, pos);
+        ops++;
+    }
+    BenchReport(label, size, ops, clock);
+
+    delete f;
+    delete [] buffer;
+}
+
+static void
+BenchRandomIO(const char * label, const char * file, unsigned chunk,
+  unsigned ops, bool write)
+{
+    OpenFile * f = fileSystem->Open(file);
+
+    ASSERT(f != nullptr);
+    unsigned size = f->Length();
+    char * buffer = new char [chunk];
+
+    memset(buffer, 'r', chunk);
+    if (size <= chunk) {
+        printf("BENCH %s SKIPPED (file too small)\n", label);
+        delete f;
+        delete [] buffer;
+        return;
+    }
+
+    BenchClock clock = BenchStart();
+    for (unsigned i = 0; i < ops; i++) {
+        unsigned pos = BenchRand() % (size - chunk);
+        if (write)
+            f->WriteAt(buffer, chunk, pos);
+        else
+            f->ReadAt(buffer, chunk, pos);
+    }
+    BenchReport(label, ops * chunk, ops, clock);
+
+    delete f;
+    delete [] buffer;
+}
+
+/// Metadata rates: a create/remove loop and an open/close loop.
+static void
+BenchMetadata()
+{
+    static const unsigned CREATE_OPS = 16;
+    static const unsigned OPEN_OPS   = 64;
+    char name[16];
+
+    BenchClock clock = BenchStart();
+    for (unsigned i = 0; i < CREATE_OPS; i++) {
+        snprintf(name, sizeof name, "bm_%u", i);
+        fileSystem->Create(name, SECTOR_SIZE);
+        fileSystem->Remove(name);
+    }
+    BenchReport("meta_create_remove", 0, 2 * CREATE_OPS, clock);
+
+    fileSystem->Create("bm_open", SECTOR_SIZE);
+    clock = BenchStart();
+    for (unsigned i = 0; i < OPEN_OPS; i++) {
+        OpenFile * f = fileSystem->Open("bm_open");
+        ASSERT(f != nullptr);
+        delete f;
+    }
+    BenchReport("meta_open_close", 0, OPEN_OPS, clock);
+    fileSystem->Remove("bm_open");
+}
+
+/// One worker of the multi-threaded mix: even ids rewrite their own
+/// file, odd ids re-read the shared one.
+struct MixJob {
+    unsigned    id;
+    Semaphore * done;
+};
+
+static const unsigned MIX_WORKERS    = 4;
+static const unsigned MIX_FILE_SIZE  = 4 * 1024;
+static const unsigned MIX_CHUNK      = SECTOR_SIZE;
+
+static void
+BenchMixWorker(void * arg)
+{
+    MixJob * job  = (MixJob *) arg;
+    char * buffer = new char [MIX_CHUNK];
+
+    memset(buffer, 'm', MIX_CHUNK);
+    if (job->id % 2 == 0) {
+        char name[16];
+        snprintf(name, sizeof name, "bmix_%u", job->id);
+        fileSystem->Create(name, MIX_FILE_SIZE);
+        OpenFile * f = fileSystem->Open(name);
+        ASSERT(f != nullptr);
+        for (unsigned pos = 0; pos < MIX_FILE_SIZE; pos += MIX_CHUNK)
+            f->WriteAt(buffer, MIX_CHUNK, pos);
+        delete f;
+    } else {
+        OpenFile * f = fileSystem->Open("bench_huge");
+        ASSERT(f != nullptr);
+        unsigned size = f->Length();
+        for (unsigned pos = 0; pos + MIX_CHUNK <= size; pos += MIX_CHUNK)
+            f->ReadAt(buffer, MIX_CHUNK, pos);
+        delete f;
+    }
+    delete [] buffer;
+    job->done->V();
+}
+
+static void
+BenchMix()
+{
+    Semaphore done("bench mix done", 0);
+    MixJob jobs[MIX_WORKERS];
+
+    BenchClock clock = BenchStart();
+    for (unsigned i = 0; i < MIX_WORKERS; i++) {
+        jobs[i].id   = i;
+        jobs[i].done = &done;
+        Thread * t = new Thread("bench mix");
+        t->Fork(BenchMixWorker, &jobs[i]);
+    }
+    for (unsigned i = 0; i < MIX_WORKERS; i++)
+        done.P();
+    BenchReport("mix_rw_4threads",
+      MIX_WORKERS / 2 * MIX_FILE_SIZE, MIX_WORKERS, clock);
+
+    char name[16];
+    for (unsigned i = 0; i < MIX_WORKERS; i += 2) {
+        snprintf(name, sizeof name, "bmix_%u", i);
+        fileSystem->Remove(name);
+    }
+}
+
+void
+FilesystemBench()
+{
+    printf("Starting file system benchmarks:\n");
+
+    // Throughput files at the sizes of the host samples, plus a larger
+    // synthetic one; the reads run against data imported with `Copy` so
+    // they read real (non-hole) sectors.
+    Copy("test/big", "bench_big");
+    Copy("test/huge", "bench_huge");
+    unsigned bigSize  = HostFileSize("test/big");
+    unsigned hugeSize = HostFileSize("test/huge");
+    static const unsigned XL_SIZE = 32 * 1024;
+
+    BenchSeqRead("seq_read_big", "bench_big", SECTOR_SIZE);
+    BenchSeqRead("seq_read_huge", "bench_huge", SECTOR_SIZE);
+    BenchSeqRead("seq_read_huge_8s", "bench_huge", 8 * SECTOR_SIZE);
+
+    BenchSeqWrite("seq_write_big", "bench_wbig", bigSize, SECTOR_SIZE);
+    BenchSeqWrite("seq_write_huge", "bench_whuge", hugeSize, SECTOR_SIZE);
+    BenchSeqWrite("seq_write_xl", "bench_wxl", XL_SIZE, 8 * SECTOR_SIZE);
+
+    BenchRandomIO("rand_read_huge", "bench_huge", SECTOR_SIZE, 64, false);
+    BenchRandomIO("rand_write_xl", "bench_wxl", SECTOR_SIZE, 64, true);
+
+    // Compressed file: the repetitive payload packs each group of four
+    // logical sectors into a one-sector extent, so both passes should
+    // see about a quarter of the disk operations of the plain runs.
+    static const unsigned COMP_SIZE = 12 * 1024;
+    BenchSeqWrite("seq_write_comp", "bench_wcomp", COMP_SIZE, SECTOR_SIZE,
+      true);
+    BenchSeqRead("seq_read_comp", "bench_wcomp", SECTOR_SIZE);
+
+    BenchMetadata();
+    BenchMix();
+
+    fileSystem->Remove("bench_big");
+    fileSystem->Remove("bench_huge");
+    fileSystem->Remove("bench_wbig");
+    fileSystem->Remove("bench_whuge");
+    fileSystem->Remove("bench_wxl");
+    fileSystem->Remove("bench_wcomp");
+
+    printf("File system benchmarks done.\n");
+} // FilesystemBench
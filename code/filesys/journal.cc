@@ -0,0 +1,216 @@
+/// Routines for the metadata journal.
+///
+/// On-disk layout (the last `JOURNAL_SECTORS` sectors of the disk):
+///
+///     +--------+--------+--------+-- ... --+--------+
+///     | header | image0 | image1 |         | imageN |
+///     +--------+--------+--------+-- ... --+--------+
+///
+/// The header holds a magic number, a count, and the home sector of each
+/// image.  A batch is committed by writing its images first and the
+/// header last; since the header is a single sector, that write is
+/// atomic, and a crash leaves either the previous batch or the new one
+/// -- never half of one.  Replay applies images in order, so a home
+/// sector logged twice ends up with its latest contents.
+///
+/// Journal sectors are written through `SynchDisk::WriteThrough`,
+/// bypassing the sector cache: they are written once, sequentially, and
+/// read back only at recovery, so caching them would just evict useful
+/// sectors -- and a journal write that sat in the cache would defeat its
+/// purpose.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "journal.hh"
+#include "threads/system.hh"
+#include "machine/statistics.hh"
+
+#include <string.h>
+
+
+/// Written and batched metadata operations, for `-ss` snapshots.
+static Counter journalOps("journal.ops");
+static Counter journalBatches("journal.batches");
+
+/// On a 128-byte sector the header caps a batch at 30 images; larger
+/// sectors are capped by the region size instead.
+static const unsigned JOURNAL_MAGIC = 0x4A524E4C; // "JRNL"
+static const unsigned JOURNAL_CAPACITY =
+  (SECTOR_SIZE - 2 * sizeof(unsigned)) / sizeof(unsigned) < JOURNAL_SECTORS - 1
+  ? (SECTOR_SIZE - 2 * sizeof(unsigned)) / sizeof(unsigned)
+  : JOURNAL_SECTORS - 1;
+
+/// First sector of the journal region.
+unsigned
+JournalStart()
+{
+    return NUM_SECTORS - JOURNAL_SECTORS;
+}
+
+/// The journal header, padded to a full sector.
+struct JournalHeader {
+    unsigned magic;
+    unsigned count;                     ///< Committed images that follow.
+    unsigned sectors[JOURNAL_CAPACITY]; ///< Their home sectors.
+};
+
+Journal::Journal()
+{
+    ASSERT(sizeof (JournalHeader) <= SECTOR_SIZE);
+
+    pending    = new PendingSector[JOURNAL_CAPACITY];
+    nPending   = 0;
+    onDisk     = 0;
+    depth      = 0;
+    batchedOps = 0;
+}
+
+Journal::~Journal()
+{
+    Checkpoint();
+    delete [] pending;
+}
+
+/// Write the journal header claiming `count` logged sectors.
+void
+Journal::WriteHeader(unsigned count)
+{
+    char buffer[SECTOR_SIZE];
+    JournalHeader * header = (JournalHeader *) buffer;
+
+    memset(buffer, 0, SECTOR_SIZE);
+    header->magic = JOURNAL_MAGIC;
+    header->count = count;
+    for (unsigned i = 0; i < count; i++)
+        header->sectors[i] = pending[i].sector;
+    synchDisk->WriteThrough(JournalStart(), buffer);
+}
+
+/// Write a clean (empty) journal header.  Called when formatting.
+void
+Journal::Format()
+{
+    WriteHeader(0);
+}
+
+/// Replay the committed batch left by a previous run, if any, and clear
+/// the journal.  Called when mounting an existing disk.
+void
+Journal::Recover()
+{
+    char buffer[SECTOR_SIZE];
+    JournalHeader * header = (JournalHeader *) buffer;
+
+    synchDisk->ReadSector(JournalStart(), buffer);
+    if (header->magic != JOURNAL_MAGIC) {
+        // Disk formatted before the journal existed; give it one.
+        DEBUG('F', "Journal: no header found, writing a clean one.\n");
+        WriteHeader(0);
+        return;
+    }
+    if (header->count == 0)
+        return;
+
+    DEBUG('F', "Journal: replaying %u metadata sectors.\n", header->count);
+    ASSERT(header->count <= JOURNAL_CAPACITY);
+    for (unsigned i = 0; i < header->count; i++) {
+        synchDisk->ReadSector(JournalStart() + 1 + i, buffer);
+        synchDisk->WriteSector(header->sectors[i], buffer);
+    }
+    // The home sectors must be durable before the journal is cleared,
+    // or a second crash would find nothing to replay.
+    synchDisk->Flush();
+    WriteHeader(0);
+}
+
+void
+Journal::Begin()
+{
+    depth++;
+}
+
+void
+Journal::Commit()
+{
+    ASSERT(depth > 0);
+    if (--depth > 0)
+        return; // Inner operation; the outer one owns the commit.
+
+    batchedOps++;
+    journalOps.Inc();
+    // Leave headroom for the next operation; checkpointing here keeps
+    // the forced split in `Log` a last resort.
+    if (nPending > JOURNAL_CAPACITY - JOURNAL_CAPACITY / 4)
+        Checkpoint();
+}
+
+bool
+Journal::InTransaction() const
+{
+    return depth > 0;
+}
+
+/// Capture the new contents of `sector`.
+///
+/// A repeated write to a sector not yet in the on-disk journal is
+/// absorbed in place -- the free map sectors, rewritten by every
+/// operation, thus cost one journal slot per batch instead of one per
+/// operation.
+void
+Journal::Log(unsigned sector, const char * data)
+{
+    ASSERT(data != nullptr);
+
+    for (unsigned i = onDisk; i < nPending; i++)
+        if (pending[i].sector == sector) {
+            memcpy(pending[i].data, data, SECTOR_SIZE);
+            return;
+        }
+
+    if (nPending == JOURNAL_CAPACITY) {
+        // One operation outgrew the journal (a huge free map under
+        // `-dg`): checkpoint mid-operation.  Atomicity degrades to the
+        // two halves of the split, so leave a trace.
+        DEBUG('F', "Journal: operation split across batches.\n");
+        Checkpoint();
+    }
+
+    pending[nPending].sector = sector;
+    memcpy(pending[nPending].data, data, SECTOR_SIZE);
+    nPending++;
+}
+
+/// Group commit: write the captured images not yet in the journal, then
+/// the header describing them, in one sequential sweep.
+void
+Journal::Flush()
+{
+    if (nPending == onDisk)
+        return;
+
+    for (unsigned i = onDisk; i < nPending; i++)
+        synchDisk->WriteThrough(JournalStart() + 1 + i, pending[i].data);
+    WriteHeader(nPending);
+    onDisk = nPending;
+    batchedOps = 0;
+    journalBatches.Inc();
+}
+
+/// Make the journal redundant: commit it, drain the sector cache so
+/// every home sector is durable, and clear the header.
+void
+Journal::Checkpoint()
+{
+    Flush();
+    synchDisk->Flush();
+    if (onDisk == 0)
+        return; // Journal already clean; skip the header write.
+
+    nPending = 0;
+    onDisk   = 0;
+    WriteHeader(0);
+}
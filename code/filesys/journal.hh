@@ -0,0 +1,117 @@
+/// A write-ahead journal for file system metadata, with group commit.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_FILESYS_JOURNAL__HH
+#define NACHOS_FILESYS_JOURNAL__HH
+
+
+#include "machine/disk.hh"
+
+
+/// Sectors reserved for the journal, at the tail of the disk: one header
+/// plus room for the logged sector images.
+const unsigned JOURNAL_SECTORS = 32;
+
+/// First sector of the journal region (the geometry is chosen at
+/// startup, cf. `-dg`).
+unsigned
+JournalStart();
+
+
+/// A crash in the middle of `Create`, `Remove` or `Expand` used to leave
+/// the free map, the directory and the file header disagreeing with each
+/// other, so any unclean shutdown meant a corrupt disk.
+///
+/// The last `JOURNAL_SECTORS` sectors of the disk are reserved as a
+/// journal.  While a metadata operation runs (between `Begin` and
+/// `Commit`), every sector it writes is also captured here, in memory.
+/// Nothing is forced to disk per operation: batches of captured sectors
+/// are written to the journal region in one sequential sweep (group
+/// commit), either by the flush daemon or when the journal fills up, and
+/// the home sectors keep reaching the disk lazily through the sector
+/// cache.  The journal header -- a single sector naming the logged home
+/// sectors, written after their images -- is what commits a batch: after
+/// a crash, `Recover` replays whatever batch the header describes, and a
+/// half-written batch is simply never described.
+///
+/// The scheme is the classic logging compromise: atomicity per *batch*,
+/// not per operation.  An operation too big for the journal (a huge free
+/// map under `-dg`) is split across batches with a warning.
+class Journal {
+public:
+
+    Journal();
+
+    /// Checkpoints, so no committed metadata is left only in the journal.
+    ~Journal();
+
+    /// Write a clean (empty) journal header.  Called when formatting.
+    void
+    Format();
+
+    /// Replay the committed batch left by a previous run, if any, and
+    /// clear the journal.  Called when mounting an existing disk.
+    void
+    Recover();
+
+    /// Bracket one metadata operation.  `Commit` is only a marker: the
+    /// actual journal write happens later, batched with its neighbours.
+    /// Operations nest (`Create` can trigger `Expand` on the directory
+    /// it writes); an inner operation just joins the outer one.
+
+    void
+    Begin();
+    void
+    Commit();
+
+    /// Is a metadata operation in progress?  (`SynchDisk::WriteSector`
+    /// asks, to know which writes to capture.)
+    bool
+    InTransaction() const;
+
+    /// Capture the new contents of `sector`.  Called from the disk layer
+    /// for every sector written inside a transaction.
+    void
+    Log(unsigned sector, const char * data);
+
+    /// Group commit: write the captured images not yet in the journal,
+    /// then the header describing them, in one sequential sweep.
+    void
+    Flush();
+
+    /// Make the journal redundant: commit it, drain the sector cache so
+    /// every home sector is durable, and clear the header.
+    void
+    Checkpoint();
+
+private:
+
+    /// One captured sector image.
+    struct PendingSector {
+        unsigned sector;
+        char     data[SECTOR_SIZE];
+    };
+
+    /// The current batch.  Entries below `onDisk` are already in the
+    /// on-disk journal and must not be touched (rewriting them would
+    /// let a crash mix two batches); later duplicates are appended and
+    /// win at replay.  Entries at or above `onDisk` are only in memory
+    /// and absorb repeated writes to the same sector in place.
+    PendingSector * pending;
+    unsigned nPending; ///< Captured images in the batch.
+    unsigned onDisk;   ///< How many of them the on-disk journal holds.
+
+    unsigned depth;      ///< Nesting level of `Begin`/`Commit` pairs.
+    unsigned batchedOps; ///< Operations absorbed into this batch.
+
+    /// Write the journal header claiming `count` logged sectors.
+    void
+    WriteHeader(unsigned count);
+};
+
+
+#endif /* ifndef NACHOS_FILESYS_JOURNAL__HH */
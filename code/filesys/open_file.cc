@@ -23,8 +23,25 @@ OpenFile::OpenFile(int _sector)
 {
     DEBUG('O',"Creating OpenFile for sector:%d\n",_sector);
     sector = _sector;
-    hdr    = new FileHeader;
+    #ifdef FILESYS
+    if (fileSystem != nullptr) {
+        // Comparto el header con cualquier otro OpenFile del mismo
+        // archivo (cf. `FileSystem::AcquireHeader`).
+        hdr       = fileSystem->AcquireHeader(sector);
+        sharedHdr = true;
+    } else {
+        // Bootstrap: el free map y el directorio raiz se abren durante
+        // la construccion de `FileSystem`, antes de que exista la
+        // variable global.
+        hdr = new FileHeader;
+        hdr->FetchFrom(sector);
+        sharedHdr = false;
+    }
+    #else
+    hdr = new FileHeader;
     hdr->FetchFrom(sector);
+    sharedHdr = false;
+    #endif
     seekPosition = 0;
 }
 
@@ -33,16 +50,25 @@ OpenFile::~OpenFile()
 {
     DEBUG('O',"Deleting OpenFile for sector:%d\n",sector);
     #ifdef FILESYS
+    if (sharedHdr)
+        // Antes del Remove diferido, para que `EvictHeader` vea el
+        // header sin usuarios.
+        fileSystem->ReleaseHeader(sector);
+    else
+        delete hdr;
     Filenode * node = filetable->find(sector);
     if (node != nullptr) {
         node->users--;
         if (node->remove && node->users <= 0) {
             DEBUG('O',"Removing file:%s\n",node->name);
-            fileSystem->Remove(node->name);
+            // La liberacion de los sectores la hace el daemon de
+            // reclamo; el que cierra no paga la deallocacion.
+            fileSystem->ReclaimLater(node->name);
         }
     }
-    #endif
+    #else
     delete hdr;
+    #endif
 }
 
 /// Change the current location within the open file -- the point at which
@@ -101,8 +127,10 @@ OpenFile::Write(const char * into, unsigned numBytes)
 /// sector at a time.  Thus:
 ///
 /// For ReadAt:
-///     We read in all of the full or partial sectors that are part of the
-///     request, but we only copy the part we are interested in.
+///     Sectors that the request covers completely are read straight into
+///     the caller's buffer (one copy, cache to caller); only a partial
+///     first or last sector bounces through a scratch sector, of which we
+///     copy just the part we are interested in.
 /// For WriteAt:
 ///     We must first read in any sectors that will be partially written, so
 ///     that we do not overwrite the unmodified portion.  We then copy in the
@@ -122,29 +150,17 @@ OpenFile::ReadAt(char * into, unsigned numBytes, unsigned position)
 
     Filenode * node = filetable->find(sector);
 
-
-    hdr->FetchFrom(sector);
+    if (!sharedHdr)
+        hdr->FetchFrom(sector);
 
     if (node != nullptr) {
         DEBUG('O',"Waiting for read %s\n",node->name);
-        node->Can_Read->P();
-        node->lectores++;
-        if (node->lectores == 1){ // Bloqueo escritura
-            DEBUG('O',"Disabling writing\n",node->name);
-            node->Can_Write->P();
-        }
-        node->Can_Read->V();
+        node->rw->AcquireRead();
     }
 
     int ret = Internal_ReadAt(into, numBytes, position);
     if (node != nullptr) {
-        node->Can_Read->P();
-        node->lectores--;
-        if (node->lectores == 0){ // Desbloqueo escritura
-            DEBUG('O',"Enabling writing\n",node->name);
-            node->Can_Write->V();
-        }
-        node->Can_Read->V();
+        node->rw->ReleaseRead();
     }
 
     DEBUG('O',"Leaving ReadAt\n");
@@ -165,17 +181,18 @@ OpenFile::WriteAt(const char * from, unsigned numBytes, unsigned position)
     ASSERT(position + numBytes <= Length());
 
     Filenode * node = filetable->find(sector);
-    hdr->FetchFrom(sector);
+    if (!sharedHdr)
+        hdr->FetchFrom(sector);
 
     if (node != nullptr) {
         DEBUG('O',"Waiting for write %s\n",node->name);
-        node->Can_Write->P();
+        node->rw->AcquireWrite();
     }
     int ret = Internal_WriteAt(from, numBytes, position);
 
     if (node != nullptr) {
         DEBUG('O',"Leaving writing of %s\n",node->name);
-        node->Can_Write->V();
+        node->rw->ReleaseWrite();
     }
 
     DEBUG('O',"Leaving ReadAt\n");
@@ -193,9 +210,13 @@ OpenFile::Internal_ReadAt(char * into, unsigned numBytes, unsigned position)
         return numBytes;
     }
 
+    if (hdr->IsCompressed()) {
+        return Internal_ReadAtComp(into, numBytes, position);
+    }
+
     unsigned fileLength = hdr->FileLength();
-    unsigned firstSector, lastSector, numSectors;
-    char * buf;
+    unsigned firstSector, lastSector;
+    char * scratch = nullptr;
 
     if (position >= fileLength)
         return 0;  // Check request.
@@ -207,17 +228,49 @@ OpenFile::Internal_ReadAt(char * into, unsigned numBytes, unsigned position)
 
     firstSector = DivRoundDown(position, SECTOR_SIZE);
     lastSector  = DivRoundDown(position + numBytes - 1, SECTOR_SIZE);
-    numSectors  = 1 + lastSector - firstSector;
 
-    // Read in all the full and partial sectors that we need.
-    buf = new char [numSectors * SECTOR_SIZE];
+    // Los sectores que el pedido cubre por completo van directo de la
+    // cache al buffer del que llama; antes cada byte rebotaba por un
+    // buffer intermedio y se copiaba dos veces.  Solo un primer o ultimo
+    // sector parcial usa el sector auxiliar.  Ademas se agrupan en un
+    // solo pedido vectorizado: el ascensor del disco se toma una vez por
+    // corrida y no una vez por sector (cf. `SynchDisk::ReadSectors`);
+    // los agujeros y los bordes parciales cortan la corrida.
+    unsigned * batch  = new unsigned [lastSector - firstSector + 1];
+    unsigned batchLen = 0, batchPos = 0;
     for (unsigned i = firstSector; i <= lastSector; i++) {
-        synchDisk->ReadSector(hdr->ByteToSector(i * SECTOR_SIZE),
-          &buf[(i - firstSector) * SECTOR_SIZE]);
+        unsigned sectorStart = i * SECTOR_SIZE;
+        unsigned lo = position > sectorStart ? position : sectorStart;
+        unsigned hi = position + numBytes < sectorStart + SECTOR_SIZE
+          ? position + numBytes : sectorStart + SECTOR_SIZE;
+        unsigned diskSector = hdr->ByteToSector(sectorStart);
+        if (diskSector != NOT_ASSIGNED &&
+          lo == sectorStart && hi == sectorStart + SECTOR_SIZE)
+        {
+            if (batchLen == 0)
+                batchPos = lo - position;
+            batch[batchLen++] = diskSector;
+            continue;
+        }
+        if (batchLen > 0) {
+            synchDisk->ReadSectors(batch, batchLen, &into[batchPos]);
+            batchLen = 0;
+        }
+        if (diskSector == NOT_ASSIGNED) {
+            // Agujero: se lee como ceros.
+            memset(&into[lo - position], 0, hi - lo);
+        } else {
+            if (scratch == nullptr)
+                scratch = new char [SECTOR_SIZE];
+            synchDisk->ReadSector(diskSector, scratch);
+            memcpy(&into[lo - position], &scratch[lo - sectorStart],
+              hi - lo);
+        }
     }
-    // Copy the part we want.
-    memcpy(into, &buf[position - firstSector * SECTOR_SIZE], numBytes);
-    delete [] buf;
+    if (batchLen > 0)
+        synchDisk->ReadSectors(batch, batchLen, &into[batchPos]);
+    delete [] batch;
+    delete [] scratch;
     return numBytes;
 } // OpenFile::Internal_ReadAt
 
@@ -228,6 +281,10 @@ OpenFile::Internal_WriteAt(const char * from, unsigned numBytes,
     ASSERT(from != nullptr);
     ASSERT(numBytes > 0);
 
+    if (hdr->IsCompressed()) {
+        return Internal_WriteAtComp(from, numBytes, position);
+    }
+
     unsigned fileLength = hdr->FileLength();
     unsigned firstSector, lastSector, numSectors;
     bool firstAligned, lastAligned;
@@ -265,20 +322,158 @@ OpenFile::Internal_WriteAt(const char * from, unsigned numBytes,
     // Copy in the bytes we want to change.
     memcpy(&buf[position - firstSector * SECTOR_SIZE], from, numBytes);
 
-    // Write modified sectors back.
+    // Write modified sectors back, grouped into one vectored request
+    // per run (materializing a hole cuts the run).
+    unsigned * batch  = new unsigned [lastSector - firstSector + 1];
+    unsigned batchLen = 0, batchPos = 0;
     for (unsigned i = firstSector; i <= lastSector; i++) {
-        synchDisk->WriteSector(hdr->ByteToSector(i * SECTOR_SIZE),
-          &buf[(i - firstSector) * SECTOR_SIZE]);
+        unsigned diskSector = hdr->ByteToSector(i * SECTOR_SIZE);
+        if (diskSector == NOT_ASSIGNED) {
+            if (batchLen > 0) {
+                synchDisk->WriteSectors(batch, batchLen, &buf[batchPos]);
+                batchLen = 0;
+            }
+            // Agujero: materializo el sector recien en la primera
+            // escritura (cf. `FileHeader::AllocSector`).
+            if (!fileSystem->Materialize(sector, i * SECTOR_SIZE)) {
+                // Disco lleno: reporto lo que llego a entrar.
+                delete [] batch;
+                delete [] buf;
+                return i == firstSector ? 0 : i * SECTOR_SIZE - position;
+            }
+            if (!sharedHdr)
+                hdr->FetchFrom(sector);
+            diskSector = hdr->ByteToSector(i * SECTOR_SIZE);
+        }
+        if (batchLen == 0)
+            batchPos = (i - firstSector) * SECTOR_SIZE;
+        batch[batchLen++] = diskSector;
     }
+    if (batchLen > 0)
+        synchDisk->WriteSectors(batch, batchLen, &buf[batchPos]);
+    delete [] batch;
     delete [] buf;
     return numBytes;
 } // OpenFile::WriteAt
 
+/// En un archivo comprimido la unidad de transferencia es el grupo de
+/// `COMP_GROUP` sectores logicos: cada grupo vive en un extent contiguo
+/// de largo variable (cf. `FileHeader::WriteGroup`), asi que un grupo
+/// que comprime bien cuesta un solo acceso a disco en vez de cuatro.
+
+int
+OpenFile::Internal_ReadAtComp(char * into, unsigned numBytes,
+  unsigned position)
+{
+    unsigned fileLength = hdr->FileLength();
+
+    if (position >= fileLength)
+        return 0;  // Check request.
+
+    if (position + numBytes > fileLength)
+        numBytes = fileLength - position;
+    DEBUG('O', "Reading %u bytes at %u, from compressed file of length"
+      " %u.\n", numBytes, position, fileLength);
+
+    unsigned firstGroup = DivRoundDown(position, COMP_GROUP_BYTES);
+    unsigned lastGroup  = DivRoundDown(position + numBytes - 1,
+        COMP_GROUP_BYTES);
+    char * groupBuf = new char [COMP_GROUP_BYTES];
+
+    for (unsigned g = firstGroup; g <= lastGroup; g++) {
+        unsigned groupStart = g * COMP_GROUP_BYTES;
+        unsigned lo = position > groupStart ? position : groupStart;
+        unsigned hi = position + numBytes < groupStart + COMP_GROUP_BYTES
+          ? position + numBytes : groupStart + COMP_GROUP_BYTES;
+        // El extent entra por la cache de sectores y se descomprime en
+        // memoria; los agujeros salen como ceros.
+        hdr->ReadGroup(g, groupBuf);
+        memcpy(&into[lo - position], &groupBuf[lo - groupStart], hi - lo);
+    }
+    delete [] groupBuf;
+    return numBytes;
+} // OpenFile::Internal_ReadAtComp
+
+int
+OpenFile::Internal_WriteAtComp(const char * from, unsigned numBytes,
+  unsigned position)
+{
+    unsigned fileLength = hdr->FileLength();
+
+    if (position >= fileLength)
+        return 0;  // Check request.
+
+    if (position + numBytes > fileLength) {
+        unsigned add_size = numBytes - (fileLength - position);
+        if (!fileSystem->Expand(sector, add_size)) {
+            numBytes = fileLength - position;
+        }
+    }
+    DEBUG('O', "Writing %u bytes at %u, from compressed file of length"
+      " %u.\n", numBytes, position, fileLength);
+
+    unsigned firstGroup = DivRoundDown(position, COMP_GROUP_BYTES);
+    unsigned lastGroup  = DivRoundDown(position + numBytes - 1,
+        COMP_GROUP_BYTES);
+    char * groupBuf = new char [COMP_GROUP_BYTES];
+
+    for (unsigned g = firstGroup; g <= lastGroup; g++) {
+        unsigned groupStart = g * COMP_GROUP_BYTES;
+        unsigned lo = position > groupStart ? position : groupStart;
+        unsigned hi = position + numBytes < groupStart + COMP_GROUP_BYTES
+          ? position + numBytes : groupStart + COMP_GROUP_BYTES;
+        if (hi - lo < COMP_GROUP_BYTES) {
+            // Grupo cubierto a medias: leo-modifico-escribo para no
+            // pisar lo que no cambia.
+            hdr->ReadGroup(g, groupBuf);
+        }
+        memcpy(&groupBuf[lo - groupStart], &from[lo - position], hi - lo);
+        if (!fileSystem->WriteGroup(sector, g, groupBuf)) {
+            // Disco lleno: reporto lo que llego a entrar.
+            delete [] groupBuf;
+            return g == firstGroup ? 0 : groupStart - position;
+        }
+        if (!sharedHdr)
+            hdr->FetchFrom(sector);
+    }
+    delete [] groupBuf;
+    return numBytes;
+} // OpenFile::Internal_WriteAtComp
+
+/// Bajar a disco los sectores sucios de este archivo (fsync).  Se toma
+/// el lock de lectura para que ninguna escritura quede a mitad de
+/// camino durante el flush; las escrituras de otros archivos siguen
+/// diferidas en la cache, que es todo el punto del write-back.
+int
+OpenFile::Sync()
+{
+    if (!sharedHdr)
+        hdr->FetchFrom(sector);
+
+    Filenode * node = filetable->find(sector);
+    if (node != nullptr)
+        node->rw->AcquireRead();
+
+    // Header + datos + tablas de indireccion (una lv1 y sus lv2).
+    unsigned numSectors = hdr->GetRaw()->numSectors;
+    unsigned max = numSectors + 2
+      + DivRoundUp(numSectors, PTRS_PER_SECTOR);
+    unsigned * list = new unsigned [max];
+    unsigned n = hdr->CollectSectors(list, max);
+    synchDisk->FlushSectors(list, n);
+    delete [] list;
+
+    if (node != nullptr)
+        node->rw->ReleaseRead();
+    return 0;
+}
+
 /// Return the number of bytes in the file.
 unsigned
 OpenFile::Length() const
 {
-    hdr->FetchFrom(sector);
+    if (!sharedHdr)
+        hdr->FetchFrom(sector);
     return hdr->FileLength();
 }
 
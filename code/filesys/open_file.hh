@@ -87,6 +87,23 @@ public:
         return Tell(file);
     }
 
+    /// UNIX file descriptor backing this file, so callers can map it
+    /// into host memory (stub implementation only).
+    int
+    GetHostFd() const
+    {
+        return file;
+    }
+
+    /// Force the file's data to stable storage (fsync).  The stub
+    /// writes straight through to the UNIX file, so there is nothing
+    /// cached to flush.
+    int
+    Sync()
+    {
+        return 0;
+    }
+
 private:
     int file;
     unsigned currentOffset;
@@ -130,11 +147,19 @@ public:
     unsigned
     Length() const;
 
+    /// Force this file's dirty cached sectors to disk (fsync).  Only
+    /// the sectors belonging to the file travel; the rest of the cache
+    /// keeps its delayed writes.  Returns 0.
+    int
+    Sync();
+
     unsigned
     Get_Sector() const;
 
 private:
     FileHeader * hdr;      ///< Header for this file.
+    bool sharedHdr;        ///< Does `hdr` come from the shared header
+                           ///< cache (cf. `FileSystem::AcquireHeader`)?
     unsigned seekPosition; ///< Current position within the file.
     unsigned sector;
     char * name;
@@ -144,6 +169,17 @@ private:
 
     int
     Internal_WriteAt(const char * from, unsigned numBytes, unsigned position);
+
+    /// Variants for compressed files, whose transfer unit is the
+    /// compression group rather than the sector (cf.
+    /// `FileHeader::ReadGroup`/`WriteGroup`).
+
+    int
+    Internal_ReadAtComp(char * into, unsigned numBytes, unsigned position);
+
+    int
+    Internal_WriteAtComp(const char * from, unsigned numBytes,
+      unsigned position);
 };
 
 #endif /* ifdef FILESYS_STUB */
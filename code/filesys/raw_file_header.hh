@@ -10,16 +10,59 @@
 #include "machine/disk.hh"
 
 
-const unsigned NUM_DIRECT    = (SECTOR_SIZE - 4 * sizeof(int)) / sizeof(int);
+const unsigned NUM_DIRECT    = (SECTOR_SIZE - 5 * sizeof(int)) / sizeof(int);
 const unsigned MAX_FILE_SIZE = NUM_DIRECT * SECTOR_SIZE;
-// NUM_DIRECT = 30 Sectores puede ser direccionados
-// MAX_FILE_SIZE = 30 * 128 bytes posibles
+// Punteros a sector que entran en un sector, para los bloques de
+// indireccion (crece junto con SECTOR_SIZE).
+const unsigned PTRS_PER_SECTOR = SECTOR_SIZE / sizeof(unsigned);
+// Con sectores de 128 bytes:
+// NUM_DIRECT = 27 Sectores puede ser direccionados
+// MAX_FILE_SIZE = 27 * 128 bytes posibles
 // Necesito 1024 sectores para direccionar 128 Kb
-// Si uso una indireccion 30 * 32 = 960 sectores(Aparentemente no son suficientes)
-// Si uso dos indirecciones 29 + 1 * 32 * 32 son suficientes
+// Si uso una indireccion 27 * 32 = 864 sectores(Aparentemente no son suficientes)
+// Si uso dos indirecciones 27 + 1 * 32 * 32 son suficientes
+
+/// Bit de `flags`: los punteros directos apuntan a extents comprimidos
+/// en vez de a sectores sueltos (cf. `FileHeader::WriteGroup`).
+const unsigned FH_COMPRESSED = 0x1;
+
+/// Unidad de compresion: cuantos sectores logicos consecutivos se
+/// comprimen juntos en un extent.  Un grupo que no comprime se guarda
+/// crudo en `COMP_GROUP` sectores, asi que nunca se pierde espacio.
+const unsigned COMP_GROUP       = 4;
+const unsigned COMP_GROUP_BYTES = COMP_GROUP * SECTOR_SIZE;
+
+/// En un archivo comprimido cada entrada del mapa empaqueta
+/// `(largo - 1)` en los bits altos del numero del primer sector del
+/// extent: los sectores del disco son pocos (muchos menos que 2^28),
+/// asi que el mapa no necesita una tabla aparte.  `NOT_ASSIGNED` sigue
+/// marcando agujeros sin ambiguedad porque sus bits altos exceden
+/// cualquier largo valido.
+const unsigned COMP_LEN_SHIFT = 28;
+
+inline unsigned
+CompPackExtent(unsigned first, unsigned len)
+{
+    return (len - 1) << COMP_LEN_SHIFT | first;
+}
+
+inline unsigned
+CompExtentFirst(unsigned entry)
+{
+    return entry & ((1u << COMP_LEN_SHIFT) - 1);
+}
+
+inline unsigned
+CompExtentLen(unsigned entry)
+{
+    return (entry >> COMP_LEN_SHIFT) + 1;
+}
 
 struct RawFileHeader {
     unsigned unrefSectors;
+    unsigned linkCount;               ///< Directory entries pointing here
+                                      ///< (hard links); free on zero.
+    unsigned flags;                   ///< `FH_COMPRESSED`.
     unsigned numBytes;                ///< Number of bytes in the file.
     unsigned numSectors;              ///< Number of data sectors in the file.
     unsigned dataSectors[NUM_DIRECT]; ///< Disk sector numbers for each data
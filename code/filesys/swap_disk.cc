@@ -0,0 +1,138 @@
+/// Routines for the dedicated swap disk.
+///
+/// Unlike the filesystem disk there is no sector cache and no elevator
+/// here: the only clients are the page fault handler and the page-out
+/// daemon, requests already arrive one page at a time, and the data's
+/// authoritative copy lives in a main memory frame anyway.  A plain
+/// lock + completion semaphore over the raw device is enough.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "swap_disk.hh"
+
+#include <string.h>
+
+
+/// Initialize the swap device on top of the UNIX file `name`.
+///
+/// The swap disk uses the same geometry as the filesystem disk (cf. `-dg`).
+/// A page slot takes a whole number of sectors; when pages are smaller
+/// than a sector each page still gets a full sector, and the transfer
+/// routines bounce through a sector-sized buffer.
+SwapDisk::SwapDisk(const char * name)
+{
+    ASSERT(PAGE_SIZE % SECTOR_SIZE == 0 || SECTOR_SIZE % PAGE_SIZE == 0);
+
+    disk        = new Disk(name, RequestDone, this, NUM_TRACKS);
+    lock        = new Lock("swap disk lock");
+    requestDone = new Semaphore("swap disk done", 0);
+
+    sectorsPerPage = DivRoundUp(PAGE_SIZE, SECTOR_SIZE);
+    numSwapPages   = NUM_SECTORS / sectorsPerPage;
+    pageMap        = new Bitmap(numSwapPages);
+}
+
+SwapDisk::~SwapDisk()
+{
+    delete pageMap;
+    delete requestDone;
+    delete lock;
+    delete disk;
+}
+
+/// Reserve a contiguous run of `numPages` page slots and return the first
+/// one.
+///
+/// Swap exhaustion is treated like memory exhaustion elsewhere in Nachos:
+/// there is no reasonable way to continue, so panic.
+unsigned
+SwapDisk::AllocPages(unsigned numPages)
+{
+    lock->Acquire();
+    int first = pageMap->FindRun(numPages);
+    lock->Release();
+    ASSERT(first >= 0);
+    return (unsigned) first;
+}
+
+/// Release the run of `numPages` slots starting at `firstPage`.
+void
+SwapDisk::FreePages(unsigned firstPage, unsigned numPages)
+{
+    lock->Acquire();
+    for (unsigned i = 0; i < numPages; i++)
+        pageMap->Clear(firstPage + i);
+    lock->Release();
+}
+
+/// Disk interrupt handler; wakes the thread waiting on `requestDone`.
+void
+SwapDisk::RequestDone(void * arg)
+{
+    ((SwapDisk *) arg)->requestDone->V();
+}
+
+/// Read one sector, waiting for the device to finish.
+void
+SwapDisk::ReadSector(unsigned sector, char * data)
+{
+    disk->ReadRequest(sector, data);
+    requestDone->P();
+}
+
+/// Write one sector, waiting for the device to finish.
+void
+SwapDisk::WriteSector(unsigned sector, const char * data)
+{
+    disk->WriteRequest(sector, data);
+    requestDone->P();
+}
+
+/// Read the page stored in slot `swapPage` into `into`.
+void
+SwapDisk::ReadPage(unsigned swapPage, char * into)
+{
+    ASSERT(into != nullptr);
+    ASSERT(swapPage < numSwapPages);
+
+    unsigned sector = swapPage * sectorsPerPage;
+
+    lock->Acquire();
+    if (PAGE_SIZE % SECTOR_SIZE == 0)
+        for (unsigned i = 0; i < sectorsPerPage; i++)
+            ReadSector(sector + i, into + i * SECTOR_SIZE);
+    else {
+        // The page is a fraction of its sector.
+        char buffer[SECTOR_SIZE];
+        ReadSector(sector, buffer);
+        memcpy(into, buffer, PAGE_SIZE);
+    }
+    lock->Release();
+}
+
+/// Write the page at `from` into slot `swapPage`.
+void
+SwapDisk::WritePage(unsigned swapPage, const char * from)
+{
+    ASSERT(from != nullptr);
+    ASSERT(swapPage < numSwapPages);
+
+    unsigned sector = swapPage * sectorsPerPage;
+
+    lock->Acquire();
+    if (PAGE_SIZE % SECTOR_SIZE == 0)
+        for (unsigned i = 0; i < sectorsPerPage; i++)
+            WriteSector(sector + i, from + i * SECTOR_SIZE);
+    else {
+        // The page is a fraction of its sector; the tail is padding.
+        char buffer[SECTOR_SIZE];
+        memcpy(buffer, from, PAGE_SIZE);
+        memset(buffer + PAGE_SIZE, 0, SECTOR_SIZE - PAGE_SIZE);
+        WriteSector(sector, buffer);
+    }
+    lock->Release();
+}
@@ -0,0 +1,77 @@
+/// A second disk device dedicated to swap.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2017 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_FILESYS_SWAPDISK__HH
+#define NACHOS_FILESYS_SWAPDISK__HH
+
+
+#include "machine/disk.hh"
+#include "machine/mmu.hh"
+#include "threads/synch.hh"
+#include "lib/bitmap.hh"
+
+
+/// With virtual memory on the real file system, page-outs and page-ins used
+/// to go through `swap.N` files on the one simulated disk, so every page
+/// fault competed with regular file traffic for the same head and the same
+/// sector cache.  This class puts swap on its own `Disk` instance (with its
+/// own backing file and interrupt handler), so paging I/O and filesystem
+/// I/O proceed in parallel.
+///
+/// The swap disk is addressed in page-sized slots, not files: each address
+/// space reserves a contiguous run of slots at creation and reads or writes
+/// its pages there directly.  There is no cache in between -- the page's
+/// frame in main memory *is* the copy of record, so caching swap sectors
+/// would only duplicate it.
+class SwapDisk {
+public:
+
+    /// Initialize the swap device on top of the UNIX file `name`.
+    SwapDisk(const char * name);
+
+    ~SwapDisk();
+
+    /// Reserve a contiguous run of `numPages` page slots and return the
+    /// first one.  Panics if the swap disk is full.
+    unsigned
+    AllocPages(unsigned numPages);
+
+    /// Release the run of `numPages` slots starting at `firstPage`.
+    void
+    FreePages(unsigned firstPage, unsigned numPages);
+
+    /// Read/write one page, returning only once the transfer is done.
+
+    void
+    ReadPage(unsigned swapPage, char * into);
+    void
+    WritePage(unsigned swapPage, const char * from);
+
+private:
+
+    Disk * disk;             ///< Raw swap disk device.
+    Lock * lock;             ///< Only one request at a time.
+    Semaphore * requestDone; ///< Signaled by the interrupt handler.
+
+    Bitmap * pageMap;         ///< Which page slots are in use.
+    unsigned sectorsPerPage;  ///< Sectors occupied by one page slot.
+    unsigned numSwapPages;    ///< Page slots on the swap disk.
+
+    /// Disk interrupt handler; wakes the thread waiting on `requestDone`.
+    static void
+    RequestDone(void * arg);
+
+    /// Synchronous single-sector transfers.
+
+    void
+    ReadSector(unsigned sector, char * data);
+    void
+    WriteSector(unsigned sector, const char * data);
+};
+
+
+#endif /* ifndef NACHOS_FILESYS_SWAPDISK__HH */
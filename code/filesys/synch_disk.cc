@@ -5,7 +5,9 @@
 ///
 /// Use a semaphore to synchronize the interrupt handlers with the pending
 /// requests.  And, because the physical disk can only handle one operation
-/// at a time, use a lock to enforce mutual exclusion.
+/// at a time, requests are queued; the queue is served in elevator (SCAN)
+/// order by track, so interleaved requests from several threads do not pay
+/// worst-case seeks.
 ///
 /// Copyright (c) 1992-1993 The Regents of the University of California.
 ///               2016-2017 Docentes de la Universidad Nacional de Rosario.
@@ -14,9 +16,30 @@
 
 
 #include "synch_disk.hh"
+#include "threads/system.hh"
 
 static const char * sector_empty[SECTOR_SIZE];
 
+/// Scratch state for picking the next request in sweep order; see the
+/// comment on `aux_pick_next` below.
+static unsigned pick_from = 0;
+static DiskRequest * pick_up   = nullptr;
+static DiskRequest * pick_down = nullptr;
+
+/// `List::Apply` helper: record the closest queued request at or above
+/// `pick_from` and the closest one below it.
+static void
+aux_pick_next(DiskRequest * req)
+{
+    if (req->track >= pick_from) {
+        if (pick_up == nullptr || req->track < pick_up->track)
+            pick_up = req;
+    } else {
+        if (pick_down == nullptr || req->track > pick_down->track)
+            pick_down = req;
+    }
+}
+
 /// Initialize the synchronous interface to the physical disk, in turn
 /// initializing the physical disk.
 ///
@@ -24,17 +47,89 @@ static const char * sector_empty[SECTOR_SIZE];
 ///   (usually, `DISK`).
 SynchDisk::SynchDisk(const char * name)
 {
-    lock = new Lock("synch disk lock");
-    disk = new CacheDisk(name);
+    lock         = new Lock("synch disk lock");
+    disk         = new CacheDisk(name);
+    queue        = new List<DiskRequest *>;
+    busy         = false;
+    currentTrack = 0;
+    movingUp     = true;
 }
 
 /// De-allocate data structures needed for the synchronous disk abstraction.
 SynchDisk::~SynchDisk()
 {
+    delete queue;
+    // El flush final (dentro de `~CacheDisk`) corre despues de que
+    // `Interrupt::Halt` imprimio las estadisticas, asi que el resumen se
+    // reporta aca.  `FlushDirty` baja los sectores en orden creciente de
+    // pista, o sea que es un unico barrido del brazo.
+    unsigned pending = disk->DirtyCount();
+    unsigned before  = stats->totalTicks;
     delete disk;
+    if (pending > 0)
+        printf("Cache shutdown flush: %u sectors in one ascending sweep, "
+          "%u ticks.\n", pending, stats->totalTicks - before);
     delete lock;
 }
 
+/// Wait until the elevator grants us the disk.
+///
+/// If the disk is free, take it right away.  Otherwise queue a request
+/// keyed by target track and sleep on a private semaphore; whoever releases
+/// the disk hands it over in sweep order.
+void
+SynchDisk::AcquireDisk(int sectorNumber)
+{
+    unsigned track = sectorNumber / SECTORS_PER_TRACK;
+
+    lock->Acquire();
+    if (!busy) {
+        busy         = true;
+        currentTrack = track;
+        lock->Release();
+        return;
+    }
+
+    Semaphore wakeUp("disk request", 0);
+    DiskRequest req;
+    req.track  = track;
+    req.wakeUp = &wakeUp;
+    queue->SortedInsert(&req, track);
+    lock->Release();
+    wakeUp.P(); // The releaser keeps `busy` set and already updated
+                // `currentTrack` for us.
+}
+
+/// Pass the disk to the queued request closest in the current sweep
+/// direction, reversing direction at the edges; mark the disk free if
+/// nobody is waiting.
+void
+SynchDisk::ReleaseDisk()
+{
+    lock->Acquire();
+    if (queue->IsEmpty()) {
+        busy = false;
+        lock->Release();
+        return;
+    }
+
+    pick_from = currentTrack;
+    pick_up   = nullptr;
+    pick_down = nullptr;
+    queue->Apply(aux_pick_next);
+
+    DiskRequest * next;
+    if (movingUp)
+        next = pick_up != nullptr ? pick_up : pick_down;
+    else
+        next = pick_down != nullptr ? pick_down : pick_up;
+    movingUp     = next->track >= currentTrack;
+    currentTrack = next->track;
+    queue->Remove(next);
+    next->wakeUp->V();
+    lock->Release();
+}
+
 /// Read the contents of a disk sector into a buffer.  Return only after the
 /// data has been read.
 ///
@@ -44,9 +139,9 @@ void
 SynchDisk::ReadSector(int sectorNumber, char * data)
 {
     ASSERT(data != nullptr);
-    lock->Acquire(); // Only one disk I/O at a time.
+    AcquireDisk(sectorNumber); // Only one disk I/O at a time.
     disk->ReadSector(sectorNumber, data);
-    lock->Release();
+    ReleaseDisk();
 }
 
 /// Write the contents of a buffer into a disk sector.  Return only
@@ -59,9 +154,106 @@ SynchDisk::WriteSector(int sectorNumber, const char * data)
 {
     ASSERT(data != nullptr);
 
-    lock->Acquire(); // only one disk I/O at a time
+    // Sectors written inside a metadata operation are also captured by
+    // the journal, so a crash can replay them (cf. `journal.hh`).
+    if (journal != nullptr && journal->InTransaction())
+        journal->Log(sectorNumber, data);
+
+    AcquireDisk(sectorNumber); // Only one disk I/O at a time.
     disk->WriteSector(sectorNumber, data);
-    lock->Release();
+    // Memory pressure: if half the cache is dirty, drain it now while we
+    // still hold the disk, rather than waiting for the flush daemon.
+    if (disk->DirtyCount() >= CACHE_SIZE / 2)
+        disk->FlushDirty();
+    ReleaseDisk();
+}
+
+/// Vectored read/write: take the elevator once (keyed by the first
+/// sector's track) and serve the whole batch, so a multi-sector file
+/// request pays one queueing round instead of one per sector, and no
+/// other thread's seek lands in the middle of it.
+
+void
+SynchDisk::ReadSectors(const unsigned * sectors, unsigned count,
+  char * data)
+{
+    ASSERT(data != nullptr);
+    if (count == 0)
+        return;
+    AcquireDisk(sectors[0]);
+    disk->ReadSectors(sectors, count, data);
+    ReleaseDisk();
+}
+
+void
+SynchDisk::WriteSectors(const unsigned * sectors, unsigned count,
+  const char * data)
+{
+    ASSERT(data != nullptr);
+    if (count == 0)
+        return;
+
+    if (journal != nullptr && journal->InTransaction())
+        for (unsigned i = 0; i < count; i++)
+            journal->Log(sectors[i], &data[i * SECTOR_SIZE]);
+
+    AcquireDisk(sectors[0]);
+    disk->WriteSectors(sectors, count, data);
+    if (disk->DirtyCount() >= CACHE_SIZE / 2)
+        disk->FlushDirty();
+    ReleaseDisk();
+}
+
+/// Keep a hot metadata sector permanently cached (within the pinned
+/// quota); loading it may do disk I/O, so take the elevator like any
+/// other request.
+bool
+SynchDisk::PinSector(int sectorNumber)
+{
+    AcquireDisk(sectorNumber);
+    bool pinned = disk->Pin(sectorNumber);
+    ReleaseDisk();
+    return pinned;
+}
+
+/// Write a sector straight to the raw disk, bypassing the delayed-write
+/// cache.
+void
+SynchDisk::WriteThrough(int sectorNumber, const char * data)
+{
+    ASSERT(data != nullptr);
+
+    AcquireDisk(sectorNumber);
+    disk->WriteThrough(sectorNumber, data);
+    ReleaseDisk();
+}
+
+/// Write every dirty cached sector back to disk, holding the disk for the
+/// whole (track-sorted) sweep.
+void
+SynchDisk::Flush()
+{
+    if (disk->DirtyCount() == 0)
+        return;
+
+    AcquireDisk(0);
+    disk->FlushDirty();
+    ReleaseDisk();
+}
+
+/// Write back only the dirty cached copies of the listed sectors,
+/// taking the elevator once for the whole run; everything else stays
+/// cached and keeps batching.  This is the durability point of fsync:
+/// one file reaches the disk without paying for the whole cache.
+void
+SynchDisk::FlushSectors(const unsigned * sectors, unsigned count)
+{
+    if (count == 0)
+        return;
+
+    AcquireDisk(sectors[0]);
+    disk->FlushSectors(sectors, count);
+    ReleaseDisk();
 }
 
 void
@@ -11,6 +11,7 @@
 
 #include "cache_disk.hh"
 #include "threads/synch.hh"
+#include "lib/list.hh"
 
 
 /// The following class defines a "synchronous" disk abstraction.
@@ -23,6 +24,21 @@
 ///
 /// This class provides the abstraction that for any individual thread making
 /// a request, it waits around until the operation finishes before returning.
+///
+/// When several threads have requests outstanding, the disk is granted in
+/// elevator (SCAN) order by track rather than first-come first-served, so
+/// the simulated head sweeps across the disk instead of seeking back and
+/// forth.  Each waiting thread sleeps on its own completion semaphore and
+/// is woken when the sweep reaches its track.
+/// A thread waiting its turn for the disk.
+///
+/// Kept public (like `PendingInterrupt`) so the scheduling helpers in
+/// `synch_disk.cc` can look at it.
+struct DiskRequest {
+    unsigned    track;  ///< Track the request will move the head to.
+    Semaphore * wakeUp; ///< Signaled when the disk is granted to it.
+};
+
 class SynchDisk {
 public:
 
@@ -44,10 +60,57 @@ public:
     void
     ClearSector(int sectorNumber);
 
+    /// Vectored requests: serve a whole batch of sectors (`sectors[i]`
+    /// maps to `data[i * SECTOR_SIZE]`) under a single elevator grant,
+    /// instead of re-queueing per sector.  One logical file read or
+    /// write becomes one schedulable request.
+    void
+    ReadSectors(const unsigned * sectors, unsigned count, char * data);
+    void
+    WriteSectors(const unsigned * sectors, unsigned count,
+      const char * data);
+
+    /// Write a sector straight to the raw disk, bypassing the delayed
+    /// write cache.  Used by the journal, whose writes must reach the
+    /// disk in order (cf. `journal.hh`).
+    void
+    WriteThrough(int sectorNumber, const char * data);
+
+    /// Write every dirty cached sector back to disk.  Called periodically
+    /// by the flush daemon (see `threads/system.cc`) and implicitly when
+    /// too many dirty sectors pile up.
+    void
+    Flush();
+
+    /// Write back just the dirty cached copies of the listed sectors
+    /// (one file's, for the fsync syscall), holding the disk once for
+    /// the whole track-sorted run.
+    void
+    FlushSectors(const unsigned * sectors, unsigned count);
+
+    /// Keep a hot metadata sector permanently cached, within the
+    /// `PINNED_MAX` quota (cf. `CacheDisk::Pin`).  Returns false if the
+    /// quota is already full.
+    bool
+    PinSector(int sectorNumber);
+
 private:
+
     CacheDisk * disk; ///< Raw disk device.
-    Lock * lock;      ///< Only one read/write request can be sent to the disk at
-    ///< a time.
+    Lock * lock;      ///< Protects the request queue and scheduling state.
+
+    List < DiskRequest * > *queue; ///< Waiting requests, sorted by track.
+    bool     busy;                 ///< Is some thread using the disk?
+    unsigned currentTrack;         ///< Track of the request being served.
+    bool     movingUp;             ///< Current sweep direction.
+
+    /// Wait until the elevator grants us the disk.
+    void
+    AcquireDisk(int sectorNumber);
+
+    /// Pass the disk to the next request in sweep order, if any.
+    void
+    ReleaseDisk();
 };
 
 
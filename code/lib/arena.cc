@@ -0,0 +1,72 @@
+/// Bump allocator with one-step teardown.
+///
+/// See `arena.hh` for the interface and the rationale.
+
+#include "arena.hh"
+#include "utility.hh"
+
+#include <string.h>
+
+
+/// Bump allocations are rounded up to this, so every object is aligned
+/// for any plain type.
+static const unsigned ARENA_ALIGN = 8;
+
+
+Arena::Arena()
+{
+    chunks = nullptr;
+    next   = nullptr;
+    left   = 0;
+}
+
+Arena::~Arena()
+{
+    while (chunks != nullptr) {
+        Chunk * c = chunks;
+        chunks = c->next;
+        delete [] (char *) c;
+    }
+}
+
+Arena::Chunk *
+Arena::NewChunk(unsigned size)
+{
+    Chunk * c = (Chunk *) new char [sizeof (Chunk) + size];
+
+    c->next = chunks;
+    chunks  = c;
+    return c;
+}
+
+void *
+Arena::Alloc(unsigned size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    if (size > CHUNK_SIZE) {
+        // Oversized: give it its own chunk, keeping the bump state of the
+        // current chunk untouched for later small allocations.
+        return (char *) NewChunk(size) + sizeof (Chunk);
+    }
+    if (size > left) {
+        Chunk * c = NewChunk(CHUNK_SIZE);
+        next = (char *) c + sizeof (Chunk);
+        left = CHUNK_SIZE;
+    }
+
+    void * p = next;
+    next += size;
+    left -= size;
+    return p;
+}
+
+char *
+Arena::CopyString(const char * s)
+{
+    ASSERT(s != nullptr);
+
+    char * copy = (char *) Alloc(strlen(s) + 1);
+    strcpy(copy, s);
+    return copy;
+}
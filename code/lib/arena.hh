@@ -0,0 +1,72 @@
+/// A bump allocator whose destructor frees everything at once.
+///
+/// Kernel objects that own several heap blocks (an address space owns its
+/// page table, its executable key, its swap file name...) pay for each of
+/// them twice: once to allocate it and once to walk them all back at
+/// teardown.  An arena replaces those individual allocations with pointer
+/// bumps inside a few large chunks, and its destructor releases the chunk
+/// list in one short walk, no matter how many objects were carved from it.
+///
+/// There is no per-object free: memory handed out by `Alloc` stays
+/// reserved until the arena itself dies.  That makes the arena a fit for
+/// metadata whose lifetime *is* the owner's lifetime, and a misfit for
+/// anything recycled while the owner lives (use `PoolAlloc` for that).
+/// An allocation that outgrows its block (say, a page table that has to
+/// be extended) just allocates the bigger copy and abandons the old one
+/// in place; the waste is bounded by the owner's lifetime.
+///
+/// `Alloc` only constructs raw storage, so it should be used for plain
+/// structs and character buffers, not for objects with constructors.
+///
+/// Copyright (c) 2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_LIB_ARENA__HH
+#define NACHOS_LIB_ARENA__HH
+
+
+class Arena {
+public:
+
+    Arena();
+
+    /// Free every chunk, and with them every object ever allocated from
+    /// the arena.
+    ~Arena();
+
+    /// Get `size` bytes, aligned for any plain type.  Never fails (the
+    /// host allocator aborts the simulation if it runs dry).
+    void *
+    Alloc(unsigned size);
+
+    /// Copy a null-terminated string into the arena.
+    char *
+    CopyString(const char * s);
+
+private:
+
+    /// Each chunk starts with its link; the object bytes follow.
+    struct Chunk {
+        Chunk * next;
+    };
+
+    /// Usable bytes per regular chunk.  Requests larger than this get a
+    /// dedicated chunk of exactly their size.
+    static const unsigned CHUNK_SIZE = 8192;
+
+    /// All chunks ever allocated, newest first.
+    Chunk * chunks;
+
+    /// Bump state: next free byte in the current chunk, and how many
+    /// bytes remain there.
+    char * next;
+    unsigned left;
+
+    /// Link a fresh chunk with `size` usable bytes onto the list.
+    Chunk *
+    NewChunk(unsigned size);
+};
+
+
+#endif /* ifndef NACHOS_LIB_ARENA__HH */
@@ -8,6 +8,7 @@
 
 
 #include "bitmap.hh"
+#include "machine/disk.hh"
 
 
 /// Initialize a bitmap with `nitems` bits, so that every bit is clear.  It
@@ -21,8 +22,33 @@ Bitmap::Bitmap(unsigned nitems)
     numBits  = nitems;
     numWords = DivRoundUp(numBits, BITS_IN_WORD);
     map      = new unsigned [numWords];
-    for (unsigned i = 0; i < numBits; i++)
-        Clear(i);
+    hintWord = 0;
+    for (unsigned i = 0; i < numWords; i++)
+        map[i] = 0;
+    clearCount = numBits;
+    // A fresh bitmap does not match whatever is on disk, so the whole
+    // range counts as modified until a `FetchFrom` says otherwise.
+    dirtyLo = 0;
+    dirtyHi = numWords - 1;
+}
+
+/// Note word `w` as modified, for the dirty-range `WriteBack`.
+void
+Bitmap::Touch(unsigned w)
+{
+    if (w < dirtyLo)
+        dirtyLo = w;
+    if (w > dirtyHi)
+        dirtyHi = w;
+}
+
+/// Mask of the bits of word `w` that actually belong to the bitmap.
+unsigned
+Bitmap::ValidBits(unsigned w) const
+{
+    if (w == numWords - 1 && numBits % BITS_IN_WORD != 0)
+        return (1u << numBits % BITS_IN_WORD) - 1;
+    return ~0u;
 }
 
 /// De-allocate a bitmap.
@@ -38,7 +64,11 @@ void
 Bitmap::Mark(unsigned which)
 {
     ASSERT(which < numBits);
-    map[which / BITS_IN_WORD] |= 1 << which % BITS_IN_WORD;
+    if (!Test(which)) {
+        map[which / BITS_IN_WORD] |= 1 << which % BITS_IN_WORD;
+        clearCount--;
+        Touch(which / BITS_IN_WORD);
+    }
 }
 
 /// Clear the “nth” bit in a bitmap.
@@ -48,7 +78,13 @@ void
 Bitmap::Clear(unsigned which)
 {
     ASSERT(which < numBits);
-    map[which / BITS_IN_WORD] &= ~(1 << which % BITS_IN_WORD);
+    if (Test(which)) {
+        map[which / BITS_IN_WORD] &= ~(1 << which % BITS_IN_WORD);
+        clearCount++;
+        Touch(which / BITS_IN_WORD);
+    }
+    if (which / BITS_IN_WORD < hintWord)
+        hintWord = which / BITS_IN_WORD;
 }
 
 /// Return true if the “nth” bit is set.
@@ -68,36 +104,108 @@ Bitmap::Test(unsigned which) const
 int
 Bitmap::Find()
 {
-    for (unsigned i = 0; i < numBits; i++)
+    // Word-at-a-time scan: full words are skipped with a single compare,
+    // and the first clear bit of a non-full word comes out of a
+    // count-trailing-zeros instead of a bit loop.  `hintWord` remembers
+    // where the last scan got to, so the full prefix is not rescanned.
+    for (unsigned w = hintWord; w < numWords; w++) {
+        unsigned freeBits = ~map[w] & ValidBits(w);
+        if (freeBits != 0) {
+            unsigned i = w * BITS_IN_WORD + __builtin_ctz(freeBits);
+            Mark(i);
+            hintWord = w;
+            return i;
+        }
+    }
+    hintWord = numWords;
+    return -1;
+}
+
+/// Like `Find`, but start scanning at `hint` and wrap around.  Lets a
+/// caller keep related allocations close together.
+int
+Bitmap::FindFrom(unsigned hint)
+{
+    for (unsigned k = 0; k < numBits; k++) {
+        unsigned i = (hint + k) % numBits;
         if (!Test(i)) {
             Mark(i);
             return i;
         }
+    }
+    return -1;
+}
+
+/// Find and allocate `n` consecutive clear bits, returning the first one.
+/// The scan starts at `near` and then retries from the beginning, so a
+/// caller with a locality hint gets a run close to it when one exists.
+/// Nothing is marked unless a whole run is found.
+///
+/// If no run of `n` clear bits exists, return -1.
+int
+Bitmap::FindRun(unsigned n, unsigned near)
+{
+    ASSERT(n > 0);
+
+    unsigned start = near < numBits ? near : 0;
+    for (unsigned pass = 0; pass < 2; pass++, start = 0) {
+        unsigned end = pass == 0 ? numBits : near;
+        unsigned run = 0;
+        for (unsigned i = start; i < end; i++) {
+            if (Test(i))
+                run = 0;
+            else if (++run == n) {
+                unsigned first = i + 1 - n;
+                for (unsigned j = first; j <= i; j++)
+                    Mark(j);
+                return first;
+            }
+        }
+    }
     return -1;
 }
 
+/// Allocate a clear bit out of the group of `groupSize` bits with the most
+/// free space.  With the group size set to the sectors per track this
+/// spreads unrelated files across cylinder groups, leaving room for each
+/// file's data to land next to its header.
+int
+Bitmap::FindSpread(unsigned groupSize)
+{
+    ASSERT(groupSize > 0);
+
+    int best          = -1;
+    unsigned bestFree = 0;
+    for (unsigned g = 0; g < numBits; g += groupSize) {
+        unsigned limit = g + groupSize < numBits ? g + groupSize : numBits;
+        unsigned nfree = 0;
+        for (unsigned i = g; i < limit; i++)
+            if (!Test(i))
+                nfree++;
+        if (nfree > bestFree) {
+            bestFree = nfree;
+            best     = g;
+        }
+    }
+    if (best < 0)
+        return -1;
+    return FindFrom(best);
+}
+
 /// Return the number of clear bits in the bitmap.  (In other words, how many
 /// bits are unallocated?)
 unsigned
 Bitmap::CountClear() const
 {
-    unsigned count = 0;
-
-    for (unsigned i = 0; i < numBits; i++)
-        if (!Test(i))
-            count++;
-    return count;
+    // Kept as a running count by `Mark`/`Clear`/`FetchFrom`, so callers
+    // that only want a size check (e.g. `Create`) do not scan the map.
+    return clearCount;
 }
 
 unsigned
 Bitmap::CountNotClear() const
 {
-    unsigned count = 0;
-
-    for (unsigned i = 0; i < numBits; i++)
-        if (Test(i))
-            count++;
-    return count;
+    return numBits - clearCount;
 }
 
 /// Print the contents of the bitmap, for debugging.
@@ -124,6 +232,13 @@ Bitmap::FetchFrom(OpenFile * file)
 {
     ASSERT(file != nullptr);
     file->ReadAt((char *) map, numWords * sizeof(unsigned), 0);
+    hintWord = 0; // The fetched contents can have anything free.
+    // Memory now matches disk, and the free count must be recomputed.
+    dirtyLo    = numWords;
+    dirtyHi    = 0;
+    clearCount = numBits;
+    for (unsigned w = 0; w < numWords; w++)
+        clearCount -= __builtin_popcount(map[w] & ValidBits(w));
 }
 
 /// Store the contents of a bitmap to a Nachos file.
@@ -132,8 +247,22 @@ Bitmap::FetchFrom(OpenFile * file)
 ///
 /// * `file` is the place to write the bitmap to.
 void
-Bitmap::WriteBack(OpenFile * file) const
+Bitmap::WriteBack(OpenFile * file)
 {
     ASSERT(file != nullptr);
-    file->WriteAt((char *) map, numWords * sizeof(unsigned), 0);
+    if (dirtyLo > dirtyHi)
+        return; // Nothing changed since the last write.
+
+    // Round the dirty word range out to whole sectors: the file layer
+    // writes sectors anyway, and this way one changed bit costs one
+    // sector, not the whole map.
+    unsigned lo = dirtyLo * sizeof(unsigned)
+      / SECTOR_SIZE * SECTOR_SIZE;
+    unsigned hi = DivRoundUp(unsigned((dirtyHi + 1) * sizeof(unsigned)),
+        SECTOR_SIZE) * SECTOR_SIZE;
+    if (hi > numWords * sizeof(unsigned))
+        hi = numWords * sizeof(unsigned);
+    file->WriteAt((char *) map + lo, hi - lo, lo);
+    dirtyLo = numWords;
+    dirtyHi = 0;
 }
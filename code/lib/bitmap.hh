@@ -65,6 +65,26 @@ public:
     int
     Find();
 
+    /// Like `Find`, but start the scan at `hint` and wrap around, so
+    /// allocations can be placed near some related bit (e.g. a file's
+    /// data near its header sector).
+    int
+    FindFrom(unsigned hint);
+
+    /// Return the index of the first run of `n` consecutive clear bits,
+    /// searching from `near` onward first, and as a side effect, set them
+    /// all.
+    ///
+    /// If no such run exists, return -1 and set nothing.
+    int
+    FindRun(unsigned n, unsigned near = 0);
+
+    /// Allocate a clear bit from the emptiest group of `groupSize` bits,
+    /// spreading unrelated allocations across groups instead of piling
+    /// them all at the low end.
+    int
+    FindSpread(unsigned groupSize);
+
     /// Return the number of clear bits.
     unsigned
     CountClear() const;
@@ -83,10 +103,14 @@ public:
 
     /// Write contents to disk.
     ///
+    /// Only the sectors containing words modified since the last
+    /// `FetchFrom`/`WriteBack` are written; rewriting the whole map per
+    /// allocation does not scale to big disks.
+    ///
     /// Note: this is not needed until the *FILESYS* assignment, when we will
     /// need to read and write the bitmap to a file.
     void
-    WriteBack(OpenFile * file) const;
+    WriteBack(OpenFile * file);
 
 private:
 
@@ -99,6 +123,29 @@ private:
 
     /// Bit storage.
     unsigned * map;
+
+    /// Lowest word that may still contain a clear bit; lets `Find` skip
+    /// the full words at the front without scanning them each time.
+    unsigned hintWord;
+
+    /// Running number of clear bits, so `CountClear` does not scan the
+    /// whole map on every call.
+    unsigned clearCount;
+
+    /// Range of words modified since the last `FetchFrom`/`WriteBack`
+    /// (`dirtyLo > dirtyHi` means none), so `WriteBack` only writes the
+    /// sectors that actually changed.
+    unsigned dirtyLo;
+    unsigned dirtyHi;
+
+    /// Note word `w` as modified.
+    void
+    Touch(unsigned w);
+
+    /// Bits of word `w` that are inside the bitmap (the last word may be
+    /// partial).
+    unsigned
+    ValidBits(unsigned w) const;
 };
 
 
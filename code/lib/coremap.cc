@@ -3,133 +3,151 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
-static unsigned size             = 0;
-static unsigned phy_page_num     = 0;
-static AddressSpace * space_addr = nullptr;
-
-bool
-operator == (const PageContent& x, const PageContent& y)
-{
-    return x.vpn == y.vpn && x.ppn == y.ppn && x.space == y.space;
-}
-
-static bool
-aux_cmp_ppn(PageContent pc)
-{
-    return pc.ppn == phy_page_num;
-}
-
-static bool
-aux_cmp_space(PageContent pc)
-{
-    return pc.space == space_addr;
-}
-
-static void
-aux_get_sz(PageContent pc)
-{
-    size++;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
 CoreMap::CoreMap()
 {
-    core_map = new List<PageContent>;
+    for (unsigned i = 0; i < NUM_PHYS_PAGES; i++) {
+        valid[i] = false;
+    }
+    numValid  = 0;
+    clockHand = 0;
 }
 
 CoreMap::~CoreMap()
-{
-    delete core_map;
-}
+{}
 
 void
 CoreMap::store(unsigned vpn, AddressSpace * space)
 {
     DEBUG('M',"Thread:%s is saving vpn:%u in the coremap\n",currentThread->GetName(),vpn);
     ASSERT(currentThread->space == space);
-    PageContent pc;
-    pc.space = space;
-    pc.vpn   = vpn;
-    pc.ppn   = currentThread->space->pageTable[vpn].physicalPage;
-    core_map->Append(pc);
+    unsigned ppn = currentThread->space->pageTable[vpn].physicalPage;
+    ASSERT(ppn < NUM_PHYS_PAGES);
+    if (valid[ppn]) { // El marco se esta reutilizando: pisar la entrada.
+        numValid--;
+    }
+    entries[ppn].space = space;
+    entries[ppn].vpn   = vpn;
+    entries[ppn].ppn   = ppn;
+    valid[ppn]         = true;
+    numValid++;
 }
 
 bool
 CoreMap::find(unsigned phy_page, PageContent * pc)
 {
-    return get_phy_page(phy_page, pc);
+    if (phy_page >= NUM_PHYS_PAGES || !valid[phy_page]) {
+        return false;
+    }
+    *pc = entries[phy_page];
+    return true;
 }
 
 void
 CoreMap::remove(unsigned page)
 {
-    PageContent pc;
     DEBUG('M',"Removing %u from the coremap\n",page);
-    if (find(page, &pc)) {
-        core_map->Remove(pc);
+    if (page < NUM_PHYS_PAGES && valid[page]) {
+        valid[page] = false;
+        numValid--;
     }
 }
 
+/// Cuantas paginas desalojar por llamada.  Desalojar de a grupos amortiza
+/// la seleccion de victimas y deja marcos libres para los proximos fallos,
+/// que entonces no desalojan nada.
+static const unsigned SWAP_CLUSTER = 4;
+
 void
 CoreMap::freepage(void)
 {
-    ASSERT(!core_map->IsEmpty());
-    PageContent pc = core_map->Pop();
-    pc.space->save_page(pc.vpn);
+    ASSERT(numValid > 0);
+
+    // Los bits de uso de las paginas del espacio actual viven en la TLB:
+    // sincronizarlos a la tabla de paginas antes de mirarlos.
+    if (currentThread->space != nullptr) {
+        currentThread->space->SaveState();
+    }
+
+    // Elegir hasta SWAP_CLUSTER victimas con el reloj.  Marcarlas como
+    // removidas ya aca, para que la proxima vuelta no las vuelva a elegir.
+    PageContent cluster[SWAP_CLUSTER];
+    unsigned found = 0;
+    while (found < SWAP_CLUSTER && numValid > 0) {
+        unsigned victim = PickVictim();
+        cluster[found++] = entries[victim];
+        remove(victim);
+    }
+    ASSERT(found > 0);
+
+    // Escribir las victimas ordenadas por archivo de swap y offset, para
+    // que los WriteAt de un mismo espacio salgan secuenciales.
+    for (unsigned i = 1; i < found; i++) {
+        PageContent pc = cluster[i];
+        int j          = i - 1;
+        while (j >= 0 && (cluster[j].space > pc.space
+          || (cluster[j].space == pc.space && cluster[j].vpn > pc.vpn)))
+        {
+            cluster[j + 1] = cluster[j];
+            j--;
+        }
+        cluster[j + 1] = pc;
+    }
+    for (unsigned i = 0; i < found; i++) {
+        cluster[i].space->save_page(cluster[i].vpn);
+    }
 }
 
+/// Reloj con segunda oportunidad: avanzar la aguja apagando bits de uso
+/// hasta encontrar una pagina no referenciada.  A lo sumo dos vueltas: la
+/// primera apaga todos los bits, la segunda encuentra victima.
 unsigned
-CoreMap::length(void)
+CoreMap::PickVictim()
 {
-    size = 0;
-    core_map->Apply(aux_get_sz);
-    return size;
+    for (unsigned scanned = 0; scanned <= 2 * NUM_PHYS_PAGES; scanned++) {
+        clockHand = (clockHand + 1) % NUM_PHYS_PAGES;
+        if (!valid[clockHand]) {
+            continue;
+        }
+        TranslationEntry * pte =
+          &entries[clockHand].space->pageTable[entries[clockHand].vpn];
+        if (pte->use) {
+            pte->use = false; // Segunda oportunidad.
+            ClearTlbUse(clockHand);
+        } else {
+            return clockHand;
+        }
+    }
+    ASSERT(false); // Con numValid > 0 siempre hay victima.
+    return 0;
 }
 
-void
-CoreMap::access(unsigned page)
+unsigned
+CoreMap::length(void)
 {
-    PageContent pc;
-
-    if (get_phy_page(page, &pc)) {
-        core_map->Remove(pc);
-        core_map->Append(pc);
-    }
+    return numValid;
 }
 
 void
 CoreMap::clean_space(AddressSpace * space)
 {
-    PageContent pc;
     DEBUG('M',"Cleaning space of %s\n",currentThread->GetName());
-    while (get_space_addr(space, &pc)) {
-        core_map->Remove(pc);
+    for (unsigned i = 0; i < NUM_PHYS_PAGES; i++) {
+        if (valid[i] && entries[i].space == space) {
+            remove(i);
+        }
     }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-bool
-CoreMap::get_phy_page(unsigned phy_page, PageContent * pc)
-{
-    phy_page_num = phy_page;
-    PageContent * res;
-    if ((res = core_map->GetFirst(aux_cmp_ppn)) != nullptr) {
-        *pc = *res;
-        return true;
-    }
-    return false;
-}
-
-bool
-CoreMap::get_space_addr(AddressSpace * space, PageContent * pc)
+void
+CoreMap::ClearTlbUse(unsigned ppn)
 {
-    space_addr = space;
-    PageContent * res;
-    if ((res = core_map->GetFirst(aux_cmp_space)) != nullptr) {
-        *pc = *res;
-        return true;
+    for (unsigned i = 0; i < TLB_SIZE; i++) {
+        TranslationEntry e = machine->GetMMU()->Get_Entry(i);
+        if (e.valid && e.physicalPage == ppn) {
+            e.use = false;
+            machine->GetMMU()->Set_Entry(e, i);
+        }
     }
-    return false;
 }
@@ -3,7 +3,7 @@
 
 #include "userprog/address_space.hh"
 #include "filesys/open_file.hh"
-#include "list.hh"
+#include "machine/mmu.hh"
 
 class Thread;
 
@@ -13,6 +13,13 @@ typedef struct {
     unsigned       ppn;
 } PageContent;
 
+/// Un arreglo indexado por pagina fisica: cada operacion es O(1) en vez
+/// de recorrer una lista.
+///
+/// El reemplazo usa el algoritmo del reloj (segunda oportunidad) sobre los
+/// bits de uso que el hardware simulado deja en las `TranslationEntry`:
+/// el camino de acceso a memoria no hace ninguna contabilidad, todo el
+/// trabajo ocurre recien al elegir una victima.
 class CoreMap {
 public:
     CoreMap();
@@ -29,9 +36,6 @@ public:
     // Nos da la proxima pagina victima
     void
     freepage();
-    // Marca un acceso al coremap(implementando LRU)
-    void
-    access(unsigned page);
     // Cuenta la cantidad de elementos
     unsigned
     length(void);
@@ -39,11 +43,20 @@ public:
     void
     clean_space(AddressSpace * space);
 private:
-    List < PageContent > *core_map;
-    bool
-    get_phy_page(unsigned phy_page, PageContent * pc);
-    bool
-    get_space_addr(AddressSpace * space, PageContent * pc);
+    PageContent entries[NUM_PHYS_PAGES]; ///< Indexado por pagina fisica.
+    bool valid[NUM_PHYS_PAGES];          ///< La entrada esta ocupada?
+
+    unsigned numValid;  ///< Cantidad de entradas ocupadas.
+    unsigned clockHand; ///< Donde quedo la aguja del reloj.
+
+    /// Elegir la proxima victima con el reloj.  Requiere `numValid > 0`.
+    unsigned
+    PickVictim();
+
+    /// Apagar el bit de uso de las copias de esta pagina en la TLB, para
+    /// que la proxima sincronizacion no lo vuelva a prender.
+    void
+    ClearTlbUse(unsigned ppn);
 };
 
 
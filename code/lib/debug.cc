@@ -18,20 +18,26 @@
 #include <string.h>
 
 
+/// Size of the trace ring; only the most recent output this many bytes
+/// long survives until the dump.
+static const unsigned TRACE_BUF_SIZE = 64 * 1024;
+
+/// Upper bound on one formatted message.
+static const unsigned TRACE_LINE_SIZE = 256;
+
+
 Debug::Debug()
 {
-    flags = "";
+    traceBuf     = nullptr;
+    traceHead    = 0;
+    traceWrapped = false;
+    SetFlags("");
 }
 
 bool
 Debug::IsEnabled(char flag) const
 {
-    if (flags != nullptr) {
-        return strchr(flags, flag) != 0 ||
-               strchr(flags, '+') != 0;
-    } else {
-        return false;
-    }
+    return enabled[(unsigned char) flag];
 }
 
 const char *
@@ -44,22 +50,43 @@ void
 Debug::SetFlags(const char * new_flags)
 {
     flags = new_flags;
+
+    // Precompute the per-flag answers, so `IsEnabled` does not have to
+    // walk the string on every `DEBUG` call.
+    bool all = flags != nullptr && strchr(flags, '+') != nullptr;
+    for (unsigned i = 0; i < sizeof enabled / sizeof *enabled; i++) {
+        enabled[i] = all;
+    }
+    if (flags != nullptr && !all) {
+        for (const char * f = flags; *f != '\0'; f++) {
+            enabled[(unsigned char) *f] = true;
+        }
+    }
 }
 
 void
-Debug::Print(char flag, const char * format, ...) const
+Debug::Print(char flag, const char * format, ...)
 {
     ASSERT(format != nullptr);
 
     if (!IsEnabled(flag))
         return;
 
-    // CAMBIO STDERR por STDOUT
-    fprintf(stdout, "[%c] ", flag);
-
     va_list ap;
     // You will get an unused variable message here -- ignore it.
     va_start(ap, format);
+
+    if (traceBuf != nullptr) {
+        char line[TRACE_LINE_SIZE];
+        unsigned n = snprintf(line, sizeof line, "[%c] ", flag);
+        n += vsnprintf(line + n, sizeof line - n, format, ap);
+        TraceWrite(line, min(n, (unsigned) sizeof line - 1));
+        va_end(ap);
+        return;
+    }
+
+    // CAMBIO STDERR por STDOUT
+    fprintf(stdout, "[%c] ", flag);
     vfprintf(stdout, format, ap);
     va_end(ap);
 
@@ -67,7 +94,7 @@ Debug::Print(char flag, const char * format, ...) const
 }
 
 void
-Debug::PrintCont(char flag, const char * format, ...) const
+Debug::PrintCont(char flag, const char * format, ...)
 {
     ASSERT(format != nullptr);
 
@@ -77,8 +104,64 @@ Debug::PrintCont(char flag, const char * format, ...) const
     va_list ap;
     // You will get an unused variable message here -- ignore it.
     va_start(ap, format);
+
+    if (traceBuf != nullptr) {
+        char line[TRACE_LINE_SIZE];
+        unsigned n = vsnprintf(line, sizeof line, format, ap);
+        TraceWrite(line, min(n, (unsigned) sizeof line - 1));
+        va_end(ap);
+        return;
+    }
+
     vfprintf(stderr, format, ap);
     va_end(ap);
 
     fflush(stderr);
 }
+
+void
+Debug::EnableTrace()
+{
+    if (traceBuf == nullptr) {
+        traceBuf = new char [TRACE_BUF_SIZE];
+    }
+    traceHead    = 0;
+    traceWrapped = false;
+}
+
+/// Copy formatted bytes into the ring.  Single head index, no locking:
+/// nothing here can block, so a message is always appended atomically with
+/// respect to the simulated kernel.
+void
+Debug::TraceWrite(const char * buffer, unsigned size)
+{
+    for (unsigned i = 0; i < size; i++) {
+        traceBuf[traceHead] = buffer[i];
+        if (++traceHead == TRACE_BUF_SIZE) {
+            traceHead    = 0;
+            traceWrapped = true;
+        }
+    }
+}
+
+void
+Debug::DumpTrace()
+{
+    if (traceBuf == nullptr || (traceHead == 0 && !traceWrapped)) {
+        return;
+    }
+
+    fprintf(stdout, "=== Debug trace (most recent %u bytes) ===\n",
+      traceWrapped ? TRACE_BUF_SIZE : traceHead);
+    if (traceWrapped) {
+        // The head also marks the oldest byte; the first line printed may
+        // be a truncated survivor of the wrap-around.
+        fwrite(traceBuf + traceHead, 1, TRACE_BUF_SIZE - traceHead, stdout);
+    }
+    fwrite(traceBuf, 1, traceHead, stdout);
+    fprintf(stdout, "=== End of debug trace ===\n");
+    fflush(stdout);
+
+    traceHead    = 0;
+    traceWrapped = false;
+}
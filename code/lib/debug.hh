@@ -59,17 +59,47 @@ public:
     ///
     /// Put a flag prefix along with the message.
     void
-    Print(char flag, const char * format, ...) const;
+    Print(char flag, const char * format, ...);
 
     /// Same as `Print` but avoid printing the flag prefix.
     ///
     /// Useful for splitting a call for a `Print` line into multiple calls.
     void
-    PrintCont(char flag, const char * format, ...) const;
+    PrintCont(char flag, const char * format, ...);
+
+    /// Switch the output from stdout to an in-memory ring buffer.
+    ///
+    /// Formatting and flushing a line to the terminal on every enabled
+    /// `DEBUG` call slows a run down severalfold.  In trace mode, messages
+    /// are instead formatted into a fixed ring that keeps the most recent
+    /// output; `DumpTrace` prints it, and `Interrupt::Halt` dumps it
+    /// automatically, so production runs can keep tracing on cheaply.
+    void
+    EnableTrace();
+
+    /// Print the contents of the trace ring, oldest first, and empty it.
+    /// A no-op when trace mode is off.
+    void
+    DumpTrace();
 
 private:
+
+    /// Append `size` bytes of an already formatted message to the ring.
+    void
+    TraceWrite(const char * buffer, unsigned size);
+
     /// String that controls which debug messages are printed.
     const char * flags;
+
+    /// `enabled[f]` caches whether flag `f` is on, so `IsEnabled` is one
+    /// array load instead of a `strchr` over `flags` per `DEBUG` call.
+    /// Rebuilt by `SetFlags`.
+    bool enabled[256];
+
+    char * traceBuf;    ///< Ring of formatted messages; null until
+                        ///< `EnableTrace`.
+    unsigned traceHead; ///< Where the next byte lands.
+    bool traceWrapped;  ///< Has the ring lapped itself yet?
 };
 
 
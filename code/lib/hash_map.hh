@@ -0,0 +1,314 @@
+/// A map from keys to values, as a flat open-addressing hash table.
+///
+/// `List` finds by walking every element and `Table` only maps dense
+/// integer indices; anything that needs real key lookup (name-to-sector
+/// directory indices, caches keyed by sector or address) had to roll its
+/// own.  This table keeps keys and values in plain arrays with linear
+/// probing and power-of-two sizing, so a lookup is a hash, a mask and a
+/// short scan of adjacent slots -- no per-entry allocation, and probe
+/// sequences stay cache-friendly.  Deletion shifts later entries of the
+/// probe sequence back instead of leaving tombstones, so tables that
+/// churn do not degrade.
+///
+/// The table doubles when it passes 3/4 full, preserving all entries.
+///
+/// Keys are compared with `==`, except `const char *` keys, which are
+/// compared by content; key strings are *not* copied, so the caller must
+/// keep them alive while they are in the table.
+///
+/// Like `List` and `Table`, there is no internal synchronization: the
+/// caller serializes access (in kernel code, by disabling interrupts).
+/// `Put` may allocate when it grows the table, so interrupt handlers
+/// should not insert unless the table was sized for its peak load.
+///
+/// Copyright (c) 2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_LIB_HASHMAP__HH
+#define NACHOS_LIB_HASHMAP__HH
+
+
+#include "utility.hh"
+
+#include <string.h>
+
+
+/// Key hashing, one overload per supported key type.  The integer
+/// variants use the multiplicative hash from Knuth (as the profiler
+/// does); strings use the same djb2 as the directory index.
+
+static inline unsigned
+HashMapHash(unsigned key)
+{
+    return key * 2654435761u;
+}
+
+static inline unsigned
+HashMapHash(int key)
+{
+    return (unsigned) key * 2654435761u;
+}
+
+static inline unsigned
+HashMapHash(const void * key)
+{
+    // Pointers are aligned; drop the always-zero low bits first.
+    return (unsigned) ((unsigned long) key >> 4) * 2654435761u;
+}
+
+static inline unsigned
+HashMapHash(const char * key)
+{
+    unsigned h = 5381;
+
+    for (unsigned i = 0; key[i] != '\0'; i++) {
+        h = h * 33 + (unsigned char) key[i];
+    }
+    return h;
+}
+
+/// Key equality; strings compare by content, everything else with `==`.
+
+template < class Key >
+static inline bool
+HashMapEqual(const Key &a, const Key &b)
+{
+    return a == b;
+}
+
+static inline bool
+HashMapEqual(const char * const &a, const char * const &b)
+{
+    return strcmp(a, b) == 0;
+}
+
+template < class Key, class Value >
+class HashMap {
+public:
+    /// Initial number of slots; must stay a power of two.
+    static const unsigned SIZE = 16;
+
+    HashMap();
+
+    /// Presized variant, for tables whose peak load is known up front
+    /// (e.g. filled from an interrupt handler, where growing is not an
+    /// option).
+    HashMap(unsigned expectedCount);
+
+    ~HashMap();
+
+    /// Map `key` to `value`, replacing any previous mapping.
+    void
+    Put(const Key &key, const Value &value);
+
+    /// Return a pointer to the value mapped to `key`, or null if there
+    /// is none.  The pointer is good until the next `Put` or `Remove`.
+    Value *
+    Get(const Key &key);
+
+    /// Drop the mapping for `key`; returns whether there was one.
+    bool
+    Remove(const Key &key);
+
+    bool
+    HasKey(const Key &key);
+
+    bool
+    IsEmpty() const;
+
+    unsigned
+    Count() const;
+
+    /// Apply `func` to every mapping, in table order.
+    void
+    Apply(void (*func)(const Key &, Value &));
+
+private:
+    Key * keys;
+    Value * values;
+    bool * full;       ///< Is slot `i` occupied?
+    unsigned size;     ///< Number of slots, a power of two.
+    unsigned count;    ///< Number of mappings.
+
+    /// Slot holding `key`, or the empty slot where it would go.
+    unsigned
+    FindSlot(const Key &key) const;
+
+    /// Double the slot count, rehashing every entry.
+    void
+    Grow();
+
+    void
+    AllocSlots(unsigned n);
+};
+
+
+template < class Key, class Value >
+HashMap < Key, Value > ::HashMap()
+{
+    AllocSlots(SIZE);
+}
+
+template < class Key, class Value >
+HashMap < Key, Value > ::HashMap(unsigned expectedCount)
+{
+    unsigned n = SIZE;
+
+    // Slots for the expected load at under 3/4 occupancy, so filling to
+    // the expected count never triggers a grow.
+    while (n * 3 < expectedCount * 4) {
+        n *= 2;
+    }
+    AllocSlots(n);
+}
+
+template < class Key, class Value >
+HashMap < Key, Value > ::~HashMap()
+{
+    delete [] keys;
+    delete [] values;
+    delete [] full;
+}
+
+template < class Key, class Value >
+void
+HashMap < Key, Value > ::AllocSlots(unsigned n)
+{
+    size   = n;
+    count  = 0;
+    keys   = new Key [size];
+    values = new Value [size];
+    full   = new bool [size];
+    for (unsigned i = 0; i < size; i++) {
+        full[i] = false;
+    }
+}
+
+template < class Key, class Value >
+unsigned
+HashMap < Key, Value > ::FindSlot(const Key &key) const
+{
+    unsigned i = HashMapHash(key) & (size - 1);
+
+    while (full[i] && !HashMapEqual(keys[i], key)) {
+        i = (i + 1) & (size - 1);
+    }
+    return i;
+}
+
+template < class Key, class Value >
+void
+HashMap < Key, Value > ::Grow()
+{
+    Key * oldKeys     = keys;
+    Value * oldValues = values;
+    bool * oldFull    = full;
+    unsigned oldSize  = size;
+
+    AllocSlots(oldSize * 2);
+    for (unsigned i = 0; i < oldSize; i++) {
+        if (oldFull[i]) {
+            Put(oldKeys[i], oldValues[i]);
+        }
+    }
+    delete [] oldKeys;
+    delete [] oldValues;
+    delete [] oldFull;
+}
+
+template < class Key, class Value >
+void
+HashMap < Key, Value > ::Put(const Key &key, const Value &value)
+{
+    unsigned i = FindSlot(key);
+
+    if (!full[i]) {
+        full[i] = true;
+        keys[i] = key;
+        count++;
+    }
+    values[i] = value;
+
+    if (count * 4 > size * 3) {
+        Grow();
+    }
+}
+
+template < class Key, class Value >
+Value *
+HashMap < Key, Value > ::Get(const Key &key)
+{
+    unsigned i = FindSlot(key);
+
+    return full[i] ? &values[i] : nullptr;
+}
+
+template < class Key, class Value >
+bool
+HashMap < Key, Value > ::HasKey(const Key &key)
+{
+    return Get(key) != nullptr;
+}
+
+template < class Key, class Value >
+bool
+HashMap < Key, Value > ::Remove(const Key &key)
+{
+    unsigned i = FindSlot(key);
+
+    if (!full[i]) {
+        return false;
+    }
+    full[i] = false;
+    count--;
+
+    // Backward-shift deletion: walk the rest of the probe run and pull
+    // back every entry that probed past the emptied slot, so lookups
+    // never need tombstones to get across it.
+    unsigned hole = i;
+    for (unsigned j = (i + 1) & (size - 1); full[j];
+         j = (j + 1) & (size - 1))
+    {
+        unsigned home = HashMapHash(keys[j]) & (size - 1);
+        // Move unless `j`'s home lies strictly inside `(hole, j]`, i.e.
+        // the entry is already as close to home as it can get.
+        if (((j - home) & (size - 1)) >= ((j - hole) & (size - 1))) {
+            keys[hole]   = keys[j];
+            values[hole] = values[j];
+            full[hole]   = true;
+            full[j]      = false;
+            hole         = j;
+        }
+    }
+    return true;
+}
+
+template < class Key, class Value >
+bool
+HashMap < Key, Value > ::IsEmpty() const
+{
+    return count == 0;
+}
+
+template < class Key, class Value >
+unsigned
+HashMap < Key, Value > ::Count() const
+{
+    return count;
+}
+
+template < class Key, class Value >
+void
+HashMap < Key, Value > ::Apply(void (*func)(const Key &, Value &))
+{
+    ASSERT(func != nullptr);
+    for (unsigned i = 0; i < size; i++) {
+        if (full[i]) {
+            func(keys[i], values[i]);
+        }
+    }
+}
+
+
+#endif /* ifndef NACHOS_LIB_HASHMAP__HH */
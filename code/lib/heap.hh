@@ -0,0 +1,197 @@
+/// Data structures to manage binary min-heaps (priority queues).
+///
+/// A heap keeps the item with the smallest key at the top, with O(log n)
+/// insertion and removal and O(1) peek of the smallest key.  It is used by
+/// the interrupt simulation, where the pending-interrupt queue may grow
+/// long when several devices are active and a sorted list would make each
+/// `Schedule` call O(n).
+///
+/// The interface deliberately mirrors the `Sorted` operations of `List`,
+/// so the two structures are interchangeable for priority-queue use.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_LIB_HEAP__HH
+#define NACHOS_LIB_HEAP__HH
+
+
+#include "utility.hh"
+
+
+/// The following class defines a “heap” -- a binary min-heap stored in a
+/// growable array, ordered by an integer key.
+template < class Item >
+class Heap {
+public:
+
+    /// Initialize the heap.
+    Heap();
+
+    /// De-allocate the heap.
+    ~Heap();
+
+    /// Is the heap empty?
+    bool
+    IsEmpty() const;
+
+    /// Put item into the heap, ordered by `sortKey`.
+    void
+    SortedInsert(Item item, int sortKey);
+
+    /// Remove the item with the smallest key.
+    Item
+    SortedPop(int * keyPtr);
+
+    /// Get the smallest key without removing its item.
+    ///
+    /// Returns false if the heap is empty.
+    bool
+    PeekKey(int * keyPtr) const;
+
+    /// Apply `func` to all items in the heap (in no particular order).
+    void
+    Apply(void (*func)(Item));
+
+private:
+
+    struct HeapNode {
+        int  key;  ///< Priority of the item.
+        Item item; ///< Item in the heap.
+    };
+
+    HeapNode * nodes;  ///< Array holding the heap, element 0 is the top.
+    unsigned   size;   ///< Number of items currently in the heap.
+    unsigned   space;  ///< Allocated capacity of `nodes`.
+};
+
+/// Initialize a heap, empty to start with.
+template < class Item >
+Heap < Item > ::Heap()
+{
+    space = 16;
+    size  = 0;
+    nodes = new HeapNode[space];
+}
+
+/// Prepare a heap for deallocation.
+///
+/// As with `List`, the “items” themselves are not de-allocated: a given
+/// item may be referenced from elsewhere, so that is the caller's job.
+template < class Item >
+Heap < Item > ::~Heap()
+{
+    delete [] nodes;
+}
+
+/// Returns true if the heap is empty (has no items).
+template < class Item >
+bool
+Heap < Item > ::IsEmpty() const
+{
+    return size == 0;
+}
+
+/// Insert an `item` into the heap.
+///
+/// The new item is appended at the bottom and sifted up until its parent's
+/// key is no larger, which takes O(log n) comparisons.  The array is grown
+/// by doubling when full.
+///
+/// * `item` is the thing to put in the heap, it can be a pointer to
+///   anything.
+/// * `sortKey` is the priority of the item.
+template < class Item >
+void
+Heap < Item > ::SortedInsert(Item item, int sortKey)
+{
+    if (size == space) { // Full: double the array.
+        HeapNode * old = nodes;
+        space *= 2;
+        nodes  = new HeapNode[space];
+        for (unsigned i = 0; i < size; i++)
+            nodes[i] = old[i];
+        delete [] old;
+    }
+
+    unsigned i = size++;
+    while (i > 0 && sortKey < nodes[(i - 1) / 2].key) {
+        nodes[i] = nodes[(i - 1) / 2];
+        i        = (i - 1) / 2;
+    }
+    nodes[i].key  = sortKey;
+    nodes[i].item = item;
+}
+
+/// Remove the “item” with the smallest key from the heap.
+///
+/// Returns the removed item, `Item()` if the heap is empty.
+///
+/// Sets `*keyPtr` to the priority value of the removed item (this is
+/// needed by `interrupt.cc`, for instance).
+///
+/// * `keyPtr` is a pointer to the location in which to store the priority
+///   of the removed item.
+template < class Item >
+Item
+Heap < Item > ::SortedPop(int * keyPtr)
+{
+    if (IsEmpty())
+        return Item();
+
+    Item thing = nodes[0].item;
+    if (keyPtr != nullptr)
+        *keyPtr = nodes[0].key;
+
+    // Move the last node to the top and sift it down.
+    HeapNode hole = nodes[--size];
+    unsigned i    = 0;
+    for (;;) {
+        unsigned child = 2 * i + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && nodes[child + 1].key < nodes[child].key)
+            child++;
+        if (nodes[child].key >= hole.key)
+            break;
+        nodes[i] = nodes[child];
+        i        = child;
+    }
+    nodes[i] = hole;
+    return thing;
+}
+
+/// Peek at the smallest key in the heap without removing anything.
+///
+/// Returns false if the heap is empty.
+template < class Item >
+bool
+Heap < Item > ::PeekKey(int * keyPtr) const
+{
+    ASSERT(keyPtr != nullptr);
+
+    if (IsEmpty())
+        return false;
+    *keyPtr = nodes[0].key;
+    return true;
+}
+
+/// Apply a function to each item in the heap.
+///
+/// Unlike `List::Apply`, items are visited in array order, not sorted
+/// order.
+///
+/// * `func` is the procedure to apply to each item.
+template < class Item >
+void
+Heap < Item > ::Apply(void (*func)(Item))
+{
+    ASSERT(func != nullptr);
+
+    for (unsigned i = 0; i < size; i++)
+        func(nodes[i].item);
+}
+
+#endif /* ifndef NACHOS_LIB_HEAP__HH */
@@ -0,0 +1,140 @@
+/// An intrusive doubly-linked list.
+///
+/// Unlike `List`, nothing is heap-allocated per node: the items themselves
+/// carry the link pointers, so `Append`, `Pop` and `Remove`-by-item are
+/// all a handful of pointer updates with no walk and no `new`.  This is
+/// what the scheduler ready queues and semaphore wait queues sit on, where
+/// an allocation per enqueue would be paid on every context switch.
+///
+/// `Item` must be a pointer to a class with public `queuePrev` and
+/// `queueNext` fields of the same pointer type.  An item can be on at most
+/// one intrusive list at a time (which holds for threads: a thread is
+/// either ready or waiting on one semaphore, never both).
+
+#ifndef NACHOS_LIB_INTRUSIVELIST__HH
+#define NACHOS_LIB_INTRUSIVELIST__HH
+
+#include "utility.hh"
+
+
+template <class Item>
+class IntrusiveList {
+public:
+
+    IntrusiveList();
+
+    /// Is the list empty?
+    bool
+    IsEmpty() const;
+
+    /// Put an item at the beginning/end of the list.
+
+    void
+    Prepend(Item item);
+
+    void
+    Append(Item item);
+
+    /// Take the first item off the list; null if empty.
+    Item
+    Pop();
+
+    /// Unlink `item`, wherever it is, in O(1).
+    void
+    Remove(Item item);
+
+    /// Apply `func` to every item on the list.
+    void
+    Apply(void (*func)(Item)) const;
+
+private:
+
+    Item first; ///< Head of the list, null if empty.
+    Item last;  ///< Last element of the list.
+};
+
+
+template <class Item>
+IntrusiveList<Item>::IntrusiveList()
+{
+    first = last = nullptr;
+}
+
+template <class Item>
+bool
+IntrusiveList<Item>::IsEmpty() const
+{
+    return first == nullptr;
+}
+
+template <class Item>
+void
+IntrusiveList<Item>::Prepend(Item item)
+{
+    ASSERT(item != nullptr);
+
+    item->queuePrev = nullptr;
+    item->queueNext = first;
+    if (first != nullptr)
+        first->queuePrev = item;
+    else
+        last = item;
+    first = item;
+}
+
+template <class Item>
+void
+IntrusiveList<Item>::Append(Item item)
+{
+    ASSERT(item != nullptr);
+
+    item->queueNext = nullptr;
+    item->queuePrev = last;
+    if (last != nullptr)
+        last->queueNext = item;
+    else
+        first = item;
+    last = item;
+}
+
+template <class Item>
+Item
+IntrusiveList<Item>::Pop()
+{
+    if (first == nullptr)
+        return nullptr;
+
+    Item item = first;
+    Remove(item);
+    return item;
+}
+
+template <class Item>
+void
+IntrusiveList<Item>::Remove(Item item)
+{
+    ASSERT(item != nullptr);
+
+    if (first == item)
+        first = item->queueNext;
+    if (last == item)
+        last = item->queuePrev;
+    if (item->queuePrev != nullptr)
+        item->queuePrev->queueNext = item->queueNext;
+    if (item->queueNext != nullptr)
+        item->queueNext->queuePrev = item->queuePrev;
+    item->queuePrev = item->queueNext = nullptr;
+}
+
+template <class Item>
+void
+IntrusiveList<Item>::Apply(void (*func)(Item)) const
+{
+    ASSERT(func != nullptr);
+
+    for (Item item = first; item != nullptr; item = item->queueNext)
+        func(item);
+}
+
+
+#endif /* ifndef NACHOS_LIB_INTRUSIVELIST__HH */
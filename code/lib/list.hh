@@ -13,6 +13,9 @@
 
 
 #include "utility.hh"
+#include "pool.hh"
+
+#include <stddef.h>
 
 
 /// The following class defines a “list element” -- which is used to keep
@@ -28,6 +31,21 @@ public:
     ListElement(Item itemPtr, int sortKey);
     ~ListElement();
 
+    /// Elements are churned on every list operation, so they come from
+    /// the small-object pool rather than the host allocator.
+
+    static void *
+    operator new(size_t size)
+    {
+        return PoolAlloc(size);
+    }
+
+    static void
+    operator delete(void * ptr, size_t size)
+    {
+        PoolFree(ptr, size);
+    }
+
     ListElement * next; ///< Next element on list, null if this is the last.
     int key;            ///< Priority, for a sorted list.
     Item item;          ///< Item on the list.
@@ -60,6 +78,10 @@ public:
     Item
     Pop();
 
+    /// Move every item of `other` onto the end of this list.
+    void
+    AppendAll(List < Item > * other);
+
     void
     Remove(Item item);
 
@@ -185,6 +207,33 @@ List < Item > ::Prepend(Item item)
     }
 }
 
+/// Move every item of `other` onto the end of this list, leaving `other`
+/// empty.
+///
+/// The list nodes are relinked rather than copied, so this takes constant
+/// time no matter how many items move over -- e.g. handing a whole wait
+/// queue to another queue in one step.
+///
+/// * `other` is the list to take the items from.
+template < class Item >
+void
+List < Item > ::AppendAll(List < Item > * other)
+{
+    ASSERT(other != nullptr);
+
+    if (other->IsEmpty()) {
+        return;
+    }
+    if (IsEmpty()) {
+        first = other->first;
+    } else { // Put them after last.
+        last->next = other->first;
+    }
+    last         = other->last;
+    other->first = nullptr;
+    other->last  = nullptr;
+}
+
 /// Remove the first `item` from the front of the list.
 ///
 /// Returns a pointer to removed item, `Item()` if nothing on the list.
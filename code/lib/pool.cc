@@ -0,0 +1,87 @@
+/// Pool allocator for small kernel objects.
+///
+/// See `pool.hh` for the interface and the rationale.
+
+#include "pool.hh"
+#include "utility.hh"
+
+
+/// Size classes are the powers of two from `1 << POOL_MIN_SHIFT` up to
+/// `1 << POOL_MAX_SHIFT` bytes; anything larger goes to the host
+/// allocator directly.
+static const unsigned POOL_MIN_SHIFT = 4;
+static const unsigned POOL_MAX_SHIFT = 8;
+static const unsigned POOL_CLASSES  = POOL_MAX_SHIFT - POOL_MIN_SHIFT + 1;
+
+/// How many bytes each slab carves into blocks when a class runs dry.
+static const unsigned POOL_SLAB_SIZE = 4096;
+
+/// A free block stores the link to the next free block in its own first
+/// bytes, so the free lists cost no extra memory.
+struct PoolBlock {
+    PoolBlock * next;
+};
+
+static PoolBlock * freeList[POOL_CLASSES];
+
+/// Smallest size class that fits `size`, or `POOL_CLASSES` if the request
+/// is too big for the pool.
+static unsigned
+ClassOf(unsigned size)
+{
+    for (unsigned c = 0; c < POOL_CLASSES; c++) {
+        if (size <= 1u << (POOL_MIN_SHIFT + c)) {
+            return c;
+        }
+    }
+    return POOL_CLASSES;
+}
+
+/// Carve one fresh slab into blocks of class `c` and chain them onto its
+/// free list.  This is the only place the pool calls the host allocator.
+static void
+Refill(unsigned c)
+{
+    unsigned blockSize = 1u << (POOL_MIN_SHIFT + c);
+    char * slab        = new char [POOL_SLAB_SIZE];
+
+    for (unsigned off = 0; off + blockSize <= POOL_SLAB_SIZE;
+      off += blockSize)
+    {
+        PoolBlock * block = (PoolBlock *) (slab + off);
+        block->next = freeList[c];
+        freeList[c] = block;
+    }
+}
+
+void *
+PoolAlloc(unsigned size)
+{
+    unsigned c = ClassOf(size);
+
+    if (c == POOL_CLASSES) {
+        return new char [size];
+    }
+    if (freeList[c] == nullptr) {
+        Refill(c);
+    }
+    PoolBlock * block = freeList[c];
+    freeList[c] = block->next;
+    return block;
+}
+
+void
+PoolFree(void * ptr, unsigned size)
+{
+    ASSERT(ptr != nullptr);
+
+    unsigned c = ClassOf(size);
+
+    if (c == POOL_CLASSES) {
+        delete [] (char *) ptr;
+        return;
+    }
+    PoolBlock * block = (PoolBlock *) ptr;
+    block->next = freeList[c];
+    freeList[c] = block;
+}
@@ -0,0 +1,33 @@
+/// A pool allocator for small, frequently recycled kernel objects.
+///
+/// Hot kernel paths create and destroy the same small objects over and
+/// over: list elements, mail messages, per-packet buffers.  Going to the
+/// host allocator for each of them is costly, and the simulator amplifies
+/// that cost because it sits on every simulated kernel path.
+///
+/// The pool keeps one free list per power-of-two size class.  `PoolAlloc`
+/// pops a block off the matching free list and `PoolFree` pushes it back,
+/// both in constant time; the host allocator is only touched when a class
+/// runs dry, to carve a fresh slab into blocks.  Freed blocks are never
+/// returned to the host, so in steady state no host allocation happens at
+/// all.  Requests larger than the biggest class fall through to the host
+/// allocator.
+///
+/// `PoolFree` must be given the same size that was passed to `PoolAlloc`,
+/// which callers know statically (it is `sizeof` their type or a
+/// compile-time buffer size).
+
+#ifndef NACHOS_LIB_POOL__HH
+#define NACHOS_LIB_POOL__HH
+
+
+/// Get a block of at least `size` bytes.
+void *
+PoolAlloc(unsigned size);
+
+/// Return a block obtained from `PoolAlloc(size)`.
+void
+PoolFree(void * ptr, unsigned size);
+
+
+#endif /* ifndef NACHOS_LIB_POOL__HH */
@@ -1,5 +1,12 @@
 /// A very simple map from non-negative integers to some type.
 ///
+/// Keys are stable: once `Add` hands an index out, it keeps naming the same
+/// item until that item is removed, no matter what happens to the rest of
+/// the table.  The table grows geometrically on demand, so capacity does
+/// not bound how many items (processes, open files) can be live at once,
+/// and vacant indices are recycled through a freelist so `Add`, `Get`,
+/// `HasKey` and `Remove` are all constant time.
+///
 /// Copyright (c) 2018 Docentes de la Universidad Nacional de Rosario.
 /// All rights reserved.  See `copyright.h` for copyright notice and
 /// limitation of liability and disclaimer of warranty provisions.
@@ -8,16 +15,19 @@
 #define NACHOS_LIB_TABLE__HH
 
 
-#include "list.hh"
+#include "utility.hh"
 
 
 template < class T >
 class Table {
 public:
+    /// Initial capacity; the table doubles whenever it fills up.
     static const unsigned SIZE = 20;
 
     Table();
 
+    ~Table();
+
     int
     Add(T item);
 
@@ -35,22 +45,77 @@ public:
 
 private:
     /// Data items.
-    T data[SIZE];
+    T * data;
+
+    /// Is slot `i` currently holding an item?
+    bool * used;
 
+    /// Freed slots below `current`, chained through `nextFree`;
+    /// `-1` terminates.  Recycling them keeps the key space dense.
+    int * nextFree;
+    int freeHead;
+
+    /// How many slots have been allocated.
+    unsigned capacity;
     /// Current greatest index for a new item.
-    int current;
-    /// A list to store indexes of items that have been freed and are not
-    /// among those with greatest numbers, so it is not possible to modify
-    /// `current`.  In other words, this keeps track of external
-    /// fragmentation.
-    List < int > freed;
+    unsigned current;
+    /// Number of items currently in the table.
+    unsigned count;
+
+    /// Double the capacity, preserving the existing keys.
+    void
+    Grow();
 };
 
 
 template < class T >
 Table < T > ::Table()
 {
-    current = 0;
+    capacity = SIZE;
+    data     = new T [capacity];
+    used     = new bool [capacity];
+    nextFree = new int [capacity];
+    for (unsigned i = 0; i < capacity; i++) {
+        used[i] = false;
+    }
+    current  = 0;
+    count    = 0;
+    freeHead = -1;
+}
+
+template < class T >
+Table < T > ::~Table()
+{
+    delete [] data;
+    delete [] used;
+    delete [] nextFree;
+}
+
+template < class T >
+void
+Table < T > ::Grow()
+{
+    unsigned newCapacity = 2 * capacity;
+    T * newData          = new T [newCapacity];
+    bool * newUsed       = new bool [newCapacity];
+    int * newNextFree    = new int [newCapacity];
+
+    for (unsigned i = 0; i < capacity; i++) {
+        newData[i]     = data[i];
+        newUsed[i]     = used[i];
+        newNextFree[i] = nextFree[i];
+    }
+    for (unsigned i = capacity; i < newCapacity; i++) {
+        newUsed[i] = false;
+    }
+
+    delete [] data;
+    delete [] used;
+    delete [] nextFree;
+    data     = newData;
+    used     = newUsed;
+    nextFree = newNextFree;
+    capacity = newCapacity;
 }
 
 template < class T >
@@ -59,17 +124,19 @@ Table < T > ::Add(T item)
 {
     int i;
 
-    if (!freed.IsEmpty()) {
-        i       = freed.Pop();
-        data[i] = item;
-        return i;
-    } else if (current < static_cast < int > (SIZE)) {
-        i       = current++;
-        data[i] = item;
-        return i;
+    if (freeHead >= 0) { // Recycle a vacant slot first.
+        i        = freeHead;
+        freeHead = nextFree[i];
     } else {
-        return -1;
+        if (current == capacity) {
+            Grow();
+        }
+        i = current++;
     }
+    data[i] = item;
+    used[i] = true;
+    count++;
+    return i;
 }
 
 template < class T >
@@ -78,7 +145,7 @@ Table < T > ::Get(int i) const
 {
     ASSERT(i >= 0);
 
-    if (freed.Has(i) || i >= current) {
+    if (!HasKey(i)) {
         return T();
     }
 
@@ -91,14 +158,14 @@ Table < T > ::HasKey(int i) const
 {
     ASSERT(i >= 0);
 
-    return !(freed.Has(i) || i >= current);
+    return i < static_cast < int > (current) && used[i];
 }
 
 template < class T >
 bool
 Table < T > ::IsEmpty() const
 {
-    return current == 0;
+    return count == 0;
 }
 
 template < class T >
@@ -110,16 +177,10 @@ Table < T > ::Remove(int i)
     if (!HasKey(i)) {
         return T();
     }
-    if (i == current - 1) {
-        current--;
-        for (int j = current - 1; j >= 0 && !HasKey(j); j--) {
-            ASSERT(freed.Has(j));
-            freed.SortedPop(&j);
-            current--;
-        }
-    } else {
-        freed.SortedInsert(i, i);
-    }
+    used[i]     = false;
+    nextFree[i] = freeHead;
+    freeHead    = i;
+    count--;
     return data[i];
 }
 
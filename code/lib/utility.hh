@@ -78,8 +78,16 @@ typedef void (* VoidNoArgFunctionPtr)();
 /// Global object for debug output.
 extern Debug debug;
 
-#define DEBUG      (debug.Print)
-#define DEBUG_CONT (debug.PrintCont)
+/// Building with `-DNO_DEBUG_PRINTS` compiles every `DEBUG` call away
+/// entirely -- the arguments are not even evaluated, so release builds pay
+/// nothing for the messages sprinkled through the hot paths.
+#ifdef NO_DEBUG_PRINTS
+# define DEBUG(...)      ((void) 0)
+# define DEBUG_CONT(...) ((void) 0)
+#else
+# define DEBUG      (debug.Print)
+# define DEBUG_CONT (debug.PrintCont)
+#endif
 
 /// If `condition` is false, print a message and dump core.
 ///
@@ -68,6 +68,7 @@ Console::Console(const char * readFile, const char * writeFile,
     readHandler  = readAvail;
     handlerArg   = callArg;
     putBusy      = false;
+    putSize      = 0;
     incoming     = EOF;
 
     // Start polling for incoming packets.
@@ -104,8 +105,12 @@ Console::CheckCharAvail()
     if (incoming != EOF || !PollFile(readFileNo))
         return;
 
-    // Otherwise, read character and tell user about it.
-    Read(readFileNo, &c, sizeof c);
+    // Otherwise, read character and tell user about it.  At end of file
+    // (input redirected from a file that ran out) there is no character,
+    // even though the descriptor polls as readable: keep quiet instead
+    // of aborting, as a real keyboard just stays silent.
+    if (ReadPartial(readFileNo, &c, sizeof c) <= 0)
+        return;
     incoming = c;
     stats->numConsoleCharsRead++;
     (*readHandler)(handlerArg);
@@ -117,7 +122,8 @@ void
 Console::WriteDone()
 {
     putBusy = false;
-    stats->numConsoleCharsWritten++;
+    stats->numConsoleCharsWritten += putSize;
+    putSize = 0;
     (*writeHandler)(handlerArg);
 }
 
@@ -136,10 +142,25 @@ Console::GetChar()
 /// occur in the future, and return.
 void
 Console::PutChar(char ch)
+{
+    PutBuffer(&ch, sizeof ch);
+}
+
+/// Write a whole buffer to the simulated display, schedule a *single*
+/// interrupt for when the last character has departed, and return.
+///
+/// The transmission time is unchanged -- `CONSOLE_TIME` per character,
+/// so the completion lands `size * CONSOLE_TIME` ticks from now -- but a
+/// burst costs one trip through the interrupt machinery instead of one
+/// per character.
+void
+Console::PutBuffer(const char * buffer, unsigned size)
 {
     ASSERT(!putBusy);
-    WriteFile(writeFileNo, &ch, sizeof(char));
+    ASSERT(size > 0);
+    WriteFile(writeFileNo, buffer, size);
     putBusy = true;
+    putSize = size;
     interrupt->Schedule(ConsoleWriteDone, this,
-      CONSOLE_TIME, CONSOLE_WRITE_INT);
+      size * CONSOLE_TIME, CONSOLE_WRITE_INT);
 }
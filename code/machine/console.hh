@@ -54,6 +54,14 @@ public:
     void
     PutChar(char ch);
 
+    /// Write a whole buffer to the console display, and return
+    /// immediately.  The serial line still takes `CONSOLE_TIME` per
+    /// character, but the batch completes with a *single* `writeHandler`
+    /// call once the last character has departed -- one interrupt
+    /// dispatch per burst instead of one per character.
+    void
+    PutBuffer(const char * buffer, unsigned size);
+
     /// Poll the console input.  If a char is available, return it.
     /// Otherwise, return EOF.  `readHandler` is called whenever there is a
     /// char to be gotten.
@@ -78,6 +86,8 @@ private:
     void * handlerArg; ///< argument to be passed to the interrupt handlers.
     bool putBusy;      ///< Is a `PutChar` operation in progress?  If so, you
     ///< cannot do another one!
+    unsigned putSize; ///< Characters in the batch in flight, so the
+    ///< completion can account for all of them at once.
     char incoming; ///< Contains the character to be read, if there is one
     ///< available.  Otherwise contains EOF.
 };
@@ -17,6 +17,8 @@
 #include "disk.hh"
 #include "threads/system.hh"
 
+#include <string.h>
+
 
 /// We put this at the front of the UNIX file representing the
 /// disk, to make it less likely we will accidentally treat a useful file
@@ -24,7 +26,15 @@
 static const unsigned MAGIC_NUMBER = 0x456789AB;
 static const unsigned MAGIC_SIZE   = sizeof(int);
 
-static const unsigned DISK_SIZE = MAGIC_SIZE + NUM_SECTORS * SECTOR_SIZE;
+/// The disk geometry, fixed at startup before any `Disk` is built
+/// (cf. `-dg` in `system.cc`).
+unsigned NUM_TRACKS  = DEFAULT_NUM_TRACKS;
+unsigned NUM_SECTORS = SECTORS_PER_TRACK * DEFAULT_NUM_TRACKS;
+
+/// Largest supported track count: file offsets go through `Lseek`, whose
+/// offsets are `int`s, so the disk file must stay under 2 GiB.
+static const unsigned MAX_NUM_TRACKS =
+  0x7FFFFFFF / (SECTORS_PER_TRACK * SECTOR_SIZE);
 
 /// dummy procedure because we cannot take a pointer of a member function
 static void
@@ -42,40 +52,61 @@ DiskDone(void * arg)
 /// * `callWhenDone` is an interrupt handler to be called when disk
 ///   read/write request completes.
 /// * `callArg` is an argument to pass the interrupt handler.
-Disk::Disk(const char * name, VoidFunctionPtr callWhenDone, void * callArg)
+/// * `numTracks` sets the geometry; sector count follows from
+///   `SECTORS_PER_TRACK`.
+Disk::Disk(const char * name, VoidFunctionPtr callWhenDone, void * callArg,
+  unsigned numTracks)
 {
     ASSERT(name != nullptr);
     ASSERT(callWhenDone != nullptr);
+    ASSERT(numTracks > 0 && numTracks <= MAX_NUM_TRACKS);
 
     int magicNum;
-    int tmp = 0;
 
     DEBUG('d', "Initializing the disk, 0x%X 0x%X\n", callWhenDone, callArg);
     handler    = callWhenDone;
     handlerArg = callArg;
     lastSector = 0;
     bufferInit = 0;
+    streamInit = 0;
+    numSectors = numTracks * SECTORS_PER_TRACK;
+    diskSize   = MAGIC_SIZE + numSectors * SECTOR_SIZE;
 
     fileno = OpenForReadWrite(name, false);
-    if (fileno >= 0) { // File exists, check magic number.
+    if (fileno >= 0) { // File exists, check magic number and geometry.
         Read(fileno, (char *) &magicNum, MAGIC_SIZE);
         ASSERT(magicNum == MAGIC_NUMBER);
+        // A disk file created under another geometry would silently
+        // read as garbage past its end; refuse it instead.
+        Lseek(fileno, 0, 2);
+        ASSERT((unsigned) Tell(fileno) == diskSize);
+        Lseek(fileno, 0, 0);
     } else { // File does not exist, create it.
         fileno   = OpenForWrite(name);
         magicNum = MAGIC_NUMBER;
         WriteFile(fileno, (char *) &magicNum, MAGIC_SIZE);
         // Write magic number.
 
-        // Need to write at end of file, so that reads will not return EOF.
-        Lseek(fileno, DISK_SIZE - sizeof(int), 0);
-        WriteFile(fileno, (char *) &tmp, sizeof(int));
+        // Extend to full size without writing any data: the file stays
+        // sparse, so creating a large disk costs neither startup time
+        // nor host blocks.  Unwritten sectors read as zeroes and get
+        // real blocks lazily, on their first write.
+        TruncateFile(fileno, diskSize);
     }
-    active = false;
+
+    // Map the disk file so each sector transfer is a `memcpy` instead of
+    // a seek plus a read or write; the mapping is synced back at
+    // shutdown.  If the host cannot map it, the old path still works.
+    mapping = MapFile(fileno, diskSize);
+    active  = false;
 }
 
-/// Clean up disk simulation, by closing the UNIX file representing the disk.
+/// Clean up disk simulation: flush the mapping (if any) back to the UNIX
+/// file representing the disk, and close it.
 Disk::~Disk()
 {
+    if (mapping != nullptr)
+        UnmapFile(mapping, diskSize);
     Close(fileno);
 }
 
@@ -118,11 +149,16 @@ Disk::ReadRequest(unsigned sectorNumber, char * data)
     int ticks = ComputeLatency(sectorNumber, false);
 
     ASSERT(!active); // only one request at a time
-    ASSERT(sectorNumber >= 0 && sectorNumber < NUM_SECTORS);
+    ASSERT(sectorNumber >= 0 && sectorNumber < numSectors);
 
     DEBUG('d', "Reading from sector %u\n", sectorNumber);
-    Lseek(fileno, SECTOR_SIZE * sectorNumber + MAGIC_SIZE, 0);
-    Read(fileno, data, SECTOR_SIZE);
+    if (mapping != nullptr) {
+        memcpy(data, mapping + SECTOR_SIZE * sectorNumber + MAGIC_SIZE,
+          SECTOR_SIZE);
+    } else {
+        Lseek(fileno, SECTOR_SIZE * sectorNumber + MAGIC_SIZE, 0);
+        Read(fileno, data, SECTOR_SIZE);
+    }
     if (debug.IsEnabled('d'))
         PrintSector(false, sectorNumber, data);
 
@@ -140,11 +176,16 @@ Disk::WriteRequest(unsigned sectorNumber, const char * data)
     int ticks = ComputeLatency(sectorNumber, true);
 
     ASSERT(!active);
-    ASSERT(sectorNumber >= 0 && sectorNumber < NUM_SECTORS);
+    ASSERT(sectorNumber >= 0 && sectorNumber < numSectors);
 
     DEBUG('d', "Writing to sector %u\n", sectorNumber);
-    Lseek(fileno, SECTOR_SIZE * sectorNumber + MAGIC_SIZE, 0);
-    WriteFile(fileno, data, SECTOR_SIZE);
+    if (mapping != nullptr) {
+        memcpy(mapping + SECTOR_SIZE * sectorNumber + MAGIC_SIZE, data,
+          SECTOR_SIZE);
+    } else {
+        Lseek(fileno, SECTOR_SIZE * sectorNumber + MAGIC_SIZE, 0);
+        WriteFile(fileno, data, SECTOR_SIZE);
+    }
     if (debug.IsEnabled('d'))
         PrintSector(true, sectorNumber, data);
 
@@ -221,6 +262,12 @@ Disk::ModuloDiff(unsigned to, unsigned from)
 /// contents of the current disk track into the buffer.  This allows read
 /// requests to the current track to be satisfied more quickly.  The contents
 /// of the track buffer are discarded after every seek to a new track.
+///
+/// Once a whole rotation has gone by with no seek, the track is completely
+/// buffered and the drive does not sit still: it seeks to the next track on
+/// its own and keeps streaming into the buffer (read-ahead).  A read on that
+/// track can then be served by the stream instead of paying a fresh seek
+/// plus rotational delay -- whichever of the two is sooner.
 int
 Disk::ComputeLatency(unsigned newSector, bool writing)
 {
@@ -228,6 +275,8 @@ Disk::ComputeLatency(unsigned newSector, bool writing)
     unsigned seek      = TimeToSeek(newSector, &rotation);
     unsigned timeAfter = stats->totalTicks + seek + rotation;
 
+    streamInit = 0;
+
     #ifndef NOTRACKBUF // Turn this on if you do not want the track buffer
                        // stuff.
     // Check if track buffer applies.
@@ -244,6 +293,30 @@ Disk::ComputeLatency(unsigned newSector, bool writing)
     rotation += ModuloDiff(newSector, timeAfter / ROTATION_TIME)
       * ROTATION_TIME;
 
+    #ifndef NOTRACKBUF
+    // Check if read-ahead applies: the buffer has been filling the
+    // current track since `bufferInit` (any seek resets it), so it holds
+    // the full track one rotation later and starts on the next one after
+    // the one-track seek.  `newSector` is fully streamed in one buffer
+    // load after it passes under the head.
+    if (!writing &&
+      newSector / SECTORS_PER_TRACK == lastSector / SECTORS_PER_TRACK + 1)
+    {
+        unsigned aheadInit = bufferInit
+          + SECTORS_PER_TRACK * ROTATION_TIME + SEEK_TIME;
+        unsigned ready = aheadInit
+          + (ModuloDiff(newSector, aheadInit / ROTATION_TIME) + 1)
+          * ROTATION_TIME;
+        unsigned fromStream = ready > stats->totalTicks
+          ? ready - stats->totalTicks : ROTATION_TIME;
+        if (fromStream < seek + rotation + ROTATION_TIME) {
+            streamInit = aheadInit;
+            DEBUG('d', "Request latency = %u\n", fromStream);
+            return fromStream;
+        }
+    }
+    #endif // ifndef NOTRACKBUF
+
     DEBUG('d', "Request latency = %u\n", seek + rotation + ROTATION_TIME);
     return seek + rotation + ROTATION_TIME;
 }
@@ -256,7 +329,12 @@ Disk::UpdateLast(unsigned newSector)
     unsigned rotate;
     unsigned seek = TimeToSeek(newSector, &rotate);
 
-    if (seek != 0)
+    if (streamInit != 0)
+        // The request was served by read-ahead: the head already moved on
+        // its own, and the buffer has been filling the new track since
+        // then, not since now.
+        bufferInit = streamInit;
+    else if (seek != 0)
         bufferInit = stats->totalTicks + seek + rotate;
     lastSector = newSector;
     DEBUG('d', "Updating last sector = %u, %u\n", lastSector, bufferInit);
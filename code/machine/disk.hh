@@ -48,22 +48,44 @@
 /// its contents are in the track buffer.  Most disks these days now come
 /// with a track buffer.
 ///
+/// The buffer also reads ahead: once a full rotation has passed with no
+/// seek, the whole track is buffered, so the drive seeks to the next track
+/// by itself and keeps streaming.  A sequential read that crosses a track
+/// boundary is served by that stream when it beats seeking on demand.
+///
 /// The track buffer simulation can be disabled by compiling with
 /// `-DNOTRACKBUF`.
 
-const unsigned SECTOR_SIZE       = 128; ///< Number of bytes per disk sector.
+/// Number of bytes per disk sector.  Configurable per build (add e.g.
+/// `-DSECTOR_SIZE_BYTES=1024` to `DEFINES` in the Makefile of the build
+/// you want): bigger sectors amortize the fixed per-request costs
+/// (interrupt, latency model, cache lookup) over more bytes, at the
+/// price of coarser allocation.  The disk file layout follows the
+/// sector size, so a DISK file cannot be shared between builds that
+/// disagree on it.
+#ifndef SECTOR_SIZE_BYTES
+#define SECTOR_SIZE_BYTES 128
+#endif
+const unsigned SECTOR_SIZE       = SECTOR_SIZE_BYTES;
 const unsigned SECTORS_PER_TRACK = 32;  ///< Number of sectors per disk
 ///< track.
-const unsigned NUM_TRACKS  = 32; ///< Number of tracks per disk.
-const unsigned NUM_SECTORS = SECTORS_PER_TRACK * NUM_TRACKS;
-///< Total # of sectors per disk.
+const unsigned DEFAULT_NUM_TRACKS = 32; ///< Tracks per disk, if `-dg` does
+///< not say otherwise.
+
+/// The geometry is chosen at startup (`-dg <tracks>`, cf. `system.cc`)
+/// and fixed before any disk-backed structure is built, so these read as
+/// constants everywhere else -- only the track count varies.
+extern unsigned NUM_TRACKS;  ///< Number of tracks per disk.
+extern unsigned NUM_SECTORS; ///< Total # of sectors per disk.
 
 class Disk {
 public:
-    /// Create a simulated disk.
+    /// Create a simulated disk with `numTracks` tracks of
+    /// `SECTORS_PER_TRACK` sectors each.
     ///
     /// Invoke `(*callWhenDone)(callArg)` every time a request completes.
-    Disk(const char * name, VoidFunctionPtr callWhenDone, void * callArg);
+    Disk(const char * name, VoidFunctionPtr callWhenDone, void * callArg,
+      unsigned numTracks);
     ~Disk(); // Deallocate the disk.
 
     /// Read/write an single disk sector.
@@ -87,7 +109,13 @@ public:
     ComputeLatency(unsigned newSector, bool writing);
 
 private:
+    unsigned numSectors;     ///< Sectors on this disk.
+    unsigned diskSize;       ///< Bytes in the simulated disk file.
     int fileno;              ///< UNIX file number for simulated disk.
+    char * mapping;          ///< Memory mapping of the disk file, so sector
+    ///< transfers are plain `memcpy`; null if the
+    ///< host could not map it, in which case we
+    ///< fall back to seek-and-read.
     VoidFunctionPtr handler; ///< Interrupt handler, to be invoked when any
     ///< disk request finishes.
     void * handlerArg;   ///< Argument to interrupt handler.
@@ -95,6 +123,9 @@ private:
     unsigned lastSector; ///< The previous disk request.
     int bufferInit;      ///< When the track buffer started being loaded.
                          // being loaded
+    unsigned streamInit; ///< When read-ahead began filling the track of
+                         ///< the last request, or 0 if that request was
+                         ///< not served by read-ahead.
 
     /// Time to get to the new track.
     unsigned
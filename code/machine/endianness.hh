@@ -2,6 +2,11 @@
 /// machine's format of little endian.  If the host machine is little endian
 /// (DEC and Intel), these end up being NOPs.
 ///
+/// They are defined inline so that on a matching host the conversion
+/// vanishes at compile time: `ReadMem`/`WriteMem`/`ReadInstruction` sit on
+/// the hot path of every simulated memory access, and an out-of-line call
+/// to a function that just returns its argument is pure overhead there.
+///
 /// What is stored in each format:
 ///
 /// Host byte ordering
@@ -18,14 +23,49 @@
 #define NACHOS_MACHINE_ENDIANNESS__HH
 
 
-unsigned
-WordToHost(unsigned word);
-unsigned short
-ShortToHost(unsigned short shortword);
-unsigned
-WordToMachine(unsigned word);
-unsigned short
-ShortToMachine(unsigned short shortword);
+inline unsigned
+WordToHost(unsigned word)
+{
+    #ifdef HOST_IS_BIG_ENDIAN
+    unsigned long result;
+    result  = word >> 24 & 0x000000FF;
+    result |= word >> 8 & 0x0000FF00;
+    result |= word << 8 & 0x00FF0000;
+    result |= word << 24 & 0xFF000000;
+    return result;
+
+    #else
+    return word;
+
+    #endif
+}
+
+inline unsigned short
+ShortToHost(unsigned short shortword)
+{
+    #ifdef HOST_IS_BIG_ENDIAN
+    unsigned short result;
+    result  = shortword << 8 & 0xFF00;
+    result |= shortword >> 8 & 0x00FF;
+    return result;
+
+    #else
+    return shortword;
+
+    #endif
+}
+
+inline unsigned
+WordToMachine(unsigned word)
+{
+    return WordToHost(word);
+}
+
+inline unsigned short
+ShortToMachine(unsigned short shortword)
+{
+    return ShortToHost(shortword);
+}
 
 
 #endif /* ifndef NACHOS_MACHINE_ENDIANNESS__HH */
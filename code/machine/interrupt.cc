@@ -30,10 +30,26 @@
 
 static const char * INT_LEVEL_NAMES[] = { "disabled", "enabled" };
 static const char * INT_TYPE_NAMES[]  = {
-    "timer",        "disk", "console write", "console read",
-    "network send", "network recv"
+    "timer",        "software timer", "disk",         "console write",
+    "console read", "network send",   "network recv"
 };
 
+/// Host time spent inside each device's interrupt handler (cf.
+/// `HostTimer`); indexed by `IntType`, in step with `INT_TYPE_NAMES`.
+static HostTimer deviceTimers[NUM_INT_TYPES] = {
+    HostTimer("host.dev.timer"),
+    HostTimer("host.dev.swTimer"),
+    HostTimer("host.dev.disk"),
+    HostTimer("host.dev.consoleWr"),
+    HostTimer("host.dev.consoleRd"),
+    HostTimer("host.dev.netSend"),
+    HostTimer("host.dev.netRecv"),
+};
+
+/// Host time spent off the `OneTick` fast path: draining the pending
+/// queue and firing handlers (the device timers above are subsets).
+static HostTimer dispatchTimer("host.intDispatch");
+
 static inline bool
 IsIntStatus(IntStatus s)
 {
@@ -46,6 +62,16 @@ IsIntType(IntType t)
     return 0 <= t && t < NUM_INT_TYPES;
 }
 
+/// Interrupts that only look for outside input, or would preempt when
+/// there is nobody to preempt.  Firing one of these does not advance the
+/// machine's state by itself, so a machine whose pending queue holds
+/// nothing else is really waiting on the outside world.
+static inline bool
+IsPollType(IntType t)
+{
+    return t == CONSOLE_READ_INT || t == NETWORK_RECV_INT || t == TIMER_INT;
+}
+
 /// Initialize a hardware device interrupt that is to be scheduled to occur
 /// in the near future.
 ///
@@ -71,17 +97,20 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, void * param,
 Interrupt::Interrupt()
 {
     level         = INT_OFF;
-    pending       = new List<PendingInterrupt *>;
+    pending       = new Heap<PendingInterrupt *>;
+    nextDeadline  = 0;
     inHandler     = false;
+    idleFiring    = false;
     yieldOnReturn = false;
     status        = SYSTEM_MODE;
+    numPendingOthers = 0;
 }
 
 /// De-allocate the data structures needed by the interrupt simulation.
 Interrupt::~Interrupt()
 {
     while (!pending->IsEmpty())
-        delete pending->Pop();
+        delete pending->SortedPop(nullptr);
     delete pending;
 }
 
@@ -139,27 +168,43 @@ Interrupt::Enable()
 ///
 /// Two things can cause `OneTick` to be called:
 /// * interrupts are re-enabled;
-/// * a user instruction is executed.
+/// * a user instruction (or a straight-line burst of them) is executed.
 void
-Interrupt::OneTick()
+Interrupt::OneTick(unsigned count)
 {
+    ASSERT(count > 0);
+
     MachineStatus old = status;
 
     // Advance simulated time.
     if (status == SYSTEM_MODE) {
-        stats->totalTicks  += SYSTEM_TICK;
-        stats->systemTicks += SYSTEM_TICK;
+        stats->totalTicks  += SYSTEM_TICK * count;
+        stats->systemTicks += SYSTEM_TICK * count;
     } else { // USER_PROGRAM
-        stats->totalTicks += USER_TICK;
-        stats->userTicks  += USER_TICK;
+        stats->totalTicks += USER_TICK * count;
+        stats->userTicks  += USER_TICK * count;
     }
     DEBUG('i', "== Tick %u ==\n", stats->totalTicks);
 
+    // Fast path: if the earliest pending interrupt is not due yet (and no
+    // handler already asked for a yield), there is nothing to do; skip the
+    // whole pending-queue machinery.  This check runs after every burst of
+    // user instructions, so it must stay a single compare.
+    if (!yieldOnReturn
+      && (pending->IsEmpty() || nextDeadline > stats->totalTicks))
+        return;
+
     // Check any pending interrupts are now ready to fire.
     ChangeLevel(INT_ON, INT_OFF); // First, turn off interrupts (interrupt
                                   // handlers run with interrupts disabled).
-    while (CheckIfDue(false))     // Check for pending interrupts.
-        ;
+    {
+        HostTimerScope scope(dispatchTimer);
+        while (CheckIfDue(false)) // Check for pending interrupts.
+            ;
+        stats->Snapshot();        // Already off the fast path, so the
+                                  // snapshot check costs nothing when
+                                  // snapshots are disabled.
+    }
     ChangeLevel(INT_OFF, INT_ON); // Re-enable interrupts.
     if (yieldOnReturn) {          // If the timer device handler asked for a
                                   // context switch, ok to do it now.
@@ -200,6 +245,8 @@ Interrupt::Idle()
         while (CheckIfDue(false))   // Check for any other pending interrupts.
             yieldOnReturn = false;  // Since there is nothing in the ready
                                     // queue, the yield is automatic.
+        stats->Snapshot();          // Idle time advances in big jumps, so
+                                    // snapshots would starve without this.
         status = SYSTEM_MODE;
         return; // Return in case there is now a runnable
                 // thread.
@@ -221,6 +268,7 @@ void
 Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
+    debug.DumpTrace(); // Flush the trace ring, if `-dt` was given.
     stats->Print();
     Cleanup(); // Never returns.
 }
@@ -235,8 +283,8 @@ Interrupt::Halt()
 void
 Interrupt::RestartTicks()
 {
-    List<PendingInterrupt *> * oldPending = pending;
-    pending = new List<PendingInterrupt *>;
+    Heap<PendingInterrupt *> * oldPending = pending;
+    pending = new Heap<PendingInterrupt *>;
 
     PendingInterrupt * i;
     unsigned oldWhen = 0;
@@ -248,6 +296,7 @@ Interrupt::RestartTicks()
     }
 
     delete oldPending;
+    UpdateNextDeadline();
     stats->totalTicks  = 0;
     stats->tickResets += 1;
 }
@@ -294,6 +343,20 @@ Interrupt::Schedule(VoidFunctionPtr handler, void * arg,
       INT_TYPE_NAMES[type], when);
 
     pending->SortedInsert(toOccur, when);
+    if (!IsPollType(type))
+        numPendingOthers++;
+    UpdateNextDeadline();
+}
+
+/// Re-read the earliest deadline from the pending queue, after anything
+/// was inserted or removed.
+void
+Interrupt::UpdateNextDeadline()
+{
+    int key;
+
+    if (pending->PeekKey(&key))
+        nextDeadline = (unsigned) key;
 }
 
 /// Check if an interrupt is scheduled to occur, and if so, fire it off.
@@ -324,6 +387,7 @@ Interrupt::CheckIfDue(bool advanceClock)
         stats->totalTicks = when;
     } else if (when > stats->totalTicks) { // Not time yet, put it back.
         pending->SortedInsert(toOccur, when);
+        UpdateNextDeadline();
         return false;
     }
 
@@ -332,8 +396,10 @@ Interrupt::CheckIfDue(bool advanceClock)
       pending->IsEmpty())
     {
         pending->SortedInsert(toOccur, when);
+        UpdateNextDeadline();
         return false;
     }
+    UpdateNextDeadline();
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %u\n",
       INT_TYPE_NAMES[toOccur->type], toOccur->when);
@@ -341,12 +407,21 @@ Interrupt::CheckIfDue(bool advanceClock)
     if (machine != nullptr)
         machine->DelayedLoad(0, 0);
     #endif
-    inHandler = true;
-    status    = SYSTEM_MODE;           // Whatever we were doing, we are now going to be
+    inHandler  = true;
+    idleFiring = old == IDLE_MODE;
+    status     = SYSTEM_MODE;          // Whatever we were doing, we are now going to be
                                        // running in the kernel.
-    (*toOccur->handler)(toOccur->arg); // Call the interrupt handler.
-    status    = old;                   // Restore the machine status.
-    inHandler = false;
+    {
+        // Per-device host time; handlers run with interrupts off, so
+        // the scope cannot span a context switch.
+        HostTimerScope scope(deviceTimers[toOccur->type]);
+        (*toOccur->handler)(toOccur->arg); // Call the interrupt handler.
+    }
+    status     = old;                  // Restore the machine status.
+    inHandler  = false;
+    idleFiring = false;
+    if (!IsPollType(toOccur->type))
+        numPendingOthers--;
     delete toOccur;
     return true;
 } // Interrupt::CheckIfDue
@@ -363,6 +438,12 @@ Interrupt::GetStatus() const
     return status;
 }
 
+bool
+Interrupt::IsIdlePolling() const
+{
+    return (status == IDLE_MODE || idleFiring) && numPendingOthers == 0;
+}
+
 void
 Interrupt::SetStatus(MachineStatus st)
 {
@@ -36,6 +36,7 @@
 #define NACHOS_MACHINE_INTERRUPT__HH
 
 
+#include "lib/heap.hh"
 #include "lib/list.hh"
 
 
@@ -61,6 +62,10 @@ enum MachineStatus {
 /// keyboard, and a network.
 enum IntType {
     TIMER_INT,
+    SOFT_TIMER_INT, ///< Software timeouts (`threads/timer_wheel.cc`).
+                    ///< Unlike `TIMER_INT`, one of these pending keeps an
+                    ///< idle machine advancing: something is waiting for
+                    ///< it (cf. the idle check in `CheckIfDue`).
     DISK_INT,
     CONSOLE_WRITE_INT,
     CONSOLE_READ_INT,
@@ -135,6 +140,16 @@ public:
     void
     SetStatus(MachineStatus st);
 
+    /// True when the machine is idle and every pending interrupt is a
+    /// device input poll (or a preemption tick with nobody to preempt):
+    /// nothing but outside input can make progress, so the devices are
+    /// free to block the host process for real while they poll (cf.
+    /// `PollFile` and `Network::CheckPktAvail`).  While something
+    /// simulated is still due -- a disk transfer, a software timer --
+    /// this stays false and idle time is skipped, not slept.
+    bool
+    IsIdlePolling() const;
+
     // Print interrupt state.
     void
     DumpState();
@@ -153,24 +168,45 @@ public:
       unsigned when, IntType type);
 
     /// Advance simulated time.
+    ///
+    /// `count` is how many ticks' worth of work was done since the last
+    /// call; the CPU simulation passes the length of a straight-line burst
+    /// of user instructions so it can check for interrupts once per burst.
     void
-    OneTick();
+    OneTick(unsigned count = 1);
 
 private:
     IntStatus level;                      ///< Are interrupts enabled or disabled?
-    List < PendingInterrupt * > *pending; ///< The list of interrupts scheduled
-    ///< to occur in the future.
+    Heap < PendingInterrupt * > *pending; ///< The queue of interrupts
+    ///< scheduled to occur in the
+    ///< future, earliest at the top.
     bool inHandler;     ///< True if we are running an interrupt handler.
+    bool idleFiring;    ///< True while running a handler that interrupted
+    ///< the idle loop; the `status` a handler sees is
+    ///< `SYSTEM_MODE`, so idleness is remembered here.
     bool yieldOnReturn; ///< True if we are to context switch on return from
     ///< the interrupt handler.
     MachineStatus status; ///< Idle, kernel mode, user mode.
 
+    unsigned numPendingOthers; ///< Pending interrupts that are not input
+    ///< polls; while any exist, the machine must
+    ///< not block the host (cf. `IsIdlePolling`).
+
+    unsigned nextDeadline; ///< Cached `when` of the earliest pending
+    ///< interrupt, so the per-instruction check
+    ///< in `OneTick` is a single compare.  Only
+    ///< meaningful while `pending` is nonempty.
+
     /// These functions are internal to the interrupt simulation code.
 
     /// Check if an interrupt is supposed to occur now.
     bool
     CheckIfDue(bool advanceClock);
 
+    /// Refresh `nextDeadline` from the top of the pending queue.
+    void
+    UpdateNextDeadline();
+
     /// SetLevel, without advancing the simulated time.
     void
     ChangeLevel(IntStatus old,
@@ -53,7 +53,18 @@ Machine::Machine(SingleStepper * st)
     for (unsigned i = 0; i < NUM_EXCEPTION_TYPES; i++)
         handlers[i] = nullptr;
 
-    singleStepper = st;
+    singleStepper  = st;
+    stepping       = st != nullptr;
+    numBreakpoints = 0;
+    numStepRanges  = 0;
+    rangeHullLo    = 0;
+    rangeHullSpan  = 0;
+
+    // Physical instruction addresses are always word aligned, so an odd
+    // tag can never match and marks the entry as empty.
+    for (unsigned i = 0; i < DECODE_CACHE_SIZE; i++)
+        decodeCache[i].physAddr = 1;
+
     CheckEndian();
 }
 
@@ -112,6 +123,30 @@ Machine::WriteMem(unsigned addr, unsigned size, int value)
     return true;
 }
 
+bool
+Machine::ReadMemBlock(unsigned addr, unsigned size, char * buffer)
+{
+    ExceptionType e = mmu.ReadMemBlock(addr, size, buffer);
+
+    if (e != NO_EXCEPTION) {
+        RaiseException(e, addr);
+        return false;
+    }
+    return true;
+}
+
+bool
+Machine::WriteMemBlock(unsigned addr, unsigned size, const char * buffer)
+{
+    ExceptionType e = mmu.WriteMemBlock(addr, size, buffer);
+
+    if (e != NO_EXCEPTION) {
+        RaiseException(e, addr);
+        return false;
+    }
+    return true;
+}
+
 /// Transfer control to the Nachos kernel from user mode, because the user
 /// program either invoked a system call, or some exception occured (such as
 /// the address translation failed).
@@ -144,3 +179,68 @@ Machine::SetHandler(ExceptionType et, ExceptionHandler handler)
 
     handlers[et] = handler;
 }
+
+bool
+Machine::SetBreakpoint(unsigned addr)
+{
+    if (numBreakpoints >= MAX_BREAKPOINTS)
+        return false;
+    breakpoints[numBreakpoints++] = addr;
+    return true;
+}
+
+bool
+Machine::ClearBreakpoint(unsigned addr)
+{
+    for (unsigned i = 0; i < numBreakpoints; i++)
+        if (breakpoints[i] == addr) {
+            breakpoints[i] = breakpoints[--numBreakpoints];
+            return true;
+        }
+    return false;
+}
+
+bool
+Machine::SetStepRange(unsigned lo, unsigned hi)
+{
+    if (numStepRanges >= MAX_STEP_RANGES || lo >= hi)
+        return false;
+    stepRangeLo[numStepRanges] = lo;
+    stepRangeHi[numStepRanges] = hi;
+    numStepRanges++;
+    RecomputeStepHull();
+    return true;
+}
+
+bool
+Machine::ClearStepRange(unsigned lo)
+{
+    for (unsigned i = 0; i < numStepRanges; i++)
+        if (stepRangeLo[i] == lo) {
+            numStepRanges--;
+            stepRangeLo[i] = stepRangeLo[numStepRanges];
+            stepRangeHi[i] = stepRangeHi[numStepRanges];
+            RecomputeStepHull();
+            return true;
+        }
+    return false;
+}
+
+void
+Machine::RecomputeStepHull()
+{
+    if (numStepRanges == 0) {
+        rangeHullLo   = 0;
+        rangeHullSpan = 0;
+        return;
+    }
+    unsigned lo = stepRangeLo[0], hi = stepRangeHi[0];
+    for (unsigned i = 1; i < numStepRanges; i++) {
+        if (stepRangeLo[i] < lo)
+            lo = stepRangeLo[i];
+        if (stepRangeHi[i] > hi)
+            hi = stepRangeHi[i];
+    }
+    rangeHullLo   = lo;
+    rangeHullSpan = hi - lo;
+}
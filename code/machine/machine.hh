@@ -22,6 +22,7 @@
 
 
 #include "exception_type.hh"
+#include "instruction.hh"
 #include "mmu.hh"
 #include "single_stepper.hh"
 #include "lib/utility.hh"
@@ -47,8 +48,6 @@ enum {
     NUM_TOTAL_REGS = 40
 };
 
-class Instruction;
-
 typedef void (* ExceptionHandler)(ExceptionType);
 
 /// The following class defines the simulated host workstation hardware, as
@@ -67,6 +66,13 @@ typedef void (* ExceptionHandler)(ExceptionType);
 class Machine {
 public:
 
+    /// How many PC-compare breakpoint registers the machine has, in the
+    /// spirit of the debug registers of real CPUs.
+    static const unsigned MAX_BREAKPOINTS = 8;
+
+    /// How many `[lo, hi)` step ranges can be armed at once.
+    static const unsigned MAX_STEP_RANGES = 4;
+
     /// Initialize the simulation of the hardware for running user programs.
     Machine(SingleStepper * st);
 
@@ -99,6 +105,14 @@ public:
     bool
     WriteMem(unsigned addr, unsigned size, int value);
 
+    /// Block variants for copies that stay within one page.
+
+    bool
+    ReadMemBlock(unsigned addr, unsigned size, char * buffer);
+
+    bool
+    WriteMemBlock(unsigned addr, unsigned size, const char * buffer);
+
     /// Print the user CPU and memory state.
     void
     DumpState();
@@ -115,6 +129,15 @@ public:
     void
     ExecInstruction(const Instruction * instr);
 
+    /// The execution loop behind `Run`, instantiated twice: `HOOKED`
+    /// compiles in the per-instruction debug checks (breakpoints, step
+    /// ranges, stepping) and the per-block profiler/stepper calls;
+    /// `!HOOKED` is the release loop with none of them, selected when no
+    /// debugger or profiler was configured at startup.  Never returns.
+    template <bool HOOKED>
+    void
+    RunLoop(Instruction * instr);
+
     /// Do a pending delayed load (modifying a reg).
     void
     DelayedLoad(unsigned nextReg, int nextVal);
@@ -133,10 +156,74 @@ public:
     void
     SetHandler(ExceptionType et, ExceptionHandler handler);
 
+    /// Arm a breakpoint on a user virtual PC; execution drops into the
+    /// single stepper right before that instruction runs.  Returns false
+    /// when all the breakpoint registers are in use.
+    bool
+    SetBreakpoint(unsigned addr);
+
+    /// Disarm the breakpoint at `addr`; returns false if there is none.
+    bool
+    ClearBreakpoint(unsigned addr);
+
+    /// Arm a step range: while the user PC is inside `[lo, hi)` every
+    /// instruction diverts to the single stepper, and outside all ranges
+    /// the machine runs at full speed.  This makes it practical to trace
+    /// one function of interest out of a long run.  Returns false when
+    /// the range is empty or all the range registers are in use.
+    bool
+    SetStepRange(unsigned lo, unsigned hi);
+
+    /// Disarm the step range starting at `lo`; returns false if there is
+    /// none.
+    bool
+    ClearStepRange(unsigned lo);
+
 private:
-    SingleStepper * singleStepper; ///< Drop back into the method of a
-    ///< provided object (may be a debugger)
-    ///< after each simulated instruction.
+    SingleStepper * singleStepper; ///< Debugger hook: dropped into after
+    ///< every instruction while `stepping`,
+    ///< and whenever a breakpoint is hit.
+    bool stepping; ///< Whether to invoke the stepper after each
+    ///< instruction; cleared when it asks to run free,
+    ///< set back on a breakpoint hit.
+    unsigned breakpoints[MAX_BREAKPOINTS]; ///< Armed PC-compare registers.
+    unsigned numBreakpoints; ///< How many of them are armed.
+    unsigned stepRangeLo[MAX_STEP_RANGES]; ///< Armed step ranges,
+    unsigned stepRangeHi[MAX_STEP_RANGES]; ///< `[lo, hi)` pairs.
+    unsigned numStepRanges; ///< How many of them are armed.
+    unsigned rangeHullLo;   ///< Cached bounds enclosing every armed
+    unsigned rangeHullSpan; ///< range; span 0 when none is.
+
+    /// Does some breakpoint register match `pc`?  Inline: this runs once
+    /// per simulated instruction, and with no breakpoints armed it must
+    /// cost just the `numBreakpoints` test (cf. `Machine::Run`).
+    bool
+    AtBreakpoint(unsigned pc) const
+    {
+        for (unsigned i = 0; i < numBreakpoints; i++)
+            if (breakpoints[i] == pc)
+                return true;
+        return false;
+    }
+
+    /// Is `pc` inside some armed step range?  Inline and guarded by one
+    /// compare against the cached hull of all ranges -- with none armed
+    /// the span is zero and that compare always fails, so this is all
+    /// the hot path pays (cf. `Machine::Run`).
+    bool
+    InStepRange(unsigned pc) const
+    {
+        if (pc - rangeHullLo >= rangeHullSpan)
+            return false;
+        for (unsigned i = 0; i < numStepRanges; i++)
+            if (pc - stepRangeLo[i] < stepRangeHi[i] - stepRangeLo[i])
+                return true;
+        return false;
+    }
+
+    /// Refresh `rangeHullLo`/`rangeHullSpan` after arming or disarming.
+    void
+    RecomputeStepHull();
 
     /// Private data structures.
     int registers[NUM_TOTAL_REGS]; ///< CPU registers, for executing user
@@ -145,6 +232,20 @@ private:
     MMU mmu; ///< Memory management unit.
 
     ExceptionHandler handlers[NUM_EXCEPTION_TYPES]; ///< Exception handlers.
+
+    /// Direct-mapped cache of already-decoded instructions, indexed by
+    /// physical PC, so tight user loops skip `Instruction::Decode`.  An
+    /// entry is reused only if both the frame's write generation and the
+    /// raw word still match, so stale decodes can never be executed.
+    static const unsigned DECODE_CACHE_SIZE = 1024; // Power of two.
+
+    struct DecodedInstruction {
+        unsigned    physAddr;   ///< Tag: physical address of the word.
+        unsigned    generation; ///< Frame write generation when decoded.
+        Instruction instr;      ///< Cracked instruction fields.
+    };
+
+    DecodedInstruction decodeCache[DECODE_CACHE_SIZE];
 };
 
 
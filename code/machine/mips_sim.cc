@@ -16,10 +16,113 @@
 #include "threads/system.hh"
 
 
+/// Opcode dispatch for `Machine::ExecInstruction`.
+///
+/// By default the simulator decodes with a portable `switch` statement.
+/// When compiled with `-DTHREADED_DISPATCH` (add it to `DEFINES` in the
+/// Makefile of the build you want, e.g. `userprog` or `vmem`), dispatch
+/// instead goes through a table of label addresses and a single indirect
+/// jump per instruction ("threaded code").  This relies on the GCC/Clang
+/// computed-goto extension, so the `switch` version remains the default.
+#ifdef THREADED_DISPATCH
+#define OP_CASE(op)  l_ ## op
+#define OP_DEFAULT   l_default
+#define DISPATCH_BEGIN                                                     \
+    static const void * DISPATCH_TABLE[MAX_OPCODE + 1] = {                 \
+        &&l_default,                                                       \
+        &&l_OP_ADD,    &&l_OP_ADDI,  &&l_OP_ADDIU, &&l_OP_ADDU,            \
+        &&l_OP_AND,    &&l_OP_ANDI,  &&l_OP_BEQ,   &&l_OP_BGEZ,            \
+        &&l_OP_BGEZAL, &&l_OP_BGTZ,  &&l_OP_BLEZ,  &&l_OP_BLTZ,            \
+        &&l_OP_BLTZAL, &&l_OP_BNE,   &&l_default,  &&l_OP_DIV,             \
+        &&l_OP_DIVU,   &&l_OP_J,     &&l_OP_JAL,   &&l_OP_JALR,            \
+        &&l_OP_JR,     &&l_OP_LB,    &&l_OP_LBU,   &&l_OP_LH,              \
+        &&l_OP_LHU,    &&l_OP_LUI,   &&l_OP_LW,    &&l_OP_LWL,             \
+        &&l_OP_LWR,    &&l_default,  &&l_OP_MFHI,  &&l_OP_MFLO,            \
+        &&l_default,   &&l_OP_MTHI,  &&l_OP_MTLO,  &&l_OP_MULT,            \
+        &&l_OP_MULTU,  &&l_OP_NOR,   &&l_OP_OR,    &&l_OP_ORI,             \
+        &&l_default /* OP_RFE */,    &&l_OP_SB,    &&l_OP_SH,              \
+        &&l_OP_SLL,    &&l_OP_SLLV,  &&l_OP_SLT,   &&l_OP_SLTI,            \
+        &&l_OP_SLTIU,  &&l_OP_SLTU,  &&l_OP_SRA,   &&l_OP_SRAV,            \
+        &&l_OP_SRL,    &&l_OP_SRLV,  &&l_OP_SUB,   &&l_OP_SUBU,            \
+        &&l_OP_SW,     &&l_OP_SWL,   &&l_OP_SWR,   &&l_OP_XOR,             \
+        &&l_OP_XORI,   &&l_OP_SYSCALL, &&l_OP_UNIMP, &&l_OP_RES            \
+    };                                                                     \
+    do {                                                                   \
+        goto *DISPATCH_TABLE[instr->opCode];
+#define DISPATCH_END  } while (0);
+#else
+#define OP_CASE(op)  case op
+#define OP_DEFAULT   default
+#define DISPATCH_BEGIN  switch (instr->opCode) {
+#define DISPATCH_END  }
+#endif
+
+
+/// Upper bound on the number of instructions executed between two
+/// interrupt checks in `Machine::Run`, so a long run of straight-line code
+/// cannot postpone a pending interrupt for too long.
+static const unsigned MAX_SUPERSTEP = 16;
+
+/// Host time spent fetching, decoding and executing guest instructions
+/// (cf. `HostTimer`) -- the interpreter proper, as opposed to the
+/// `OneTick` bookkeeping that follows each burst.  A burst that traps
+/// (a fault or a system call) keeps accumulating while the handler
+/// runs, so kernel-side service shows up here too.
+static HostTimer execTimer("host.cpuExec");
+
+/// True if executing `opCode` may transfer control, ending a straight-line
+/// basic block.
+static inline bool
+IsBlockEnd(unsigned char opCode)
+{
+    switch (opCode) {
+        case OP_BEQ:
+        case OP_BGEZ:
+        case OP_BGEZAL:
+        case OP_BGTZ:
+        case OP_BLEZ:
+        case OP_BLTZ:
+        case OP_BLTZAL:
+        case OP_BNE:
+        case OP_J:
+        case OP_JAL:
+        case OP_JALR:
+        case OP_JR:
+        case OP_SYSCALL:
+        case OP_UNIMP:
+        case OP_RES:
+            return true;
+        default:
+            return false;
+    }
+}
+
 /// Simulate the execution of a user-level program on Nachos.
 ///
 /// Called by the kernel when the program starts up; never returns.
 ///
+/// Instructions are executed in straight-line bursts: a basic block runs
+/// as a unit and pending interrupts are checked once per block, with tick
+/// accounting batched by block length, instead of per instruction.  A
+/// block ends at any control transfer, at any exception, or after
+/// `MAX_SUPERSTEP` instructions.  When single stepping, blocks degenerate
+/// to one instruction so the stepper still sees every PC.
+///
+/// Breakpoints work like the address-compare registers of real hardware:
+/// between them the machine runs at full speed (batched blocks, one
+/// predicated comparison per instruction), and only a hit -- or an
+/// explicit step request -- drops into the single stepper.
+///
+/// Step ranges scope the stepper to `[lo, hi)` PC windows: every
+/// instruction inside one diverts to the stepper, while outside all of
+/// them execution stays at full speed behind a single compare against
+/// the cached hull of the ranges.  This is what makes tracing one small
+/// region of an hour-long run practical.
+///
+/// When neither a debugger nor a profiler was configured at startup,
+/// `Run` selects a copy of the loop compiled without any of these
+/// checks (see `RunLoop`), so production runs pay nothing for them.
+///
 /// This routine is re-entrant, in that it can be called multiple times
 /// concurrently -- one for each thread executing user code.
 void
@@ -33,12 +136,59 @@ Machine::Run()
         printf("Starting to run at time %u\n", stats->totalTicks);
     interrupt->SetStatus(USER_MODE);
 
+    // Release fast mode: breakpoints and step ranges can only appear
+    // through the debugger, so with no debugger and no profiler the loop
+    // instantiated without any hook checks is safe -- and production
+    // runs stop paying per instruction for features that are off.
+    if (singleStepper == nullptr && profiler == nullptr
+      && numBreakpoints == 0 && numStepRanges == 0)
+        RunLoop<false>(instr);
+    else
+        RunLoop<true>(instr);
+}
+
+template <bool HOOKED>
+void
+Machine::RunLoop(Instruction * instr)
+{
     for (;;) {
-        if (FetchInstruction(instr))
-            ExecInstruction(instr);
-        interrupt->OneTick();
-        if (singleStepper != nullptr && !singleStepper->Step())
-            singleStepper = nullptr;
+        unsigned executed = 0;
+        bool hit = false;
+        {
+            // One scope per burst, not per instruction, so the timer
+            // reads stay off the innermost loop.
+            HostTimerScope scope(execTimer);
+            do {
+                bool fetched = FetchInstruction(instr);
+                if (fetched)
+                    ExecInstruction(instr);
+                executed++;
+                if (!fetched)
+                    break;  // The exception handler already ran.
+                if (HOOKED) {
+                    if (numBreakpoints != 0
+                      && AtBreakpoint(registers[PC_REG])) {
+                        hit = true;  // Stop before the marked instruction
+                                     // runs.
+                        break;
+                    }
+                    if (InStepRange(registers[PC_REG])) {
+                        hit = true;  // Divert per instruction inside a
+                                     // range.
+                        break;
+                    }
+                }
+            } while ((!HOOKED || !stepping)
+              && !IsBlockEnd(instr->opCode)
+              && executed < MAX_SUPERSTEP);
+        }
+        interrupt->OneTick(executed);
+        if (HOOKED) {
+            if (profiler != nullptr)
+                profiler->Tick(executed, (unsigned) registers[PC_REG]);
+            if (singleStepper != nullptr && (stepping || hit))
+                stepping = singleStepper->Step();
+        }
     }
 }
 
@@ -61,11 +211,29 @@ Machine::FetchInstruction(Instruction * instr)
     ASSERT(instr != nullptr);
 
     int raw;
-    if (!ReadMem(registers[PC_REG], 4, &raw))
+    unsigned physAddr;
+    ExceptionType e = mmu.ReadInstruction(registers[PC_REG], &raw,
+        &physAddr);
+    if (e != NO_EXCEPTION) {
+        RaiseException(e, registers[PC_REG]);
         return false;  // Exception occurred.
+    }
 
-    instr->value = raw;
-    instr->Decode();
+    // Look up the decode cache by physical PC; on a hit the cracked fields
+    // are copied straight out and `Decode` is skipped.
+    DecodedInstruction * cached =
+      &decodeCache[physAddr / 4 % DECODE_CACHE_SIZE];
+    if (cached->physAddr == physAddr
+        && cached->generation == mmu.codeGeneration[physAddr / PAGE_SIZE]
+        && cached->instr.value == (unsigned) raw) {
+        *instr = cached->instr;
+    } else {
+        instr->value = raw;
+        instr->Decode();
+        cached->physAddr   = physAddr;
+        cached->generation = mmu.codeGeneration[physAddr / PAGE_SIZE];
+        cached->instr      = *instr;
+    }
 
     if (debug.IsEnabled('m')) {
         const struct OpString * str = &OP_STRINGS[instr->opCode];
@@ -177,8 +345,8 @@ Machine::ExecInstruction(const Instruction * instr)
     unsigned rs, rt, imm;
 
     // Execute the instruction (cf. Kane's book).
-    switch (instr->opCode) {
-        case OP_ADD:
+    DISPATCH_BEGIN
+        OP_CASE(OP_ADD):
             sum = registers[instr->rs] + registers[instr->rt];
             if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
               (registers[instr->rs] ^ sum) & SIGN_BIT)
@@ -189,7 +357,7 @@ Machine::ExecInstruction(const Instruction * instr)
             registers[instr->rd] = sum;
             break;
 
-        case OP_ADDI:
+        OP_CASE(OP_ADDI):
             sum = registers[instr->rs] + instr->extra;
             if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
               (instr->extra ^ sum) & SIGN_BIT)
@@ -200,60 +368,60 @@ Machine::ExecInstruction(const Instruction * instr)
             registers[instr->rt] = sum;
             break;
 
-        case OP_ADDIU:
+        OP_CASE(OP_ADDIU):
             registers[instr->rt] = registers[instr->rs] + instr->extra;
             break;
 
-        case OP_ADDU:
+        OP_CASE(OP_ADDU):
             registers[instr->rd] = registers[instr->rs]
               + registers[instr->rt];
             break;
 
-        case OP_AND:
+        OP_CASE(OP_AND):
             registers[instr->rd] = registers[instr->rs]
               & registers[instr->rt];
             break;
 
-        case OP_ANDI:
+        OP_CASE(OP_ANDI):
             registers[instr->rt] = registers[instr->rs]
               & (instr->extra & 0xFFFF);
             break;
 
-        case OP_BEQ:
+        OP_CASE(OP_BEQ):
             if (registers[instr->rs] == registers[instr->rt])
                 pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
             break;
 
-        case OP_BGEZAL:
+        OP_CASE(OP_BGEZAL):
             registers[RET_ADDR_REG] = registers[NEXT_PC_REG] + 4;
-        case OP_BGEZ:
+        OP_CASE(OP_BGEZ):
             if (!(registers[instr->rs] & SIGN_BIT))
                 pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
             break;
 
-        case OP_BGTZ:
+        OP_CASE(OP_BGTZ):
             if (registers[instr->rs] > 0)
                 pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
             break;
 
-        case OP_BLEZ:
+        OP_CASE(OP_BLEZ):
             if (registers[instr->rs] <= 0)
                 pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
             break;
 
-        case OP_BLTZAL:
+        OP_CASE(OP_BLTZAL):
             registers[RET_ADDR_REG] = registers[NEXT_PC_REG] + 4;
-        case OP_BLTZ:
+        OP_CASE(OP_BLTZ):
             if (registers[instr->rs] & SIGN_BIT)
                 pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
             break;
 
-        case OP_BNE:
+        OP_CASE(OP_BNE):
             if (registers[instr->rs] != registers[instr->rt])
                 pcAfter = registers[NEXT_PC_REG] + IndexToAddr(instr->extra);
             break;
 
-        case OP_DIV:
+        OP_CASE(OP_DIV):
             if (registers[instr->rt] == 0) {
                 registers[LO_REG] = 0;
                 registers[HI_REG] = 0;
@@ -265,7 +433,7 @@ Machine::ExecInstruction(const Instruction * instr)
             }
             break;
 
-        case OP_DIVU:
+        OP_CASE(OP_DIVU):
             rs = (unsigned) registers[instr->rs];
             rt = (unsigned) registers[instr->rt];
             if (rt == 0) {
@@ -279,20 +447,20 @@ Machine::ExecInstruction(const Instruction * instr)
             }
             break;
 
-        case OP_JAL:
+        OP_CASE(OP_JAL):
             registers[RET_ADDR_REG] = registers[NEXT_PC_REG] + 4;
-        case OP_J:
+        OP_CASE(OP_J):
             pcAfter = (pcAfter & 0xF0000000) | IndexToAddr(instr->extra);
             break;
 
-        case OP_JALR:
+        OP_CASE(OP_JALR):
             registers[instr->rd] = registers[NEXT_PC_REG] + 4;
-        case OP_JR:
+        OP_CASE(OP_JR):
             pcAfter = registers[instr->rs];
             break;
 
-        case OP_LB:
-        case OP_LBU:
+        OP_CASE(OP_LB):
+        OP_CASE(OP_LBU):
             tmp = registers[instr->rs] + instr->extra;
             if (!ReadMem(tmp, 1, &value))
                 return;
@@ -305,8 +473,8 @@ Machine::ExecInstruction(const Instruction * instr)
             nextLoadValue = value;
             break;
 
-        case OP_LH:
-        case OP_LHU:
+        OP_CASE(OP_LH):
+        OP_CASE(OP_LHU):
             tmp = registers[instr->rs] + instr->extra;
             if (tmp & 0x1) {
                 RaiseException(ADDRESS_ERROR_EXCEPTION, tmp);
@@ -323,12 +491,12 @@ Machine::ExecInstruction(const Instruction * instr)
             nextLoadValue = value;
             break;
 
-        case OP_LUI:
+        OP_CASE(OP_LUI):
             DEBUG('P', "Executing: LUI r%d,%d\n", instr->rt, instr->extra);
             registers[instr->rt] = instr->extra << 16;
             break;
 
-        case OP_LW:
+        OP_CASE(OP_LW):
             tmp = registers[instr->rs] + instr->extra;
             if (tmp & 0x3) {
                 RaiseException(ADDRESS_ERROR_EXCEPTION, tmp);
@@ -341,7 +509,7 @@ Machine::ExecInstruction(const Instruction * instr)
             nextLoadValue = value;
             break;
 
-        case OP_LWL:
+        OP_CASE(OP_LWL):
             tmp = registers[instr->rs] + instr->extra;
 
             // `ReadMem` assumes all 4 byte requests are aligned on an even
@@ -373,7 +541,7 @@ Machine::ExecInstruction(const Instruction * instr)
             nextLoadReg = instr->rt;
             break;
 
-        case OP_LWR:
+        OP_CASE(OP_LWR):
             tmp = registers[instr->rs] + instr->extra;
 
             // `ReadMem` assumes all 4 byte requests are aligned on an even
@@ -408,85 +576,85 @@ Machine::ExecInstruction(const Instruction * instr)
             nextLoadReg = instr->rt;
             break;
 
-        case OP_MFHI:
+        OP_CASE(OP_MFHI):
             registers[instr->rd] = registers[HI_REG];
             break;
 
-        case OP_MFLO:
+        OP_CASE(OP_MFLO):
             registers[instr->rd] = registers[LO_REG];
             break;
 
-        case OP_MTHI:
+        OP_CASE(OP_MTHI):
             registers[HI_REG] = registers[instr->rs];
             break;
 
-        case OP_MTLO:
+        OP_CASE(OP_MTLO):
             registers[LO_REG] = registers[instr->rs];
             break;
 
-        case OP_MULT:
+        OP_CASE(OP_MULT):
             Mult(registers[instr->rs], registers[instr->rt],
               true, &registers[HI_REG], &registers[LO_REG]);
             break;
 
-        case OP_MULTU:
+        OP_CASE(OP_MULTU):
             Mult(registers[instr->rs], registers[instr->rt],
               false, &registers[HI_REG], &registers[LO_REG]);
             break;
 
-        case OP_NOR:
+        OP_CASE(OP_NOR):
             registers[instr->rd] = ~(registers[instr->rs]
               | registers[instr->rt]);
             break;
 
-        case OP_OR:
+        OP_CASE(OP_OR):
             registers[instr->rd] = registers[instr->rs]
               | registers[instr->rt];
             break;
 
-        case OP_ORI:
+        OP_CASE(OP_ORI):
             registers[instr->rt] = registers[instr->rs]
               | (instr->extra & 0xFFFF);
             break;
 
-        case OP_SB:
+        OP_CASE(OP_SB):
             if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra),
               1, registers[instr->rt]))
                 return;
 
             break;
 
-        case OP_SH:
+        OP_CASE(OP_SH):
             if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra),
               2, registers[instr->rt]))
                 return;
 
             break;
 
-        case OP_SLL:
+        OP_CASE(OP_SLL):
             registers[instr->rd] = registers[instr->rt] << instr->extra;
             break;
 
-        case OP_SLLV:
+        OP_CASE(OP_SLLV):
             registers[instr->rd] = registers[instr->rt]
                 << (registers[instr->rs] & 0x1F);
             break;
 
-        case OP_SLT:
+        OP_CASE(OP_SLT):
             if (registers[instr->rs] < registers[instr->rt])
                 registers[instr->rd] = 1;
             else
                 registers[instr->rd] = 0;
             break;
 
-        case OP_SLTI:
+        OP_CASE(OP_SLTI):
             if (registers[instr->rs] < instr->extra)
                 registers[instr->rt] = 1;
             else
                 registers[instr->rt] = 0;
             break;
 
-        case OP_SLTIU:
+        OP_CASE(OP_SLTIU):
             rs  = registers[instr->rs];
             imm = instr->extra;
             if (rs < imm)
@@ -495,7 +663,7 @@ Machine::ExecInstruction(const Instruction * instr)
                 registers[instr->rt] = 0;
             break;
 
-        case OP_SLTU:
+        OP_CASE(OP_SLTU):
             rs = registers[instr->rs];
             rt = registers[instr->rt];
             if (rs < rt)
@@ -504,28 +672,28 @@ Machine::ExecInstruction(const Instruction * instr)
                 registers[instr->rd] = 0;
             break;
 
-        case OP_SRA:
+        OP_CASE(OP_SRA):
             registers[instr->rd] = registers[instr->rt] >> instr->extra;
             break;
 
-        case OP_SRAV:
+        OP_CASE(OP_SRAV):
             registers[instr->rd] = registers[instr->rt]
               >> (registers[instr->rs] & 0x1F);
             break;
 
-        case OP_SRL:
+        OP_CASE(OP_SRL):
             tmp   = registers[instr->rt];
             tmp >>= instr->extra;
             registers[instr->rd] = tmp;
             break;
 
-        case OP_SRLV:
+        OP_CASE(OP_SRLV):
             tmp   = registers[instr->rt];
             tmp >>= registers[instr->rs] & 0x1F;
             registers[instr->rd] = tmp;
             break;
 
-        case OP_SUB:
+        OP_CASE(OP_SUB):
             diff = registers[instr->rs] - registers[instr->rt];
             if ((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT &&
               (registers[instr->rs] ^ diff) & SIGN_BIT)
@@ -536,19 +704,19 @@ Machine::ExecInstruction(const Instruction * instr)
             registers[instr->rd] = diff;
             break;
 
-        case OP_SUBU:
+        OP_CASE(OP_SUBU):
             registers[instr->rd] = registers[instr->rs]
               - registers[instr->rt];
             break;
 
-        case OP_SW:
+        OP_CASE(OP_SW):
             if (!WriteMem((unsigned) (registers[instr->rs] + instr->extra),
               4, registers[instr->rt]))
                 return;
 
             break;
 
-        case OP_SWL:
+        OP_CASE(OP_SWL):
             tmp = registers[instr->rs] + instr->extra;
 
             // The little endian/big endian swap code would fail (I think) if
@@ -580,7 +748,7 @@ Machine::ExecInstruction(const Instruction * instr)
 
             break;
 
-        case OP_SWR:
+        OP_CASE(OP_SWR):
             tmp = registers[instr->rs] + instr->extra;
 
             // The little endian/big endian swap code would fail (I think) if
@@ -611,28 +779,28 @@ Machine::ExecInstruction(const Instruction * instr)
 
             break;
 
-        case OP_SYSCALL:
+        OP_CASE(OP_SYSCALL):
             RaiseException(SYSCALL_EXCEPTION, 0);
             return;
 
-        case OP_XOR:
+        OP_CASE(OP_XOR):
             registers[instr->rd] = registers[instr->rs]
               ^ registers[instr->rt];
             break;
 
-        case OP_XORI:
+        OP_CASE(OP_XORI):
             registers[instr->rt] = registers[instr->rs]
               ^ (instr->extra & 0xFFFF);
             break;
 
-        case OP_RES:
-        case OP_UNIMP:
+        OP_CASE(OP_RES):
+        OP_CASE(OP_UNIMP):
             RaiseException(ILLEGAL_INSTR_EXCEPTION, 0);
             return;
 
-        default:
+        OP_DEFAULT:
             ASSERT(false);
-    }
+    DISPATCH_END
 
     // Now we have successfully executed the instruction.
 
@@ -32,6 +32,8 @@
 #include "endianness.hh"
 #include "threads/system.hh"
 
+#include <string.h>
+
 MMU::MMU()
 {
     mainMemory = new char [MEMORY_SIZE];
@@ -41,6 +43,13 @@ MMU::MMU()
     tlb = new TranslationEntry[TLB_SIZE];
     Clear_TLB();
     pageTable = nullptr;
+
+    for (unsigned i = 0; i < NUM_PHYS_PAGES; i++)
+        codeGeneration[i] = 0;
+
+    lastReadEntry  = TLB_SIZE;
+    lastWriteEntry = TLB_SIZE;
+    asid = 0;
 }
 
 MMU::~MMU()
@@ -56,7 +65,11 @@ MMU::Clear_TLB()
     for (unsigned i = 0; i < TLB_SIZE; i++) {
         tlb[i].valid       = false;
         tlb[i].virtualPage = 2000;
+        tlbStamp[i]        = 0;
     }
+    tlbClock       = 0;
+    lastReadEntry  = TLB_SIZE;
+    lastWriteEntry = TLB_SIZE;
 }
 
 void
@@ -73,13 +86,38 @@ MMU::Set_TLB(const TranslationEntry * pageT, unsigned numPages)
 void
 MMU::Get_TLB(TranslationEntry * pageT, unsigned numPages)
 {
+    // Only entries tagged with the current identifier belong to the
+    // caller's page table; entries from other spaces are left alone.
     for (unsigned i = 0; i < TLB_SIZE; i++) {
-        if (tlb[i].valid) {
+        if (tlb[i].valid && tlb[i].asid == asid) {
             pageT[tlb[i].virtualPage] = tlb[i];
         }
     }
 }
 
+void
+MMU::SetAsid(unsigned newAsid)
+{
+    asid = newAsid;
+    // The micro-cached entries may belong to the previous space.
+    lastReadEntry  = TLB_SIZE;
+    lastWriteEntry = TLB_SIZE;
+}
+
+unsigned
+MMU::PickLruEntry()
+{
+    unsigned victim = 0;
+
+    for (unsigned i = 0; i < TLB_SIZE; i++) {
+        if (!tlb[i].valid)
+            return i;
+        if (tlbStamp[i] < tlbStamp[victim])
+            victim = i;
+    }
+    return victim;
+}
+
 /// Read `size` (1, 2, or 4) bytes of virtual memory at `addr` into
 /// the location pointed to by `value`.
 ///
@@ -165,11 +203,90 @@ MMU::WriteMem(unsigned addr, unsigned size, int value)
             ASSERT(false);
     }
 
+    InvalidateCodePage(physicalAddress / PAGE_SIZE);
+    return NO_EXCEPTION;
+}
+
+/// Read `size` bytes of virtual memory at `addr` into `buffer`.
+///
+/// The range must lie within a single page, so one translation covers the
+/// whole copy.
+///
+/// * `addr` is the virtual address to read from.
+/// * `size` is the number of bytes to read.
+/// * `buffer` is the place to write the result.
+ExceptionType
+MMU::ReadMemBlock(unsigned addr, unsigned size, char * buffer)
+{
+    ASSERT(buffer != nullptr);
+    ASSERT(size > 0);
+    ASSERT(addr % PAGE_SIZE + size <= PAGE_SIZE);
+
+    DEBUG('z', "Reading block at VA 0x%X, size %u\n", addr, size);
+
+    unsigned physicalAddress;
+    ExceptionType e = Translate(addr, &physicalAddress, 1, false);
+    if (e != NO_EXCEPTION)
+        return e;
+
+    memcpy(buffer, &mainMemory[physicalAddress], size);
+    return NO_EXCEPTION;
+}
+
+/// Write `size` bytes from `buffer` into virtual memory at `addr`.
+///
+/// The range must lie within a single page, so one translation covers the
+/// whole copy.
+///
+/// * `addr` is the virtual address to write to.
+/// * `size` is the number of bytes to be written.
+/// * `buffer` holds the data to be written.
+ExceptionType
+MMU::WriteMemBlock(unsigned addr, unsigned size, const char * buffer)
+{
+    ASSERT(buffer != nullptr);
+    ASSERT(size > 0);
+    ASSERT(addr % PAGE_SIZE + size <= PAGE_SIZE);
+
+    DEBUG('z', "Writing block at VA 0x%X, size %u\n", addr, size);
+
+    unsigned physicalAddress;
+    ExceptionType e = Translate(addr, &physicalAddress, 1, true);
+    if (e != NO_EXCEPTION)
+        return e;
+
+    memcpy(&mainMemory[physicalAddress], buffer, size);
+    InvalidateCodePage(physicalAddress / PAGE_SIZE);
     return NO_EXCEPTION;
 }
 
+/// Fetch the instruction word at virtual address `addr`.
+///
+/// Besides the word itself, the physical address is stored in `*physAddr`,
+/// so the caller can index its decode cache by physical PC.
 ExceptionType
-MMU::RetrievePageEntry(unsigned vpn, TranslationEntry ** entry) const
+MMU::ReadInstruction(unsigned addr, int * value, unsigned * physAddr)
+{
+    ASSERT(value != nullptr);
+    ASSERT(physAddr != nullptr);
+
+    ExceptionType e = Translate(addr, physAddr, 4, false);
+    if (e != NO_EXCEPTION)
+        return e;
+
+    *value = WordToHost(*(unsigned *) &mainMemory[*physAddr]);
+    return NO_EXCEPTION;
+}
+
+void
+MMU::InvalidateCodePage(unsigned physPage)
+{
+    ASSERT(physPage < NUM_PHYS_PAGES);
+    codeGeneration[physPage]++;
+}
+
+ExceptionType
+MMU::RetrievePageEntry(unsigned vpn, TranslationEntry ** entry)
 {
     ASSERT(entry != nullptr);
     DEBUG('z', "Buscando entrada %u\n", vpn);
@@ -196,13 +313,15 @@ MMU::RetrievePageEntry(unsigned vpn, TranslationEntry ** entry) const
         stats->numPageSearchs++;
         unsigned i;
         for (i = 0; i < TLB_SIZE; i++)
-            if (tlb[i].valid && tlb[i].virtualPage == vpn) {
-                *entry = &tlb[i]; // FOUND!
+            if (tlb[i].valid && tlb[i].asid == asid
+              && tlb[i].virtualPage == vpn) {
+                *entry      = &tlb[i]; // FOUND!
+                tlbStamp[i] = ++tlbClock;
                 stats->numsPageHits++;
-                coremap->access(tlb[i].physicalPage);
                 return NO_EXCEPTION;
             }
         // Not found.
+        stats->numTlbMisses++;
         stats->numPageFaults++;
         DEBUG_CONT('z', "no valid TLB entry found for this virtual page!\n");
         return PAGE_FAULT_EXCEPTION; // Really, this is a TLB fault, the
@@ -233,7 +352,12 @@ MMU::Get_Entry(unsigned index)
 void
 MMU::Set_Entry(TranslationEntry pageT, unsigned index)
 {
-    tlb[index] = pageT;
+    // The entry keeps the identifier its owner stamped on it, so kernel
+    // code can rewrite entries of spaces other than the running one.
+    tlb[index]       = pageT;
+    tlbStamp[index]  = ++tlbClock; // Freshly installed: most recent.
+    lastReadEntry  = TLB_SIZE;
+    lastWriteEntry = TLB_SIZE;
 }
 
 ExceptionType
@@ -260,10 +384,34 @@ MMU::Translate(unsigned virtAddr, unsigned * physAddr,
 
     DEBUG('z', "virtAddr:%u vpn:%u offset:%u\n", virtAddr, vpn, offset);
 
-    TranslationEntry * entry;
-    ExceptionType exception = RetrievePageEntry(vpn, &entry);
-    if (exception != NO_EXCEPTION)
-        return exception;
+    TranslationEntry * entry = nullptr;
+
+    // Fast path: check the TLB entry used by the last access of this kind
+    // before doing a full scan.  Sequential copies hit the same page over
+    // and over, so this usually resolves the translation right away.
+    if (tlb != nullptr) {
+        unsigned cached = writing ? lastWriteEntry : lastReadEntry;
+        if (cached < TLB_SIZE && tlb[cached].valid
+          && tlb[cached].asid == asid
+          && tlb[cached].virtualPage == vpn) {
+            entry = &tlb[cached];
+            tlbStamp[cached] = ++tlbClock;
+            stats->numPageSearchs++;
+            stats->numsPageHits++;
+        }
+    }
+
+    if (entry == nullptr) {
+        ExceptionType exception = RetrievePageEntry(vpn, &entry);
+        if (exception != NO_EXCEPTION)
+            return exception;
+        if (tlb != nullptr) {
+            if (writing)
+                lastWriteEntry = entry - tlb;
+            else
+                lastReadEntry = entry - tlb;
+        }
+    }
 
     if (entry->readOnly && writing) { // Trying to write to a read-only
                                       // page.
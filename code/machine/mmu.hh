@@ -16,9 +16,15 @@
 
 /// Definitions related to the size, and format of user memory.
 
-const unsigned PAGE_SIZE = SECTOR_SIZE; ///< Set the page size equal to the
-///< disk sector size, for
-///< simplicity.
+/// Number of bytes per virtual memory page.  Historically tied to the
+/// disk sector size; now configurable on its own (add e.g.
+/// `-DPAGE_SIZE_BYTES=1024` to `DEFINES`), since all paging I/O goes
+/// through `OpenFile`, which handles transfers that span sectors or
+/// cover only part of one.
+#ifndef PAGE_SIZE_BYTES
+#define PAGE_SIZE_BYTES 128
+#endif
+const unsigned PAGE_SIZE = PAGE_SIZE_BYTES;
 const unsigned NUM_PHYS_PAGES = 64;
 const unsigned MEMORY_SIZE    = NUM_PHYS_PAGES * PAGE_SIZE;
 const unsigned TLB_SIZE       = 8; ///< if there is a TLB, make it small.
@@ -43,6 +49,30 @@ public:
     ExceptionType
     WriteMem(unsigned addr, unsigned size, int value);
 
+    /// Read or write a block of `size` bytes of virtual memory starting at
+    /// `addr`.  The block must not cross a page boundary: the address is
+    /// translated once and the bytes are copied with `memcpy`, so callers
+    /// can move data page-at-a-time instead of byte-at-a-time.
+
+    ExceptionType
+    ReadMemBlock(unsigned addr, unsigned size, char * buffer);
+
+    ExceptionType
+    WriteMemBlock(unsigned addr, unsigned size, const char * buffer);
+
+    /// Read one instruction word at virtual address `addr` and also return
+    /// its physical address, so the CPU simulation can maintain a decode
+    /// cache indexed by physical PC.
+    ExceptionType
+    ReadInstruction(unsigned addr, int * value, unsigned * physAddr);
+
+    /// Bump the write generation of a physical frame, invalidating any
+    /// decoded instructions cached for it.  Called on every store through
+    /// `WriteMem`; kernel code that writes `mainMemory` directly (e.g. when
+    /// loading or swapping pages) should call it too.
+    void
+    InvalidateCodePage(unsigned physPage);
+
     /// Data structures -- all of these are accessible to Nachos kernel code.
     /// “Public” for convenience.
     ///
@@ -86,15 +116,48 @@ public:
     void
     Set_Entry(TranslationEntry pageT, unsigned index);
 
+    /// Tell the MMU which address space is running.  Only TLB entries
+    /// tagged with the current identifier match in translation, so a
+    /// context switch changes the tag instead of flushing the TLB and
+    /// paying a refill burst afterwards.
+    void
+    SetAsid(unsigned newAsid);
+
+    /// Pick the TLB entry the miss handler should replace: a free entry
+    /// if there is one, otherwise the least recently used.
+    unsigned
+    PickLruEntry();
+
     TranslationEntry * pageTable;
     unsigned pageTableSize;
 
+    /// Per-frame write generation counters backing the decode cache in
+    /// `Machine`; a cached decode is stale once its frame's counter moves.
+    unsigned codeGeneration[NUM_PHYS_PAGES];
+
 private:
 
+    /// Index into `tlb` of the entry used by the last read and the last
+    /// write, or `TLB_SIZE` when unknown.  Sequential accesses hit the
+    /// same page thousands of times in a row, so checking this first
+    /// turns the common case into a mask-and-compare instead of a TLB
+    /// scan.  Reset by `Clear_TLB` and `Set_Entry`.
+    unsigned lastReadEntry;
+    unsigned lastWriteEntry;
+
+    /// Identifier of the running address space; TLB entries with another
+    /// tag do not match.
+    unsigned asid;
+
+    /// Logical clock of TLB accesses and per-entry timestamp of the last
+    /// access, so `PickLruEntry` can order victims by recency.
+    unsigned tlbClock;
+    unsigned tlbStamp[TLB_SIZE];
+
     /// Retrieve a page entry either from a page table or the TLB.
     ExceptionType
     RetrievePageEntry(unsigned vpn,
-      TranslationEntry **      entry) const;
+      TranslationEntry **      entry);
 
     /// Translate an address, and check for alignment.
     ///
@@ -1,5 +1,8 @@
-/// Routines to simulate a network interface, using UNIX sockets to deliver
-/// packets between multiple invocations of nachos.
+/// Routines to simulate a network interface, using a shared-memory file
+/// to deliver packets between multiple invocations of nachos.  Each node
+/// owns one incoming packet ring in the file (cf. `ShmNetAttach`), so a
+/// send is a `memcpy` into the destination's ring instead of a trip
+/// through the host's socket layer, and N nodes scale with host cores.
 ///
 /// DO NOT CHANGE -- part of the machine emulation
 ///
@@ -12,6 +15,10 @@
 #include "threads/system.hh"
 
 
+/// The device MTU (cf. `network.hh`); `-mtu` overrides it at startup,
+/// before the `Network` object exists.
+unsigned WIRE_SIZE = 64;
+
 /// Dummy functions because C++ cannot call member functions indirectly.
 
 static void
@@ -57,10 +64,13 @@ Network::Network(NetworkAddress addr, double reliability,
     sendBusy     = false;
     inHdr.length = 0;
 
-    sock = OpenSocket();
-    snprintf(sockName, sizeof sockName, "SOCKET_%u", (unsigned) addr);
-    AssignNameToSocket(sockName, sock); // Bind socket to a filename in the
-    // current directory.
+    ShmNetAttach(addr); // Map the shared packet rings (file in the
+    // current directory).
+
+    // A host thread watches our ring and raises `packetReady` the moment
+    // a packet lands, so polling below is just a memory read.
+    packetReady = false;
+    ShmNetWatch(addr, &packetReady);
 
     // Start polling for incoming packets.
     interrupt->Schedule(NetworkReadPoll, this,
@@ -69,8 +79,8 @@ Network::Network(NetworkAddress addr, double reliability,
 
 Network::~Network()
 {
-    CloseSocket(sock);
-    DeAssignNameToSocket(sockName);
+    ShmNetUnwatch();
+    ShmNetDetach();
 }
 
 /// If a packet is already buffered, we simply delay reading the incoming
@@ -86,16 +96,36 @@ Network::CheckPktAvail()
     if (inHdr.length != 0) // Do nothing if packet is already buffered.
         return;
 
-    if (!PollSocket(sock)) // Do nothing if no packet to be read.
+    if (!packetReady && interrupt->IsIdlePolling())
+        // Nothing has landed yet and nothing but outside input can make
+        // progress: wait here for an arrival (up to the old 20 ms
+        // polling delay) so a packet is picked up the moment it lands
+        // and the host core is released meanwhile; a busy machine -- or
+        // one with a simulated event still due -- just goes on.
+        WaitForFlag(&packetReady, 20000);
+
+    // Funnel the arrival through record/replay: on a replayed run the
+    // log, not the host socket, decides whether a packet arrives at
+    // this poll, so delivery ticks are reproduced exactly.
+    if (!ReplayableValue('n', packetReady))
         return;
+    if (!packetReady)
+        // The log says a packet arrived at this poll; on the host it is
+        // still in flight (the replaying peer runs at its own pace), so
+        // wait for it without advancing simulated time.
+        WaitForFlag(&packetReady, 1000000);
+    packetReady = false; // The watcher re-raises it if more are queued.
 
     // Otherwise, read packet in.
-    char * buffer = new char [MAX_WIRE_SIZE];
-    ReadFromSocket(sock, buffer, MAX_WIRE_SIZE);
+    char * buffer = new char [WIRE_SIZE];
+    bool   got    = ShmNetRecv(ident, buffer, WIRE_SIZE);
+    ASSERT(got); // The watcher only raises the flag once a packet is
+                 // fully published in the ring.
 
-    // Divide packet into header and data.
+    // Divide packet into header and data.  A length over the MTU means
+    // the peer was started with a different `-mtu`.
     inHdr = *(PacketHeader *) buffer;
-    ASSERT(inHdr.to == ident && inHdr.length <= MAX_PACKET_SIZE);
+    ASSERT(inHdr.to == ident && inHdr.length <= PacketSize());
     memcpy(inbox, buffer + sizeof(PacketHeader), inHdr.length);
     delete [] buffer;
 
@@ -119,19 +149,15 @@ Network::SendDone()
 /// Send a packet by concatenating hdr and data, and schedule an interrupt to
 /// tell the user when the next packet can be sent.
 ///
-/// Note we always pad out a packet to `MAX_WIRE_SIZE` before putting it into
+/// Note we always pad out a packet to `WIRE_SIZE` before putting it into
 /// the socket, because it is simpler at the receive end.
 void
 Network::Send(PacketHeader hdr, const char * data)
 {
     ASSERT(data != nullptr);
 
-    char toName[32];
-
-    snprintf(toName, sizeof toName, "SOCKET_%u", (unsigned) hdr.to);
-
     ASSERT(!sendBusy && hdr.length > 0 &&
-      hdr.length <= MAX_PACKET_SIZE && hdr.from == ident);
+      hdr.length <= PacketSize() && hdr.from == ident);
     DEBUG('N', "Sending to addr %u, %u bytes... ", hdr.to, hdr.length);
 
     interrupt->Schedule(NetworkSendDone, this,
@@ -143,10 +169,10 @@ Network::Send(PacketHeader hdr, const char * data)
     }
 
     // Concatenate `hdr` and `data` into a single buffer, and send it out.
-    char * buffer = new char [MAX_WIRE_SIZE];
+    char * buffer = new char [WIRE_SIZE];
     *(PacketHeader *) buffer = hdr;
     memcpy(buffer + sizeof(PacketHeader), data, hdr.length);
-    SendToSocket(sock, buffer, MAX_WIRE_SIZE, toName);
+    ShmNetSend(hdr.to, buffer, WIRE_SIZE);
     delete [] buffer;
 }
 
@@ -41,12 +41,30 @@ public:
     ///< by the post office).
 };
 
-/// Largest packet that can go out on the wire.
-const unsigned MAX_WIRE_SIZE = 64;
+/// Hard ceiling on the wire size: buffers and the shared-memory ring
+/// slots are laid out for this, so the runtime MTU can be anything up
+/// to it.
+const unsigned MAX_WIRE_SIZE = 512;
 
-/// Data “payload” of the largest packet.
+/// Data “payload” of the largest possible packet; sizes the receive
+/// buffers.
 const unsigned MAX_PACKET_SIZE = MAX_WIRE_SIZE - sizeof(PacketHeader);
 
+/// Wire size in use for this run -- the device MTU.  Set once at
+/// startup (flag `-mtu`, default 64, the classic wire size); every
+/// co-operating node must be started with the same value, since packets
+/// are padded to the full wire size on the sender.  Jumbo packets carry
+/// more payload per send, so a bulk transfer pays fewer per-packet
+/// costs (interrupts, delivery wakeups, acks).
+extern unsigned WIRE_SIZE;
+
+/// Data payload of the largest packet at the current MTU.
+inline unsigned
+PacketSize()
+{
+    return WIRE_SIZE - sizeof(PacketHeader);
+}
+
 
 /// The following class defines a physical network device.
 ///
@@ -104,11 +122,10 @@ private:
     /// Likelihood packet will be dropped.
     double chanceToWork;
 
-    /// UNIX socket number for incoming packets.
-    int sock;
-
-    /// File name corresponding to UNIX socket.
-    char sockName[32];
+    /// Raised by the host watcher thread the moment a packet lands on
+    /// our shared-memory ring, so polling is a memory read instead of a
+    /// system call.
+    volatile bool packetReady;
 
     /// Interrupt handler, signalling next packet can be sent.
     VoidFunctionPtr writeHandler;
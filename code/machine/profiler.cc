@@ -0,0 +1,95 @@
+/// Routines for the PC-sampling profiler.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+
+#include "profiler.hh"
+#include "lib/utility.hh"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+Profiler::Profiler(unsigned everyTicks)
+{
+    ASSERT(everyTicks > 0);
+
+    interval  = everyTicks;
+    countdown = everyTicks;
+    used      = 0;
+    taken     = 0;
+    dropped   = 0;
+    for (unsigned i = 0; i < TABLE_SIZE; i++)
+        table[i].count = 0;
+}
+
+Profiler::~Profiler()
+{
+    Dump();
+}
+
+/// Bump the bucket for `pc`.
+///
+/// Open addressing with a multiplicative hash of the word-aligned PC;
+/// collisions just probe forward.  If the table somehow fills up, the
+/// sample is counted as dropped rather than evicting a hot bucket.
+void
+Profiler::Record(unsigned pc)
+{
+    unsigned h = (pc >> 2) * 2654435761u & (TABLE_SIZE - 1);
+
+    taken++;
+    for (unsigned i = 0; i < TABLE_SIZE; i++) {
+        PcSample * s = &table[(h + i) & (TABLE_SIZE - 1)];
+        if (s->count == 0) {
+            s->pc    = pc;
+            s->count = 1;
+            used++;
+            return;
+        }
+        if (s->pc == pc) {
+            s->count++;
+            return;
+        }
+    }
+    dropped++;
+}
+
+/// Address is the tie-breaker so the output is stable across runs.
+int
+Profiler::CompareSamples(const void * a, const void * b)
+{
+    const PcSample * sa = (const PcSample *) a;
+    const PcSample * sb = (const PcSample *) b;
+
+    if (sa->count != sb->count)
+        return sa->count < sb->count ? 1 : -1;
+    return sa->pc < sb->pc ? -1 : sa->pc > sb->pc;
+}
+
+void
+Profiler::Dump()
+{
+    if (taken == 0)
+        return;
+
+    // Compact the occupied buckets so `qsort` sees a dense array.
+    PcSample * hot = new PcSample [used];
+    unsigned n     = 0;
+
+    for (unsigned i = 0; i < TABLE_SIZE; i++)
+        if (table[i].count != 0)
+            hot[n++] = table[i];
+    ASSERT(n == used);
+
+    qsort(hot, n, sizeof (PcSample), CompareSamples);
+
+    printf("profile: interval=%u samples=%lu dropped=%lu pcs=%u\n",
+      interval, taken, dropped, used);
+    for (unsigned i = 0; i < n; i++)
+        printf("profile: pc=0x%08X count=%lu\n", hot[i].pc, hot[i].count);
+
+    delete [] hot;
+}
@@ -0,0 +1,75 @@
+/// A sampling profiler for user programs.
+///
+/// Every `everyTicks` user ticks the machine hands the current PC to
+/// `Tick`, which bumps its slot in a fixed-size hash table.  At exit
+/// the table comes out as a flat `pc count` profile, sorted by count,
+/// that can be symbolized against the binary with `bin/disasm`.
+///
+/// Sampling instead of tracing keeps the overhead to one countdown per
+/// instruction burst, so profiled runs time roughly like normal runs.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_MACHINE_PROFILER__HH
+#define NACHOS_MACHINE_PROFILER__HH
+
+
+class Profiler {
+public:
+
+    /// Record one sample every `everyTicks` user ticks.
+    Profiler(unsigned everyTicks);
+
+    /// Dumps the profile.
+    ~Profiler();
+
+    /// Called by the machine after a burst of `count` user instructions
+    /// retires with the program counter at `pc`.  The common case is a
+    /// countdown and a compare; `Record` runs once per interval.
+    void
+    Tick(unsigned count, unsigned pc)
+    {
+        if (countdown > count) {
+            countdown -= count;
+            return;
+        }
+        Record(pc);
+        countdown = interval;
+    }
+
+    /// Print the PC→count table, hottest first.
+    void
+    Dump();
+
+private:
+
+    void
+    Record(unsigned pc);
+
+    /// Comparison callback for sorting the dump, hottest PC first.
+    static int
+    CompareSamples(const void * a, const void * b);
+
+    /// Slots in the histogram; a power of two, and plenty for the
+    /// distinct sampled PCs of a Nachos-sized binary.
+    static const unsigned TABLE_SIZE = 16384;
+
+    /// One histogram bucket; a zero count marks an empty slot (the PC
+    /// alone cannot, since user text may start at address 0).
+    struct PcSample {
+        unsigned pc;
+        unsigned long count;
+    };
+
+    PcSample table[TABLE_SIZE];
+    unsigned interval;       ///< Ticks between samples.
+    unsigned countdown;      ///< Ticks until the next sample.
+    unsigned used;           ///< Occupied slots.
+    unsigned long taken;     ///< Samples recorded.
+    unsigned long dropped;   ///< Samples lost to a full table.
+};
+
+
+#endif /* ifndef NACHOS_MACHINE_PROFILER__HH */
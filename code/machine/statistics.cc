@@ -12,6 +12,51 @@
 #include "lib/utility.hh"
 
 
+/// Head of the counter registry.  Zero-initialized before any
+/// constructor runs, so counters defined at file scope in other modules
+/// can link themselves in safely.
+static Counter * counterList = nullptr;
+
+Counter::Counter(const char * counterName)
+{
+    ASSERT(counterName != nullptr);
+
+    name  = counterName;
+    value = 0;
+    next  = counterList;
+    counterList = this;
+}
+
+Counter *
+Counter::GetFirst()
+{
+    return counterList;
+}
+
+/// Head of the host-timer registry; zero-initialized for the same
+/// reason as `counterList`.
+static HostTimer * hostTimerList = nullptr;
+
+/// Off unless `-hprof` was given.
+bool hostProfile = false;
+
+HostTimer::HostTimer(const char * timerName)
+{
+    ASSERT(timerName != nullptr);
+
+    name    = timerName;
+    totalNs = 0;
+    entries = 0;
+    next    = hostTimerList;
+    hostTimerList = this;
+}
+
+HostTimer *
+HostTimer::GetFirst()
+{
+    return hostTimerList;
+}
+
 /// Initialize performance metrics to zero, at system startup.
 Statistics::Statistics()
 {
@@ -20,15 +65,57 @@ Statistics::Statistics()
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPacketsSent      = numPacketsRecvd = 0;
     numPageFaults       = numPageSearchs = numsPageHits = 0;
+    numTlbMisses        = 0;
     #ifdef DFS_TICKS_FIX
     tickResets = 0;
     #endif
+    snapshotEvery     = 0;
+    nextSnapshotTicks = 0;
+    snapshotFile      = nullptr;
 }
 
-/// Print performance metrics, when we have finished everything at system
-/// shutdown.
 void
-Statistics::Print()
+Statistics::EnableSnapshots(unsigned everyTicks, const char * fileName)
+{
+    ASSERT(everyTicks > 0);
+    ASSERT(fileName != nullptr);
+
+    snapshotFile = fopen(fileName, "w");
+    ASSERT(snapshotFile != nullptr);
+    snapshotEvery     = everyTicks;
+    nextSnapshotTicks = totalTicks + everyTicks;
+}
+
+/// Write one snapshot line if one is due.
+///
+/// Each line carries the cumulative core statistics and every
+/// registered counter as `key=value` fields; differencing consecutive
+/// lines gives the per-interval rates.
+void
+Statistics::Snapshot()
+{
+    if (snapshotFile == nullptr || totalTicks < nextSnapshotTicks)
+        return;
+
+    nextSnapshotTicks = totalTicks + snapshotEvery;
+    fprintf(snapshotFile,
+      "ticks=%u idle=%u system=%u user=%u"
+      " diskReads=%u diskWrites=%u pktsSent=%u pktsRecvd=%u"
+      " tlbSearches=%u tlbHits=%u tlbMisses=%u pageFaults=%u",
+      totalTicks, idleTicks, systemTicks, userTicks,
+      numDiskReads, numDiskWrites, numPacketsSent, numPacketsRecvd,
+      numPageSearchs, numsPageHits, numTlbMisses, numPageFaults);
+    for (Counter * c = Counter::GetFirst(); c != nullptr; c = c->GetNext())
+        fprintf(snapshotFile, " %s=%lu", c->GetName(), c->Value());
+    fprintf(snapshotFile, "\n");
+    fflush(snapshotFile); // So a crashed run still has its snapshots.
+}
+
+/// Print the metrics gathered so far.  Safe to call mid-run (cf. the
+/// debugger's `stats` command): it only reads, so the run goes on
+/// undisturbed afterwards.
+void
+Statistics::Report()
 {
     #ifdef DFS_TICKS_FIX
     if (tickResets != 0)
@@ -42,7 +129,45 @@ Statistics::Print()
       numConsoleCharsRead, numConsoleCharsWritten);
     printf("Network I/O: packets received %u, sent %u\n",
       numPacketsRecvd, numPacketsSent);
-    printf("Paging: searchs %u, hits %u, faults %u\n", numPageSearchs,
-      numsPageHits, numPageFaults);
+    printf("Paging: searchs %u, hits %u, TLB misses %u, faults %u\n",
+      numPageSearchs, numsPageHits, numTlbMisses, numPageFaults);
     printf("Hit Ratio: %.2f\n", (float) numsPageHits / (float) numPageSearchs);
+    if (Counter::GetFirst() != nullptr) {
+        printf("Counters:");
+        for (Counter * c = Counter::GetFirst();
+          c != nullptr; c = c->GetNext())
+            printf(" %s %lu%s", c->GetName(), c->Value(),
+              c->GetNext() != nullptr ? "," : "");
+        printf("\n");
+    }
+    if (hostProfile) {
+        // Where the nachos *process* spent its real time; timers that
+        // never ran (devices that were off) are left out.  Scopes can
+        // nest, so the milliseconds are views, not a partition.
+        printf("Host time (ms/scopes):");
+        bool first = true;
+        for (HostTimer * t = HostTimer::GetFirst();
+          t != nullptr; t = t->GetNext()) {
+            if (t->Entries() == 0)
+                continue;
+            printf("%s %s %.1f/%lu", first ? "" : ",",
+              t->GetName(), t->TotalNs() / 1.0e6, t->Entries());
+            first = false;
+        }
+        printf("\n");
+    }
+}
+
+/// Print performance metrics, when we have finished everything at system
+/// shutdown.
+void
+Statistics::Print()
+{
+    Report();
+    if (snapshotFile != nullptr) {
+        nextSnapshotTicks = 0; // Force one last line with the final totals.
+        Snapshot();
+        fclose(snapshotFile);
+        snapshotFile = nullptr;
+    }
 }
@@ -11,6 +11,170 @@
 #define NACHOS_MACHINE_STATS__HH
 
 
+#include <stdio.h>
+#include <time.h>
+
+
+/// A cheap named counter owned by a subsystem.
+///
+/// Define one (usually at file scope, next to the code it measures) and
+/// bump it inline; construction registers it in a global list, so the
+/// periodic snapshots and the final report can enumerate every counter
+/// without the statistics module knowing about each subsystem.
+class Counter {
+public:
+
+    /// `counterName` is not copied; pass a literal or otherwise
+    /// permanent string.
+    Counter(const char * counterName);
+
+    void
+    Inc()
+    {
+        value++;
+    }
+
+    void
+    Add(unsigned n)
+    {
+        value += n;
+    }
+
+    unsigned long
+    Value() const
+    {
+        return value;
+    }
+
+    const char *
+    GetName() const
+    {
+        return name;
+    }
+
+    Counter *
+    GetNext() const
+    {
+        return next;
+    }
+
+    /// First registered counter, for iterating the registry.
+    static Counter *
+    GetFirst();
+
+private:
+
+    const char * name;
+    unsigned long value;
+    Counter * next;
+};
+
+
+/// A named accumulator of *host* time, for profiling the simulator
+/// itself: the tick statistics say where the guest spends simulated
+/// time, these say where the nachos process spends real time (the
+/// interpreter loop, interrupt dispatch, each device handler, blocking
+/// host calls).  Like `Counter`, construction registers the timer in a
+/// global list, so the final report can enumerate them all.
+///
+/// Timers are charged through `HostTimerScope` and only when `-hprof`
+/// was given, so an unprofiled run pays one predictable branch per
+/// scope.
+class HostTimer {
+public:
+
+    /// `timerName` is not copied; pass a literal or otherwise
+    /// permanent string.
+    HostTimer(const char * timerName);
+
+    void
+    Add(unsigned long ns)
+    {
+        totalNs += ns;
+        entries++;
+    }
+
+    unsigned long
+    TotalNs() const
+    {
+        return totalNs;
+    }
+
+    unsigned long
+    Entries() const
+    {
+        return entries;
+    }
+
+    const char *
+    GetName() const
+    {
+        return name;
+    }
+
+    HostTimer *
+    GetNext() const
+    {
+        return next;
+    }
+
+    /// First registered timer, for iterating the registry.
+    static HostTimer *
+    GetFirst();
+
+private:
+
+    const char * name;
+    unsigned long totalNs; ///< Accumulated host time, in nanoseconds.
+    unsigned long entries; ///< Scopes charged to this timer.
+    HostTimer * next;
+};
+
+/// Is host-time self-profiling on?  Set once at startup by the `-hprof`
+/// flag, before any scope runs.
+extern bool hostProfile;
+
+/// Read the host monotonic clock, in nanoseconds.  Simulated time never
+/// enters here: this is the wall clock of the machine running nachos.
+inline unsigned long
+HostClockNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long) ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/// Charge the host time spent in a lexical scope to a `HostTimer`:
+/// construction reads the clock, destruction adds the elapsed time.
+///
+/// Scopes may nest (a device handler runs inside interrupt dispatch);
+/// the nested time is then counted in both timers, so the report is a
+/// set of overlapping views of the run, not a partition of it.
+class HostTimerScope {
+public:
+
+    HostTimerScope(HostTimer & t)
+      : timer(t), running(hostProfile)
+    {
+        if (running)
+            startNs = HostClockNs();
+    }
+
+    ~HostTimerScope()
+    {
+        if (running)
+            timer.Add(HostClockNs() - startNs);
+    }
+
+private:
+
+    HostTimer & timer;
+    bool running;
+    unsigned long startNs;
+};
+
+
 /// The following class defines the statistics that are to be kept about
 /// Nachos behavior -- how much time (ticks) elapsed, how many user
 /// instructions executed, etc.
@@ -59,6 +223,11 @@ public:
     /// Number of Hist of the TLB
     unsigned numsPageHits;
 
+    /// Number of TLB refills (lookups that missed and went through the
+    /// fault handler); unlike `numPageFaults` this does not count lookups
+    /// resolved by a linear page table.
+    unsigned numTlbMisses;
+
     #ifdef DFS_TICKS_FIX
     /// Number of times the tick count gets reset.
     unsigned long tickResets;
@@ -67,9 +236,35 @@ public:
     /// Initialize everything to zero.
     Statistics();
 
-    /// Print collected statistics.
+    /// Print the statistics collected so far; read-only, so it can be
+    /// used on a live run (cf. the debugger's `stats` command).
+    void
+    Report();
+
+    /// Print collected statistics and finalize snapshots, at shutdown.
     void
     Print();
+
+    /// Dump a snapshot line (core stats plus every registered `Counter`)
+    /// to `fileName` each time `everyTicks` simulated ticks go by.
+    void
+    EnableSnapshots(unsigned everyTicks, const char * fileName);
+
+    /// Write a snapshot if one is due; called by the machine as time
+    /// advances, so it must stay a cheap compare in the common case.
+    void
+    Snapshot();
+
+private:
+
+    /// Ticks between snapshots, or zero when disabled.
+    unsigned snapshotEvery;
+
+    /// Tick count at which the next snapshot is due.
+    unsigned nextSnapshotTicks;
+
+    /// Destination of the snapshot lines.
+    FILE * snapshotFile;
 };
 
 /// Constants used to reflect the relative time an operation would take in a
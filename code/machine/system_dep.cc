@@ -51,9 +51,77 @@ extern "C" {
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/mman.h>
+#include <pthread.h> // Socket watcher threads.
 }
 
 
+///     Host time spent in the blocking host calls below (cf.
+///     `HostTimer`): the device-availability `select`, device file
+///     reads and writes, the waits for a watcher flag, and the
+///     shared-memory packet ring.  Together with the interpreter and
+///     interrupt timers these show whether a slow run is compute bound
+///     or stuck in the host kernel.
+
+static HostTimer pollTimer("host.poll");
+static HostTimer fileIoTimer("host.fileIo");
+static HostTimer waitTimer("host.wait");
+static HostTimer shmNetTimer("host.shmNet");
+
+
+///     Record/replay of nondeterministic inputs.
+///
+///     Every value the simulation takes from the outside world (random
+///     numbers, device availability polls, packet arrival) goes through
+///     `ReplayableValue`.  When recording, the live value is appended to
+///     a log; when replaying, the logged value is fed back instead, so
+///     the whole run -- schedules, interleavings, tick counts -- comes
+///     out bit-identical, no matter how much instrumentation is on.
+
+static FILE * recordLog = nullptr;
+static FILE * replayLog = nullptr;
+static bool replayEnded = false;
+
+void
+StartRecording(const char * fileName)
+{
+    ASSERT(fileName != nullptr);
+    recordLog = fopen(fileName, "w");
+    ASSERT(recordLog != nullptr);
+}
+
+void
+StartReplay(const char * fileName)
+{
+    ASSERT(fileName != nullptr);
+    replayLog = fopen(fileName, "r");
+    ASSERT(replayLog != nullptr);
+}
+
+int
+ReplayableValue(char tag, int liveValue)
+{
+    if (replayLog != nullptr && !replayEnded) {
+        char loggedTag;
+        int loggedValue;
+
+        if (fscanf(replayLog, " %c %d", &loggedTag, &loggedValue) == 2) {
+            // A tag mismatch means the replayed run consumed its inputs
+            // in a different order than the recorded one -- the builds
+            // or command lines differ in something that matters.
+            ASSERT(loggedTag == tag);
+            return loggedValue;
+        }
+        replayEnded = true;
+        fprintf(stderr,
+          "WARNING: replay log exhausted; continuing with live inputs.\n");
+    }
+    if (recordLog != nullptr) {
+        fprintf(recordLog, "%c %d\n", tag, liveValue);
+        fflush(recordLog); // Keep the log complete even if we crash.
+    }
+    return liveValue;
+}
+
 ///     Check open file or open socket to see if there are any
 ///     characters that can be read immediately.  If so, read them
 ///     in, and return TRUE.
@@ -72,24 +140,36 @@ PollFile(int fd)
 {
     int rfd = (1 << fd), wfd = 0, xfd = 0, retVal;
     struct timeval pollTime;
+    static bool lastPollEmpty = false;  ///< Previous poll found no input.
 
     // Decide how long to wait if there are no characters on the file.
+    // When nothing but outside input can make progress -- and the last
+    // poll came up empty, so input really is not flowing -- block the
+    // host in `select` so an idle machine does not pin a core; `select`
+    // wakes early the moment real input lands on the descriptor.  The
+    // empty-poll condition keeps an always-readable descriptor (e.g.
+    // stdin at end of file) on the zero-timeout fast path.
     pollTime.tv_sec = 0;
-    if (interrupt->GetStatus() == IDLE_MODE)
+    if (lastPollEmpty && interrupt->IsIdlePolling())
         pollTime.tv_usec = 20000;  // Delay to let other nachos run.
     else
         pollTime.tv_usec = 0;  // No delay.
 
     // Poll file or socket.
-    #ifdef HOST_LINUX
-    retVal = select(32, (fd_set *) &rfd, (fd_set *) &wfd, (fd_set *) &xfd,
-        &pollTime);
-    #else
-    retVal = select(32, &rfd, &wfd, &xfd, &pollTime);
-    #endif
+    {
+        HostTimerScope scope(pollTimer);
+        #ifdef HOST_LINUX
+        retVal = select(32, (fd_set *) &rfd, (fd_set *) &wfd,
+            (fd_set *) &xfd, &pollTime);
+        #else
+        retVal = select(32, &rfd, &wfd, &xfd, &pollTime);
+        #endif
+    }
 
     ASSERT(retVal == 0 || retVal == 1);
-    return retVal; // If 0, no char waiting to be read.
+    lastPollEmpty = retVal == 0;
+    // If 0, no char waiting to be read.
+    return ReplayableValue('f', retVal);
 }
 
 /// Open a file for writing.
@@ -129,6 +209,7 @@ Read(int fd, char * buffer, size_t nBytes)
 {
     ASSERT(buffer != nullptr);
     ASSERT(nBytes > 0);
+    HostTimerScope scope(fileIoTimer);
     ssize_t retVal = read(fd, buffer, nBytes);
     ASSERT(retVal > 0 && retVal == (ssize_t) nBytes);
 }
@@ -139,6 +220,7 @@ ReadPartial(int fd, char * buffer, size_t nBytes)
 {
     ASSERT(buffer != nullptr);
     ASSERT(nBytes > 0);
+    HostTimerScope scope(fileIoTimer);
     return read(fd, buffer, nBytes);
 }
 
@@ -150,6 +232,7 @@ WriteFile(int fd, const char * buffer, size_t nBytes)
 {
     ASSERT(buffer != nullptr);
     ASSERT(nBytes > 0);
+    HostTimerScope scope(fileIoTimer);
     ssize_t retVal = write(fd, buffer, nBytes);
     ASSERT(retVal > 0 && retVal == (ssize_t) nBytes);
 }
@@ -198,6 +281,59 @@ Unlink(const char * name)
     return unlink(name);
 }
 
+/// Set the length of an open file without writing any data.  Growing a
+/// file this way leaves it sparse: the host allocates no blocks for the
+/// extended region, and reads of it return zeroes.
+void
+TruncateFile(int fd, unsigned size)
+{
+    int result = ftruncate(fd, size);
+
+    ASSERT(result == 0);
+}
+
+/// Make a hard link.  Returns 0 on success, as `link`.
+int
+LinkFile(const char * oldName, const char * newName)
+{
+    ASSERT(oldName != nullptr && newName != nullptr);
+    return link(oldName, newName);
+}
+
+/// Rename a file.  Returns 0 on success, as `rename`.
+int
+RenameFile(const char * oldName, const char * newName)
+{
+    ASSERT(oldName != nullptr && newName != nullptr);
+    return rename(oldName, newName);
+}
+
+/// Map the first `size` bytes of an open file into memory, shared, so
+/// stores are carried through to the file.
+///
+/// Returns null on failure, so the caller can fall back to `read`/`write`.
+char *
+MapFile(int fd, unsigned size)
+{
+    ASSERT(size > 0);
+
+    void * addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+        fd, 0);
+    return addr == MAP_FAILED ? nullptr : (char *) addr;
+}
+
+/// Write a mapping's dirty pages back to the underlying file and remove
+/// the mapping.
+void
+UnmapFile(char * addr, unsigned size)
+{
+    ASSERT(addr != nullptr);
+    ASSERT(size > 0);
+
+    msync(addr, size, MS_SYNC);
+    munmap(addr, size);
+}
+
 /// Open an interprocess communication (IPC) connection.
 ///
 /// For now, just open a datagram port where other Nachos (simulating
@@ -264,6 +400,99 @@ PollSocket(int sockID)
     return PollFile(sockID); // On UNIX, socket ID's are just file ID's.
 }
 
+/// Socket watchers: each runs on a host thread that blocks in `select`
+/// on one socket and raises a flag the moment it becomes readable.  The
+/// simulation then tests for packet arrival with a plain memory read
+/// instead of a system call per poll, and reacts to a packet as soon as
+/// it lands instead of on the next fixed polling delay.
+
+static const unsigned MAX_WATCHED = 4;
+
+typedef struct {
+    int fd;
+    volatile bool * flag;
+    volatile bool stop;
+    bool inUse;
+    pthread_t thread;
+} WatchedSocket;
+
+static WatchedSocket watched[MAX_WATCHED];
+
+static void *
+SocketWatcher(void * arg)
+{
+    WatchedSocket * w = (WatchedSocket *) arg;
+
+    while (!w->stop) {
+        if (*w->flag) {
+            // The last packet has not been consumed yet; nothing to
+            // watch for until it is.
+            usleep(1000);
+            continue;
+        }
+
+        fd_set rfds;
+        struct timeval tv;
+
+        FD_ZERO(&rfds);
+        FD_SET(w->fd, &rfds);
+        tv.tv_sec  = 0;
+        tv.tv_usec = 100000; // Wake up now and then to honor `stop`.
+        if (select(w->fd + 1, &rfds, nullptr, nullptr, &tv) > 0)
+            *w->flag = true;
+    }
+    return nullptr;
+}
+
+void
+WatchSocket(int sockID, volatile bool * flag)
+{
+    ASSERT(flag != nullptr);
+
+    unsigned i;
+
+    for (i = 0; i < MAX_WATCHED; i++)
+        if (!watched[i].inUse)
+            break;
+
+    ASSERT(i < MAX_WATCHED); // Too many watched sockets.
+
+    watched[i].fd    = sockID;
+    watched[i].flag  = flag;
+    watched[i].stop  = false;
+    watched[i].inUse = true;
+
+    int retVal = pthread_create(&watched[i].thread, nullptr,
+        SocketWatcher, &watched[i]);
+    ASSERT(retVal == 0);
+}
+
+void
+UnwatchSocket(int sockID)
+{
+    for (unsigned i = 0; i < MAX_WATCHED; i++) {
+        if (watched[i].inUse && watched[i].fd == sockID) {
+            watched[i].stop = true;
+            pthread_join(watched[i].thread, nullptr);
+            watched[i].inUse = false;
+            return;
+        }
+    }
+}
+
+/// Wait until `*flag` is raised, or until `maxUs` microseconds pass,
+/// whichever comes first.  The wait sleeps in short slices, so the host
+/// CPU stays available for the other Nachos instances.
+void
+WaitForFlag(volatile bool * flag, unsigned maxUs)
+{
+    ASSERT(flag != nullptr);
+
+    HostTimerScope scope(waitTimer);
+    for (unsigned waited = 0; !*flag && waited < maxUs; waited += 1000)
+        usleep(1000);
+}
+
 /// Read a fixed size packet off the IPC port.
 ///
 /// Abort on error.
@@ -316,6 +545,200 @@ SendToSocket(int sockID, const char * buffer,
     ASSERT(retVal > 0 && retVal == (ssize_t) packetSize);
 }
 
+/// Shared-memory network transport (cf. `ShmNetAttach` in the header).
+/// The file holds one incoming packet ring per node; senders reserve a
+/// slot with an atomic increment, so any number of nodes can write to
+/// the same ring concurrently, and only the owner advances `tail`.
+
+static const unsigned SHM_NET_NODES = 16; ///< Nodes sharing the file.
+static const unsigned SHM_NET_SLOTS = 64; ///< Ring capacity, per node.
+static const unsigned SHM_NET_SLOT_BYTES = 512; ///< >= `MAX_WIRE_SIZE`,
+                                                ///< so jumbo MTUs fit.
+
+struct ShmNetSlot {
+    volatile unsigned full;
+    char data[SHM_NET_SLOT_BYTES];
+};
+
+struct ShmNetRing {
+    volatile unsigned reserve; ///< Next slot ticket handed to a sender.
+    volatile unsigned tail;    ///< Next slot the owner will read.
+    ShmNetSlot slot[SHM_NET_SLOTS];
+};
+
+static ShmNetRing * shmNet   = nullptr;
+static int          shmNetFd = -1;
+
+void
+ShmNetAttach(unsigned node)
+{
+    ASSERT(node < SHM_NET_NODES);
+    ASSERT(shmNet == nullptr);
+
+    shmNetFd = open("NETWORK_SHM", O_RDWR | O_CREAT, 0666);
+    ASSERT(shmNetFd >= 0);
+    unsigned size = SHM_NET_NODES * sizeof(ShmNetRing);
+    int retVal    = ftruncate(shmNetFd, size); // Zero-fills new bytes.
+    ASSERT(retVal == 0);
+    void * map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+        shmNetFd, 0);
+    ASSERT(map != MAP_FAILED);
+    shmNet = (ShmNetRing *) map;
+
+    // The file may be left over from a previous run in this directory
+    // (like stale `SOCKET_*` files): reset our own ring.  Peers cannot
+    // have sent to us yet.
+    ShmNetRing * ring = &shmNet[node];
+    ring->reserve = ring->tail = 0;
+    for (unsigned i = 0; i < SHM_NET_SLOTS; i++)
+        ring->slot[i].full = 0;
+}
+
+/// Drop the mapping.  The file itself stays put: unlinking it would make
+/// a node started later create a fresh file and miss its peers.
+void
+ShmNetDetach()
+{
+    if (shmNet == nullptr)
+        return;
+    munmap(shmNet, SHM_NET_NODES * sizeof(ShmNetRing));
+    close(shmNetFd);
+    shmNet   = nullptr;
+    shmNetFd = -1;
+}
+
+void
+ShmNetSend(unsigned dest, const char * packet, size_t packetSize)
+{
+    ASSERT(shmNet != nullptr);
+    ASSERT(packet != nullptr);
+    ASSERT(dest < SHM_NET_NODES);
+    ASSERT(packetSize > 0 && packetSize <= SHM_NET_SLOT_BYTES);
+
+    HostTimerScope scope(shmNetTimer);
+    ShmNetRing * ring = &shmNet[dest];
+    unsigned ticket   = __sync_fetch_and_add(&ring->reserve, 1);
+    ShmNetSlot * slot = &ring->slot[ticket % SHM_NET_SLOTS];
+    // Ring full: wait for the owner to drain up to our slot.
+    while (slot->full)
+        usleep(100);
+    memcpy(slot->data, packet, packetSize);
+    __sync_synchronize(); // Publish the data before the flag.
+    slot->full = 1;
+}
+
+bool
+ShmNetRecv(unsigned node, char * packet, size_t packetSize)
+{
+    ASSERT(shmNet != nullptr);
+    ASSERT(packet != nullptr);
+    ASSERT(packetSize > 0 && packetSize <= SHM_NET_SLOT_BYTES);
+
+    HostTimerScope scope(shmNetTimer);
+    ShmNetRing * ring = &shmNet[node];
+    ShmNetSlot * slot = &ring->slot[ring->tail % SHM_NET_SLOTS];
+    if (!slot->full)
+        return false;
+    __sync_synchronize(); // The flag before the data.
+    memcpy(packet, slot->data, packetSize);
+    __sync_synchronize(); // Drain the data before freeing the slot.
+    slot->full = 0;
+    ring->tail++;
+    return true;
+}
+
+/// The ring watcher thread (the shared-memory analogue of
+/// `SocketWatcher`): raise the flag whenever the node's ring has a
+/// packet buffered.  The 200 us nap bounds how stale the flag can be --
+/// two orders of magnitude finer than the old 20 ms socket poll.
+
+static struct {
+    pthread_t       thread;
+    unsigned        node;
+    volatile bool * flag;
+    volatile bool   stop;
+    bool            inUse;
+} shmNetWatcher = {};
+
+static void *
+ShmNetWatcherLoop(void * arg)
+{
+    while (!shmNetWatcher.stop) {
+        ShmNetRing * ring = &shmNet[shmNetWatcher.node];
+        if (ring->slot[ring->tail % SHM_NET_SLOTS].full)
+            *shmNetWatcher.flag = true;
+        usleep(200);
+    }
+    return nullptr;
+}
+
+void
+ShmNetWatch(unsigned node, volatile bool * flag)
+{
+    ASSERT(flag != nullptr);
+    ASSERT(!shmNetWatcher.inUse); // One node per process.
+
+    shmNetWatcher.node  = node;
+    shmNetWatcher.flag  = flag;
+    shmNetWatcher.stop  = false;
+    shmNetWatcher.inUse = true;
+
+    int retVal = pthread_create(&shmNetWatcher.thread, nullptr,
+        ShmNetWatcherLoop, nullptr);
+    ASSERT(retVal == 0);
+}
+
+void
+ShmNetUnwatch()
+{
+    if (!shmNetWatcher.inUse)
+        return;
+    shmNetWatcher.stop = true;
+    pthread_join(shmNetWatcher.thread, nullptr);
+    shmNetWatcher.inUse = false;
+}
+
+/// Where wild memory references are reported; see `CallOnSegFault`.
+static void (* segFaultHandler)(const void * addr) = nullptr;
+
+static void
+SegFaultTrampoline(int sig, siginfo_t * info, void * context)
+{
+    if (segFaultHandler != nullptr)
+        (*segFaultHandler)(info->si_addr);
+    // If the handler comes back, the fault was not one of ours: restore
+    // the default action and return, so the instruction re-faults and a
+    // debugger or core dump sees the original fault address.
+    signal(SIGSEGV, SIG_DFL);
+}
+
+/// Arrange that `handler` be told the faulting address of any wild memory
+/// reference.  Unless the handler ends the process itself, the fault is
+/// then re-taken with the default fatal behavior.
+///
+/// The handler runs on its own stack: the faults of interest include
+/// thread stack overflows, where the faulting stack has no room left.
+void
+CallOnSegFault(void (* handler)(const void * addr))
+{
+    ASSERT(handler != nullptr);
+    segFaultHandler = handler;
+
+    static char handlerStack[16 * 1024];
+    stack_t ss;
+    ss.ss_sp    = handlerStack;
+    ss.ss_size  = sizeof handlerStack;
+    ss.ss_flags = 0;
+    sigaltstack(&ss, nullptr);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_sigaction = SegFaultTrampoline;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigaction(SIGSEGV, &sa, nullptr);
+}
+
 /// Arrange that `func` will be called when the user aborts (e.g., by hitting
 /// ctl-C).
 void
@@ -350,7 +773,7 @@ RandomInit(unsigned seed)
 int
 Random()
 {
-    return rand();
+    return ReplayableValue('r', rand());
 }
 
 /// Return an array, with the two pages just before and after the array
@@ -364,13 +787,14 @@ Random()
 char *
 AllocBoundedArray(unsigned size)
 {
-    int pgSize = getpagesize();
-    char * ptr = new char [pgSize * 2 + size];
-
-    #ifndef HOST_LINUX
-    mprotect(ptr, pgSize, 0);
-    mprotect(ptr + pgSize + size, pgSize, 0);
-    #endif
+    unsigned pgSize = getpagesize();
+    unsigned rounded = (size + pgSize - 1) / pgSize * pgSize;
+    char * ptr = (char *) mmap(nullptr, pgSize * 2 + rounded,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    ASSERT(ptr != MAP_FAILED);
+    mprotect(ptr, pgSize, PROT_NONE);
+    mprotect(ptr + pgSize + rounded, pgSize, PROT_NONE);
     return ptr + pgSize;
 }
 
@@ -384,11 +808,8 @@ DeallocBoundedArray(const char * ptr, unsigned size)
     ASSERT(ptr != nullptr);
     ASSERT(size > 0);
 
-    int pgSize = getpagesize();
+    unsigned pgSize = getpagesize();
+    unsigned rounded = (size + pgSize - 1) / pgSize * pgSize;
 
-    #ifndef HOST_LINUX
-    mprotect(ptr - pgSize, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
-    mprotect(ptr + size, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
-    #endif
-    delete [] (ptr - pgSize);
+    munmap((void *) (ptr - pgSize), pgSize * 2 + rounded);
 }
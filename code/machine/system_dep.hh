@@ -54,6 +54,26 @@ Close(int fd);
 extern bool
 Unlink(const char * name);
 
+extern void
+TruncateFile(int fd, unsigned size);
+
+extern int
+LinkFile(const char * oldName, const char * newName);
+
+extern int
+RenameFile(const char * oldName, const char * newName);
+
+/// Map an open file into memory, so its contents can be accessed with
+/// plain loads and stores.  Returns null if the host cannot map it.
+
+extern char *
+MapFile(int fd, unsigned size);
+
+/// Flush a mapping back to its file and remove it.
+
+extern void
+UnmapFile(char * addr, unsigned size);
+
 /// Interprocess communication operations, for simulating the network.
 
 extern int
@@ -71,6 +91,23 @@ DeAssignNameToSocket(const char * socketName);
 extern bool
 PollSocket(int sockID);
 
+/// Watch `sockID` from a host thread that blocks in `select` and sets
+/// `*flag` the moment the socket becomes readable.  Polling then costs a
+/// memory read instead of a system call, and an idle machine can react
+/// to a packet as soon as it lands (see `WaitForFlag`).
+
+extern void
+WatchSocket(int sockID, volatile bool * flag);
+
+extern void
+UnwatchSocket(int sockID);
+
+/// Wait until `*flag` is raised, or until `maxUs` microseconds pass,
+/// whichever comes first, yielding the host CPU in between.
+
+extern void
+WaitForFlag(volatile bool * flag, unsigned maxUs);
+
 extern void
 ReadFromSocket(int sockID, char * buffer, size_t packetSize);
 
@@ -78,6 +115,35 @@ extern void
 SendToSocket(int sockID, const char * buffer,
   size_t packetSize, const char * toName);
 
+/// Shared-memory network transport: every node maps the same file
+/// (`NETWORK_SHM`, in the current directory) holding one incoming packet
+/// ring per node.  Sending is a `memcpy` into the destination's ring and
+/// receiving a `memcpy` out of one's own, so inter-node traffic costs no
+/// system call per packet and scales with host cores.
+
+extern void
+ShmNetAttach(unsigned node);
+
+extern void
+ShmNetDetach();
+
+extern void
+ShmNetSend(unsigned dest, const char * packet, size_t packetSize);
+
+/// Pull the next packet off `node`'s ring, if one is buffered.
+
+extern bool
+ShmNetRecv(unsigned node, char * packet, size_t packetSize);
+
+/// Watch `node`'s ring from a host thread that sets `*flag` the moment a
+/// packet lands (the shared-memory analogue of `WatchSocket`).
+
+extern void
+ShmNetWatch(unsigned node, volatile bool * flag);
+
+extern void
+ShmNetUnwatch();
+
 /// Process control: `sleep`.
 
 extern void
@@ -88,6 +154,27 @@ Delay(unsigned seconds);
 extern void
 CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
 
+/// Report the faulting address of wild memory references to `handler`;
+/// faults it does not claim stay fatal.
+extern void
+CallOnSegFault(void (* handler)(const void * addr));
+
+/// Record/replay of nondeterministic inputs (random numbers, device
+/// availability, packet arrival), so a recorded run can later be
+/// reproduced bit-identically -- heavy instrumentation and all.
+
+extern void
+StartRecording(const char * fileName);
+
+extern void
+StartReplay(const char * fileName);
+
+/// Funnel for a nondeterministic `liveValue`: appended to the log when
+/// recording, overridden by the logged value when replaying.  `tag`
+/// names the source, to catch replays that diverge from the recording.
+extern int
+ReplayableValue(char tag, int liveValue);
+
 /// Initialize the pseudo random number generator.
 extern void
 RandomInit(unsigned seed);
@@ -53,6 +53,12 @@ public:
 
     /// This bit is set by the hardware every time the page is modified.
     bool dirty;
+
+    /// Which address space the entry translates for, meaningful when the
+    /// entry sits in the TLB.  Tagged entries survive context switches:
+    /// switching spaces just changes the MMU's current identifier instead
+    /// of flushing the whole TLB.
+    unsigned asid;
 };
 
 
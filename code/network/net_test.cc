@@ -23,6 +23,9 @@
 #include "machine/interrupt.hh"
 #include "threads/system.hh"
 
+#include <stdint.h>
+#include <stdlib.h>
+
 
 /// Test out message delivery, by doing the following:
 ///
@@ -73,3 +76,136 @@ MailTest(int farAddr)
     // Then we are done!
     interrupt->Halt();
 } // MailTest
+
+/// Network benchmark.
+///
+/// One machine runs the responder (`nachos -nbs`), the other the
+/// initiator (`nachos -nb <farAddr> <size> <count>`).  The initiator
+/// measures, in simulated ticks:
+///
+/// 1. Streaming throughput: `count` windowed messages of `size` bytes,
+///    closed by a barrier that waits for the responder to have seen
+///    them all.
+/// 2. Request/response latency: echo round trips of `size` bytes, with
+///    p50/p99 over the distribution.
+///
+/// Results come out as single `netbench:` lines with `key=value`
+/// fields, so runs can be collected and diffed by scripts.  Loss-rate
+/// sweeps are driven from outside by re-running with different `-l`
+/// reliability values.
+
+/// Mailboxes used by the benchmark: requests arrive at the responder's
+/// box, echoes at the initiator's.
+static const int BENCH_SERVER_BOX = 2;
+static const int BENCH_CLIENT_BOX = 3;
+
+/// Largest benchmark message; bigger ones are fragmented by the post
+/// office anyway, this only bounds the buffers here.
+static const unsigned MAX_BENCH_MSG = 8192;
+
+/// Round trips measured in the latency phase.
+static const unsigned BENCH_PINGS = 200;
+
+/// Echo loop: swallow streamed data, echo pings and barriers back.
+///
+/// The first payload byte tells the phases apart: `S` for streamed
+/// data (no reply), anything else is echoed to the sender.
+void
+NetBenchServer()
+{
+    PacketHeader pktHdr, outPktHdr;
+    MailHeader mailHdr, outMailHdr;
+    char * buffer = new char [MAX_BENCH_MSG];
+
+    printf("netbench: role=server box=%d\n", BENCH_SERVER_BOX);
+    for (;;) {
+        unsigned total = postOffice->ReceiveMessage(BENCH_SERVER_BOX,
+            &pktHdr, &mailHdr, buffer, MAX_BENCH_MSG);
+
+        if (total == 0 || buffer[0] == 'S')
+            continue;
+
+        outPktHdr.to    = pktHdr.from;
+        outMailHdr.to   = BENCH_CLIENT_BOX;
+        outMailHdr.from = BENCH_SERVER_BOX;
+        postOffice->SendMessage(outPktHdr, outMailHdr, buffer,
+          total <= MAX_BENCH_MSG ? total : MAX_BENCH_MSG);
+    }
+} // NetBenchServer
+
+/// Comparison callback for sorting the latency samples.
+static int
+CompareTicks(const void * a, const void * b)
+{
+    unsigned ta = *(const unsigned *) a, tb = *(const unsigned *) b;
+
+    return ta < tb ? -1 : ta > tb;
+}
+
+void
+NetBench(int farAddr, int msgSize, int msgCount)
+{
+    ASSERT(msgSize > 0 && (unsigned) msgSize <= MAX_BENCH_MSG);
+    ASSERT(msgCount > 0);
+
+    PacketHeader outPktHdr, inPktHdr;
+    MailHeader outMailHdr, inMailHdr;
+    unsigned size  = msgSize;
+    unsigned count = msgCount;
+    char * out = new char [MAX_BENCH_MSG];
+    char * in  = new char [MAX_BENCH_MSG];
+
+    memset(out, 'x', size);
+    outPktHdr.to    = farAddr;
+    outMailHdr.to   = BENCH_SERVER_BOX;
+    outMailHdr.from = BENCH_CLIENT_BOX;
+
+    // Phase 1: streaming throughput.  The barrier echo at the end makes
+    // sure every streamed byte was actually delivered (the window
+    // retransmits into the measured interval, as it should: lost
+    // packets cost their real time).
+    unsigned startTicks = stats->totalTicks;
+
+    out[0] = 'S';
+    for (unsigned i = 0; i < count; i++)
+        postOffice->SendMessage(outPktHdr, outMailHdr, out, size);
+    out[0] = 'B';
+    postOffice->SendMessage(outPktHdr, outMailHdr, out, 1);
+    postOffice->ReceiveMessage(BENCH_CLIENT_BOX, &inPktHdr, &inMailHdr,
+      in, MAX_BENCH_MSG);
+
+    unsigned streamTicks = stats->totalTicks - startTicks;
+    unsigned bytes       = size * count;
+
+    printf("netbench: phase=stream size=%u count=%u bytes=%u ticks=%u "
+      "bytes_per_ktick=%u\n", size, count, bytes, streamTicks,
+      streamTicks > 0 ? (unsigned) ((uint64_t) bytes * 1000 / streamTicks)
+      : 0);
+
+    // Phase 2: request/response latency distribution.
+    unsigned samples[BENCH_PINGS];
+
+    out[0] = 'P';
+    for (unsigned i = 0; i < BENCH_PINGS; i++) {
+        unsigned before = stats->totalTicks;
+        postOffice->SendMessage(outPktHdr, outMailHdr, out, size);
+        postOffice->ReceiveMessage(BENCH_CLIENT_BOX, &inPktHdr, &inMailHdr,
+          in, MAX_BENCH_MSG);
+        samples[i] = stats->totalTicks - before;
+    }
+
+    qsort(samples, BENCH_PINGS, sizeof (unsigned), CompareTicks);
+
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < BENCH_PINGS; i++)
+        sum += samples[i];
+
+    printf("netbench: phase=latency size=%u count=%u min=%u p50=%u "
+      "p99=%u max=%u avg=%u\n", size, BENCH_PINGS, samples[0],
+      samples[BENCH_PINGS / 2], samples[BENCH_PINGS * 99 / 100],
+      samples[BENCH_PINGS - 1], (unsigned) (sum / BENCH_PINGS));
+
+    delete [] out;
+    delete [] in;
+    interrupt->Halt();
+} // NetBench
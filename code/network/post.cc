@@ -19,6 +19,17 @@
 
 
 #include "post.hh"
+#include "threads/system.hh"
+
+
+/// Simulated ticks before unacknowledged window packets are resent.
+static const unsigned RETRANSMIT_TICKS = 1000;
+
+/// Simulated ticks an acknowledgement may wait for a reverse-direction
+/// data packet to ride on before going out bare.  Well under
+/// `RETRANSMIT_TICKS`, so a delayed bare ack still beats the peer's
+/// retransmit timer.
+static const unsigned ACK_DELAY_TICKS = 300;
 
 
 /// Initialize a single mail message, by concatenating the headers to
@@ -44,6 +55,7 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, const char * msgData)
 MailBox::MailBox()
 {
     messages = new SynchList<Mail *>;
+    count    = 0;
 }
 
 /// De-allocate a single mail box within the post office.
@@ -82,7 +94,22 @@ MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, const char * data)
 {
     ASSERT(data != nullptr);
 
-    Mail * mail = new Mail(pktHdr, mailHdr, data);
+    Put(new Mail(pktHdr, mailHdr, data));
+}
+
+/// Add an already-built message to the mailbox, taking ownership of it.
+///
+/// This is the zero-copy path: the `Mail` the packet was received into
+/// is handed through to the receiving thread as-is.
+void
+MailBox::Put(Mail * mail)
+{
+    ASSERT(mail != nullptr);
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    count++;
+    interrupt->SetLevel(oldLevel);
+
     messages->Append(mail); // Put on the end of the list of arrived
                             // messages, and wake up any waiters.
 }
@@ -102,22 +129,45 @@ MailBox::Get(PacketHeader * pktHdr, MailHeader * mailHdr, char * data)
     ASSERT(mailHdr != nullptr);
     ASSERT(data != nullptr);
 
-    DEBUG('n', "Waiting for mail in mailbox\n");
-    Mail * mail = messages->Pop(); // Remove message from list;
-                                   // will wait if list is empty.
+    Mail * mail = GetMail();
 
     *pktHdr  = mail->pktHdr;
     *mailHdr = mail->mailHdr;
-    if (debug.IsEnabled('n')) {
-        printf("Got mail from mailbox: ");
-        PrintHeader(*pktHdr, *mailHdr);
-    }
     memmove(data, mail->data, mail->mailHdr.length);
     // Copy the message data into the caller's buffer.
     delete mail; // We have copied out the stuff we need, we can now discard
                  // the message.
 }
 
+/// Take the next message out of the mailbox without copying it.
+///
+/// The calling thread waits if there are no messages, and owns the
+/// returned `Mail`.
+Mail *
+MailBox::GetMail()
+{
+    DEBUG('n', "Waiting for mail in mailbox\n");
+    Mail * mail = messages->Pop(); // Remove message from list;
+                                   // will wait if list is empty.
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    count--;
+    interrupt->SetLevel(oldLevel);
+
+    if (debug.IsEnabled('n')) {
+        printf("Got mail from mailbox: ");
+        PrintHeader(mail->pktHdr, mail->mailHdr);
+    }
+    return mail;
+}
+
+/// Is the mailbox at its bound?
+bool
+MailBox::Full() const
+{
+    return count >= MAX_MESSAGES;
+}
+
 /// PostalHelper, ReadAvail, WriteDone
 ///
 /// Dummy functions because C++ cannot indirectly invoke member functions.
@@ -150,6 +200,38 @@ WriteDone(void * arg)
     po->PacketSent();
 }
 
+static void
+RetransmitHelper(void * arg)
+{
+    ASSERT(arg != nullptr);
+    PostOffice * po = (PostOffice *) arg;
+    po->RetransmitDelivery();
+}
+
+static void
+AckHelper(void * arg)
+{
+    ASSERT(arg != nullptr);
+    PostOffice * po = (PostOffice *) arg;
+    po->AckDelivery();
+}
+
+static void
+TimeoutHelper(void * arg)
+{
+    ASSERT(arg != nullptr);
+    PostOffice * po = (PostOffice *) arg;
+    po->RetransmitTimeout();
+}
+
+static void
+AckTimeoutHelper(void * arg)
+{
+    ASSERT(arg != nullptr);
+    PostOffice * po = (PostOffice *) arg;
+    po->AckTimeout();
+}
+
 /// Initialize a post office as a collection of mailboxes.
 ///
 /// Also initialize the network device, to allow post offices on different
@@ -174,6 +256,15 @@ PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
     messageAvailable = new Semaphore("message available", 0);
     messageSent      = new Semaphore("message sent", 0);
     sendLock         = new Lock("message send lock");
+    windowLock       = new Lock("sliding window lock");
+    retransmitGo     = new Semaphore("retransmit timer", 0);
+    ackGo            = new Semaphore("delayed ack", 0);
+    timerSet         = false;
+    ackTimerSet      = false;
+    for (unsigned i = 0; i < MAX_LINKS; i++) {
+        links[i].inUse = false;
+        links[i].space = nullptr;
+    }
 
     // Second, initialize the mailboxes.
     netAddr  = addr;
@@ -185,10 +276,22 @@ PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
     network = new Network(addr, reliability, ReadAvail, WriteDone, this);
 
     // Finally, create a thread whose sole job is to wait for incoming
-    // messages, and put them in the right mailbox.
+    // messages, and put them in the right mailbox, plus a second one
+    // that resends unacknowledged window packets when the retransmit
+    // timer fires.
     Thread * t = new Thread("postal worker");
 
     t->Fork(PostalHelper, this);
+
+    Thread * r = new Thread("retransmit worker");
+
+    r->Fork(RetransmitHelper, this);
+
+    // And one more that sends the bare acks left over when no reverse
+    // data packet showed up to piggyback them on.
+    Thread * a = new Thread("ack worker");
+
+    a->Fork(AckHelper, this);
 }
 
 /// De-allocate the post office data structures.
@@ -199,6 +302,16 @@ PostOffice::~PostOffice()
     delete messageAvailable;
     delete messageSent;
     delete sendLock;
+    delete windowLock;
+    delete retransmitGo;
+    delete ackGo;
+    for (unsigned i = 0; i < MAX_LINKS; i++) {
+        if (!links[i].inUse)
+            continue;
+        for (unsigned s = 0; s < SEND_WINDOW; s++)
+            delete links[i].pending[s];
+        delete links[i].space;
+    }
 }
 
 /// Wait for incoming messages, and put them in the right mailbox.
@@ -208,16 +321,24 @@ PostOffice::~PostOffice()
 void
 PostOffice::PostalDelivery()
 {
-    PacketHeader pktHdr;
-    MailHeader mailHdr;
-    char * buffer = new char [MAX_PACKET_SIZE];
+    // Packets are received straight into the `Mail` object that travels
+    // to the receiving thread: inside the post office the payload is
+    // never copied, only the buffer's ownership moves.  This relies on
+    // the wire layout (`MailHeader`, then data) matching the `Mail`
+    // layout from `mailHdr` onwards.
+    ASSERT(offsetof(Mail, data)
+      == offsetof(Mail, mailHdr) + sizeof(MailHeader));
 
     for (;;) {
-        // First, wait for a message.
+        // First, wait for a message; `Mail` is pooled, so this is a
+        // cheap fixed-size allocation.
         messageAvailable->P();
-        pktHdr = network->Receive(buffer);
 
-        mailHdr = *(MailHeader *) buffer;
+        Mail * mail = new Mail;
+        mail->pktHdr = network->Receive((char *) &mail->mailHdr);
+
+        PacketHeader pktHdr = mail->pktHdr;
+        MailHeader mailHdr  = mail->mailHdr;
         if (debug.IsEnabled('n')) {
             printf("Putting mail into mailbox: ");
             PrintHeader(pktHdr, mailHdr);
@@ -227,8 +348,68 @@ PostOffice::PostalDelivery()
         ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
         ASSERT(mailHdr.length <= MAX_MAIL_SIZE);
 
-        // Put into mailbox.
-        boxes[mailHdr.to].Put(pktHdr, mailHdr, buffer + sizeof(MailHeader));
+        if (mailHdr.flags & MH_ACK) {
+            // Cumulative ack: everything below `ack` got through.  Free
+            // the retransmission copies and open window slots.  The ack
+            // may ride on a data packet, which then continues below.
+            windowLock->Acquire();
+            Link * link = GetLink(pktHdr.from);
+            while (link->sendBase < mailHdr.ack) {
+                Mail * m = link->pending[link->sendBase % SEND_WINDOW];
+                if (m != nullptr) {
+                    delete m;
+                    link->pending[link->sendBase % SEND_WINDOW] = nullptr;
+                    link->space->V();
+                }
+                link->sendBase++;
+            }
+            windowLock->Release();
+            if (!(mailHdr.flags & MH_DATA)) {
+                delete mail;
+                continue; // Bare acks never reach a mailbox.
+            }
+        }
+
+        if (mailHdr.flags & MH_DATA) {
+            // Sequenced payload: deliver only the next in-order packet;
+            // duplicates and gaps are dropped.  A full mailbox also
+            // refuses the packet -- the ack then repeats the old
+            // sequence, so the sender keeps it and retries later: the
+            // box's bound turns into backpressure on the window.
+            windowLock->Acquire();
+            Link * link  = GetLink(pktHdr.from);
+            bool deliver = mailHdr.seq == link->expected
+              && !boxes[mailHdr.to].Full();
+            if (deliver)
+                link->expected++;
+
+            // Do not ack right away: mark the link as owing one, so it
+            // piggybacks on the next data packet to this peer.  If none
+            // shows up, the delayed-ack timeout sends it bare -- well
+            // before the peer's retransmit timer fires.
+            link->ackOwed = true;
+            link->ackBox  = mailHdr.from;
+            link->ackFrom = mailHdr.to;
+            if (!ackTimerSet) {
+                ackTimerSet = true;
+                timerWheel->Schedule(AckTimeoutHelper, this,
+                  ACK_DELAY_TICKS);
+            }
+            windowLock->Release();
+
+            if (deliver)
+                boxes[mailHdr.to].Put(mail);
+            else
+                delete mail;
+            continue;
+        }
+
+        // Put into mailbox; if the box is full, the packet is dropped,
+        // which an unreliable network may do anyway.
+        if (boxes[mailHdr.to].Full())
+            delete mail;
+        else
+            boxes[mailHdr.to].Put(mail);
     }
 }
 
@@ -246,14 +427,15 @@ PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, const char * data)
 {
     ASSERT(data != nullptr);
 
-    char * buffer = new char [MAX_PACKET_SIZE]; // Space to hold concatenated
-                                                // `mailHdr` + data.
+    // Space to hold concatenated `mailHdr` + data; pooled, since one of
+    // these is churned per message sent.
+    char * buffer = (char *) PoolAlloc(MAX_PACKET_SIZE);
 
     if (debug.IsEnabled('n')) {
         printf("Post send: ");
         PrintHeader(pktHdr, mailHdr);
     }
-    ASSERT(mailHdr.length <= MAX_MAIL_SIZE);
+    ASSERT(mailHdr.length <= MailSize());
     ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
 
     // Fill in `pktHdr`, for the `Network` layer.
@@ -271,8 +453,264 @@ PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, const char * data)
                       // message.
     sendLock->Release();
 
-    delete [] buffer; // We have sent the message, so we can delete our
-                      // buffer.
+    PoolFree(buffer, MAX_PACKET_SIZE); // We have sent the message, so we
+                                       // can recycle our buffer.
+}
+
+/// Find (or set up) the sliding-window state for `peer`.
+///
+/// Call with `windowLock` held.  Link slots are never recycled, so the
+/// returned pointer stays valid after the lock is released.
+PostOffice::Link *
+PostOffice::GetLink(NetworkAddress peer)
+{
+    int free = -1;
+
+    for (unsigned i = 0; i < MAX_LINKS; i++) {
+        if (links[i].inUse && links[i].peer == peer)
+            return &links[i];
+
+        if (!links[i].inUse && free < 0)
+            free = i;
+    }
+    ASSERT(free >= 0); // Too many peers for the link table.
+
+    Link * link = &links[free];
+    link->peer     = peer;
+    link->inUse    = true;
+    link->nextSeq  = 0;
+    link->sendBase = 0;
+    link->expected = 0;
+    link->ackOwed  = false;
+    link->ackBox   = 0;
+    link->ackFrom  = 0;
+    link->space    = new Semaphore("window space", SEND_WINDOW);
+    for (unsigned s = 0; s < SEND_WINDOW; s++)
+        link->pending[s] = nullptr;
+    return link;
+}
+
+/// Send a message through the sliding window to `pktHdr.to`.
+///
+/// The packet is stamped with the next sequence number for that machine,
+/// a copy is kept for retransmission, and the call returns as soon as
+/// the packet is on the wire -- without waiting for the ack -- so up to
+/// `SEND_WINDOW` packets pipeline in flight.  Blocks only when the
+/// window is full.
+///
+/// * `pktHdr` -- source, destination machine ID's.
+/// * `mailHdr` -- source, destination mailbox ID's.
+/// * `data` is the payload message data.
+void
+PostOffice::SendWindowed(PacketHeader pktHdr, MailHeader mailHdr,
+  const char * data)
+{
+    ASSERT(data != nullptr);
+    ASSERT(mailHdr.length <= MailSize());
+
+    windowLock->Acquire();
+    Link * link = GetLink(pktHdr.to);
+    windowLock->Release();
+
+    link->space->P(); // Wait for a free slot in the window.
+
+    windowLock->Acquire();
+    mailHdr.seq    = link->nextSeq++;
+    mailHdr.flags |= MH_DATA; // Keep `MH_MORE` if the caller set it.
+    if (link->ackOwed) {
+        // Reverse-direction traffic: let the pending ack ride along
+        // instead of costing its own packet.
+        mailHdr.flags |= MH_ACK;
+        mailHdr.ack    = link->expected;
+        link->ackOwed  = false;
+    }
+    pktHdr.from   = netAddr;
+    link->pending[mailHdr.seq % SEND_WINDOW] = new Mail(pktHdr, mailHdr,
+        data);
+    if (!timerSet) {
+        timerSet = true;
+        interrupt->Schedule(TimeoutHelper, this, RETRANSMIT_TICKS,
+          NETWORK_SEND_INT);
+    }
+    windowLock->Release();
+
+    Send(pktHdr, mailHdr, data);
+}
+
+/// Send a message of arbitrary size in one logical operation.
+///
+/// The payload is cut into `MailSize()` fragments, each flagged with
+/// `MH_MORE` except the last, and pushed through the sliding window, so
+/// up to `SEND_WINDOW` fragments are in flight at once.  The window
+/// delivers fragments in order, which is what lets the receiver simply
+/// concatenate them.
+///
+/// * `pktHdr` -- source, destination machine ID's.
+/// * `mailHdr` -- source, destination mailbox ID's.
+/// * `data` is the payload message data.
+/// * `length` is the number of bytes in `data`.
+void
+PostOffice::SendMessage(PacketHeader pktHdr, MailHeader mailHdr,
+  const char * data, unsigned length)
+{
+    ASSERT(data != nullptr);
+
+    unsigned offset = 0;
+
+    do {
+        unsigned chunk = length - offset;
+        if (chunk > MailSize())
+            chunk = MailSize();
+        mailHdr.length = chunk;
+        mailHdr.flags  = offset + chunk < length ? MH_MORE : 0;
+        SendWindowed(pktHdr, mailHdr, data + offset);
+        offset += chunk;
+    } while (offset < length);
+}
+
+/// Reassemble a message sent with `SendMessage`.
+///
+/// Collect fragments from `box` until one arrives without `MH_MORE`,
+/// copying at most `maxLength` bytes into `data`.  Returns the full
+/// message length, which tells the caller whether it was truncated.
+///
+/// * `box` is the mailbox ID in which to look for fragments.
+/// * `pktHdr` is the address to put: source, destination machine ID's.
+/// * `mailHdr` is the address to put: source, destination mailbox ID's.
+/// * `data` is the address to put: reassembled message data.
+/// * `maxLength` is the size of the buffer at `data`.
+unsigned
+PostOffice::ReceiveMessage(int box, PacketHeader * pktHdr,
+  MailHeader * mailHdr, char * data, unsigned maxLength)
+{
+    ASSERT(pktHdr != nullptr);
+    ASSERT(mailHdr != nullptr);
+    ASSERT(data != nullptr);
+
+    unsigned total = 0;
+    bool more = true;
+
+    while (more) {
+        Mail * mail = ReceiveMail(box);
+        *pktHdr  = mail->pktHdr;
+        *mailHdr = mail->mailHdr;
+        more = (mail->mailHdr.flags & MH_MORE) != 0;
+
+        unsigned n = mail->mailHdr.length;
+        if (total + n > maxLength)
+            n = maxLength > total ? maxLength - total : 0;
+        memmove(data + total, mail->data, n);
+        total += mail->mailHdr.length;
+        delete mail;
+    }
+    return total;
+}
+
+/// Resend every packet still waiting for an ack.
+///
+/// Runs in its own thread, woken by the retransmit timer: the copies are
+/// gathered under the lock and resent without it, since `Send` blocks on
+/// the network device.
+void
+PostOffice::RetransmitDelivery()
+{
+    Mail * copies[MAX_LINKS * SEND_WINDOW];
+
+    for (;;) {
+        retransmitGo->P();
+
+        unsigned numCopies = 0;
+
+        windowLock->Acquire();
+        timerSet = false;
+        for (unsigned i = 0; i < MAX_LINKS; i++) {
+            if (!links[i].inUse)
+                continue;
+            for (unsigned s = links[i].sendBase; s < links[i].nextSeq;
+              s++)
+            {
+                Mail * m = links[i].pending[s % SEND_WINDOW];
+                if (m != nullptr)
+                    copies[numCopies++] = new Mail(m->pktHdr, m->mailHdr,
+                        m->data);
+            }
+        }
+        if (numCopies > 0) {
+            // Still unacked traffic: keep the timer running.
+            timerSet = true;
+            interrupt->Schedule(TimeoutHelper, this, RETRANSMIT_TICKS,
+              NETWORK_SEND_INT);
+        }
+        windowLock->Release();
+
+        for (unsigned i = 0; i < numCopies; i++) {
+            DEBUG('n', "Resending seq %u to %d\n", copies[i]->mailHdr.seq,
+              copies[i]->pktHdr.to);
+            Send(copies[i]->pktHdr, copies[i]->mailHdr, copies[i]->data);
+            delete copies[i];
+        }
+    }
+}
+
+/// Send a bare ack to every peer still owed one.
+///
+/// Runs in its own thread, woken by the delayed-ack timeout: by then any
+/// pending ack that could piggyback on reverse data already has, so what
+/// remains goes out as a zero-length `MH_ACK` packet.  The headers are
+/// gathered under the lock and sent without it, since `Send` blocks on
+/// the network device.
+void
+PostOffice::AckDelivery()
+{
+    PacketHeader barePkt[MAX_LINKS];
+    MailHeader bareMail[MAX_LINKS];
+
+    for (;;) {
+        ackGo->P();
+
+        unsigned numBare = 0;
+
+        windowLock->Acquire();
+        ackTimerSet = false;
+        for (unsigned i = 0; i < MAX_LINKS; i++) {
+            Link * link = &links[i];
+            if (!link->inUse || !link->ackOwed)
+                continue;
+            barePkt[numBare].to       = link->peer;
+            bareMail[numBare].to      = link->ackBox;
+            bareMail[numBare].from    = link->ackFrom;
+            bareMail[numBare].length  = 0;
+            bareMail[numBare].seq     = 0;
+            bareMail[numBare].ack     = link->expected;
+            bareMail[numBare].flags   = MH_ACK;
+            numBare++;
+            link->ackOwed = false;
+        }
+        windowLock->Release();
+
+        for (unsigned i = 0; i < numBare; i++)
+            Send(barePkt[i], bareMail[i], "");
+    }
+}
+
+/// Timer-wheel handler for the delayed-ack timeout.
+///
+/// Just wake up the ack worker; sending takes locks and cannot be done
+/// at interrupt level.
+void
+PostOffice::AckTimeout()
+{
+    ackGo->V();
+}
+
+/// Interrupt handler, called when the retransmit timer expires.
+///
+/// Just wake up the retransmit worker; resending takes locks and cannot
+/// be done at interrupt level.
+void
+PostOffice::RetransmitTimeout()
+{
+    retransmitGo->V();
 }
 
 /// Retrieve a message from a specific box if one is available, otherwise
@@ -298,6 +736,20 @@ PostOffice::Receive(int box, PacketHeader * pktHdr,
     ASSERT(mailHdr->length <= MAX_MAIL_SIZE);
 }
 
+/// Retrieve the next message from `box` without copying it.
+///
+/// The returned `Mail` is the buffer the packet was received into; the
+/// caller owns it and must `delete` it (it goes back to the pool).
+Mail *
+PostOffice::ReceiveMail(int box)
+{
+    ASSERT(box >= 0 && box < numBoxes);
+
+    Mail * mail = boxes[box].GetMail();
+    ASSERT(mail->mailHdr.length <= MAX_MAIL_SIZE);
+    return mail;
+}
+
 /// Interrupt handler, called when a packet arrives from the network.
 ///
 /// Signal the PostalDelivery routine that it is time to get to work!
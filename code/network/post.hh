@@ -29,6 +29,9 @@
 
 #include "network.hh"
 #include "threads/synch_list.hh"
+#include "lib/pool.hh"
+
+#include <stddef.h>
 
 
 /// Mailbox address -- uniquely identifies a mailbox on a given machine.
@@ -46,12 +49,36 @@ public:
     MailBoxAddress from; ///< Mail box to reply to.
     unsigned length;     ///< Bytes of message data (excluding the mail
     ///< header).
+
+    /// Sliding-window fields, used by `PostOffice::SendWindowed`.  Plain
+    /// `Send` traffic leaves them zero and bypasses the window logic.
+    unsigned seq   = 0; ///< Sequence number of this data packet.
+    unsigned ack   = 0; ///< Cumulative acknowledgement: everything below
+                        ///< it has arrived (valid when `MH_ACK` is set).
+    unsigned flags = 0; ///< Mask of `MH_DATA`/`MH_ACK`, or zero.
 };
 
+/// Values for `MailHeader::flags`.
+const unsigned MH_DATA = 1; ///< Sequenced payload; expects an ack.
+const unsigned MH_ACK  = 2; ///< `ack` acknowledges everything below it.
+                            ///< Set alone (a bare ack) or together with
+                            ///< `MH_DATA` (piggybacked on reverse data).
+const unsigned MH_MORE = 4; ///< More fragments of this message follow.
+
 /// Maximum “payload” -- real data -- that can included in a single message.
-/// Excluding the `MailHeader` and the `PacketHeader`.
+/// Excluding the `MailHeader` and the `PacketHeader`.  This is the
+/// ceiling at the largest supported wire size; it sizes the buffers.
 const unsigned MAX_MAIL_SIZE = MAX_PACKET_SIZE - sizeof(MailHeader);
 
+/// Largest payload of one message at the current MTU (cf. `WIRE_SIZE`):
+/// what a single send may carry, and the fragment size `SendMessage`
+/// cuts large payloads into.
+inline unsigned
+MailSize()
+{
+    return PacketSize() - sizeof(MailHeader);
+}
+
 /// The following class defines the format of an incoming/outgoing `Mail`
 /// message.
 ///
@@ -65,6 +92,27 @@ public:
     /// Initialize a mail message by concatenating the headers to the data.
     Mail(PacketHeader pktH, MailHeader mailH, const char * msgData);
 
+    /// Uninitialized mail: headers and data are filled in place by the
+    /// caller (e.g. by receiving a packet straight into the message).
+    Mail()
+    {
+    }
+
+    /// One `Mail` is created per delivered packet, so they are recycled
+    /// through the small-object pool.
+
+    static void *
+    operator new(size_t size)
+    {
+        return PoolAlloc(size);
+    }
+
+    static void
+    operator delete(void * ptr, size_t size)
+    {
+        PoolFree(ptr, size);
+    }
+
     PacketHeader pktHdr;      ///< Header appended by `Network`.
     MailHeader mailHdr;       ///< Header appended by `PostOffice`.
     char data[MAX_MAIL_SIZE]; ///< Payload -- message data.
@@ -89,15 +137,37 @@ public:
     void
     Put(PacketHeader pktHdr, MailHeader mailHdr, const char * data);
 
+    /// Atomically put a message into the mailbox, taking ownership of
+    /// `mail`: the buffer travels to the receiver without being copied.
+    void
+    Put(Mail * mail);
+
     /// Atomically get a message out of the mailbox (and wait if there is no
     /// message to get!).
     void
     Get(PacketHeader * pktHdr, MailHeader * mailHdr, char * data);
 
+    /// Atomically take the next message out of the mailbox, waiting if
+    /// there is none.  The caller owns (and must `delete`) the result.
+    Mail *
+    GetMail();
+
+    /// Is the mailbox at its bound?  The post office then pushes back on
+    /// the sender instead of queueing without limit.
+    bool
+    Full() const;
+
 private:
 
+    /// Bound on messages queued in one box: a receiver that stops
+    /// draining its box stops its senders, instead of eating memory.
+    static const unsigned MAX_MESSAGES = 32;
+
     /// A mailbox is just a list of arrived messages.
     SynchList < Mail * > *messages;
+
+    /// Messages currently queued.
+    unsigned count;
 };
 
 /// The following class defines a “post office”, or a collection of
@@ -128,6 +198,33 @@ public:
     void
     Send(PacketHeader pktHdr, MailHeader mailHdr, const char * data);
 
+    /// Like `Send`, but through a per-peer sliding window: the call
+    /// returns as soon as the packet is in the window, so several
+    /// packets pipeline in flight, and lost ones are retransmitted until
+    /// a cumulative ack from the receiver covers them.  Blocks only when
+    /// the window to that machine is full.
+    void
+    SendWindowed(PacketHeader pktHdr, MailHeader mailHdr, const char * data);
+
+    /// Send a message of arbitrary size in one logical operation:
+    /// payloads over `MAX_MAIL_SIZE` are split into fragments that
+    /// pipeline under the sliding window, and `ReceiveMessage` on the
+    /// other side reassembles them.  `mailHdr.length` is ignored;
+    /// `length` is the size of `data`.
+    void
+    SendMessage(PacketHeader pktHdr, MailHeader mailHdr, const char * data,
+      unsigned length);
+
+    /// Counterpart of `SendMessage`: collect fragments from `box` until
+    /// the message is complete, copying at most `maxLength` bytes into
+    /// `data`.  Returns the full message length (even if truncated).
+    ///
+    /// Fragments from different senders must not interleave in one box:
+    /// use a box per large-message peer.
+    unsigned
+    ReceiveMessage(int box, PacketHeader * pktHdr, MailHeader * mailHdr,
+      char * data, unsigned maxLength);
+
     // Retrieve a message from `box`.
     //
     // Wait if there is no message in the box.
@@ -135,6 +232,12 @@ public:
     Receive(int box, PacketHeader * pktHdr,
       MailHeader * mailHdr, char * data);
 
+    /// Retrieve the next message from `box` without copying it out: the
+    /// returned `Mail` is the very buffer the packet was received into,
+    /// and the caller owns (and must `delete`) it.
+    Mail *
+    ReceiveMail(int box);
+
     // Wait for incoming messages, and then put them in the correct mailbox.
     void
     PostalDelivery();
@@ -149,8 +252,57 @@ public:
     void
     IncomingPacket();
 
+    /// Retransmit worker: waits for the retransmit timer and resends
+    /// every packet still waiting for an ack.
+    void
+    RetransmitDelivery();
+
+    /// Ack worker: when the delayed-ack timeout fires, sends a bare ack
+    /// to every peer still owed one -- that is, to peers whose data got
+    /// no reverse-direction packet to piggyback the ack on.
+    void
+    AckDelivery();
+
+    /// Timer-wheel handler for the delayed-ack timeout; wakes up the ack
+    /// worker.
+    void
+    AckTimeout();
+
+    /// Interrupt handler, called when the retransmit timer expires; wakes
+    /// up the retransmit worker.
+    void
+    RetransmitTimeout();
+
 private:
 
+    /// Packets that may be in flight at once towards a single machine,
+    /// and how many peer machines we keep window state for.
+    static const unsigned SEND_WINDOW = 8;
+    static const unsigned MAX_LINKS   = 16;
+
+    /// Sliding-window state for one remote machine: the unacknowledged
+    /// copies kept for retransmission, the sequence counters on the send
+    /// side, and the next in-order sequence expected on the receive side.
+    struct Link {
+        NetworkAddress peer;
+        bool inUse;
+        unsigned nextSeq;  ///< Next sequence number to stamp.
+        unsigned sendBase; ///< Oldest unacknowledged sequence.
+        Mail * pending[SEND_WINDOW]; ///< Unacked copies, `seq % SEND_WINDOW`.
+        Semaphore * space; ///< Free slots in the window.
+        unsigned expected; ///< Next in-order sequence from this peer.
+        bool ackOwed;      ///< The peer is owed a cumulative ack; it
+                           ///< rides on the next data packet to it, or
+                           ///< goes bare on the delayed-ack timeout.
+        MailBoxAddress ackBox;  ///< Mailbox addressing for a bare ack,
+        MailBoxAddress ackFrom; ///< taken from the peer's last data.
+    };
+
+    /// Find (or set up) the window state for `peer`.  Call with
+    /// `windowLock` held.
+    Link *
+    GetLink(NetworkAddress peer);
+
     /// Physical network connection.
     Network * network;
 
@@ -171,6 +323,25 @@ private:
 
     // Only one outgoing message at a time.
     Lock * sendLock;
+
+    // Guards the sliding-window state below.
+    Lock * windowLock;
+
+    // Per-peer sliding windows.
+    Link links[MAX_LINKS];
+
+    // `V`'ed by the retransmit timer interrupt; `P`'ed by the retransmit
+    // worker thread.
+    Semaphore * retransmitGo;
+
+    // `V`'ed by the delayed-ack timeout; `P`'ed by the ack worker.
+    Semaphore * ackGo;
+
+    // Is a retransmit timeout already scheduled?
+    bool timerSet;
+
+    // Is a delayed-ack timeout already scheduled?
+    bool ackTimerSet;
 };
 
 
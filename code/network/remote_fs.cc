@@ -0,0 +1,316 @@
+/// A remote file service on top of the RPC layer.
+///
+/// The server side keeps a small table of files it opened on behalf of
+/// remote clients; the handle it returns from `RFS_OPEN` is an index
+/// into that table, and the other operations take it as their first
+/// argument.  The client side wraps the handles in `RemoteFile` objects
+/// and caches clean sectors locally, so only the first read of a region
+/// pays the network round trip.
+
+
+#include "remote_fs.hh"
+#include "filesys/file_system.hh"
+#include "threads/system.hh"
+
+
+/// Argument layout of the read and write calls; for writes, the data to
+/// write follows the structure.
+struct RangeArgs {
+    int handle;
+    unsigned numBytes;
+    unsigned position;
+};
+
+
+/// Server side.
+
+static const unsigned MAX_REMOTE_OPEN = 16;
+
+/// Files opened on behalf of remote clients, indexed by handle.
+static OpenFile * remoteOpen[MAX_REMOTE_OPEN];
+
+static OpenFile *
+RemoteFileFor(const char * args, unsigned argLen, RangeArgs * out)
+{
+    if (argLen < sizeof(RangeArgs))
+        return nullptr;
+
+    *out = *(const RangeArgs *) args;
+    if (out->handle < 0 || (unsigned) out->handle >= MAX_REMOTE_OPEN)
+        return nullptr;
+
+    return remoteOpen[out->handle];
+}
+
+static int
+HandleOpen(const char * args, unsigned argLen,
+  char * reply, unsigned maxLen, unsigned * replyLen)
+{
+    if (argLen == 0 || args[argLen - 1] != '\0')
+        return -1; // The argument must be a terminated file name.
+
+    unsigned handle;
+
+    for (handle = 0; handle < MAX_REMOTE_OPEN; handle++)
+        if (remoteOpen[handle] == nullptr)
+            break;
+
+    if (handle == MAX_REMOTE_OPEN) {
+        DEBUG('n', "File server: no free handles for `%s`\n", args);
+        return -1;
+    }
+
+    OpenFile * file = fileSystem->Open(args);
+    if (file == nullptr) {
+        DEBUG('n', "File server: cannot open `%s`\n", args);
+        return -1;
+    }
+
+    remoteOpen[handle] = file;
+    DEBUG('n', "File server: `%s` opened as handle %u\n", args, handle);
+    return handle;
+}
+
+static int
+HandleClose(const char * args, unsigned argLen,
+  char * reply, unsigned maxLen, unsigned * replyLen)
+{
+    RangeArgs range;
+
+    OpenFile * file = RemoteFileFor(args, argLen, &range);
+    if (file == nullptr)
+        return -1;
+
+    delete file;
+    remoteOpen[range.handle] = nullptr;
+    return 0;
+}
+
+static int
+HandleReadAt(const char * args, unsigned argLen,
+  char * reply, unsigned maxLen, unsigned * replyLen)
+{
+    RangeArgs range;
+
+    OpenFile * file = RemoteFileFor(args, argLen, &range);
+    if (file == nullptr)
+        return -1;
+
+    unsigned n = range.numBytes;
+    if (n > maxLen)
+        n = maxLen;
+    if (n == 0)
+        return 0;
+
+    int count = file->ReadAt(reply, n, range.position);
+    if (count > 0)
+        *replyLen = count;
+    return count;
+}
+
+static int
+HandleWriteAt(const char * args, unsigned argLen,
+  char * reply, unsigned maxLen, unsigned * replyLen)
+{
+    RangeArgs range;
+
+    OpenFile * file = RemoteFileFor(args, argLen, &range);
+    if (file == nullptr)
+        return -1;
+
+    if (argLen < sizeof(RangeArgs) + range.numBytes)
+        return -1; // Less data than announced.
+
+    if (range.numBytes == 0)
+        return 0;
+
+    return file->WriteAt(args + sizeof(RangeArgs), range.numBytes,
+             range.position);
+}
+
+static void
+FileServerLoop(void * arg)
+{
+    ASSERT(arg != nullptr);
+    RpcServer * server = (RpcServer *) arg;
+    server->Run();
+}
+
+void
+StartFileServer(PostOffice * post, int requestBox)
+{
+    ASSERT(post != nullptr);
+
+    RpcServer * server = new RpcServer(post, requestBox);
+
+    server->RegisterHandler(RFS_OPEN, HandleOpen);
+    server->RegisterHandler(RFS_CLOSE, HandleClose);
+    server->RegisterHandler(RFS_READ_AT, HandleReadAt);
+    server->RegisterHandler(RFS_WRITE_AT, HandleWriteAt);
+
+    Thread * t = new Thread("file server");
+
+    t->Fork(FileServerLoop, server);
+}
+
+
+/// Client side.
+
+RemoteFileSystem::RemoteFileSystem(PostOffice * post,
+  NetworkAddress serverAddr, int serverBox, int replyBox)
+{
+    rpc = new RpcClient(post, serverAddr, serverBox, replyBox);
+}
+
+RemoteFileSystem::~RemoteFileSystem()
+{
+    delete rpc;
+}
+
+RemoteFile *
+RemoteFileSystem::Open(const char * name)
+{
+    ASSERT(name != nullptr);
+
+    int handle = rpc->Call(RFS_OPEN, name, strlen(name) + 1,
+        nullptr, 0, nullptr);
+
+    if (handle < 0)
+        return nullptr;
+
+    return new RemoteFile(this, handle);
+}
+
+RemoteFile::RemoteFile(RemoteFileSystem * _fs, int _handle)
+{
+    fs     = _fs;
+    handle = _handle;
+    for (unsigned i = 0; i < CACHE_SECTORS; i++)
+        cache[i].valid = false;
+}
+
+RemoteFile::~RemoteFile()
+{
+    RangeArgs args = { handle, 0, 0 };
+
+    fs->rpc->Call(RFS_CLOSE, (const char *) &args, sizeof args,
+      nullptr, 0, nullptr);
+}
+
+/// Drop every cached sector overlapping the given byte range.
+void
+RemoteFile::InvalidateRange(unsigned position, unsigned numBytes)
+{
+    unsigned first = position / SECTOR_SIZE;
+    unsigned last  = (position + numBytes - 1) / SECTOR_SIZE;
+
+    for (unsigned s = first; s <= last; s++) {
+        CachedSector * c = &cache[s % CACHE_SECTORS];
+        if (c->valid && c->sector == s)
+            c->valid = false;
+    }
+}
+
+int
+RemoteFile::ReadAt(char * into, unsigned numBytes, unsigned position)
+{
+    ASSERT(into != nullptr);
+    ASSERT(numBytes > 0);
+
+    // If every sector the range touches is cached, serve it locally.
+    unsigned first  = position / SECTOR_SIZE;
+    unsigned last   = (position + numBytes - 1) / SECTOR_SIZE;
+    bool allCached = true;
+
+    for (unsigned s = first; s <= last && allCached; s++) {
+        CachedSector * c = &cache[s % CACHE_SECTORS];
+        allCached = c->valid && c->sector == s;
+    }
+
+    if (allCached) {
+        for (unsigned s = first; s <= last; s++) {
+            CachedSector * c = &cache[s % CACHE_SECTORS];
+            unsigned begin = s == first ? position % SECTOR_SIZE : 0;
+            unsigned end   = s == last
+              ? (position + numBytes - 1) % SECTOR_SIZE + 1 : SECTOR_SIZE;
+            memmove(into + (s * SECTOR_SIZE + begin - position),
+              c->data + begin, end - begin);
+        }
+        DEBUG('n', "Remote read served from cache, %u bytes at %u\n",
+          numBytes, position);
+        return numBytes;
+    }
+
+    // Otherwise fetch the whole range from the server, a chunk of
+    // `MAX_RPC_DATA` per call.
+    unsigned got = 0;
+
+    while (got < numBytes) {
+        unsigned chunk = numBytes - got;
+        if (chunk > MAX_RPC_DATA)
+            chunk = MAX_RPC_DATA;
+
+        RangeArgs args = { handle, chunk, position + got };
+        unsigned replyLen = 0;
+        int count = fs->rpc->Call(RFS_READ_AT, (const char *) &args,
+            sizeof args, into + got, chunk, &replyLen);
+
+        if (count < 0)
+            return got > 0 ? (int) got : count;
+        got += count;
+        if ((unsigned) count < chunk)
+            break; // End of file on the server.
+    }
+
+    // Remember the clean sectors the reply fully covers.
+    for (unsigned s = first; s <= last; s++) {
+        if (s * SECTOR_SIZE < position
+          || (s + 1) * SECTOR_SIZE > position + got)
+            continue; // Only whole sectors enter the cache.
+        CachedSector * c = &cache[s % CACHE_SECTORS];
+        c->sector = s;
+        c->valid  = true;
+        memmove(c->data, into + (s * SECTOR_SIZE - position), SECTOR_SIZE);
+    }
+    return got;
+}
+
+int
+RemoteFile::WriteAt(const char * from, unsigned numBytes, unsigned position)
+{
+    ASSERT(from != nullptr);
+    ASSERT(numBytes > 0);
+
+    // The cache only ever holds clean data: anything this write touches
+    // is dropped and will be re-fetched on the next read.
+    InvalidateRange(position, numBytes);
+
+    char * buffer = new char [sizeof(RangeArgs) + MAX_RPC_DATA];
+    unsigned put  = 0;
+
+    while (put < numBytes) {
+        unsigned chunk = numBytes - put;
+        if (chunk > MAX_RPC_DATA - sizeof(RangeArgs))
+            chunk = MAX_RPC_DATA - sizeof(RangeArgs);
+
+        RangeArgs * args = (RangeArgs *) buffer;
+        args->handle   = handle;
+        args->numBytes = chunk;
+        args->position = position + put;
+        memmove(buffer + sizeof(RangeArgs), from + put, chunk);
+
+        int count = fs->rpc->Call(RFS_WRITE_AT, buffer,
+            sizeof(RangeArgs) + chunk, nullptr, 0, nullptr);
+
+        if (count < 0) {
+            delete [] buffer;
+            return put > 0 ? (int) put : count;
+        }
+        put += count;
+        if ((unsigned) count < chunk)
+            break; // The server could not take more (disk full?).
+    }
+
+    delete [] buffer;
+    return put;
+}
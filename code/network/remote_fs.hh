@@ -0,0 +1,97 @@
+/// A remote file service on top of the RPC layer.
+///
+/// One machine runs the server (`StartFileServer`), which exposes its
+/// local `FileSystem` -- open, read, write, close -- to the other
+/// Nachos instances.  Clients go through `RemoteFileSystem`, whose
+/// `Open` hands out `RemoteFile` objects with the same `ReadAt`/
+/// `WriteAt` interface as a local `OpenFile`.
+///
+/// Each `RemoteFile` keeps a small cache of clean sectors: repeated
+/// reads of the same region are served from memory instead of paying a
+/// full simulated network round trip, and writes invalidate whatever
+/// they overlap so the cache never holds stale data.
+
+#ifndef NACHOS_NETWORK_REMOTEFS__HH
+#define NACHOS_NETWORK_REMOTEFS__HH
+
+
+#include "rpc.hh"
+#include "machine/disk.hh"
+
+
+/// Operation codes of the file service.
+
+const int RFS_OPEN     = 0;
+const int RFS_CLOSE    = 1;
+const int RFS_READ_AT  = 2;
+const int RFS_WRITE_AT = 3;
+
+/// Start serving this machine's file system to the network: forks a
+/// thread that answers file RPCs arriving at `requestBox`.
+void
+StartFileServer(PostOffice * post, int requestBox);
+
+class RemoteFile;
+
+/// Client side of the file service; one per server machine.
+class RemoteFileSystem {
+public:
+
+    /// * `serverAddr`/`serverBox` locate the file server.
+    /// * `replyBox` is a local mailbox owned by this client.
+    RemoteFileSystem(PostOffice * post, NetworkAddress serverAddr,
+      int serverBox, int replyBox);
+
+    ~RemoteFileSystem();
+
+    /// Open the file `name` on the server.  Returns null on failure.
+    RemoteFile *
+    Open(const char * name);
+
+private:
+
+    friend class RemoteFile;
+
+    RpcClient * rpc;
+};
+
+/// An open file living on the server, with the `OpenFile` read/write
+/// interface.  Delete it to close the remote file.
+class RemoteFile {
+public:
+
+    ~RemoteFile();
+
+    int
+    ReadAt(char * into, unsigned numBytes, unsigned position);
+
+    int
+    WriteAt(const char * from, unsigned numBytes, unsigned position);
+
+private:
+
+    friend class RemoteFileSystem;
+
+    RemoteFile(RemoteFileSystem * fs, int handle);
+
+    /// Clean sectors cached from previous reads, direct-mapped by
+    /// sector number.
+    static const unsigned CACHE_SECTORS = 16;
+
+    struct CachedSector {
+        unsigned sector;
+        bool     valid;
+        char     data[SECTOR_SIZE];
+    };
+
+    /// Drop every cached sector overlapping the given byte range.
+    void
+    InvalidateRange(unsigned position, unsigned numBytes);
+
+    RemoteFileSystem * fs;
+    int handle;
+    CachedSector cache[CACHE_SECTORS];
+};
+
+
+#endif /* ifndef NACHOS_NETWORK_REMOTEFS__HH */
@@ -0,0 +1,138 @@
+/// Remote procedure calls over the post office.
+///
+/// The client stamps each request with a fresh transaction id and waits
+/// on its private reply box; responses whose id does not match the
+/// outstanding call are stale duplicates and are dropped.  The server
+/// loops on its request box, looks the operation up in its handler
+/// table and sends the handler's results back to the box named in the
+/// request's `from` field.
+
+
+#include "rpc.hh"
+
+
+RpcClient::RpcClient(PostOffice * _post, NetworkAddress _serverAddr,
+  int _serverBox, int _replyBox)
+{
+    ASSERT(_post != nullptr);
+
+    post       = _post;
+    serverAddr = _serverAddr;
+    serverBox  = _serverBox;
+    replyBox   = _replyBox;
+    nextXid    = 0;
+}
+
+int
+RpcClient::Call(int op, const char * args, unsigned argLen,
+  char * reply, unsigned maxReplyLen, unsigned * replyLen)
+{
+    ASSERT(argLen <= MAX_RPC_DATA);
+    ASSERT(args != nullptr || argLen == 0);
+
+    char * buffer = new char [sizeof(RpcHeader) + MAX_RPC_DATA];
+    RpcHeader * hdr = (RpcHeader *) buffer;
+
+    hdr->op     = op;
+    hdr->xid    = nextXid++;
+    hdr->status = 0;
+    if (argLen > 0)
+        memmove(buffer + sizeof(RpcHeader), args, argLen);
+
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    pktHdr.to    = serverAddr;
+    mailHdr.to   = serverBox;
+    mailHdr.from = replyBox;
+    post->SendMessage(pktHdr, mailHdr, buffer, sizeof(RpcHeader) + argLen);
+
+    // Wait for the response that matches this call; anything else in
+    // the box is a stale duplicate from a retransmission.
+    int status;
+    for (;;) {
+        PacketHeader inPktHdr;
+        MailHeader inMailHdr;
+        unsigned total = post->ReceiveMessage(replyBox, &inPktHdr,
+            &inMailHdr, buffer, sizeof(RpcHeader) + MAX_RPC_DATA);
+
+        ASSERT(total >= sizeof(RpcHeader));
+        if (hdr->xid != nextXid - 1) {
+            DEBUG('n', "Dropping stale RPC response, xid %u\n", hdr->xid);
+            continue;
+        }
+
+        status = hdr->status;
+        unsigned n = total - sizeof(RpcHeader);
+        if (n > maxReplyLen)
+            n = maxReplyLen;
+        if (n > 0 && reply != nullptr)
+            memmove(reply, buffer + sizeof(RpcHeader), n);
+        if (replyLen != nullptr)
+            *replyLen = n;
+        break;
+    }
+
+    delete [] buffer;
+    return status;
+}
+
+RpcServer::RpcServer(PostOffice * _post, int _requestBox)
+{
+    ASSERT(_post != nullptr);
+
+    post       = _post;
+    requestBox = _requestBox;
+    for (unsigned i = 0; i < MAX_RPC_OPS; i++)
+        handlers[i] = nullptr;
+}
+
+void
+RpcServer::RegisterHandler(int op, RpcHandlerFn handler)
+{
+    ASSERT(op >= 0 && (unsigned) op < MAX_RPC_OPS);
+    ASSERT(handler != nullptr);
+
+    handlers[op] = handler;
+}
+
+void
+RpcServer::Run()
+{
+    char * request = new char [sizeof(RpcHeader) + MAX_RPC_DATA];
+    char * reply   = new char [sizeof(RpcHeader) + MAX_RPC_DATA];
+
+    for (;;) {
+        PacketHeader pktHdr;
+        MailHeader mailHdr;
+        unsigned total = post->ReceiveMessage(requestBox, &pktHdr,
+            &mailHdr, request, sizeof(RpcHeader) + MAX_RPC_DATA);
+
+        ASSERT(total >= sizeof(RpcHeader));
+
+        RpcHeader * reqHdr = (RpcHeader *) request;
+        RpcHeader * repHdr = (RpcHeader *) reply;
+        unsigned replyLen  = 0;
+
+        repHdr->op  = reqHdr->op;
+        repHdr->xid = reqHdr->xid;
+        if (reqHdr->op >= 0 && (unsigned) reqHdr->op < MAX_RPC_OPS
+          && handlers[reqHdr->op] != nullptr)
+        {
+            repHdr->status = handlers[reqHdr->op](
+                request + sizeof(RpcHeader), total - sizeof(RpcHeader),
+                reply + sizeof(RpcHeader), MAX_RPC_DATA, &replyLen);
+        } else {
+            DEBUG('n', "Unknown RPC operation %d\n", reqHdr->op);
+            repHdr->status = -1;
+        }
+
+        // Send the response back to the caller's reply box.
+        PacketHeader outPktHdr;
+        MailHeader outMailHdr;
+        outPktHdr.to   = pktHdr.from;
+        outMailHdr.to  = mailHdr.from;
+        outMailHdr.from = requestBox;
+        post->SendMessage(outPktHdr, outMailHdr, reply,
+          sizeof(RpcHeader) + replyLen);
+    }
+}
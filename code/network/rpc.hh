@@ -0,0 +1,92 @@
+/// Remote procedure calls over the post office.
+///
+/// A call is a request message sent to a well-known mailbox on the
+/// server machine, answered by a response message to a reply box owned
+/// by the caller.  Requests and responses carry a transaction id so a
+/// late duplicate response (the window layer may retransmit) is never
+/// matched to the wrong call, plus an operation code that the server
+/// uses to dispatch into a handler table, in the style of the syscall
+/// dispatch table in `userprog/exception.cc`.
+///
+/// Messages ride on `SendMessage`/`ReceiveMessage`, so arguments and
+/// results larger than one packet are fragmented transparently and
+/// pipeline under the sliding window.
+
+#ifndef NACHOS_NETWORK_RPC__HH
+#define NACHOS_NETWORK_RPC__HH
+
+
+#include "post.hh"
+
+
+/// Every RPC message starts with this header; the operation's arguments
+/// or results follow it.
+struct RpcHeader {
+    int op;        ///< Operation code (server-defined).
+    unsigned xid;  ///< Transaction id, echoed in the response.
+    int status;    ///< Result of the call; meaningless in requests.
+};
+
+/// Largest argument/result payload of a single call, header excluded.
+const unsigned MAX_RPC_DATA = 4096;
+
+/// A handler fills `reply` (at most `maxLen` bytes) from `args` and
+/// returns the call's status; a negative status reports failure.  The
+/// number of reply bytes is returned through `replyLen`.
+typedef int (* RpcHandlerFn)(const char * args, unsigned argLen,
+  char * reply, unsigned maxLen, unsigned * replyLen);
+
+/// Client side: issue calls against one server machine.
+class RpcClient {
+public:
+
+    /// * `serverAddr`/`serverBox` locate the server's request mailbox.
+    /// * `replyBox` is a mailbox on this machine owned by this client;
+    ///   two clients must not share one.
+    RpcClient(PostOffice * post, NetworkAddress serverAddr,
+      int serverBox, int replyBox);
+
+    /// Perform one call: send `args` and block until the matching
+    /// response arrives.  At most `maxReplyLen` bytes of results are
+    /// copied into `reply` (`replyLen` gets the actual count).  Returns
+    /// the status reported by the server's handler.
+    int
+    Call(int op, const char * args, unsigned argLen,
+      char * reply, unsigned maxReplyLen, unsigned * replyLen);
+
+private:
+
+    PostOffice * post;
+    NetworkAddress serverAddr;
+    int serverBox;
+    int replyBox;
+    unsigned nextXid;
+};
+
+/// Server side: dispatch incoming calls to registered handlers.
+class RpcServer {
+public:
+
+    /// Serve calls arriving at `requestBox` on this machine.
+    RpcServer(PostOffice * post, int requestBox);
+
+    /// Register the handler for operation code `op`.
+    void
+    RegisterHandler(int op, RpcHandlerFn handler);
+
+    /// Serve requests forever; meant to run in its own thread.
+    void
+    Run();
+
+private:
+
+    /// Operation codes are small integers indexing this table.
+    static const unsigned MAX_RPC_OPS = 16;
+
+    PostOffice * post;
+    int requestBox;
+    RpcHandlerFn handlers[MAX_RPC_OPS];
+};
+
+
+#endif /* ifndef NACHOS_NETWORK_RPC__HH */
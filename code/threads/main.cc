@@ -11,19 +11,29 @@
 /// =====
 ///
 ///     nachos [-d <debugflags>] [-p] [-rs <random seed #>] [-z]
-///            [-s] [-x <nachos file>] [-tc <consoleIn> <consoleOut>]
+///            [-hprof] [-tq <interactive quantum> <batch quantum>]
+///            [-s] [-x <nachos file>] [-restore <checkpoint file>]
+///            [-tc <consoleIn> <consoleOut>]
 ///            [-f] [-cp <unix file> <nachos file>] [-pr <nachos file>]
 ///            [-rm <nachos file>] [-ls] [-D] [-tf]
 ///            [-n <network reliability>] [-id <machine id>]
-///            [-tn <other machine id>]
+///            [-mtu <bytes>] [-tn <other machine id>]
 ///
 /// General options
 /// ---------------
 ///
 /// * `-d`  -- causes certain debugging messages to be printed (cf.
 ///   `utility.hh`).
+/// * `-dt` -- sends debug messages to an in-memory ring buffer that is
+///   dumped on halt, instead of printing them as they happen.
+/// * `-hprof` -- profiles the simulator itself on the host clock and
+///   prints a per-subsystem breakdown of real time at halt.
 /// * `-p`  -- enables preemptive multitasking for kernel threads.
 /// * `-rs` -- causes `Yield` to occur at random (but repeatable) spots.
+/// * `-tbench` -- runs the threads microbenchmark suite (cf.
+///   `threads/thread_bench.cc`) and halts.
+/// * `-tq` -- sets the preemption quanta, in timer ticks, for the highest
+///   and lowest priority levels; the levels in between interpolate.
 /// * `-z`  -- prints version and copyright information, and exits.
 ///
 /// *USER_PROGRAM* options
@@ -31,6 +41,8 @@
 ///
 /// * `-s`  -- causes user programs to be executed in single-step mode.
 /// * `-x`  -- runs a user program.
+/// * `-restore` -- resumes a user program from a checkpoint file written
+///   by the `Checkpoint` system call.
 /// * `-tc` -- tests the console.
 ///
 /// *FILESYS* options
@@ -40,15 +52,25 @@
 /// * `-cp` -- copies a file from UNIX to Nachos.
 /// * `-pr` -- prints a Nachos file to standard output.
 /// * `-rm` -- removes a Nachos file from the file system.
+/// * `-ln` -- makes a hard link to a Nachos file.
+/// * `-mv` -- renames a Nachos file or directory.
 /// * `-ls` -- lists the contents of the Nachos directory.
 /// * `-D`  -- prints the contents of the entire file system.
 /// * `-tf` -- tests the performance of the Nachos file system.
+/// * `-bench` -- runs the file system benchmark suite (cf.
+///   `filesys/fs_bench.cc`).
+/// * `-dtc` -- captures a disk access trace (cf. `filesys/disk_trace.cc`).
+/// * `-dtr` -- replays a disk access trace; clobbers data, use a
+///   throwaway copy of `DISK`.
+/// * `-fsck` -- checks the consistency of the file system.
 ///
 /// *NETWORK* options
 /// -----------------
 ///
 /// * `-n`  -- sets the network reliability.
 /// * `-id` -- sets this machine's host id (needed for the network).
+/// * `-mtu` -- sets the network device MTU (wire size in bytes, up to
+///   512); co-operating nodes must use the same value.
 /// * `-tn` -- runs a simple test of the Nachos network software.
 ///
 /// ----
@@ -97,17 +119,31 @@
 void
 ThreadTest();
 void
+ThreadBench();
+void
 Copy(const char * unixFile, const char * nachosFile);
 void
 Print(const char * file);
 void
 PerformanceTest(void);
 void
+FilesystemBench(void);
+void
+DiskTraceCapture(const char * name);
+void
+DiskTraceReplay(const char * name);
+void
 StartProcess(const char * file);
 void
+RestoreProcess(const char * file);
+void
 ConsoleTest(const char * in, const char * out);
 void
 MailTest(int networkID);
+void
+NetBench(int farAddr, int msgSize, int msgCount);
+void
+NetBenchServer();
 
 static inline void
 PrintVersion()
@@ -141,11 +177,21 @@ main(int argc, char ** argv)
             PrintVersion();
             return 0;
         }
+        if (!strcmp(*argv, "-tbench")) { // Threads microbenchmark suite;
+                                         // runs instead of the demo.
+            ThreadBench();
+            currentThread->Finish();
+        }
         #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-x")) { // Run a user program.
             ASSERT(argc > 1);
             StartProcess(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-restore")) { // Resume from a
+                                                 // checkpoint.
+            ASSERT(argc > 1);
+            RestoreProcess(*(argv + 1));
+            argCount = 2;
         } else if (!strcmp(*argv, "-tc")) { // Test the console.
             if (argc == 1) {
                 ConsoleTest(nullptr, nullptr);
@@ -173,6 +219,14 @@ main(int argc, char ** argv)
             ASSERT(argc > 1);
             fileSystem->Remove(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-ln")) { // Hard-link a Nachos file.
+            ASSERT(argc > 2);
+            fileSystem->Link(*(argv + 1), *(argv + 2));
+            argCount = 3;
+        } else if (!strcmp(*argv, "-mv")) { // Rename a Nachos file.
+            ASSERT(argc > 2);
+            fileSystem->Rename(*(argv + 1), *(argv + 2));
+            argCount = 3;
         } else if (!strcmp(*argv, "-ls")) { // List Nachos directory.
             if (argc > 1) {
                 fileSystem->List(*(argv + 1));
@@ -186,6 +240,19 @@ main(int argc, char ** argv)
             printf("\n");
         } else if (!strcmp(*argv, "-tf")) { // Performance test.
             PerformanceTest();
+        } else if (!strcmp(*argv, "-bench")) { // Benchmark suite.
+            FilesystemBench();
+        } else if (!strcmp(*argv, "-dtc")) { // Capture a disk trace.
+            ASSERT(argc > 1);
+            DiskTraceCapture(*(argv + 1));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-dtr")) { // Replay a disk trace.
+            ASSERT(argc > 1);
+            DiskTraceReplay(*(argv + 1));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-fsck")) { // Check the filesystem.
+            fileSystem->Check();
+            printf("\n");
         } else if (!strcmp(*argv, "-mkd")) { // Crea un directorio
             ASSERT(argc > 1);
             fileSystem->MakeDir(*(argv + 1));
@@ -206,6 +273,17 @@ main(int argc, char ** argv)
                       // up another nachos.
             MailTest(atoi(*(argv + 1)));
             argCount = 2;
+        } else if (!strcmp(*argv, "-nb")) {
+            // Network benchmark, initiator side:
+            //     -nb <farAddr> <msgSize> <msgCount>
+            ASSERT(argc > 3);
+            Delay(2); // Give the user time to start the responder.
+            NetBench(atoi(*(argv + 1)), atoi(*(argv + 2)),
+              atoi(*(argv + 3)));
+            argCount = 4;
+        } else if (!strcmp(*argv, "-nbs")) {
+            // Network benchmark, responder side (echo loop).
+            NetBenchServer();
         }
         #endif // NETWORK
     }
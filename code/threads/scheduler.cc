@@ -25,15 +25,30 @@
 /// Initialize the list of ready but not running threads to empty.
 Scheduler::Scheduler()
 {
-    for (int i = 0; i < 3; i++) {
-        readyList[i] = new List<Thread *>;
+    for (unsigned i = 0; i < NUM_PRIORITY_LEVELS; i++) {
+        readyList[i] = new IntrusiveList<Thread *>;
     }
+    readyMask = 0;
+    SetQuanta(1, 8); // Defaults; overridable at startup with `-tq`.
 }
 
 /// De-allocate the list of ready threads.
 Scheduler::~Scheduler()
 {
-    for (int i = 0; i < 3; i++) delete readyList[i];
+    for (unsigned i = 0; i < NUM_PRIORITY_LEVELS; i++) delete readyList[i];
+}
+
+/// Clamp a thread priority into a valid queue index.
+unsigned
+Scheduler::PriorityLevel(int priority)
+{
+    if (priority < 0) {
+        return 0;
+    }
+    if (priority >= (int) NUM_PRIORITY_LEVELS) {
+        return NUM_PRIORITY_LEVELS - 1;
+    }
+    return priority;
 }
 
 /// Mark a thread as ready, but not running.
@@ -51,13 +66,9 @@ Scheduler::ReadyToRun(Thread * thread)
       thread->GetName(), priority);
     thread->SetStatus(READY);
 
-    if (priority < 20) {
-        readyList[0]->SortedInsert(thread, priority);
-    } else if (priority == 20) {
-        readyList[1]->SortedInsert(thread, priority);
-    } else {
-        readyList[2]->SortedInsert(thread, priority);
-    }
+    unsigned level = PriorityLevel(priority);
+    readyList[level]->Append(thread);
+    readyMask |= 1u << level;
 }
 
 /// Return the next thread to be scheduled onto the CPU.
@@ -68,16 +79,102 @@ Scheduler::ReadyToRun(Thread * thread)
 Thread *
 Scheduler::FindNextToRun()
 {
-    for (int i = 2; i >= 0; i--) {
-        if (!readyList[i]->IsEmpty()) {
-            return readyList[i]->Pop();
+    if (readyMask == 0) {
+        DEBUG('H', "****No hay procesos para ejecutar****\n");
+        return NULL;
+    }
+
+    // Highest set bit = highest non-empty priority queue; no per-level
+    // probing regardless of how many levels exist.
+    unsigned level = 31 - __builtin_clz(readyMask);
+    Thread * thread = readyList[level]->Pop();
+    if (readyList[level]->IsEmpty()) {
+        readyMask &= ~(1u << level);
+    }
+    return thread;
+}
+
+/// Feedback step for a thread that burned a full timer quantum: CPU-bound
+/// work sinks below threads that block early.
+void
+Scheduler::QuantumExpired(Thread * thread)
+{
+    ASSERT(thread != nullptr);
+    thread->AdjustPriority(-1);
+}
+
+/// Give each priority level its own quantum, interpolating linearly from
+/// `interactive` timer ticks at the top level down to `batch` at level 0.
+/// Interactive threads float to the top levels (they block early and get
+/// boosted), so short quanta there keep console latency down; compute
+/// threads sink to the bottom, where long quanta cut switch overhead.
+void
+Scheduler::SetQuanta(unsigned interactive, unsigned batch)
+{
+    ASSERT(interactive > 0 && batch > 0);
+
+    const unsigned top = NUM_PRIORITY_LEVELS - 1;
+    for (unsigned level = 0; level <= top; level++) {
+        quantum[level] = batch
+          + ((int) interactive - (int) batch) * (int) level / (int) top;
+    }
+}
+
+/// Quantum, in timer ticks, for a thread of the given priority.
+unsigned
+Scheduler::QuantumFor(int priority) const
+{
+    return quantum[PriorityLevel(priority)];
+}
+
+/// Feedback step for a thread that blocked before its quantum ran out.
+void
+Scheduler::Boost(Thread * thread)
+{
+    ASSERT(thread != nullptr);
+    thread->AdjustPriority(1);
+}
+
+/// Lift every ready thread one level.  Called periodically from the timer
+/// interrupt handler; together with quantum demotions this keeps levels
+/// in a steady state while bounding how long anything can starve.
+void
+Scheduler::Age()
+{
+    for (int level = NUM_PRIORITY_LEVELS - 2; level >= 0; level--) {
+        if (readyList[level]->IsEmpty()) {
+            continue;
+        }
+        while (!readyList[level]->IsEmpty()) {
+            Thread * thread = readyList[level]->Pop();
+            thread->AdjustPriority(1);
+            readyList[level + 1]->Append(thread);
         }
+        readyMask = (readyMask & ~(1u << level)) | 1u << (level + 1);
     }
+}
 
+/// Change `thread`'s effective priority and, if it is sitting on a ready
+/// queue, move it to the queue of its new level.  Assumes interrupts are
+/// disabled.
+void
+Scheduler::Reprioritize(Thread * thread, int newPriority)
+{
+    ASSERT(thread != nullptr);
 
-    DEBUG('H', "****No hay procesos para ejecutar****\n");
+    unsigned oldLevel = PriorityLevel(thread->GetPriority());
+    unsigned newLevel = PriorityLevel(newPriority);
+    thread->SetPriority(newPriority);
+    if (thread->GetStatus() != READY || oldLevel == newLevel) {
+        return;
+    }
 
-    return NULL;
+    readyList[oldLevel]->Remove(thread);
+    if (readyList[oldLevel]->IsEmpty()) {
+        readyMask &= ~(1u << oldLevel);
+    }
+    readyList[newLevel]->Append(thread);
+    readyMask |= 1u << newLevel;
 }
 
 /// Dispatch the CPU to `nextThread`.
@@ -91,11 +188,25 @@ Scheduler::FindNextToRun()
 /// Side effect: the global variable `currentThread` becomes `nextThread`.
 ///
 /// * `nextThread` is the thread to be put into the CPU.
+
+/// Contador de cambios de contexto, para los snapshots de estadisticas.
+static Counter dispatches("scheduler.dispatches");
+
 void
 Scheduler::Run(Thread * nextThread)
 {
     ASSERT(nextThread != nullptr);
 
+    if (nextThread == currentThread) {
+        // Self-switch: the CPU already holds this thread's state, so the
+        // save/restore and the `SWITCH` round trip would be no-ops.
+        // Happens when a yielding thread turns out to be the best pick
+        // (everything else ready has lower priority).  Not a dispatch,
+        // so the counters are left alone.
+        nextThread->SetStatus(RUNNING);
+        return;
+    }
+
     Thread * oldThread = currentThread;
 
     #ifdef USER_PROGRAM // Ignore until running user programs.
@@ -106,8 +217,9 @@ Scheduler::Run(Thread * nextThread)
     }
     #endif
 
-    oldThread->CheckOverflow(); // Check if the old thread had an undetected
-                                // stack overflow.
+    oldThread->ChargeTicks();    // Account the slice that just ended,
+    nextThread->CountDispatch(); // and start the new thread's slice.
+    dispatches.Inc();
 
     currentThread = nextThread;        // Switch to the next thread.
     currentThread->SetStatus(RUNNING); // `nextThread` is now running.
@@ -154,13 +266,36 @@ ThreadPrint(Thread * t)
     t->Print();
 }
 
+static void
+ThreadPrintStats(Thread * t)
+{
+    ASSERT(t != nullptr);
+    printf("    %s: %u ticks in %u dispatches\n",
+      t->GetName(), t->GetCpuTicks(), t->GetNumDispatches());
+}
+
+/// Dump the CPU accounting of the current and ready threads, so a slow
+/// workload can be traced to the thread eating the simulated CPU.
+void
+Scheduler::PrintStats()
+{
+    printf("Per-thread CPU usage:\n");
+    currentThread->ChargeTicks(); // Include the running slice so far.
+    ThreadPrintStats(currentThread);
+    for (int i = NUM_PRIORITY_LEVELS - 1; i >= 0; i--) {
+        readyList[i]->Apply(ThreadPrintStats);
+    }
+}
+
 void
 Scheduler::Print()
 {
-    for (int i = 2; i >= 0; i--) {
-        if (readyList[i]->IsEmpty()) {
-            printf("List %d is empty\n", i);
-        } else {
+    if (readyMask == 0) {
+        printf("All ready lists are empty\n");
+        return;
+    }
+    for (int i = NUM_PRIORITY_LEVELS - 1; i >= 0; i--) {
+        if (!readyList[i]->IsEmpty()) {
             printf("Priority %d ready list contents:\n", i);
             readyList[i]->Apply(ThreadPrint);
         }
@@ -12,9 +12,14 @@
 
 
 #include "thread.hh"
-#include "lib/list.hh"
+#include "lib/intrusive_list.hh"
 
 
+/// Number of distinct priority levels the scheduler keeps ready queues
+/// for.  Thread priorities outside `[0, NUM_PRIORITY_LEVELS)` are clamped
+/// into the range.  Must not exceed the width of the ready bitmask.
+const unsigned NUM_PRIORITY_LEVELS = 32;
+
 /// The following class defines the scheduler/dispatcher abstraction --
 /// the data structures and operations needed to keep track of which
 /// thread is running, and which threads are ready but not running.
@@ -39,14 +44,74 @@ public:
     void
     Run(Thread * nextThread);
 
+    /// Multilevel feedback: a thread that consumed its whole quantum
+    /// sinks one level.
+    void
+    QuantumExpired(Thread * thread);
+
+    /// Set the per-level quanta: `interactive` timer ticks for the
+    /// highest priority level, `batch` for the lowest, interpolating
+    /// linearly in between.
+    void
+    SetQuanta(unsigned interactive, unsigned batch);
+
+    /// Quantum, in timer ticks, for a thread of the given priority.
+    unsigned
+    QuantumFor(int priority) const;
+
+    /// Multilevel feedback: a thread that blocked before its quantum ran
+    /// out rises one level.
+    void
+    Boost(Thread * thread);
+
+    /// Periodic aging: lift every ready thread one level so demoted
+    /// threads cannot starve behind a steady stream of high-priority
+    /// work.
+    void
+    Age();
+
+    /// Change a thread's effective priority, moving it between ready
+    /// queues if it is currently queued.  Used by priority inheritance:
+    /// boosting a READY lock holder must also requeue it, or it keeps
+    /// waiting at its old level.
+    void
+    Reprioritize(Thread * thread, int newPriority);
+
+    /// Is any thread ready to run?  Inline: `Yield` asks on every poll
+    /// iteration, and the answer is one test of the ready bitmask.
+    bool
+    IsEmpty() const
+    {
+        return readyMask == 0;
+    }
+
     // Print contents of ready list.
     void
     Print();
 
+    /// Print the per-thread CPU tick and dispatch counters.
+    void
+    PrintStats();
+
 private:
 
-    // Queue of queue of threads that are ready to run, but not running.
-    List < Thread * > *readyList[3];
+    // One FIFO queue of ready threads per priority level.  Intrusive, so
+    // queueing a thread never allocates.
+    IntrusiveList < Thread * > *readyList[NUM_PRIORITY_LEVELS];
+
+    // Bit `i` is set iff `readyList[i]` is non-empty, so picking the next
+    // thread is a single find-highest-set-bit no matter how many levels
+    // there are.
+    unsigned readyMask;
+
+    // Quantum, in timer ticks, for each priority level.  Short at the
+    // interactive (high) end to keep latency down, long at the batch
+    // (low) end to cut context-switch overhead on compute phases.
+    unsigned quantum[NUM_PRIORITY_LEVELS];
+
+    /// Clamp a thread priority into a queue index.
+    static unsigned
+    PriorityLevel(int priority);
 };
 
 
@@ -34,7 +34,7 @@ Semaphore::Semaphore(const char * debugName, int initialValue)
 {
     name  = debugName;
     value = initialValue;
-    queue = new List<Thread *>;
+    queue = new IntrusiveList<Thread *>;
 }
 
 /// De-allocate semaphore, when no longer needed.
@@ -67,6 +67,9 @@ Semaphore::P()
     DEBUG('S', "%s hace P en %s\n", currentThread->GetName(), name);
     while (value == 0) {              // Semaphore not available.
         queue->Append(currentThread); // So go to sleep.
+        // Blocking before the quantum ran out looks interactive/I/O
+        // bound: give the thread a level back.
+        scheduler->Boost(currentThread);
         currentThread->Sleep();
     }
     value--; // Semaphore available, consume its value.
@@ -101,15 +104,48 @@ Semaphore::V()
 /// Note -- without a correct implementation of `Condition::Wait`, the test
 /// case in the network assignment will not work!
 
+#ifdef SYNCH_STATS
+/// Every live lock, so `PrintStats` can walk them.  Doubly linked: locks
+/// die in any order and the destructor unlinks in O(1).
+static Lock * statsList = nullptr;
+
+/// Aggregates across all locks, fed to the statistics registry so the
+/// periodic snapshots show contention building up over time.
+static Counter lockAcquisitions("synch.lock.acquisitions");
+static Counter lockContended("synch.lock.contended");
+static Counter lockWaitTicks("synch.lock.waitTicks");
+#endif
+
 Lock::Lock(const char * debugName)
 {
     name   = debugName;
     lock   = new Semaphore(name, 1);
     thread = NULL;
+    #ifdef SYNCH_STATS
+    numAcquisitions = numContended = 0;
+    waitTicks     = maxWaitTicks = 0;
+    maxWaitHolder = nullptr;
+    statsPrev     = nullptr;
+    statsNext     = statsList;
+    if (statsList != nullptr) {
+        statsList->statsPrev = this;
+    }
+    statsList = this;
+    #endif
 }
 
 Lock::~Lock()
 {
+    #ifdef SYNCH_STATS
+    if (statsPrev != nullptr) {
+        statsPrev->statsNext = statsNext;
+    } else {
+        statsList = statsNext;
+    }
+    if (statsNext != nullptr) {
+        statsNext->statsPrev = statsPrev;
+    }
+    #endif
     delete lock;
 }
 
@@ -123,12 +159,40 @@ void
 Lock::Acquire()
 {
     ASSERT(!IsHeldByCurrentThread());
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    #ifdef SYNCH_STATS
+    // Contended means someone holds the lock right now; remember who, so
+    // the worst wait can name its culprit.  Thread names are not copied
+    // (same deal as the lock's own `name`).
+    numAcquisitions++;
+    lockAcquisitions.Inc();
+    bool contended     = thread != NULL;
+    const char * holder = contended ? thread->GetName() : nullptr;
+    unsigned waitStart  = stats->totalTicks;
+    #endif
     if (thread != NULL) {
         if (thread->GetPriority() < currentThread->GetPriority()) {
-            thread->SetPriority(currentThread->GetPriority());
+            // Priority inheritance: the boost has to requeue the holder
+            // if it is READY, or it stays parked at its old level and
+            // the inversion persists.
+            scheduler->Reprioritize(thread, currentThread->GetPriority());
         }
     }
+    interrupt->SetLevel(oldLevel);
     lock->P();
+    #ifdef SYNCH_STATS
+    if (contended) {
+        unsigned waited = stats->totalTicks - waitStart;
+        numContended++;
+        waitTicks += waited;
+        lockContended.Inc();
+        lockWaitTicks.Add(waited);
+        if (waited > maxWaitTicks) {
+            maxWaitTicks  = waited;
+            maxWaitHolder = holder;
+        }
+    }
+    #endif
     thread = currentThread;
     DEBUG('L', "%s acquires the lock %s\n", thread->GetName(), name);
 }
@@ -149,6 +213,33 @@ Lock::IsHeldByCurrentThread() const
     return thread == currentThread;
 }
 
+/// Dump the contention counters of every live lock that was ever taken,
+/// worst offenders included, so a convoy shows up as a report instead of
+/// needing printf archaeology.
+void
+Lock::PrintStats()
+{
+    #ifdef SYNCH_STATS
+    printf("Lock contention (live locks):\n");
+    for (Lock * l = statsList; l != nullptr; l = l->statsNext) {
+        if (l->numAcquisitions == 0) {
+            continue;
+        }
+        printf("    %s: %u acquisitions, %u contended,"
+          " %lu wait ticks, max %lu",
+          l->name, l->numAcquisitions, l->numContended,
+          l->waitTicks, l->maxWaitTicks);
+        if (l->maxWaitHolder != nullptr) {
+            printf(" (held then by %s)", l->maxWaitHolder);
+        }
+        printf("\n");
+    }
+    #else
+    printf("Lock statistics not compiled in"
+      " (rebuild with -DSYNCH_STATS).\n");
+    #endif
+}
+
 ////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////
 
@@ -158,6 +249,7 @@ Condition::Condition(const char * debugName, Lock * conditionLock)
     condition = conditionLock;
     internal  = new Lock("Internal_Lock_Condition");
     q_threads = new List<Semaphore *>;
+    handoff   = new List<Semaphore *>;
 }
 
 Condition::~Condition()
@@ -168,8 +260,14 @@ Condition::~Condition()
         f->V();
         delete f;
     }
+    while (!handoff->IsEmpty()) {
+        Semaphore * f = handoff->Pop();
+        f->V();
+        delete f;
+    }
     internal->Release();
     delete q_threads;
+    delete handoff;
     delete internal;
 }
 
@@ -190,6 +288,16 @@ Condition::Wait()
       currentThread->GetName(), name);
     f->P();
     condition->Acquire();
+    // Traspaso en cadena tras un Broadcast: el que recupera el lock
+    // despierta al proximo de la cola de traspaso, que a su vez recien
+    // compite por el lock cuando este se libere.  Asi los despertados
+    // toman el lock por turnos en vez de salir todos juntos a pelearlo.
+    internal->Acquire();
+    if (!handoff->IsEmpty()) {
+        Semaphore * next = handoff->Pop();
+        next->V();
+    }
+    internal->Release();
 }
 
 void
@@ -211,8 +319,12 @@ Condition::Broadcast()
     internal->Acquire();
     DEBUG('C', "Thread %s broadcast in condition %s",
       currentThread->GetName(), name);
-    while (!q_threads->IsEmpty()) {
+    if (!q_threads->IsEmpty()) {
+        // Despierta solo al primero; el resto pasa entero a la cola de
+        // traspaso en un unico splice, sin recorrer la cola ni poner N
+        // hilos listos de golpe (ver Wait para la cadena de despertado).
         Semaphore * f = q_threads->Pop();
+        handoff->AppendAll(q_threads);
         f->V();
     }
     internal->Release();
@@ -221,6 +333,89 @@ Condition::Broadcast()
 /////////////////////////////////////////////////
 /////////////////////////////////////////////////
 
+RWLock::RWLock(const char * debugName)
+{
+    name           = debugName;
+    lock           = new Lock("Internal_rwlock_lock");
+    okToRead       = new Condition("RWLock_read_condition", lock);
+    okToWrite      = new Condition("RWLock_write_condition", lock);
+    readers        = 0;
+    writing        = false;
+    writersWaiting = 0;
+}
+
+RWLock::~RWLock()
+{
+    delete okToRead;
+    delete okToWrite;
+    delete lock;
+}
+
+const char *
+RWLock::GetName() const
+{
+    return name;
+}
+
+void
+RWLock::AcquireRead()
+{
+    lock->Acquire();
+    // Los escritores en espera tienen prioridad: un lector nuevo no pasa
+    // por delante de ellos, para que no se mueran de hambre.
+    while (writing || writersWaiting > 0)
+        okToRead->Wait();
+    readers++;
+    DEBUG('L', "%s acquires %s for reading (%u readers)\n",
+      currentThread->GetName(), name, readers);
+    lock->Release();
+}
+
+void
+RWLock::ReleaseRead()
+{
+    lock->Acquire();
+    ASSERT(readers > 0);
+    readers--;
+    DEBUG('L', "%s releases %s for reading (%u readers)\n",
+      currentThread->GetName(), name, readers);
+    if (readers == 0)
+        okToWrite->Signal();
+    lock->Release();
+}
+
+void
+RWLock::AcquireWrite()
+{
+    lock->Acquire();
+    writersWaiting++;
+    while (writing || readers > 0)
+        okToWrite->Wait();
+    writersWaiting--;
+    writing = true;
+    DEBUG('L', "%s acquires %s for writing\n",
+      currentThread->GetName(), name);
+    lock->Release();
+}
+
+void
+RWLock::ReleaseWrite()
+{
+    lock->Acquire();
+    ASSERT(writing);
+    writing = false;
+    DEBUG('L', "%s releases %s for writing\n",
+      currentThread->GetName(), name);
+    if (writersWaiting > 0)
+        okToWrite->Signal();
+    else
+        okToRead->Broadcast();
+    lock->Release();
+}
+
+/////////////////////////////////////////////////
+/////////////////////////////////////////////////
+
 Port::Port(const char * debugName)
 {
     name = debugName;
@@ -21,6 +21,7 @@
 
 #include "thread.hh"
 #include "lib/list.hh"
+#include "lib/intrusive_list.hh"
 
 using namespace std;
 
@@ -67,7 +68,8 @@ private:
     int value;
 
     /// Queue of threads waiting on `P` because the value is zero.
-    List < Thread * > *queue;
+    /// Intrusive: the links live in the threads, so `P` never allocates.
+    IntrusiveList < Thread * > *queue;
 };
 
 /// This class defines a “lock”.
@@ -108,12 +110,34 @@ public:
     bool
     IsHeldByCurrentThread() const;
 
+    /// Dump the contention counters of every live lock (cf. the
+    /// debugger's `stats` command).  Without `SYNCH_STATS` it only says
+    /// the counters are compiled out.
+    static void
+    PrintStats();
+
 private:
 
     /// For debugging.
     const char * name;
     Semaphore * lock;
     Thread * thread;
+
+    #ifdef SYNCH_STATS
+    /// Contention counters, for spotting lock convoys: how often the
+    /// lock was taken, how often it was already held then, the ticks
+    /// spent waiting for it, and the worst single wait together with who
+    /// held the lock when that wait began.  Live locks form an intrusive
+    /// list so `PrintStats` can walk them; compile without `SYNCH_STATS`
+    /// and all of this (including the links) vanishes.
+    unsigned numAcquisitions;
+    unsigned numContended;
+    unsigned long waitTicks;
+    unsigned long maxWaitTicks;
+    const char * maxWaitHolder;
+    Lock * statsNext;
+    Lock * statsPrev;
+    #endif
     // Add other needed fields here.
 };
 
@@ -174,18 +198,66 @@ public:
     // Despierta el primer hilo de la cola
     void
     Broadcast();
-    // Despirta todos los hilos de la cola
+    // Despierta al primer hilo de la cola y pasa el resto, con un solo
+    // splice O(1), a la cola de traspaso; cada despertado despierta al
+    // siguiente recien cuando recupera el lock (ver Wait), asi nunca hay
+    // mas de un despertado compitiendo por el lock a la vez
 
 private:
 
     const char * name;
     List < Semaphore * > *q_threads;
+    List < Semaphore * > *handoff;
+    // Despertados por un Broadcast que todavia esperan su turno para
+    // tomar el lock
     Lock * condition;
     Lock * internal;
     // Other needed fields are to be added here.
 };
 
 
+/// This class defines a “reader-writer lock”.
+///
+/// Any number of readers may hold the lock at once, but a writer excludes
+/// both readers and other writers.  Waiting writers have priority over new
+/// readers, so a steady stream of readers cannot starve a writer.
+///
+/// Useful wherever shared data is read much more often than it is written
+/// -- e.g. the per-file locks in the filesystem, where concurrent readers
+/// of the same file should not queue behind each other.
+class RWLock {
+public:
+
+    RWLock(const char * debugName);
+
+    ~RWLock();
+
+    const char *
+    GetName() const;
+
+    /// Shared side: many readers at once, excluded only by a writer.
+    void
+    AcquireRead();
+    void
+    ReleaseRead();
+
+    /// Exclusive side: one writer, no readers.
+    void
+    AcquireWrite();
+    void
+    ReleaseWrite();
+
+private:
+
+    const char * name;
+    Lock * lock;            ///< Protects the state below.
+    Condition * okToRead;
+    Condition * okToWrite;
+    unsigned readers;        ///< Readers currently inside.
+    bool     writing;        ///< Is a writer inside?
+    unsigned writersWaiting; ///< Writers queued (they get priority).
+};
+
 // Definition of Port class
 class Port {
 public:
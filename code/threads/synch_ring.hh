@@ -0,0 +1,154 @@
+/// Data structure for handing items from one producer to one consumer.
+///
+/// `SynchList` takes a lock and signals a condition on every `Append` and
+/// `Pop`, which is the right tool when any number of threads touch the
+/// list.  But several of our queues have exactly one producer and one
+/// consumer -- a device handler feeding a worker thread, the postal
+/// delivery thread feeding the ack worker -- and there the per-item
+/// synchronization is pure overhead.
+///
+/// This class is a fixed-capacity ring for that single-producer /
+/// single-consumer case.  The producer and the consumer each own one
+/// index (`tail` and `head` respectively) and only read the other's, so
+/// neither side needs a lock and the producer never disables interrupts:
+/// `Put` is safe to call from an interrupt handler.  The consumer blocks
+/// on a semaphore, but the producer `V`s it only when the consumer has
+/// announced it is about to sleep -- on a steadily busy queue items move
+/// through with no synchronization at all.
+///
+/// NOT safe with two producers or two consumers; use `SynchList` there.
+///
+/// Copyright (c) 1992-1993 The Regents of the University of California.
+///               2016-2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_SYNCHRING__HH
+#define NACHOS_THREADS_SYNCHRING__HH
+
+
+#include "synch.hh"
+
+
+template < class Item >
+class SynchRing {
+public:
+
+    /// Initialize an empty ring holding up to `capacity` items (rounded
+    /// up to a power of two).
+    SynchRing(const char * debugName, unsigned capacity);
+
+    /// De-allocate the ring.  Assume no one is still waiting on it!
+    ~SynchRing();
+
+    /// For debugging.
+    const char *
+    GetName() const;
+
+    /// Append an item; producer side only.  Returns `false`, leaving the
+    /// ring untouched, if the ring is full -- the producer must drop or
+    /// retry, it cannot wait (it may be an interrupt handler).
+    bool
+    Put(Item item);
+
+    /// Remove the oldest item, waiting if the ring is empty; consumer
+    /// side only.
+    Item
+    Pop();
+
+private:
+
+    /// For debugging.
+    const char * name;
+
+    Item * buffer;     ///< `size` slots, indexed by the counters mod `size`.
+    unsigned size;     ///< Capacity, a power of two.
+
+    /// Free-running counters: the item count is `tail - head`, which is
+    /// right even across wraparound since both advance modulo 2^32.
+    volatile unsigned head; ///< Next slot to read; written by `Pop` only.
+    volatile unsigned tail; ///< Next slot to fill; written by `Put` only.
+
+    volatile bool waiting; ///< The consumer is about to sleep; set by
+    ///< `Pop` before its final empty re-check, so
+    ///< a `Put` that slips in between still wakes
+    ///< it.  Cleared by the `Put` that does.
+
+    Semaphore * avail; ///< Where the consumer sleeps while the ring is
+    ///< empty.  A stale `V` (the consumer re-checked
+    ///< and found the item on its own) at worst makes
+    ///< one later sleep spin an extra loop iteration.
+};
+
+template < class Item >
+SynchRing < Item > ::SynchRing(const char * debugName, unsigned capacity)
+{
+    ASSERT(capacity > 0);
+
+    name = debugName;
+    for (size = 1; size < capacity; size *= 2) {}
+    buffer  = new Item [size];
+    head    = 0;
+    tail    = 0;
+    waiting = false;
+    avail   = new Semaphore("ring avail", 0);
+}
+
+template < class Item >
+SynchRing < Item > ::~SynchRing()
+{
+    delete [] buffer;
+    delete avail;
+}
+
+template < class Item >
+const char *
+SynchRing < Item > ::GetName() const
+{
+    return name;
+}
+
+/// Append an `item` to the ring; wake the consumer if it is waiting.
+///
+/// No lock and no interrupt fiddling: only `Put` writes `tail`, so the
+/// slot is ours, and the consumer cannot see the item until the `tail`
+/// store that follows the slot store.
+template < class Item >
+bool
+SynchRing < Item > ::Put(Item item)
+{
+    if (tail - head == size) { // Ring is full.
+        return false;
+    }
+    buffer[tail % size] = item;
+    tail = tail + 1; // Publish; the consumer may consume from here on.
+    if (waiting) {
+        waiting = false;
+        avail->V();
+    }
+    return true;
+}
+
+/// Remove the oldest item from the ring.  Wait if the ring is empty.
+///
+/// Returns the removed item.
+template < class Item >
+Item
+SynchRing < Item > ::Pop()
+{
+    while (head == tail) {
+        waiting = true;
+        if (head != tail) { // A `Put` slipped in before the announcement
+            waiting = false; // was visible; the re-check catches it.
+            break;
+        }
+        avail->P();
+    }
+
+    Item item = buffer[head % size];
+    head = head + 1; // Free the slot; the producer may refill from here.
+    return item;
+}
+
+
+#endif /* ifndef NACHOS_THREADS_SYNCHRING__HH */
@@ -26,6 +26,10 @@ Interrupt * interrupt;        ///< Interrupt status.
 Statistics * stats;           ///< Performance metrics.
 Timer * timer;                ///< The hardware timer device, for invoking
 ///< context switches.
+TimerWheel * timerWheel;      ///< Software timeouts over the single
+///< hardware interrupt source.
+WorkQueue * workQueue;        ///< Shared daemon pool for background
+///< chores (flush, reclaim, page-out).
 
 // 2007, Jose Miguel Santos Espino
 PreemptiveScheduler * preemptiveScheduler = nullptr;
@@ -38,13 +42,18 @@ FileSystem * fileSystem;
 #ifdef FILESYS
 SynchDisk * synchDisk;
 FileTable * filetable;
+Journal * journal;
+# ifdef VMEM
+SwapDisk * swapDisk;
+# endif
 #endif
 
 #ifdef USER_PROGRAM // Requires either *FILESYS* or *FILESYS_STUB*.
-Machine * machine;  ///< User program memory and registers.
+Machine * machine;   ///< User program memory and registers.
+Profiler * profiler; ///< PC-sampling profiler, or null.
 SynchConsole * synchConsole;
 Bitmap * bitmap;
-Table<Thread *> * processTable;
+ProcessManager * processManager; ///< SpaceId bookkeeping.
 CoreMap * coremap;
 #endif
 
@@ -70,13 +79,151 @@ Cleanup();
 ///
 /// * `dummy` is because every interrupt handler takes one argument, whether
 ///   it needs it or not.
+/// Timer interrupts between aging passes over the ready queues.
+static const unsigned AGING_PERIOD = 10;
+
 static void
 TimerInterruptHandler(void * dummy)
 {
-    if (interrupt->GetStatus() != IDLE_MODE)
-        interrupt->YieldOnReturn();
+    // How many consecutive timer ticks the current thread has run; only
+    // when that reaches its level's quantum is it preempted, so batch
+    // threads (long quanta at the low levels) are not switched out on
+    // every tick the way interactive ones are.
+    static Thread * running  = nullptr;
+    static unsigned ranTicks = 0;
+
+    if (interrupt->GetStatus() != IDLE_MODE) {
+        if (currentThread != running) {
+            running  = currentThread;
+            ranTicks = 0;
+        }
+        if (++ranTicks >= scheduler->QuantumFor(currentThread->GetPriority())) {
+            ranTicks = 0;
+            // The running thread consumed its whole quantum: demote it
+            // one level before the forced yield.
+            scheduler->QuantumExpired(currentThread);
+            interrupt->YieldOnReturn();
+        }
+    }
+
+    static unsigned sinceAging = 0;
+    if (++sinceAging >= AGING_PERIOD) {
+        sinceAging = 0;
+        scheduler->Age();
+    }
+}
+
+/// The standard background chores all run on the shared work queue
+/// instead of owning one forked thread each.  Two workers at a low
+/// scheduling priority are enough: the chores are rare and batched, and
+/// the low priority keeps them from stealing quanta from foreground
+/// threads.  Page-out outranks the filesystem housekeeping -- memory
+/// pressure stalls page faults right now, a deferred flush does not.
+
+static const unsigned WORK_QUEUE_WORKERS = 2;
+static const int WORK_QUEUE_PRIORITY     = 4;
+
+#ifdef FILESYS
+/// Background flush of the disk cache.
+///
+/// `WriteSector` only dirties the in-cache copy, so somebody has to write
+/// dirty sectors back eventually.  The flush re-arms itself through the
+/// work queue's delayed submission, so it owns no timer of its own: it
+/// commits the pending metadata batch before its home sectors can reach
+/// the disk, then drains the cache in a single track-ordered sweep.
+
+/// Simulated ticks between flushes of the disk cache.
+static const unsigned FLUSH_PERIOD_TICKS = 10 * TIMER_TICKS;
+
+static void
+FlushWork(void * dummy)
+{
+    journal->Checkpoint();
+    workQueue->SubmitDelayed(FlushWork, nullptr, FLUSH_PERIOD_TICKS);
 }
 
+/// Background reclamation of files removed while open.
+///
+/// The last thread to close a removed file only queues the name; the
+/// reclaim work does the actual deallocation, batching every queued file
+/// into one free-map write-back, so the closer never stalls behind a
+/// large file's sector-by-sector release.
+
+/// Is a reclaim item already submitted and not yet run?  Kicks coalesce
+/// on this flag: one pending item drains however many files queued up.
+static bool reclaimQueued = false;
+
+static void
+ReclaimWork(void * dummy)
+{
+    reclaimQueued = false;
+    # ifdef FILESYS_NEEDED
+    fileSystem->ReclaimPending();
+    # endif
+}
+
+/// Called with freshly queued work: submit a reclaim item unless one is
+/// already pending.
+void
+KickReclaimDaemon()
+{
+    if (workQueue == nullptr) {
+        return;
+    }
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    if (!reclaimQueued) {
+        reclaimQueued = true;
+        workQueue->Submit(ReclaimWork, nullptr, 1);
+    }
+    interrupt->SetLevel(oldLevel);
+}
+#endif
+
+#ifdef VMEM
+/// Background page-out.
+///
+/// Without it, a page fault with memory full must evict a victim and write
+/// it to swap before it can even start reading the page it wants -- two
+/// I/O waits on the fault critical path.  The page-out work evicts ahead
+/// of demand whenever the pool of free frames drops below a small reserve,
+/// so the fault handler usually just grabs a free frame and does the read.
+
+/// How many free frames the page-out work tries to keep in reserve.
+static const unsigned FREE_FRAME_RESERVE = 4;
+
+/// Is a page-out item already submitted and not yet run?
+static bool pageOutQueued = false;
+
+static void
+PageOutWork(void * dummy)
+{
+    pageOutQueued = false;
+    while (bitmap->CountClear() < FREE_FRAME_RESERVE
+      && coremap->length() > 0)
+    {
+        coremap->freepage();
+    }
+}
+
+/// Called from the fault path after taking a frame: submit a page-out
+/// item if the reserve is getting low and none is pending yet.
+void
+KickPageOutDaemon()
+{
+    if (workQueue == nullptr
+      || bitmap->CountClear() >= FREE_FRAME_RESERVE)
+    {
+        return;
+    }
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    if (!pageOutQueued) {
+        pageOutQueued = true;
+        workQueue->Submit(PageOutWork, nullptr, 2);
+    }
+    interrupt->SetLevel(oldLevel);
+}
+#endif
+
 /// Initialize Nachos global data structures.
 ///
 /// Interpret command line arguments in order to determine flags for the
@@ -105,7 +252,9 @@ Initialize(int argc, char ** argv)
     long long timeSlice;
 
     #ifdef USER_PROGRAM
-    bool debugUserProg = false; // Single step user program.
+    bool debugUserProg     = false; // Single step user program.
+    unsigned profileEvery  = 0;     // Ticks between PC samples
+                                    // (0 = no profiling).
     #endif
     #ifdef FILESYS_NEEDED
     bool format = false; // Format disk.
@@ -114,6 +263,11 @@ Initialize(int argc, char ** argv)
     double rely = 1; // Network reliability.
     int netname = 0; // UNIX socket name.
     #endif
+    unsigned snapshotEvery       = 0;       // Ticks between statistics
+                                            // snapshots (0 = disabled).
+    const char * snapshotFile    = nullptr; // Where the snapshots go.
+    unsigned quantumInteractive  = 0;       // Per-priority quanta
+    unsigned quantumBatch        = 0;       // (0 = scheduler defaults).
 
     for (argc--, argv++; argc > 0; argc -= argCount, argv += argCount) {
         argCount = 1;
@@ -124,6 +278,32 @@ Initialize(int argc, char ** argv)
                 debugArgs = *(argv + 1);
                 argCount  = 2;
             }
+        } else if (!strcmp(*argv, "-dt")) {
+            // Debug messages go to an in-memory ring instead of stdout,
+            // dumped at halt; cheap enough to leave on in timed runs.
+            debug.EnableTrace();
+        } else if (!strcmp(*argv, "-rec")) {
+            // Record nondeterministic inputs for later replay:
+            //     -rec <file>
+            ASSERT(argc > 1);
+            StartRecording(*(argv + 1));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-rep")) {
+            // Replay a recorded run bit-identically:
+            //     -rep <file>
+            ASSERT(argc > 1);
+            StartReplay(*(argv + 1));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-tq")) {
+            // Per-priority preemption quanta, in timer ticks:
+            //     -tq <interactive> <batch>
+            // Parsed into locals here because `scheduler` does not exist
+            // yet.
+            ASSERT(argc > 2);
+            quantumInteractive = atoi(*(argv + 1));
+            quantumBatch       = atoi(*(argv + 2));
+            ASSERT(quantumInteractive > 0 && quantumBatch > 0);
+            argCount = 3;
         } else if (!strcmp(*argv, "-rs")) {
             ASSERT(argc > 1);
             RandomInit(atoi(*(argv + 1))); // Initialize pseudo-random
@@ -131,6 +311,19 @@ Initialize(int argc, char ** argv)
             randomYield = true;
             argCount    = 2;
         }
+        else if (!strcmp(*argv, "-ss")) {
+            // Periodic statistics snapshots:
+            //     -ss <ticks> <file>
+            // Parsed into locals here because `stats` does not exist yet.
+            ASSERT(argc > 2);
+            snapshotEvery = atoi(*(argv + 1));
+            snapshotFile  = *(argv + 2);
+            argCount      = 3;
+        }
+        else if (!strcmp(*argv, "-hprof"))
+            // Host-time self-profiling: scope timers around the
+            // simulator's own phases; the breakdown prints at halt.
+            hostProfile = true;
         // 2007, Jose Miguel Santos Espino
         else if (!strcmp(*argv, "-p")) {
             preemptiveScheduling = true;
@@ -144,11 +337,33 @@ Initialize(int argc, char ** argv)
         #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-s"))
             debugUserProg = true;
+        else if (!strcmp(*argv, "-prof")) {
+            // Sample the user PC every so many ticks:
+            //     -prof <ticks>
+            ASSERT(argc > 1);
+            profileEvery = atoi(*(argv + 1));
+            ASSERT(profileEvery > 0);
+            argCount = 2;
+        }
         #endif
         #ifdef FILESYS_NEEDED
         if (!strcmp(*argv, "-f"))
             format = true;
         #endif
+        #ifdef FILESYS
+        if (!strcmp(*argv, "-dg")) {
+            // Disk geometry, in tracks of SECTORS_PER_TRACK sectors:
+            //     -dg <tracks>
+            // Takes effect here, before any disk-backed structure is
+            // built; an existing DISK file with another geometry is
+            // rejected by the Disk constructor.
+            ASSERT(argc > 1);
+            NUM_TRACKS = atoi(*(argv + 1));
+            ASSERT(NUM_TRACKS > 0);
+            NUM_SECTORS = NUM_TRACKS * SECTORS_PER_TRACK;
+            argCount    = 2;
+        }
+        #endif
         #ifdef NETWORK
         if (!strcmp(*argv, "-n")) {
             ASSERT(argc > 1);
@@ -158,14 +373,28 @@ Initialize(int argc, char ** argv)
             ASSERT(argc > 1);
             netname  = atoi(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-mtu")) {
+            // Device MTU; every co-operating node must use the same
+            // value (cf. `WIRE_SIZE` in `machine/network.hh`).
+            ASSERT(argc > 1);
+            WIRE_SIZE = atoi(*(argv + 1));
+            ASSERT(WIRE_SIZE > sizeof(PacketHeader) + sizeof(MailHeader));
+            ASSERT(WIRE_SIZE <= MAX_WIRE_SIZE);
+            argCount = 2;
         }
         #endif
     }
 
     debug.SetFlags(debugArgs);  // Initialize `DEBUG` messages.
     stats     = new Statistics; // Collect statistics.
+    if (snapshotEvery > 0)
+        stats->EnableSnapshots(snapshotEvery, snapshotFile);
     interrupt = new Interrupt;  // Start up interrupt handling.
     scheduler = new Scheduler;  // Initialize the ready queue.
+    if (quantumInteractive > 0)
+        scheduler->SetQuanta(quantumInteractive, quantumBatch);
+    timerWheel = new TimerWheel; // Software timeouts; idle until the
+                                 // first timer is scheduled.
     if (randomYield)            // Start the timer (if needed).
         timer = new Timer(TimerInterruptHandler, 0, randomYield);
 
@@ -186,21 +415,34 @@ Initialize(int argc, char ** argv)
         preemptiveScheduler->SetUp(timeSlice);
     }
 
+    // The shared daemon pool; the standard chores submit to it.
+    workQueue = new WorkQueue("background work", WORK_QUEUE_WORKERS,
+      WORK_QUEUE_PRIORITY);
+
     #ifdef USER_PROGRAM
     Debugger * d = debugUserProg ? new Debugger : nullptr;
     machine      = new Machine(d); // This must come first.
+    profiler     = profileEvery > 0 ? new Profiler(profileEvery) : nullptr;
     synchConsole = new SynchConsole("Console");
     bitmap       = new Bitmap(NUM_PHYS_PAGES - 1);
     coremap      = new CoreMap();
-    processTable = new Table<Thread *>;
+    processManager = new ProcessManager;
     if (!timer)
         timer = new Timer(TimerInterruptHandler, 0, randomYield);
     SetExceptionHandlers();
+
     #endif
 
     #ifdef FILESYS
     synchDisk = new SynchDisk("DISK");
     filetable = new FileTable;
+    journal   = new Journal;
+    # ifdef VMEM
+    swapDisk = new SwapDisk("SWAP");
+    # endif
+
+    // Arm the periodic cache flush; it re-submits itself from then on.
+    workQueue->SubmitDelayed(FlushWork, nullptr, FLUSH_PERIOD_TICKS);
     #endif
 
     #ifdef FILESYS_NEEDED
@@ -227,10 +469,11 @@ Cleanup()
     #endif
 
     #ifdef USER_PROGRAM
+    delete profiler; // Its destructor dumps the profile.
     delete machine;
     delete synchConsole;
     delete bitmap;
-    delete processTable;
+    delete processManager;
     #endif
 
     #ifdef FILESYS_NEEDED
@@ -238,11 +481,17 @@ Cleanup()
     #endif
 
     #ifdef FILESYS
-    delete synchDisk;
+    delete journal;   // Its destructor checkpoints the pending batch.
+    delete synchDisk; // Its destructor drains the remaining dirty sectors.
     delete filetable;
+    # ifdef VMEM
+    delete swapDisk;
+    # endif
     #endif
 
     delete timer;
+    delete workQueue;
+    delete timerWheel;
     delete scheduler;
     delete interrupt;
 
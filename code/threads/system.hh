@@ -11,6 +11,8 @@
 
 #include "thread.hh"
 #include "scheduler.hh"
+#include "timer_wheel.hh"
+#include "work_queue.hh"
 #include "lib/utility.hh"
 #include "machine/interrupt.hh"
 #include "machine/statistics.hh"
@@ -34,17 +36,31 @@ extern Scheduler * scheduler;        ///< The ready list.
 extern Interrupt * interrupt;        ///< Interrupt status.
 extern Statistics * stats;           ///< Performance metrics.
 extern Timer * timer;                ///< The hardware alarm clock.
+extern TimerWheel * timerWheel;      ///< Software timeouts (cf.
+                                     ///< `timer_wheel.hh`).
+extern WorkQueue * workQueue;        ///< Shared pool for background
+                                     ///< chores (cf. `work_queue.hh`).
 
 #ifdef USER_PROGRAM
 # include "machine/machine.hh"
+# include "machine/profiler.hh"
+# include "userprog/process_manager.hh"
 # include "userprog/synch_console.hh"
 # include "lib/bitmap.hh"
 # include "lib/coremap.hh"
-extern Machine * machine; // User program memory and registers.
+extern Machine * machine;   // User program memory and registers.
+extern Profiler * profiler; // PC-sampling profiler, or null.
 extern SynchConsole * synchConsole;
 extern Bitmap * bitmap;
-extern Table < Thread * > * processTable;
+extern ProcessManager * processManager; // SpaceId bookkeeping (cf.
+                                        // `userprog/process_manager.hh`).
 extern CoreMap * coremap;
+
+# ifdef VMEM
+/// Wake the page-out daemon if the free-frame reserve is running low.
+void
+KickPageOutDaemon();
+# endif
 #endif
 
 #ifdef FILESYS_NEEDED // *FILESYS* or *FILESYS_STUB*.
@@ -56,8 +72,20 @@ extern FileSystem * fileSystem;
 #ifdef FILESYS
 # include "filesys/synch_disk.hh"
 # include "filesys/filetable.hh"
+# include "filesys/journal.hh"
 extern SynchDisk * synchDisk;
 extern FileTable * filetable;
+extern Journal * journal; // Metadata write-ahead journal.
+
+/// Wake the reclaim daemon: there are removed files waiting to have
+/// their sectors freed (cf. `FileSystem::ReclaimPending`).
+void
+KickReclaimDaemon();
+
+# ifdef VMEM
+#  include "filesys/swap_disk.hh"
+extern SwapDisk * swapDisk; // Second disk, dedicated to swap.
+# endif
 #endif
 
 #ifdef NETWORK
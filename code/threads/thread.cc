@@ -22,10 +22,86 @@
 #include "synch.hh"
 #include "system.hh"
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 
-/// This is put at the top of the execution stack, for detecting stack
-/// overflows.
-const unsigned STACK_FENCEPOST = 0xDEADBEEF;
+/// Pool of recycled thread stacks.
+///
+/// `AllocBoundedArray` costs a host `mmap` plus the protection changes
+/// for the guard pages, which is pure overhead when threads are forked
+/// and destroyed in quick succession.  Dead threads park their stack
+/// here and `Fork` reuses it -- guard mappings included.  The pool is
+/// allowed to hold as many stacks as the high watermark of concurrently
+/// live ones, so it adapts to the workload's actual burst size.
+static List<HostMemoryAddress *> * stackPool = nullptr;
+static unsigned pooledStacks = 0;
+static unsigned liveStacks   = 0;
+static unsigned maxLiveStacks = 0;
+
+/// Called with the faulting address of any wild reference; claims the
+/// fault if it landed on the running thread's stack guard page.  If not,
+/// returning lets the fault stay fatal the default way.
+static void
+StackOverflowHandler(const void * addr)
+{
+    if (currentThread != nullptr && currentThread->OverflowedStack(addr)) {
+        fprintf(stderr, "Stack overflow in thread \"%s\"!\n"
+          "Increase `STACK_SIZE`, or keep large data off the stack.\n",
+          currentThread->GetName());
+        exit(1);
+    }
+}
+
+static HostMemoryAddress *
+AllocThreadStack()
+{
+    static bool catching = false;
+    if (!catching) {
+        catching = true;
+        CallOnSegFault(StackOverflowHandler);
+    }
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    HostMemoryAddress * stack = nullptr;
+    if (pooledStacks > 0) {
+        stack = stackPool->Pop();
+        pooledStacks--;
+    }
+    liveStacks++;
+    if (liveStacks > maxLiveStacks) {
+        maxLiveStacks = liveStacks;
+    }
+    interrupt->SetLevel(oldLevel);
+
+    if (stack == nullptr) {
+        stack = (HostMemoryAddress *) AllocBoundedArray(STACK_SIZE
+            * sizeof *stack);
+    }
+    return stack;
+}
+
+static void
+FreeThreadStack(HostMemoryAddress * stack)
+{
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    liveStacks--;
+    if (pooledStacks < maxLiveStacks) {
+        if (stackPool == nullptr) {
+            stackPool = new List<HostMemoryAddress *>;
+        }
+        stackPool->Prepend(stack);
+        pooledStacks++;
+        stack = nullptr;
+    }
+    interrupt->SetLevel(oldLevel);
+
+    if (stack != nullptr) {
+        DeallocBoundedArray((char *) stack, STACK_SIZE * sizeof *stack);
+    }
+}
 
 
 static inline bool
@@ -49,16 +125,20 @@ Thread::Thread(const char * threadName, bool j_flag, int _priority)
     original_priority = _priority;
     dead              = NULL;
     path              = "/";
+    cpuTicks          = 0;
+    numDispatches     = 0;
+    sliceStart        = stats->totalTicks;
+    queuePrev         = nullptr;
+    queueNext         = nullptr;
     DEBUG('T', "Thread constructor starting with join_flag=%d - name=%s\n",
       j_flag, name);
-    if (join_flag) {
-        dead = new Port("Join_Port");
-    }
+    // El puerto de Join se crea recien en el primer uso (ver `JoinPort`);
+    // un hilo joinable que nunca se joinea ni termina no lo paga.
 
     #ifdef USER_PROGRAM
     space = nullptr;
-    if (processTable)
-        pid = processTable->Add(this);
+    if (processManager)
+        pid = processManager->Register(this);
     DescriptorTable = new Table<OpenFile *>();
     DescriptorTable->Add(NULL);// Adding CONSOLE_INPUT
     DescriptorTable->Add(NULL);// Adding CONSOLE_OUTPUT
@@ -79,16 +159,20 @@ Thread::~Thread()
     ASSERT(this != currentThread);
 
     if (stack != nullptr)
-        DeallocBoundedArray((char *) stack, STACK_SIZE * sizeof *stack);
+        FreeThreadStack(stack);
 
     #ifdef USER_PROGRAM
-    if (processTable)
-        processTable->Remove(pid);
+    if (processManager)
+        processManager->Unregister(pid);
     for (int fd = 0; !DescriptorTable->IsEmpty() && fd < 100; fd++) {
         delete DescriptorTable->Remove(fd);
     }
     delete DescriptorTable;
-    delete space;
+    // Los hilos creados con SC_FORK comparten el espacio con su padre:
+    // recien el ultimo en irse lo libera.
+    if (space != nullptr && space->Unref()) {
+        delete space;
+    }
     #endif
 }
 
@@ -129,23 +213,24 @@ Thread::Fork(VoidFunctionPtr func, void * arg)
     interrupt->SetLevel(oldLevel);
 }
 
-/// Check a thread's stack to see if it has overrun the space that has been
-/// allocated for it.  If we had a smarter compiler, we would not need to
-/// worry about this, but we do not.
+/// Does `addr` fall on this thread's stack guard page?
 ///
-/// NOTE: Nachos will not catch all stack overflow conditions.  In other
-/// words, your program may still crash because of an overflow.
-///
-/// If you get bizarre results (such as seg faults where there is no code)
-/// then you *may* need to increase the stack size.  You can avoid stack
-/// overflows by not putting large data structures on the stack.  Do not do
-/// this:
+/// The page just below each thread stack is mapped `PROT_NONE`, so an
+/// overrun faults on the very access that goes too far -- no periodic
+/// check, and nothing slips past the way a skipped canary word could.
+/// A large enough stack frame can still jump the guard entirely; if you
+/// get bizarre faults, increase `STACK_SIZE`, and avoid putting large
+/// data structures on the stack.  Do not do this:
 ///         void foo() { int bigArray[10000]; ... }
-void
-Thread::CheckOverflow() const
+bool
+Thread::OverflowedStack(const void * addr) const
 {
-    if (stack != nullptr)
-        ASSERT(*stack == STACK_FENCEPOST);
+    if (stack == nullptr) { // The main thread runs on the host's stack.
+        return false;
+    }
+    const char * base = (const char *) stack;
+    return base - getpagesize() <= (const char *) addr
+           && (const char *) addr < base;
 }
 
 void
@@ -155,6 +240,12 @@ Thread::SetStatus(ThreadStatus st)
     status = st;
 }
 
+ThreadStatus
+Thread::GetStatus() const
+{
+    return status;
+}
+
 const char *
 Thread::GetName() const
 {
@@ -191,6 +282,51 @@ Thread::RestoreOriginalPriority()
     priority = original_priority;
 }
 
+static int
+ClampPriority(int p)
+{
+    if (p < 0) {
+        return 0;
+    }
+    if (p >= (int) NUM_PRIORITY_LEVELS) {
+        return NUM_PRIORITY_LEVELS - 1;
+    }
+    return p;
+}
+
+void
+Thread::AdjustPriority(int delta)
+{
+    priority          = ClampPriority(priority + delta);
+    original_priority = ClampPriority(original_priority + delta);
+}
+
+void
+Thread::CountDispatch()
+{
+    numDispatches++;
+    sliceStart = stats->totalTicks;
+}
+
+void
+Thread::ChargeTicks()
+{
+    cpuTicks  += stats->totalTicks - sliceStart;
+    sliceStart = stats->totalTicks;
+}
+
+unsigned
+Thread::GetCpuTicks() const
+{
+    return cpuTicks;
+}
+
+unsigned
+Thread::GetNumDispatches() const
+{
+    return numDispatches;
+}
+
 void
 Thread::Print() const
 {
@@ -215,8 +351,10 @@ Thread::Finish(int ret)
     ASSERT(this == currentThread);
 
     DEBUG('T', "Finishing thread \"%s\"\n", GetName());
+    // Un hilo no joinable se va sin tocar el puerto: ni alocacion ni
+    // handshake, solo el Sleep de abajo.
     if (join_flag) {
-        dead->Send(ret);
+        JoinPort()->Send(ret);
     }
 
     threadToBeDestroyed = currentThread;
@@ -233,7 +371,7 @@ Thread::Join()
         DEBUG('T', "%s is waiting \"%s\" to finishes\n",
           currentThread->GetName(), GetName());
         int msm = 0;
-        dead->Receive(&msm);
+        JoinPort()->Receive(&msm);
         DEBUG('T', "Joining with %d\n", msm);
         delete dead;
         dead = nullptr;
@@ -245,6 +383,26 @@ Thread::Join()
     return 0;
 }
 
+/// Puerto del handshake de `Join`, creado en el primer uso.
+///
+/// Tanto `Join` (el que espera) como `Finish` (el que publica el
+/// retorno) pueden llegar primero, asi que el test-y-creacion se hace
+/// con interrupciones deshabilitadas.  Crear el puerto cuesta un lock y
+/// dos variables de condicion; diferirlo hace que los hilos
+/// fire-and-forget no lo paguen nunca.
+Port *
+Thread::JoinPort()
+{
+    ASSERT(join_flag);
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    if (dead == nullptr) {
+        dead = new Port("Join_Port");
+    }
+    interrupt->SetLevel(oldLevel);
+    return dead;
+}
+
 /// Relinquish the CPU if any other thread is ready to run.
 ///
 /// If so, put the thread on the end of the ready list, so that it will
@@ -269,10 +427,14 @@ Thread::Yield()
 
     DEBUG('T', "Yielding thread \"%s\"\n", GetName());
 
-    Thread * nextThread = scheduler->FindNextToRun();
-    if (nextThread != nullptr) {
+    // Polling loops yield millions of times with nobody else ready; the
+    // empty test keeps that case down to a single compare.  Otherwise we
+    // requeue ourselves *before* picking, so a thread that outranks
+    // everything ready picks itself back and `Run` skips the `SWITCH`
+    // round trip, instead of handing the CPU to lower-priority work.
+    if (!scheduler->IsEmpty()) {
         scheduler->ReadyToRun(this);
-        scheduler->Run(nextThread);
+        scheduler->Run(scheduler->FindNextToRun());
     }
 
     interrupt->SetLevel(oldLevel);
@@ -341,8 +503,7 @@ Thread::StackAllocate(VoidFunctionPtr func, void * arg)
 {
     ASSERT(func != nullptr);
 
-    stack = (HostMemoryAddress *) AllocBoundedArray(STACK_SIZE
-        * sizeof *stack);
+    stack = AllocThreadStack();
 
     // i386 & MIPS & SPARC stack works from high addresses to low addresses.
     stackTop = stack + STACK_SIZE - 4; // -4 to be on the safe side!
@@ -353,8 +514,6 @@ Thread::StackAllocate(VoidFunctionPtr func, void * arg)
     // `ThreadRoot`.
     *--stackTop = (HostMemoryAddress) ThreadRoot;
 
-    *stack = STACK_FENCEPOST;
-
     machineState[PCState]         = (HostMemoryAddress) ThreadRoot;
     machineState[StartupPCState]  = (HostMemoryAddress) InterruptEnable;
     machineState[InitialPCState]  = (HostMemoryAddress) func;
@@ -400,7 +559,11 @@ Thread::AddFile(OpenFile * file)
 OpenFile *
 Thread::GetFile(OpenFileId fId)
 {
-    ASSERT(DescriptorTable->HasKey(fId));
+    // Resolucion O(1): chequeo de rango y una carga en la tabla indexada
+    // por id.  Devuelve null si el id no esta en uso, asi el camino de
+    // syscall resuelve el descriptor con una sola consulta.
+    if (fId < 0 || !DescriptorTable->HasKey(fId))
+        return NULL;
 
     return DescriptorTable->Get(fId);
 }
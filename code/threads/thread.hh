@@ -127,13 +127,16 @@ public:
     void
     Finish(int ret = 1);
 
-    /// Check if thread has overflowed its stack.
-    void
-    CheckOverflow() const;
+    /// Does `addr` fall on this thread's stack guard page?
+    bool
+    OverflowedStack(const void * addr) const;
 
     void
     SetStatus(ThreadStatus st);
 
+    ThreadStatus
+    GetStatus() const;
+
     const char *
     GetName() const;
 
@@ -146,11 +149,39 @@ public:
     void
     RestoreOriginalPriority();
 
+    /// Shift the scheduling priority by `delta` levels (clamped to the
+    /// scheduler's range), moving the base priority too so priority
+    /// inheritance does not undo the shift.
+    void
+    AdjustPriority(int delta);
+
+    /// CPU accounting, driven by `Scheduler::Run` at context switches.
+
+    /// Note the start of a slice on the CPU.
+    void
+    CountDispatch();
+
+    /// Charge the ticks of the slice that just ended.
+    void
+    ChargeTicks();
+
+    unsigned
+    GetCpuTicks() const;
+
+    unsigned
+    GetNumDispatches() const;
+
     void
     Print() const;
 
     bool join_flag;
 
+    /// Link fields for the intrusive ready/wait queues
+    /// (see `lib/intrusive_list.hh`).  A thread sits on at most one such
+    /// queue at a time.
+    Thread * queuePrev;
+    Thread * queueNext;
+
     const char *
     GetPath() const;
 
@@ -173,10 +204,22 @@ private:
     Port * dead;
     int priority;
     int original_priority;
+
+    /// CPU accounting: total ticks on the CPU, how many times this thread
+    /// was dispatched, and when its current/last slice began.
+    unsigned cpuTicks;
+    unsigned numDispatches;
+    unsigned sliceStart;
+
     /// Allocate a stack for thread.  Used internally by `Fork`.
     void
     StackAllocate(VoidFunctionPtr func, void * arg);
 
+    /// The port backing the `Join` handshake, created on first use (see
+    /// `thread.cc`).
+    Port *
+    JoinPort();
+
     #ifdef USER_PROGRAM
     /// User-level CPU register state.
     ///
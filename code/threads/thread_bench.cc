@@ -0,0 +1,259 @@
+/// Microbenchmark suite for the thread system (flag `-tbench`).
+///
+/// `ThreadTest` (cf. `thread_test.cc`) is a demo, not a measurement
+/// tool: it prints what the threads do, not what they cost.  This suite
+/// measures the primitives every scheduler and synchronization change
+/// is judged against:
+///
+/// * context switch round trips between two yielding threads;
+/// * semaphore ping-pong rate between two threads;
+/// * lock acquire/release under contention, with 2 to 16 threads;
+/// * raw `ReadyToRun`/`FindNextToRun` cost at several queue depths;
+/// * thread create/run/join/destroy rate.
+///
+/// Every result is printed as one machine-readable line:
+///
+///     BENCH <name> threads=<n> ops=<n> ticks=<n> wall_us=<n> ns_per_op=<n>
+///
+/// where `ticks` is simulated time (`stats->totalTicks`) and the wall
+/// figures are host time, so a change can be judged both by what the
+/// simulation clock sees and by what the primitives cost to run.
+///
+/// Copyright (c) 2016-2018 Docentes de la Universidad Nacional de
+/// Rosario.  All rights reserved.  See `copyright.h` for copyright notice
+/// and limitation of liability and disclaimer of warranty provisions.
+
+
+#include "system.hh"
+#include "synch.hh"
+#include "scheduler.hh"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+
+static unsigned long
+WallMicros()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000000ul + tv.tv_usec;
+}
+
+/// Snapshot of both clocks at the start of one measurement.
+struct BenchClock {
+    unsigned      ticks;
+    unsigned long us;
+};
+
+static BenchClock
+BenchStart()
+{
+    BenchClock c;
+
+    c.ticks = stats->totalTicks;
+    c.us    = WallMicros();
+    return c;
+}
+
+static void
+BenchReport(const char * name, unsigned threads, unsigned ops,
+  const BenchClock &start)
+{
+    unsigned long us = WallMicros() - start.us;
+
+    printf("BENCH %s threads=%u ops=%u ticks=%u wall_us=%lu ns_per_op=%lu\n",
+      name, threads, ops, stats->totalTicks - start.ticks, us,
+      ops > 0 ? us * 1000 / ops : 0);
+}
+
+/// Workers signal here when they are done with their share of a phase.
+static Semaphore * benchDone = nullptr;
+
+/// Context switch: the peer yields `arg` times, so every yield of the
+/// main thread is a round trip through `SWITCH` and back.
+
+static void
+YieldWorker(void * rounds_)
+{
+    unsigned rounds = (unsigned) (uintptr_t) rounds_;
+
+    for (unsigned i = 0; i < rounds; i++) {
+        currentThread->Yield();
+    }
+    benchDone->V();
+}
+
+static void
+BenchContextSwitch(unsigned rounds)
+{
+    Thread * peer = new Thread("bench peer");
+
+    peer->Fork(YieldWorker, (void *) (uintptr_t) rounds);
+
+    BenchClock clock = BenchStart();
+    for (unsigned i = 0; i < rounds; i++) {
+        currentThread->Yield();
+    }
+    benchDone->P();
+    // Each round trip is two switches; report per-switch cost.
+    BenchReport("context-switch", 2, 2 * rounds, clock);
+}
+
+/// Semaphore ping-pong: the pair of `P`/`V` chains makes every round
+/// trip cost two sleeps, two wakeups and two context switches.
+
+static Semaphore * ping = nullptr;
+static Semaphore * pong = nullptr;
+
+static void
+PingPongWorker(void * rounds_)
+{
+    unsigned rounds = (unsigned) (uintptr_t) rounds_;
+
+    for (unsigned i = 0; i < rounds; i++) {
+        ping->P();
+        pong->V();
+    }
+    benchDone->V();
+}
+
+static void
+BenchSemaphorePingPong(unsigned rounds)
+{
+    ping = new Semaphore("bench ping", 0);
+    pong = new Semaphore("bench pong", 0);
+    Thread * peer = new Thread("bench peer");
+
+    peer->Fork(PingPongWorker, (void *) (uintptr_t) rounds);
+
+    BenchClock clock = BenchStart();
+    for (unsigned i = 0; i < rounds; i++) {
+        ping->V();
+        pong->P();
+    }
+    benchDone->P();
+    BenchReport("semaphore-pingpong", 2, rounds, clock);
+
+    delete ping;
+    delete pong;
+}
+
+/// Lock contention: every worker yields inside the critical section, so
+/// each acquisition finds the lock wanted by all the other workers.
+
+static Lock * benchLock = nullptr;
+
+static void
+LockWorker(void * rounds_)
+{
+    unsigned rounds = (unsigned) (uintptr_t) rounds_;
+
+    for (unsigned i = 0; i < rounds; i++) {
+        benchLock->Acquire();
+        currentThread->Yield();
+        benchLock->Release();
+    }
+    benchDone->V();
+}
+
+static void
+BenchLockContention(unsigned nThreads, unsigned rounds)
+{
+    benchLock = new Lock("bench lock");
+
+    BenchClock clock = BenchStart();
+    for (unsigned i = 0; i < nThreads; i++) {
+        Thread * worker = new Thread("bench worker");
+        worker->Fork(LockWorker, (void *) (uintptr_t) rounds);
+    }
+    for (unsigned i = 0; i < nThreads; i++) {
+        benchDone->P();
+    }
+    BenchReport("lock-contention", nThreads, nThreads * rounds, clock);
+
+    delete benchLock;
+}
+
+/// Raw ready-queue cost: park `depth` never-run threads on the ready
+/// list, then rotate it (`FindNextToRun` + `ReadyToRun`) with interrupts
+/// disabled, so nothing but the queue operations is measured.  Simulated
+/// time does not advance here; only the wall figures are meaningful.
+
+static void
+BenchReadyQueue(unsigned depth, unsigned rounds)
+{
+    // Let any thread still winding down from an earlier phase finish, so
+    // only our dummies are on the ready list while we rotate it.  Block
+    // instead of yielding: the work-queue daemons sit below us in
+    // priority, so a yield loop would pick us right back and spin while
+    // they stay ready forever.
+    while (!scheduler->IsEmpty()) {
+        timerWheel->SleepFor(1);
+    }
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    Thread ** dummies = new Thread * [depth];
+    for (unsigned i = 0; i < depth; i++) {
+        dummies[i] = new Thread("bench dummy");
+        scheduler->ReadyToRun(dummies[i]);
+    }
+
+    BenchClock clock = BenchStart();
+    for (unsigned i = 0; i < rounds; i++) {
+        scheduler->ReadyToRun(scheduler->FindNextToRun());
+    }
+    BenchReport("ready-queue", depth, rounds, clock);
+
+    for (unsigned i = 0; i < depth; i++) {
+        delete scheduler->FindNextToRun();
+    }
+    delete [] dummies;
+
+    interrupt->SetLevel(oldLevel);
+}
+
+/// Thread lifecycle: fork a trivial thread and join its death, `rounds`
+/// times.  Exercises stack allocation (and the stack pool), dispatch,
+/// `Finish` and destruction.
+
+static void
+NullWorker(void * dummy)
+{ }
+
+static void
+BenchCreateDestroy(unsigned rounds)
+{
+    BenchClock clock = BenchStart();
+
+    for (unsigned i = 0; i < rounds; i++) {
+        Thread * worker = new Thread("bench short-lived", true);
+        worker->Fork(NullWorker, nullptr);
+        worker->Join();
+    }
+    BenchReport("create-destroy", 1, rounds, clock);
+}
+
+/// Run the whole suite.  Sized so the full run stays in the hundreds of
+/// milliseconds while each phase still does enough operations for the
+/// per-op figures to be stable.
+void
+ThreadBench()
+{
+    benchDone = new Semaphore("bench done", 0);
+
+    BenchContextSwitch(100000);
+    BenchSemaphorePingPong(50000);
+    for (unsigned nThreads = 2; nThreads <= 16; nThreads *= 2) {
+        BenchLockContention(nThreads, 20000 / nThreads);
+    }
+    for (unsigned depth = 1; depth <= 4096; depth *= 16) {
+        BenchReadyQueue(depth, 200000);
+    }
+    BenchCreateDestroy(20000);
+
+    delete benchDone;
+    benchDone = nullptr;
+}
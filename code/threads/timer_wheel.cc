@@ -0,0 +1,164 @@
+/// Rueda de timers jerarquica (ver `timer_wheel.hh`).
+
+#include "timer_wheel.hh"
+#include "synch.hh"
+#include "system.hh"
+
+
+/// El tick maestro: la unica interrupcion pendiente de la rueda.
+static void
+TimerWheelTick(void * arg)
+{
+    ASSERT(arg != nullptr);
+    ((TimerWheel *) arg)->Advance();
+}
+
+/// Handler de `SleepFor`: despertar al hilo dormido.
+static void
+SleepWakeUp(void * arg)
+{
+    ASSERT(arg != nullptr);
+    ((Semaphore *) arg)->V();
+}
+
+TimerWheel::TimerWheel()
+{
+    for (unsigned i = 0; i < WHEEL_SLOTS; i++) {
+        fine[i]   = nullptr;
+        coarse[i] = nullptr;
+    }
+    faraway    = nullptr;
+    fineCursor = stats->totalTicks / WHEEL_TICK + 1;
+    count      = 0;
+    armed      = false;
+}
+
+TimerWheel::~TimerWheel()
+{
+    // Los timers que queden vencen con la maquina: solo liberar.
+    for (unsigned i = 0; i < WHEEL_SLOTS; i++) {
+        SoftTimer * t;
+        while ((t = fine[i]) != nullptr) {
+            fine[i] = t->next;
+            delete t;
+        }
+        while ((t = coarse[i]) != nullptr) {
+            coarse[i] = t->next;
+            delete t;
+        }
+    }
+    while (faraway != nullptr) {
+        SoftTimer * t = faraway;
+        faraway = t->next;
+        delete t;
+    }
+}
+
+void
+TimerWheel::Enqueue(SoftTimer * t)
+{
+    unsigned now   = stats->totalTicks;
+    unsigned delta = t->due > now ? t->due - now : 0;
+
+    SoftTimer ** list;
+    if (delta < WHEEL_SLOTS * WHEEL_TICK)
+        list = &fine[t->due / WHEEL_TICK % WHEEL_SLOTS];
+    else if (delta < WHEEL_SLOTS * WHEEL_SLOTS * WHEEL_TICK)
+        list = &coarse[t->due / (WHEEL_TICK * WHEEL_SLOTS) % WHEEL_SLOTS];
+    else
+        list = &faraway;
+    t->next = *list;
+    *list   = t;
+}
+
+void
+TimerWheel::Schedule(VoidFunctionPtr handler, void * arg,
+  unsigned ticksFromNow)
+{
+    ASSERT(handler != nullptr);
+
+    SoftTimer * t = new SoftTimer;
+    t->handler = handler;
+    t->arg     = arg;
+    // Redondeo hacia arriba a la proxima ranura: la rueda nunca dispara
+    // antes de tiempo.
+    t->due = stats->totalTicks + ticksFromNow + WHEEL_TICK;
+
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    Enqueue(t);
+    count++;
+    Arm();
+    interrupt->SetLevel(oldLevel);
+}
+
+void
+TimerWheel::SleepFor(unsigned ticks)
+{
+    Semaphore wakeUp("timer wheel sleep", 0);
+
+    Schedule(SleepWakeUp, &wakeUp, ticks);
+    wakeUp.P();
+}
+
+void
+TimerWheel::Arm()
+{
+    if (armed)
+        return;
+    armed = true;
+    // `SOFT_TIMER_INT`, no `TIMER_INT`: el chequeo de maquina ociosa en
+    // `CheckIfDue` descarta un `TIMER_INT` solitario (una alarma de
+    // preempcion sin nadie que correr), pero a este tick siempre lo
+    // espera alguien.
+    interrupt->Schedule(TimerWheelTick, this, WHEEL_TICK, SOFT_TIMER_INT);
+}
+
+/// Procesar cada ranura fina vencida desde la ultima pasada.  Al cruzar
+/// una vuelta completa de la rueda fina se cascadea la ranura gruesa que
+/// empieza (sus timers caen ahora dentro de la vuelta fina) y se revisa
+/// la lista lejana.  Corre con interrupciones apagadas, como todo
+/// handler pendiente.
+void
+TimerWheel::Advance()
+{
+    armed = false;
+    unsigned now = stats->totalTicks;
+
+    for (; fineCursor <= now / WHEEL_TICK; fineCursor++) {
+        if (fineCursor % WHEEL_SLOTS == 0) {
+            // Arranca otra vuelta fina: bajar la ranura gruesa que la
+            // cubre, y ver si algo lejano ya quedo al alcance.
+            unsigned cSlot = fineCursor / WHEEL_SLOTS % WHEEL_SLOTS;
+            SoftTimer * t  = coarse[cSlot];
+            coarse[cSlot] = nullptr;
+            while (t != nullptr) {
+                SoftTimer * nxt = t->next;
+                Enqueue(t);
+                t = nxt;
+            }
+            t       = faraway;
+            faraway = nullptr;
+            while (t != nullptr) {
+                SoftTimer * nxt = t->next;
+                Enqueue(t);
+                t = nxt;
+            }
+        }
+
+        SoftTimer * t = fine[fineCursor % WHEEL_SLOTS];
+        fine[fineCursor % WHEEL_SLOTS] = nullptr;
+        while (t != nullptr) {
+            SoftTimer * nxt = t->next;
+            if (t->due <= now + WHEEL_TICK) {
+                (*t->handler)(t->arg);
+                count--;
+                delete t;
+            } else {
+                Enqueue(t); // De una vuelta futura: todavia no.
+            }
+            t = nxt;
+        }
+    }
+    if (count > 0)
+        Arm();
+}
@@ -0,0 +1,82 @@
+/// Rueda de timers jerarquica: muchos timeouts de software baratos sobre
+/// la unica fuente de interrupciones del hardware.
+///
+/// `interrupt->Schedule` mantiene una lista ordenada de interrupciones
+/// pendientes; usarla directo para cada timeout del kernel hace que cada
+/// alta pague la insercion ordenada.  La rueda agrupa los timers en
+/// ranuras de `WHEEL_TICK` ticks y mantiene UNA sola interrupcion
+/// pendiente (el "tick maestro"), que al dispararse procesa la ranura
+/// vencida; dar de alta un timer es encadenarlo a su ranura, O(1).
+///
+/// Jerarquia clasica de dos niveles mas una lista lejana: la rueda fina
+/// cubre una vuelta de `WHEEL_SLOTS * WHEEL_TICK` ticks, la gruesa
+/// `WHEEL_SLOTS` veces eso, y lo que cae mas alla espera en una lista
+/// que se recascadea periodicamente.  El tick maestro solo esta armado
+/// mientras haya timers vivos, asi una maquina sin timeouts no paga
+/// nada.
+///
+/// `SleepFor` es el uso tipico: bloquear al hilo actual una cantidad de
+/// ticks (syscall `Sleep`), en vez de girar sobre `Yield` quemando CPU
+/// simulada.
+
+#ifndef NACHOS_THREADS_TIMERWHEEL__HH
+#define NACHOS_THREADS_TIMERWHEEL__HH
+
+#include "lib/utility.hh"
+
+
+class TimerWheel {
+public:
+
+    TimerWheel();
+    ~TimerWheel();
+
+    /// Llamar `handler(arg)` dentro de `ticksFromNow` ticks simulados
+    /// (redondeado hacia arriba a la granularidad de la rueda).  El
+    /// handler corre en contexto de interrupcion, como los de
+    /// `interrupt->Schedule`.
+    void
+    Schedule(VoidFunctionPtr handler, void * arg, unsigned ticksFromNow);
+
+    /// Bloquear al hilo actual por al menos `ticks` ticks simulados.
+    void
+    SleepFor(unsigned ticks);
+
+    /// Procesar las ranuras vencidas; interno, lo llama el tick maestro.
+    void
+    Advance();
+
+private:
+
+    struct SoftTimer {
+        VoidFunctionPtr handler;
+        void *          arg;
+        unsigned        due; ///< Tick absoluto de vencimiento.
+        SoftTimer *     next;
+    };
+
+    static const unsigned WHEEL_SLOTS = 64;
+    static const unsigned WHEEL_TICK  = 1000; ///< Granularidad fina.
+
+    SoftTimer * fine[WHEEL_SLOTS];   ///< Una vuelta de rueda fina.
+    SoftTimer * coarse[WHEEL_SLOTS]; ///< `WHEEL_SLOTS` vueltas finas.
+    SoftTimer * faraway;             ///< Mas alla de la rueda gruesa.
+
+    /// Proxima ranura fina (en ticks absolutos / `WHEEL_TICK`) que el
+    /// tick maestro todavia no proceso.
+    unsigned fineCursor;
+
+    unsigned count; ///< Timers vivos.
+    bool     armed; ///< Hay un tick maestro pendiente.
+
+    /// Encadenar un timer en la rueda que corresponde a su distancia.
+    void
+    Enqueue(SoftTimer * t);
+
+    /// Asegurar que haya un tick maestro pendiente.
+    void
+    Arm();
+};
+
+
+#endif /* ifndef NACHOS_THREADS_TIMERWHEEL__HH */
@@ -0,0 +1,102 @@
+/// Shared pool of daemon threads running prioritized background work.
+///
+/// See `work_queue.hh` for the interface and the rationale.
+
+#include "work_queue.hh"
+#include "synch.hh"
+#include "system.hh"
+#include "lib/pool.hh"
+
+
+WorkQueue::WorkQueue(const char * debugName, unsigned numWorkers,
+  int workerPriority)
+{
+    ASSERT(numWorkers > 0);
+
+    name  = debugName;
+    items = new List<WorkItem *>;
+    avail = new Semaphore(debugName, 0);
+    for (unsigned i = 0; i < numWorkers; i++) {
+        Thread * worker = new Thread(debugName, false, workerPriority);
+        worker->Fork(Worker, this);
+    }
+}
+
+WorkQueue::~WorkQueue()
+{
+    delete items;
+    delete avail;
+}
+
+const char *
+WorkQueue::GetName() const
+{
+    return name;
+}
+
+void
+WorkQueue::Enqueue(WorkItem * item)
+{
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+
+    // `SortedPop` takes the smallest key, so negate: highest priority
+    // pops first, equal priorities keep submission order.
+    items->SortedInsert(item, -item->priority);
+    interrupt->SetLevel(oldLevel);
+    avail->V();
+}
+
+void
+WorkQueue::Submit(VoidFunctionPtr func, void * arg, int priority)
+{
+    ASSERT(func != nullptr);
+
+    WorkItem * item = (WorkItem *) PoolAlloc(sizeof (WorkItem));
+    item->func     = func;
+    item->arg      = arg;
+    item->priority = priority;
+    item->queue    = this;
+    Enqueue(item);
+}
+
+void
+WorkQueue::SubmitDelayed(VoidFunctionPtr func, void * arg,
+  unsigned ticksFromNow, int priority)
+{
+    ASSERT(func != nullptr);
+
+    WorkItem * item = (WorkItem *) PoolAlloc(sizeof (WorkItem));
+    item->func     = func;
+    item->arg      = arg;
+    item->priority = priority;
+    item->queue    = this;
+    timerWheel->Schedule(DelayReady, item, ticksFromNow);
+}
+
+void
+WorkQueue::DelayReady(void * item_)
+{
+    WorkItem * item = (WorkItem *) item_;
+
+    item->queue->Enqueue(item);
+}
+
+void
+WorkQueue::Worker(void * queue_)
+{
+    WorkQueue * queue = (WorkQueue *) queue_;
+
+    for (;;) {
+        queue->avail->P();
+        IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+        WorkItem * item = queue->items->SortedPop(nullptr);
+        interrupt->SetLevel(oldLevel);
+
+        DEBUG('T', "Work queue %s runs an item at priority %d\n",
+          queue->name, item->priority);
+        VoidFunctionPtr func = item->func;
+        void * arg = item->arg;
+        PoolFree(item, sizeof (WorkItem));
+        func(arg);
+    }
+}
@@ -0,0 +1,100 @@
+/// A shared pool of daemon threads consuming prioritized work items.
+///
+/// Background chores keep growing -- flushing the disk cache, reclaiming
+/// removed files, paging out ahead of demand -- and giving each its own
+/// forked thread duplicates the same sleep/wake loop while filling the
+/// scheduler with single-purpose daemons.  A work queue runs them all on
+/// one small pool: `Submit` queues a function with a priority, and the
+/// first idle worker runs the highest-priority item pending.  The
+/// workers are created at a low scheduling priority, so background work
+/// only runs when it would not steal the CPU from foreground threads.
+///
+/// `SubmitDelayed` queues an item after a number of simulated ticks have
+/// passed (through the timer wheel), which is how periodic chores re-arm
+/// themselves without owning a hardware `Timer` each.
+///
+/// `Submit` is safe to call from an interrupt handler.  Work functions
+/// run in thread context and may block; items of equal priority run in
+/// submission order, but nothing orders items across priorities beyond
+/// "higher first", so work that depends on other work must synchronize
+/// on its own.
+///
+/// Copyright (c) 2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_THREADS_WORKQUEUE__HH
+#define NACHOS_THREADS_WORKQUEUE__HH
+
+
+#include "lib/list.hh"
+#include "lib/utility.hh"
+
+class Semaphore;
+
+
+class WorkQueue {
+public:
+
+    /// Fork `numWorkers` daemon threads at scheduling priority
+    /// `workerPriority`.  The pool is expected to live as long as the
+    /// machine does.
+    WorkQueue(const char * debugName, unsigned numWorkers,
+      int workerPriority);
+
+    /// Assumes the workers are parked and no items are pending, like
+    /// deleting a `Semaphore` someone still waits on.
+    ~WorkQueue();
+
+    /// For debugging.
+    const char *
+    GetName() const;
+
+    /// Run `func(arg)` on a worker thread.  Higher `priority` runs
+    /// first.  Callable from interrupt handlers.
+    void
+    Submit(VoidFunctionPtr func, void * arg, int priority = 0);
+
+    /// Like `Submit`, but the item only becomes runnable after
+    /// `ticksFromNow` simulated ticks (rounded up to the timer wheel's
+    /// granularity).
+    void
+    SubmitDelayed(VoidFunctionPtr func, void * arg, unsigned ticksFromNow,
+      int priority = 0);
+
+private:
+
+    /// One queued call; recycled through the kernel object pool.
+    struct WorkItem {
+        VoidFunctionPtr func;
+        void *          arg;
+        int             priority;
+        WorkQueue *     queue; ///< Owner, for the timer-wheel trampoline.
+    };
+
+    /// For debugging.
+    const char * name;
+
+    /// Pending items, highest priority first.
+    List < WorkItem * > *items;
+
+    /// Counts pending items; idle workers sleep here.
+    Semaphore * avail;
+
+    /// Queue an already-built item; the interrupt-safe core shared by
+    /// `Submit` and the timer-wheel trampoline.
+    void
+    Enqueue(WorkItem * item);
+
+    /// Worker body: loop forever running the best pending item.
+    static void
+    Worker(void * queue_);
+
+    /// Timer-wheel handler for `SubmitDelayed`: the delay has passed,
+    /// queue the item for real.
+    static void
+    DelayReady(void * item_);
+};
+
+
+#endif /* ifndef NACHOS_THREADS_WORKQUEUE__HH */
@@ -1,17 +1,9 @@
 #include "syscall.h"
+#include "nlib.h"
 
 #define THREAD_NUM 4
 #define PUT(s) (Write((s), strlen((s)), CONSOLE_OUTPUT))
 
-static inline unsigned
-strlen(const char * s)
-{
-    unsigned i;
-
-    for (i = 0; s[i] != '\0'; i++);
-    return i;
-}
-
 int
 main(int argc, char * argv[])
 {
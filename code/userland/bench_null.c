@@ -0,0 +1,11 @@
+/// Smallest possible child for the Exec/Join round-trip measurement in
+/// `syscall_bench.c`: start up, exit.
+
+#include "syscall.h"
+
+int
+main(int argc, char ** argv)
+{
+    Exit(0);
+    return 0;
+}
@@ -1,20 +1,5 @@
 #include "syscall.h"
-
-static inline unsigned
-strlen(const char * s)
-{
-    unsigned i;
-
-    for (i = 0; s[i] != '\0' && s[i] != 0; i++);
-    return i;
-}
-
-void
-PutStr(const char * str)
-{
-    Write(str, strlen(str), CONSOLE_OUTPUT);
-    Write("\n", strlen("\n"), CONSOLE_OUTPUT);
-}
+#include "nlib.h"
 
 int
 main(int argc, char * argv[])
@@ -22,7 +7,7 @@ main(int argc, char * argv[])
     int i;
 
     for (i = 1; i < argc; i++) {
-        PutStr(argv[i]);
+        PutLine(argv[i]);
     }
     Exit(i);
 }
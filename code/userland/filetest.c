@@ -1,13 +1,5 @@
 #include "syscall.h"
-
-unsigned
-strlen(const char * s)
-{
-    unsigned i;
-
-    for (i = 0; s[i] != '\0' && s[i] != '\n'; i++);
-    return i;
-}
+#include "nlib.h"
 
 int
 main(int argc, char ** argv)
@@ -1,41 +1,153 @@
-/// Test program to do matrix multiplication on large arrays.
+/// Matrix multiplication benchmark, intended to stress the virtual
+/// memory system.
 ///
-/// Intended to stress virtual memory system.
+/// Multiplies `A[i][j] = i` by `B[i][j] = j`, so every cell of the
+/// result has the closed form `C[i][j] = i * j * n` and can be checked
+/// exactly.  Two variants run over each size: the naive triple loop,
+/// whose column walk through `B` touches a different page per inner
+/// iteration once the matrices outgrow memory, and a cache-blocked one
+/// that finishes a `BLOCK`x`BLOCK` tile before moving on.  The gap
+/// between them measures how much locality the paging setup rewards.
 ///
-/// Ideally, we could read the matrices off of the file system, and store the
-/// result back to the file system!
+/// With no argument a sweep of sizes is run; `matmult <n>` runs a
+/// single size.  Ticks are taken with `Ticks()` -- the interpreter
+/// charges one tick per user instruction, so ticks-per-cell is a direct
+/// instruction count (plus whatever the kernel spent on our page
+/// faults, which is part of what we want to see).
 
 
 #include "syscall.h"
+#include "nlib.h"
 
 
-/// Sum total of the arrays does not fit in physical memory.
-#define DIM 13
+#define MAX_DIM 64
+#define BLOCK   8
 
-static int A[DIM][DIM];
-static int B[DIM][DIM];
-static int C[DIM][DIM];
+static int A[MAX_DIM][MAX_DIM];
+static int B[MAX_DIM][MAX_DIM];
+static int C[MAX_DIM][MAX_DIM];
 
-int
-main(void)
+static void
+Init(int n)
 {
-    int i, j, k;
+    int i, j;
 
-    // First initialize the matrices.
-    for (i = 0; i < DIM; i++)
-        for (j = 0; j < DIM; j++) {
+    for (i = 0; i < n; i++)
+        for (j = 0; j < n; j++) {
             A[i][j] = i;
             B[i][j] = j;
-            C[i][j] = 0;
         }
+}
+
+static void
+Clear(int n)
+{
+    int i;
 
-    // Then multiply them together.
-    for (i = 0; i < DIM; i++)
-        for (j = 0; j < DIM; j++)
-            for (k = 0; k < DIM; k++)
+    for (i = 0; i < n; i++)
+        memset(C[i], 0, n * sizeof (int));
+}
+
+static void
+Naive(int n)
+{
+    int i, j, k;
+
+    for (i = 0; i < n; i++)
+        for (j = 0; j < n; j++)
+            for (k = 0; k < n; k++)
                 C[i][j] += A[i][k] * B[k][j];
+}
+
+static void
+Blocked(int n)
+{
+    int ii, jj, kk, i, j, k, lim_i, lim_j, lim_k;
+
+    for (ii = 0; ii < n; ii += BLOCK)
+        for (kk = 0; kk < n; kk += BLOCK)
+            for (jj = 0; jj < n; jj += BLOCK) {
+                lim_i = ii + BLOCK < n ? ii + BLOCK : n;
+                lim_k = kk + BLOCK < n ? kk + BLOCK : n;
+                lim_j = jj + BLOCK < n ? jj + BLOCK : n;
+                for (i = ii; i < lim_i; i++)
+                    for (k = kk; k < lim_k; k++)
+                        for (j = jj; j < lim_j; j++)
+                            C[i][j] += A[i][k] * B[k][j];
+            }
+}
+
+static int
+Check(int n)
+{
+    int i, j;
+
+    for (i = 0; i < n; i++)
+        for (j = 0; j < n; j++)
+            if (C[i][j] != i * j * n)
+                return 0;
+
+    return 1;
+}
+
+/// Run one variant over `n`x`n` matrices and report `name: <ticks>
+/// ticks, <ticks / n^2> per cell, ok|MISMATCH`.  Returns 1 if the
+/// result validated.
+static int
+Run(const char * name, void (* mult)(int), int n)
+{
+    unsigned t0, t1;
+    int ok;
+
+    Clear(n);
+    t0 = Ticks();
+    mult(n);
+    t1 = Ticks();
+    ok = Check(n);
+
+    PutInt(n);
+    PutStr("x");
+    PutInt(n);
+    PutStr(" ");
+    PutStr(name);
+    PutStr(": ");
+    PutInt(t1 - t0);
+    PutStr(" ticks, ");
+    PutInt((t1 - t0) / (n * n));
+    PutStr(" per cell, ");
+    PutLine(ok ? "ok" : "MISMATCH");
+
+    return ok;
+}
+
+static int
+RunSize(int n)
+{
+    Init(n);
+    return Run("naive", Naive, n) & Run("blocked", Blocked, n);
+}
+
+int
+main(int argc, char * argv[])
+{
+    static const int SWEEP[] = { 8, 16, 32, 64 };
+    int ok = 1;
+
+    if (argc > 1) {
+        int n = 0;
+        const char * s = argv[1];
+        while (*s >= '0' && *s <= '9')
+            n = n * 10 + *s++ - '0';
+        if (n < 1 || n > MAX_DIM) {
+            PutLine("matmult: size must be between 1 and 64");
+            Exit(1);
+        }
+        ok = RunSize(n);
+    } else {
+        unsigned i;
+        for (i = 0; i < sizeof SWEEP / sizeof SWEEP[0]; i++)
+            ok &= RunSize(SWEEP[i]);
+    }
 
-    // And then we are done.
-    Exit(C[DIM - 1][DIM - 1]);
-    // Result:1872
+    Exit(ok ? 0 : 1);
 }
@@ -0,0 +1,224 @@
+/// Word-at-a-time string routines and buffered console I/O for user
+/// programs.  See `nlib.h` for the interface notes.
+
+#include "nlib.h"
+
+
+#define WORD_MASK  3u
+
+/// A word has a zero byte iff `(w - ONES) & ~w & HIGHS` is nonzero: the
+/// subtraction borrows through a 0x00 byte and sets its high bit, and
+/// `~w` masks out bytes that had the high bit set on their own.
+#define ONES   0x01010101u
+#define HIGHS  0x80808080u
+#define HAS_ZERO(w)  ((((w) - ONES) & ~(w)) & HIGHS)
+
+unsigned
+strlen(const char * s)
+{
+    const char * p = s;
+
+    if (!s) {
+        return 0;
+    }
+    for (; (unsigned) p & WORD_MASK; p++) {
+        if (*p == '\0') {
+            return p - s;
+        }
+    }
+    const unsigned * w = (const unsigned *) p;
+    while (!HAS_ZERO(*w)) {
+        w++;
+    }
+    for (p = (const char *) w; *p != '\0'; p++);
+    return p - s;
+}
+
+int
+strcmp(const char * a, const char * b)
+{
+    // Words can only be compared when both strings sit at the same
+    // offset within their words; otherwise fall through to bytes.
+    if (((unsigned) a & WORD_MASK) == ((unsigned) b & WORD_MASK)) {
+        for (; (unsigned) a & WORD_MASK; a++, b++) {
+            if (*a != *b || *a == '\0') {
+                return (unsigned char) *a - (unsigned char) *b;
+            }
+        }
+        const unsigned * wa = (const unsigned *) a;
+        const unsigned * wb = (const unsigned *) b;
+        while (*wa == *wb && !HAS_ZERO(*wa)) {
+            wa++, wb++;
+        }
+        a = (const char *) wa;
+        b = (const char *) wb;
+    }
+    for (; *a == *b && *a != '\0'; a++, b++);
+    return (unsigned char) *a - (unsigned char) *b;
+}
+
+char *
+strcpy(char * dst, const char * src)
+{
+    char * d = dst;
+
+    if (((unsigned) d & WORD_MASK) == ((unsigned) src & WORD_MASK)) {
+        for (; (unsigned) d & WORD_MASK; d++, src++) {
+            if ((*d = *src) == '\0') {
+                return dst;
+            }
+        }
+        unsigned * dw = (unsigned *) d;
+        const unsigned * sw = (const unsigned *) src;
+        while (!HAS_ZERO(*sw)) {
+            *dw++ = *sw++;
+        }
+        d   = (char *) dw;
+        src = (const char *) sw;
+    }
+    while ((*d++ = *src++) != '\0');
+    return dst;
+}
+
+void *
+memcpy(void * dst, const void * src, unsigned n)
+{
+    char * d       = dst;
+    const char * s = src;
+
+    if (((unsigned) d & WORD_MASK) == ((unsigned) s & WORD_MASK)) {
+        for (; n > 0 && ((unsigned) d & WORD_MASK); n--) {
+            *d++ = *s++;
+        }
+        unsigned * dw = (unsigned *) d;
+        const unsigned * sw = (const unsigned *) s;
+        for (; n >= sizeof (unsigned); n -= sizeof (unsigned)) {
+            *dw++ = *sw++;
+        }
+        d = (char *) dw;
+        s = (const char *) sw;
+    }
+    for (; n > 0; n--) {
+        *d++ = *s++;
+    }
+    return dst;
+}
+
+void *
+memset(void * dst, int c, unsigned n)
+{
+    char * d       = dst;
+    unsigned fill  = (unsigned char) c;
+
+    fill |= fill << 8;
+    fill |= fill << 16;
+
+    for (; n > 0 && ((unsigned) d & WORD_MASK); n--) {
+        *d++ = c;
+    }
+    unsigned * dw = (unsigned *) d;
+    for (; n >= sizeof (unsigned); n -= sizeof (unsigned)) {
+        *dw++ = fill;
+    }
+    for (d = (char *) dw; n > 0; n--) {
+        *d++ = c;
+    }
+    return dst;
+}
+
+/// Console output buffer.  Line buffered: a newline (or a full buffer)
+/// triggers the `Write` syscall, so `shell`-style prompt/echo traffic
+/// still appears immediately while multi-line output gets batched per
+/// line instead of per fragment.
+
+#define OBUF_SIZE  128
+
+static char obuf[OBUF_SIZE];
+static unsigned obufLen = 0;
+
+void
+FlushOutput(void)
+{
+    if (obufLen > 0) {
+        Write(obuf, obufLen, CONSOLE_OUTPUT);
+        obufLen = 0;
+    }
+}
+
+void
+PutChar(char c)
+{
+    obuf[obufLen++] = c;
+    if (obufLen == OBUF_SIZE || c == '\n') {
+        FlushOutput();
+    }
+}
+
+void
+PutStr(const char * s)
+{
+    unsigned n = strlen(s);
+
+    if (n >= OBUF_SIZE) {
+        // Too big to batch: hand it to the kernel directly.
+        FlushOutput();
+        Write(s, n, CONSOLE_OUTPUT);
+        return;
+    }
+    if (obufLen + n > OBUF_SIZE) {
+        FlushOutput();
+    }
+    memcpy(obuf + obufLen, s, n);
+    obufLen += n;
+    if (n > 0 && s[n - 1] == '\n') {
+        FlushOutput();
+    }
+}
+
+void
+PutLine(const char * s)
+{
+    PutStr(s);
+    PutChar('\n');
+}
+
+void
+PutInt(int n)
+{
+    char digits[12];
+    unsigned u = n, i = 0;
+
+    if (n < 0) {
+        PutChar('-');
+        u = -u;
+    }
+    do {
+        digits[i++] = '0' + u % 10;
+    } while ((u /= 10) > 0);
+    while (i > 0) {
+        PutChar(digits[--i]);
+    }
+}
+
+unsigned
+GetLine(char * buffer, unsigned size)
+{
+    if (!buffer || size == 0) {
+        return 0;
+    }
+    FlushOutput();
+
+    // The console delivers a `Read` as soon as a newline arrives, so the
+    // whole line comes back from a single syscall instead of the
+    // byte-per-`Read` loop programs used to carry around.
+    int n = Read(buffer, size - 1, CONSOLE_INPUT);
+    if (n <= 0) {
+        buffer[0] = '\0';
+        return 0;
+    }
+    if (buffer[n - 1] == '\n') {
+        n--;
+    }
+    buffer[n] = '\0';
+    return n;
+}
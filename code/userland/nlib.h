@@ -0,0 +1,55 @@
+/// Small runtime library for Nachos user programs.
+///
+/// The MIPS simulator charges one tick per executed instruction, so the
+/// byte-at-a-time string loops every program used to hand-roll are the
+/// most expensive way to do the job.  The routines here move a word per
+/// iteration where alignment allows, and the console helpers batch
+/// traffic so a whole line costs one `Read`/`Write` syscall instead of
+/// one per character.
+///
+/// Linked into every program by `userland/Makefile`; just include this
+/// header instead of redefining `strlen` locally.
+
+#ifndef NACHOS_USERLAND_NLIB__H
+#define NACHOS_USERLAND_NLIB__H
+
+#include "syscall.h"
+
+
+/// String and memory routines, with the usual C library semantics.
+
+unsigned strlen(const char * s);
+int strcmp(const char * a, const char * b);
+char * strcpy(char * dst, const char * src);
+void * memcpy(void * dst, const void * src, unsigned n);
+void * memset(void * dst, int c, unsigned n);
+
+
+/// Buffered console output.
+///
+/// Characters accumulate in a private buffer and reach the console in a
+/// single `Write` when the buffer fills or a newline is appended (line
+/// buffering), so interactive output still appears promptly.  Call
+/// `FlushOutput` before `Exit` if the last output did not end in a
+/// newline.
+
+void PutChar(char c);
+
+/// Write the string as is, without a trailing newline.
+void PutStr(const char * s);
+
+/// Write the string followed by a newline, and flush.
+void PutLine(const char * s);
+
+/// Write `n` in decimal.
+void PutInt(int n);
+
+void FlushOutput(void);
+
+/// Read a line from the console into `buffer` (at most `size - 1`
+/// characters), strip the newline and NUL-terminate.  Returns the length
+/// read.  Pending output is flushed first so prompts are visible.
+unsigned GetLine(char * buffer, unsigned size);
+
+
+#endif
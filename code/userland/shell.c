@@ -1,4 +1,5 @@
 #include "syscall.h"
+#include "nlib.h"
 
 #include <stdbool.h>
 #include <assert.h>
@@ -7,55 +8,6 @@
 #define MAX_LINE_SIZE 50
 #define ARG_SEPARATOR ' '
 
-static inline unsigned
-strlen(const char * s)
-{
-    if (!s) return 0;
-
-    unsigned i;
-    for (i = 0; s[i] != '\0'; i++);
-    return i;
-}
-
-static void
-reverse(char s[])
-{
-    int i, j;
-    char c;
-
-    for (i = 0, j = strlen(s) - 1; i < j; i++, j--) {
-        c    = s[i];
-        s[i] = s[j];
-        s[j] = c;
-    }
-}
-
-static void
-itoa(int n, char s[])
-{
-    int i, sign = n;
-
-    if (sign < 0) {
-        n = -n;
-    }
-    i = 0;
-    do {
-        s[i++] = n % 10 + '0';
-    } while ((n /= 10) > 0);
-    if (sign < 0) {
-        s[i++] = '-';
-    }
-    s[i] = '\0';
-    reverse(s);
-}
-
-void
-PutStr(const char * str)
-{
-    Write(str, strlen(str), CONSOLE_OUTPUT);
-    Write("\n", strlen("\n"), CONSOLE_OUTPUT);
-}
-
 static inline void
 WritePrompt(OpenFileId output)
 {
@@ -75,28 +27,6 @@ WriteError(const char * description, OpenFileId output)
     Write(SUFFIX, sizeof SUFFIX - 1, output);
 }
 
-static unsigned
-ReadLine(char * buffer, unsigned size, OpenFileId input)
-{
-    if (!buffer) return 0;
-
-    unsigned i = 0;
-    size--;
-
-    for (i = 0; i < size; i++) {
-        if (Read(&buffer[i], 1, input) != 1) {
-            WriteError("Problem with syscall Read", CONSOLE_OUTPUT);
-            return 0;
-        }
-        if (buffer[i] == '\n' || buffer[i] == '\0') {
-            break;
-        }
-    }
-    buffer[i] = '\0';
-
-    return i;
-}
-
 static bool
 PrepareArguments(char * line, char ** argv, unsigned argvSize)
 {
@@ -147,6 +77,113 @@ PrepareArguments(char * line, char ** argv, unsigned argvSize)
     return true;
 } /* PrepareArguments */
 
+/// If the arguments contain a `> file` redirection, open (creating if
+/// needed) the target, drop the tokens from `argv` and return the file
+/// id; otherwise return `CONSOLE_OUTPUT`.  Returns -1 if the target is
+/// missing or cannot be opened.
+static OpenFileId
+RedirectOutput(char ** argv)
+{
+    int i;
+
+    for (i = 1; argv[i] != NULL; i++) {
+        if (argv[i][0] == '>' && argv[i][1] == '\0') {
+            if (argv[i + 1] == NULL) {
+                WriteError("missing redirection target.", CONSOLE_OUTPUT);
+                return -1;
+            }
+            Create(argv[i + 1]);
+            OpenFileId out = Open(argv[i + 1]);
+            if (out < 0) {
+                WriteError("cannot open redirection target.", CONSOLE_OUTPUT);
+                return -1;
+            }
+            argv[i] = NULL;
+            return out;
+        }
+    }
+    return CONSOLE_OUTPUT;
+}
+
+static void
+BuiltinEcho(char ** argv, OpenFileId out)
+{
+    char buf[MAX_LINE_SIZE + 2];
+    unsigned len = 0;
+    int i;
+
+    // The arguments came from one input line, so they always fit; join
+    // them back with spaces and pay a single Write.
+    for (i = 1; argv[i] != NULL; i++) {
+        unsigned n = strlen(argv[i]);
+        if (i > 1) {
+            buf[len++] = ' ';
+        }
+        memcpy(buf + len, argv[i], n);
+        len += n;
+    }
+    buf[len++] = '\n';
+    Write(buf, len, out);
+}
+
+static int
+BuiltinCat(char ** argv, OpenFileId out)
+{
+    char buf[128];
+    int i, ret = 0;
+
+    for (i = 1; argv[i] != NULL; i++) {
+        OpenFileId fd = Open(argv[i]);
+        int r;
+
+        if (fd < 0) {
+            WriteError(argv[i], CONSOLE_OUTPUT);
+            ret = 1;
+            continue;
+        }
+        while ((r = Read(buf, sizeof buf, fd)) > 0) {
+            Write(buf, r, out);
+        }
+        Close(fd);
+    }
+    return ret;
+}
+
+/// Run `argv` in-process if its command is a builtin.  Trivial commands
+/// do not deserve executable load plus address space construction and
+/// teardown, which is where scripted sessions spend most of their
+/// simulated time.  Returns the command status, or -1 if the command is
+/// not a builtin and should be `Exec`ed as usual.
+static int
+RunBuiltin(char ** argv)
+{
+    // `argv[0]` always carries the "userland/" prefix added below.
+    const char * cmd = argv[0] + 9;
+    int isEcho = strcmp(cmd, "echo") == 0;
+    int isCat  = strcmp(cmd, "cat") == 0;
+
+    if (!isEcho && !isCat) {
+        return -1;
+    }
+
+    OpenFileId out = RedirectOutput(argv);
+    if (out < 0) {
+        return 1;
+    }
+
+    int ret = 0;
+    if (isEcho) {
+        BuiltinEcho(argv, out);
+    } else {
+        ret = BuiltinCat(argv, out);
+    }
+
+    if (out != CONSOLE_OUTPUT) {
+        Close(out);
+    }
+    return ret;
+}
+
 static int
 isexit(const char * line)
 {
@@ -172,10 +209,8 @@ isret(const char * line, int last_ret)
       (line[i + 1] == '?');
 
     if (ret) {
-        char snum[20];
-        itoa(last_ret, snum);
-        Write(snum, strlen(snum), CONSOLE_OUTPUT);
-        Write("\n", strlen("\n"), CONSOLE_OUTPUT);
+        PutInt(last_ret);
+        PutChar('\n');
     }
 
     return ret;
@@ -184,7 +219,6 @@ isret(const char * line, int last_ret)
 int
 main(void)
 {
-    const OpenFileId INPUT  = CONSOLE_INPUT;
     const OpenFileId OUTPUT = CONSOLE_OUTPUT;
     char root_line[MAX_LINE_SIZE
     + 1]        = { 'u', 's', 'e', 'r', 'l', 'a', 'n', 'd', '/' };
@@ -197,7 +231,7 @@ main(void)
 
         WritePrompt(OUTPUT);
 
-        const unsigned lineSize = ReadLine(line, MAX_LINE_SIZE, INPUT);
+        const unsigned lineSize = GetLine(line, MAX_LINE_SIZE);
 
         if (lineSize == 0) {
             continue;
@@ -220,6 +254,12 @@ main(void)
             continue;
         }
 
+        const int builtin = RunBuiltin(argv);
+        if (builtin >= 0) {
+            last_ret = builtin;
+            continue;
+        }
+
         const SpaceId newProc = Exec(root_line, argv, background ? 0 : 1);
         if (!background) {
             last_ret = Join(newProc);
@@ -129,6 +129,174 @@ Close:
         j       $31
         .end    Close
 
+        .globl  Readv
+        .ent    Readv
+Readv:
+        addiu   $2, $0, SC_READV
+        syscall
+        j       $31
+        .end    Readv
+
+        .globl  Writev
+        .ent    Writev
+Writev:
+        addiu   $2, $0, SC_WRITEV
+        syscall
+        j       $31
+        .end    Writev
+
+        .globl  Mmap
+        .ent    Mmap
+Mmap:
+        addiu   $2, $0, SC_MMAP
+        syscall
+        j       $31
+        .end    Mmap
+
+        .globl  Munmap
+        .ent    Munmap
+Munmap:
+        addiu   $2, $0, SC_MUNMAP
+        syscall
+        j       $31
+        .end    Munmap
+
+        .globl  Pipe
+        .ent    Pipe
+Pipe:
+        addiu   $2, $0, SC_PIPE
+        syscall
+        j       $31
+        .end    Pipe
+
+        .globl  Shmget
+        .ent    Shmget
+Shmget:
+        addiu   $2, $0, SC_SHMGET
+        syscall
+        j       $31
+        .end    Shmget
+
+        .globl  Shmat
+        .ent    Shmat
+Shmat:
+        addiu   $2, $0, SC_SHMAT
+        syscall
+        j       $31
+        .end    Shmat
+
+        .globl  SemInit
+        .ent    SemInit
+SemInit:
+        addiu   $2, $0, SC_SEMINIT
+        syscall
+        j       $31
+        .end    SemInit
+
+        .globl  SemP
+        .ent    SemP
+SemP:
+        addiu   $2, $0, SC_SEMP
+        syscall
+        j       $31
+        .end    SemP
+
+        .globl  SemV
+        .ent    SemV
+SemV:
+        addiu   $2, $0, SC_SEMV
+        syscall
+        j       $31
+        .end    SemV
+
+        .globl  AioRead
+        .ent    AioRead
+AioRead:
+        addiu   $2, $0, SC_AIO_READ
+        syscall
+        j       $31
+        .end    AioRead
+
+        .globl  AioWrite
+        .ent    AioWrite
+AioWrite:
+        addiu   $2, $0, SC_AIO_WRITE
+        syscall
+        j       $31
+        .end    AioWrite
+
+        .globl  AioWait
+        .ent    AioWait
+AioWait:
+        addiu   $2, $0, SC_AIO_WAIT
+        syscall
+        j       $31
+        .end    AioWait
+
+        .globl  Link
+        .ent    Link
+Link:
+        addiu   $2, $0, SC_LINK
+        syscall
+        j       $31
+        .end    Link
+
+        .globl  Rename
+        .ent    Rename
+Rename:
+        addiu   $2, $0, SC_RENAME
+        syscall
+        j       $31
+        .end    Rename
+
+        .globl  Checkpoint
+        .ent    Checkpoint
+Checkpoint:
+        addiu   $2, $0, SC_CKPT
+        syscall
+        j       $31
+        .end    Checkpoint
+
+        .globl  Sleep
+        .ent    Sleep
+Sleep:
+        addiu   $2, $0, SC_SLEEP
+        syscall
+        j       $31
+        .end    Sleep
+
+        .globl  Ticks
+        .ent    Ticks
+Ticks:
+        addiu   $2, $0, SC_TICKS
+        syscall
+        j       $31
+        .end    Ticks
+
+        .globl  ThreadTicks
+        .ent    ThreadTicks
+ThreadTicks:
+        addiu   $2, $0, SC_THREAD_TICKS
+        syscall
+        j       $31
+        .end    ThreadTicks
+
+        .globl  Sync
+        .ent    Sync
+Sync:
+        addiu   $2, $0, SC_SYNC
+        syscall
+        j       $31
+        .end    Sync
+
+        .globl  Fsync
+        .ent    Fsync
+Fsync:
+        addiu   $2, $0, SC_FSYNC
+        syscall
+        j       $31
+        .end    Fsync
+
 /// Dummy function to keep gcc happy.
         .globl  __main
         .ent    __main
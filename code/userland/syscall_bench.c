@@ -0,0 +1,51 @@
+/// Syscall latency driver: hammers each syscall enough times for the
+/// kernel's per-syscall counters (`syscall.<n>`, `.ticks`, `.maxticks`
+/// in the statistics registry) to carry stable figures.  The final Halt
+/// prints the report; add `-ss <ticks> <file>` for per-phase snapshots.
+
+#include "syscall.h"
+
+#define YIELD_ROUNDS 1000
+#define WRITE_ROUNDS 200
+#define OPEN_ROUNDS  100
+#define EXEC_ROUNDS  10
+
+int
+main(int argc, char ** argv)
+{
+    char buf[128];
+    int i, size;
+    OpenFileId o;
+
+    for (i = 0; i < 128; i++) {
+        buf[i] = 'a' + i % 26;
+    }
+
+    for (i = 0; i < YIELD_ROUNDS; i++) {
+        Yield();
+    }
+
+    /* Write at sizes 1, 8, 64: per-size figures come from differencing
+     * snapshots between phases. */
+    Create("bench.tmp");
+    o = Open("bench.tmp");
+    for (size = 1; size <= 64; size *= 8) {
+        for (i = 0; i < WRITE_ROUNDS; i++) {
+            Write(buf, size, o);
+        }
+    }
+    Close(o);
+
+    for (i = 0; i < OPEN_ROUNDS; i++) {
+        o = Open("bench.tmp");
+        Close(o);
+    }
+    Remove("bench.tmp");
+
+    for (i = 0; i < EXEC_ROUNDS; i++) {
+        Join(Exec("bench_null", NULL, 1));
+    }
+
+    Halt();
+    return 0;
+}
@@ -22,11 +22,429 @@
 #include "threads/system.hh"
 #include "lib/utility.hh"
 
-unsigned AddressSpace::last_page = 0;
-unsigned AddressSpace::next_id   = 0;
+#ifdef FILESYS_STUB
+#include <sys/mman.h>
+#endif
+
+unsigned AddressSpace::next_id    = 0;
+unsigned AddressSpace::zero_frame = NOT_ASSIGNED;
 // Valores altos para usar como flags
 const unsigned IN_SWAP = 4294967294;
 
+/// Fallos consecutivos vpn, vpn+1, ... antes de prefetchear, y cuantas
+/// paginas traer por adelantado una vez detectada la racha.
+static const unsigned SEQ_FAULT_THRESHOLD = 3;
+static const unsigned PREFETCH_PAGES      = 4;
+
+/// Ventana (en ticks) sobre la que se estima el working set de cada
+/// espacio: los fallos de una ventana cumplida pasan a ser la
+/// estimacion de la siguiente.
+static const unsigned WS_WINDOW_TICKS = 10000;
+
+/// Orden de creacion de los espacios, monotonico (ver `createSeq`).
+static unsigned spaceSeq = 0;
+
+/// Cache global de paginas de codigo residentes, clave (binario, vpn):
+/// varias instancias del mismo ejecutable comparten un unico juego de
+/// marcos de solo lectura en vez de cargar cada una su copia.  Los marcos
+/// compartidos no entran al coremap (el reloj no los desaloja); viven
+/// mientras su cuenta de referencias sea positiva.
+
+static const unsigned TEXT_CACHE_SIZE = 32;
+static const unsigned TEXT_KEY_LEN    = 60;
+
+typedef struct {
+    char     key[TEXT_KEY_LEN]; ///< Nombre del binario.
+    unsigned vpn;               ///< Pagina virtual de codigo.
+    unsigned ppn;               ///< Marco fisico compartido.
+    unsigned refs;              ///< Espacios que lo tienen mapeado.
+    bool     valid;
+} TextFrame;
+
+static TextFrame textCache[TEXT_CACHE_SIZE];
+
+/// Cache de cabeceras NOFF ya parseadas, clave el nombre del binario:
+/// los Exec repetidos del mismo ejecutable (el caso tipico de un shell
+/// en bucle) se ahorran la lectura de la cabecera y la conversion de
+/// endianness.  Se guarda la cabecera ya validada y en orden de host.
+
+static const unsigned NOFF_CACHE_SIZE = 16;
+
+typedef struct {
+    char       key[TEXT_KEY_LEN]; ///< Nombre del binario.
+    noffHeader hdr;               ///< Cabecera parseada y validada.
+    bool       valid;
+} NoffCacheEntry;
+
+static NoffCacheEntry noffCache[NOFF_CACHE_SIZE];
+static unsigned noffCacheNext = 0;
+
+static bool
+NoffLookup(const char * key, noffHeader * out)
+{
+    for (unsigned i = 0; i < NOFF_CACHE_SIZE; i++) {
+        if (noffCache[i].valid
+          && !strncmp(noffCache[i].key, key, TEXT_KEY_LEN))
+        {
+            *out = noffCache[i].hdr;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void
+NoffInsert(const char * key, const noffHeader * hdr)
+{
+    if (strlen(key) >= TEXT_KEY_LEN)
+        return; // Nombre demasiado largo para la clave: no se cachea.
+
+    unsigned i = noffCacheNext;
+    noffCacheNext = (noffCacheNext + 1) % NOFF_CACHE_SIZE;
+    strncpy(noffCache[i].key, key, TEXT_KEY_LEN);
+    noffCache[i].hdr   = *hdr;
+    noffCache[i].valid = true;
+}
+
+void
+AddressSpace::InvalidateExecCache(const char * name)
+{
+    if (name == nullptr)
+        return;
+
+    for (unsigned i = 0; i < NOFF_CACHE_SIZE; i++) {
+        if (noffCache[i].valid
+          && !strncmp(noffCache[i].key, name, TEXT_KEY_LEN))
+        {
+            noffCache[i].valid = false;
+        }
+    }
+}
+
+static int
+TextLookup(const char * key, unsigned vpn)
+{
+    for (unsigned i = 0; i < TEXT_CACHE_SIZE; i++) {
+        if (textCache[i].valid && textCache[i].vpn == vpn
+          && !strncmp(textCache[i].key, key, TEXT_KEY_LEN))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/// Registrar un marco recien cargado; si la cache esta llena, la pagina
+/// simplemente queda privada.  Devuelve si se registro.
+static bool
+TextInsert(const char * key, unsigned vpn, unsigned ppn)
+{
+    for (unsigned i = 0; i < TEXT_CACHE_SIZE; i++) {
+        if (!textCache[i].valid) {
+            strncpy(textCache[i].key, key, TEXT_KEY_LEN - 1);
+            textCache[i].key[TEXT_KEY_LEN - 1] = '\0';
+            textCache[i].vpn   = vpn;
+            textCache[i].ppn   = ppn;
+            textCache[i].refs  = 1;
+            textCache[i].valid = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Soltar una referencia; con la ultima se libera el marco.
+static void
+TextRelease(int i)
+{
+    ASSERT(textCache[i].valid && textCache[i].refs > 0);
+    if (--textCache[i].refs == 0) {
+        unsigned ppn      = textCache[i].ppn;
+        char * mainMemory = machine->GetMMU()->mainMemory;
+        memset(&mainMemory[ppn * PAGE_SIZE], 0, PAGE_SIZE);
+        machine->GetMMU()->InvalidateCodePage(ppn);
+        bitmap->Clear(ppn);
+        textCache[i].valid = false;
+    }
+}
+
+/// Espacios vivos, buscables por asid.  Con la TLB etiquetada una entrada
+/// victima puede pertenecer a otro espacio: antes de pisarla hay que
+/// devolverle sus bits de uso/modificado a su dueño, si sigue vivo.
+
+static const unsigned MAX_LIVE_SPACES = 128;
+
+static AddressSpace * liveSpaces[MAX_LIVE_SPACES];
+static unsigned liveAsids[MAX_LIVE_SPACES];
+
+static void
+RegisterSpace(unsigned asid, AddressSpace * space)
+{
+    for (unsigned i = 0; i < MAX_LIVE_SPACES; i++) {
+        if (liveSpaces[i] == nullptr) {
+            liveSpaces[i] = space;
+            liveAsids[i]  = asid;
+            return;
+        }
+    }
+    ASSERT(false); // Mas espacios vivos que ranuras.
+}
+
+static void
+UnregisterSpace(unsigned asid)
+{
+    for (unsigned i = 0; i < MAX_LIVE_SPACES; i++) {
+        if (liveSpaces[i] != nullptr && liveAsids[i] == asid) {
+            liveSpaces[i] = nullptr;
+            return;
+        }
+    }
+}
+
+static AddressSpace *
+FindSpaceByAsid(unsigned asid)
+{
+    for (unsigned i = 0; i < MAX_LIVE_SPACES; i++) {
+        if (liveSpaces[i] != nullptr && liveAsids[i] == asid) {
+            return liveSpaces[i];
+        }
+    }
+    return nullptr;
+}
+
+/// Cache de swap comprimido (estilo zswap): las paginas victimas se
+/// comprimen a un pool chico en memoria del host antes que ir al disco,
+/// y el page-in consulta el pool antes de tocar el disco.  El swap en
+/// disco queda solo para las paginas que no comprimen y para lo que el
+/// pool derrama al desbordar.  Con paginas de 128 bytes y datos tipicos
+/// (BSS en cero, pila apenas tocada) la mayoria de los page-in se
+/// resuelve a velocidad de memoria en vez de pagar el disco simulado.
+
+static const unsigned ZSWAP_SLOTS     = 64;
+static const unsigned ZSWAP_POOL_SIZE = 2048;
+
+typedef struct {
+    AddressSpace * space;
+    unsigned       vpn;
+    unsigned       offset; ///< Donde empieza lo comprimido en el pool.
+    unsigned       size;   ///< Bytes comprimidos.
+    bool           valid;
+} ZswapEntry;
+
+static ZswapEntry zswapTable[ZSWAP_SLOTS];
+static char zswapPool[ZSWAP_POOL_SIZE];
+static unsigned zswapUsed = 0;
+
+static Counter zswapStores("vmem.zswap.stores");
+static Counter zswapHits("vmem.zswap.hits");
+static Counter zswapSpills("vmem.zswap.spills");
+
+/// RLE de a pares (cuenta, byte).  Devuelve el tamanio comprimido, o
+/// `PAGE_SIZE` si no achica: una pagina que no comprime no paga el pool.
+static unsigned
+RleCompress(const char * src, char * dst)
+{
+    unsigned out = 0;
+
+    for (unsigned i = 0; i < PAGE_SIZE; ) {
+        unsigned run = 1;
+        while (i + run < PAGE_SIZE && src[i + run] == src[i] && run < 255) {
+            run++;
+        }
+        if (out + 2 >= PAGE_SIZE) {
+            return PAGE_SIZE;
+        }
+        dst[out++] = (char) run;
+        dst[out++] = src[i];
+        i += run;
+    }
+    return out;
+}
+
+static void
+RleDecompress(const char * src, unsigned size, char * dst)
+{
+    unsigned out = 0;
+
+    for (unsigned i = 0; i + 1 < size; i += 2) {
+        unsigned run = (unsigned char) src[i];
+        for (unsigned r = 0; r < run; r++) {
+            dst[out++] = src[i + 1];
+        }
+    }
+    ASSERT(out == PAGE_SIZE);
+}
+
+/// Sacar la entrada `idx` y compactar su hueco del pool.  El pool crece
+/// por el final y la compactacion corre los offsets mayores, asi que el
+/// orden por offset sigue siendo el orden de llegada.
+static void
+ZswapDrop(unsigned idx)
+{
+    ZswapEntry * e = &zswapTable[idx];
+
+    ASSERT(e->valid);
+    memmove(&zswapPool[e->offset], &zswapPool[e->offset + e->size],
+      zswapUsed - e->offset - e->size);
+    zswapUsed -= e->size;
+    for (unsigned i = 0; i < ZSWAP_SLOTS; i++) {
+        if (zswapTable[i].valid && zswapTable[i].offset > e->offset) {
+            zswapTable[i].offset -= e->size;
+        }
+    }
+    e->valid = false;
+}
+
+static int
+ZswapFind(AddressSpace * space, unsigned vpn)
+{
+    for (unsigned i = 0; i < ZSWAP_SLOTS; i++) {
+        if (zswapTable[i].valid && zswapTable[i].space == space
+          && zswapTable[i].vpn == vpn)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/// Derramar la entrada mas vieja (la de menor offset) al swap en disco
+/// de su dueño, para hacer lugar.
+static void
+ZswapSpillOldest()
+{
+    int oldest = -1;
+
+    for (unsigned i = 0; i < ZSWAP_SLOTS; i++) {
+        if (zswapTable[i].valid && (oldest < 0
+          || zswapTable[i].offset < zswapTable[oldest].offset))
+        {
+            oldest = i;
+        }
+    }
+    ASSERT(oldest >= 0);
+
+    char page[PAGE_SIZE];
+    RleDecompress(&zswapPool[zswapTable[oldest].offset],
+      zswapTable[oldest].size, page);
+    zswapTable[oldest].space->WriteSwap(zswapTable[oldest].vpn, page);
+    zswapSpills.Inc();
+    ZswapDrop(oldest);
+}
+
+/// Guardar la pagina victima en el nivel comprimido.  Devuelve false si
+/// no comprime: el que llama la manda directo al disco.
+static bool
+ZswapStore(AddressSpace * space, unsigned vpn, const char * data)
+{
+    int old = ZswapFind(space, vpn);
+
+    if (old >= 0) {
+        ZswapDrop(old); // La copia vieja quedo obsoleta.
+    }
+
+    char cbuf[PAGE_SIZE];
+    unsigned csize = RleCompress(data, cbuf);
+    if (csize >= PAGE_SIZE) {
+        return false;
+    }
+
+    while (zswapUsed + csize > ZSWAP_POOL_SIZE) {
+        ZswapSpillOldest();
+    }
+    int slot = -1;
+    for (unsigned i = 0; i < ZSWAP_SLOTS && slot < 0; i++) {
+        if (!zswapTable[i].valid) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        // Sin ranura libre aunque sobren bytes: derramar una abre lugar.
+        ZswapSpillOldest();
+        for (unsigned i = 0; i < ZSWAP_SLOTS && slot < 0; i++) {
+            if (!zswapTable[i].valid) {
+                slot = i;
+            }
+        }
+    }
+    memcpy(&zswapPool[zswapUsed], cbuf, csize);
+    zswapTable[slot].space  = space;
+    zswapTable[slot].vpn    = vpn;
+    zswapTable[slot].offset = zswapUsed;
+    zswapTable[slot].size   = csize;
+    zswapTable[slot].valid  = true;
+    zswapUsed += csize;
+    zswapStores.Inc();
+    return true;
+}
+
+/// Traer la pagina del nivel comprimido, si esta.  La entrada se
+/// descarta al usarla: toda re-expulsion reescribe el respaldo (ver
+/// `save_page`), asi que retenerla solo gastaria pool.
+static bool
+ZswapLoad(AddressSpace * space, unsigned vpn, char * data)
+{
+    int idx = ZswapFind(space, vpn);
+
+    if (idx < 0) {
+        return false;
+    }
+    RleDecompress(&zswapPool[zswapTable[idx].offset], zswapTable[idx].size,
+      data);
+    ZswapDrop(idx);
+    zswapHits.Inc();
+    return true;
+}
+
+/// Olvidar todas las paginas de un espacio que muere.
+static void
+ZswapDropSpace(AddressSpace * space)
+{
+    for (unsigned i = 0; i < ZSWAP_SLOTS; i++) {
+        if (zswapTable[i].valid && zswapTable[i].space == space) {
+            ZswapDrop(i);
+        }
+    }
+}
+
+/// Segmentos de memoria compartida: juegos de marcos fisicos con cuenta
+/// de referencias, mapeables en varios espacios a la vez.  Como los
+/// marcos de codigo compartidos, no entran al coremap: el reloj no debe
+/// desalojar un marco con mas de un dueño.  Se liberan cuando el ultimo
+/// espacio que los mapeaba muere.
+
+static const unsigned MAX_SHM_SEGS  = 8;
+static const unsigned MAX_SHM_PAGES = 16;
+
+typedef struct {
+    int      key;
+    unsigned numPgs;
+    unsigned frames[MAX_SHM_PAGES];
+    unsigned refs;
+    bool     valid;
+} ShmSegment;
+
+static ShmSegment shmTable[MAX_SHM_SEGS];
+
+/// Soltar una referencia al segmento; con la ultima se liberan los
+/// marcos.
+static void
+ShmRelease(int segId)
+{
+    ShmSegment * seg = &shmTable[segId];
+
+    ASSERT(seg->valid && seg->refs > 0);
+    if (--seg->refs == 0) {
+        char * mainMemory = machine->GetMMU()->mainMemory;
+        for (unsigned i = 0; i < seg->numPgs; i++) {
+            memset(&mainMemory[seg->frames[i] * PAGE_SIZE], 0, PAGE_SIZE);
+            machine->GetMMU()->InvalidateCodePage(seg->frames[i]);
+            bitmap->Clear(seg->frames[i]);
+        }
+        seg->valid = false;
+    }
+}
+
 /// Do little endian to big endian conversion on the bytes in the object file
 /// header, in case the file was generated on a little endian machine, and we
 /// are re now running on a big endian machine.
@@ -61,17 +479,46 @@ SwapHeader(noffHeader * noffH)
 /// * `executable` is the file containing the object code to load into
 ///   memory.
 
-AddressSpace::AddressSpace(OpenFile * _executable)
+AddressSpace::AddressSpace(OpenFile * _executable, const char * name)
 {
     executable = _executable;
 
     ASSERT(executable != nullptr);
 
-    executable->ReadAt((char *) &noffH, sizeof noffH, 0);
-    if (noffH.noffMagic != NOFF_MAGIC &&
-      WordToHost(noffH.noffMagic) == NOFF_MAGIC)
-        SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFF_MAGIC);
+    exec_key = nullptr;
+    if (name != nullptr) {
+        exec_key = arena.CopyString(name);
+    }
+
+    if (exec_key == nullptr || !NoffLookup(exec_key, &noffH)) {
+        executable->ReadAt((char *) &noffH, sizeof noffH, 0);
+        // Se aceptan las dos versiones del formato: la 2 solo agrega que
+        // los segmentos arrancan en offsets alineados a pagina dentro
+        // del archivo, asi que el mismo codigo de carga sirve para
+        // ambas.
+        if (noffH.noffMagic != NOFF_MAGIC && noffH.noffMagic != NOFF_MAGIC2
+          && (WordToHost(noffH.noffMagic) == NOFF_MAGIC
+          || WordToHost(noffH.noffMagic) == NOFF_MAGIC2))
+            SwapHeader(&noffH);
+        ASSERT(noffH.noffMagic == NOFF_MAGIC
+          || noffH.noffMagic == NOFF_MAGIC2);
+        if (exec_key != nullptr)
+            NoffInsert(exec_key, &noffH);
+    }
+
+    execImage     = nullptr;
+    execImageSize = 0;
+    #ifdef FILESYS_STUB
+    // Con el stub el ejecutable es un archivo UNIX: mapearlo solo
+    // lectura en memoria del host y copiar las paginas directo del
+    // mapeo, sin el seek+read de `ReadAt` por cada fallo.  Si el mapeo
+    // falla se sigue usando `ReadAt`.
+    execImageSize = executable->Length();
+    void * img = mmap(nullptr, execImageSize, PROT_READ, MAP_PRIVATE,
+        executable->GetHostFd(), 0);
+    if (img != MAP_FAILED)
+        execImage = (const char *) img;
+    #endif
 
     unsigned size = noffH.code.size + noffH.initData.size
       + noffH.uninitData.size + USER_STACK_SIZE;
@@ -84,41 +531,139 @@ AddressSpace::AddressSpace(OpenFile * _executable)
 
     NumPages = numPages;
 
+    // El mismo contador que numera el swap sirve de asid: las entradas de
+    // la TLB quedan estampadas con el y sobreviven los cambios de
+    // contexto.
+    asid = AddressSpace::next_id;
+
     // First, set up the translation.
-    pageTable = new TranslationEntry[numPages];
+    pageTable =
+      (TranslationEntry *) arena.Alloc(numPages * sizeof (TranslationEntry));
+    uint32_t code_begin = noffH.code.virtualAddr;
+    uint32_t code_end   = noffH.code.virtualAddr + noffH.code.size;
     for (unsigned i = 0; i < numPages; i++) {
         pageTable[i].physicalPage = NOT_ASSIGNED;
         pageTable[i].virtualPage  = i;
         pageTable[i].valid        = false;
         pageTable[i].use      = false;
         pageTable[i].dirty    = false;
-        pageTable[i].readOnly = false;
-        // If the code segment was entirely on a separate page, we could
-        // set its pages to be read-only.
+        pageTable[i].asid     = asid;
+        // Las paginas que caen enteras dentro del segmento de codigo son
+        // solo lectura: nunca se ensucian, y al desalojarlas no hay que
+        // mandarlas a swap porque el ejecutable ya las respalda.
+        uint32_t pageBegin = i * PAGE_SIZE;
+        pageTable[i].readOnly = noffH.code.size > 0
+          && pageBegin >= code_begin
+          && pageBegin + PAGE_SIZE <= code_end;
     }
+    seqNextVpn = 0;
+    seqRunLen  = 0;
+    tlbMisses  = 0;
+
+    wsWindowStart = stats->totalTicks;
+    wsFaults      = 0;
+    wsEstimate    = 0;
+    createSeq     = spaceSeq++;
+    refCount      = 1;
+    for (unsigned i = 0; i < MAX_MMAPS; i++)
+        mmaps[i].valid = false;
+    for (unsigned i = 0; i < MAX_SHM_REGIONS; i++)
+        shms[i].valid = false;
+
     // Create swap
-    swap_id = new char[20];
+    #ifdef FILESYS
+    // Con el filesystem real el swap no es un archivo mas en el disco de
+    // datos: vive en su propio disco, asi el paginado no compite con el
+    // trafico de archivos.  Alcanza con reservar una corrida de slots.
+    swapBase = swapDisk->AllocPages(numPages);
+    #else
+    swap_id = (char *) arena.Alloc(20);
     sprintf(swap_id, "swap.%u", AddressSpace::next_id);
     fileSystem->Remove(swap_id);
     fileSystem->Create(swap_id, numPages * PAGE_SIZE);
     swap = fileSystem->Open(swap_id);
     ASSERT(swap);
+    #endif
     AddressSpace::next_id = (AddressSpace::next_id + 1) % 4096;
+
+    RegisterSpace(asid, this);
 }
 
 /// Deallocate an address space.
+unsigned
+AddressSpace::GetNumPages() const
+{
+    return numPages;
+}
+
+const char *
+AddressSpace::GetExecName() const
+{
+    return exec_key;
+}
+
 AddressSpace::~AddressSpace()
 {
-    DEBUG('a', "Liberando %u paginas\n", numPages);
+    DEBUG('a', "Liberando %u paginas (%u fallos de TLB)\n", numPages,
+      tlbMisses);
+    // Desmapear lo que haya quedado mapeado, para que las paginas sucias
+    // lleguen a sus archivos antes de soltar los marcos.
+    for (unsigned i = 0; i < MAX_MMAPS; i++) {
+        if (mmaps[i].valid) {
+            Munmap(mmaps[i].startVpn * PAGE_SIZE);
+        }
+    }
+    // Soltar los segmentos compartidos: las paginas pasan a no asignadas
+    // para que el bucle de abajo no libere marcos que no son nuestros.
+    for (unsigned i = 0; i < MAX_SHM_REGIONS; i++) {
+        if (!shms[i].valid)
+            continue;
+        for (unsigned vpn = shms[i].startVpn;
+          vpn < shms[i].startVpn + shms[i].numPgs; vpn++)
+        {
+            pageTable[vpn].valid        = false;
+            pageTable[vpn].physicalPage = NOT_ASSIGNED;
+        }
+        ShmRelease(shms[i].segId);
+        shms[i].valid = false;
+    }
     for (unsigned page = 0; page < numPages; page++) {
         unsigned ppn = pageTable[page].physicalPage;
-        if (ppn != IN_SWAP && ppn != NOT_ASSIGNED)
-            bitmap->Clear(pageTable[page].physicalPage);
+        if (ppn == IN_SWAP || ppn == NOT_ASSIGNED || ppn == zero_frame)
+            continue; // Sin marco propio que liberar.
+        if (pageTable[page].readOnly && exec_key != nullptr) {
+            int t = TextLookup(exec_key, page);
+            if (t >= 0 && textCache[t].ppn == ppn) {
+                TextRelease(t); // Marco de codigo compartido.
+                continue;
+            }
+        }
+        bitmap->Clear(ppn);
+    }
+    // Invalidar las entradas de este espacio que sigan en la TLB, para
+    // que el identificador pueda reutilizarse sin traducciones fantasma.
+    for (unsigned i = 0; i < TLB_SIZE; i++) {
+        TranslationEntry e = machine->GetMMU()->Get_Entry(i);
+        if (e.valid && e.asid == asid) {
+            e.valid = false;
+            machine->GetMMU()->Set_Entry(e, i);
+        }
     }
+    ZswapDropSpace(this); // Sus paginas comprimidas ya no valen nada.
+    UnregisterSpace(asid);
+    #ifdef FILESYS_STUB
+    if (execImage != nullptr)
+        munmap((void *) execImage, execImageSize);
+    #endif
+    #ifdef FILESYS
+    swapDisk->FreePages(swapBase, numPages);
+    #else
     fileSystem->Remove(swap_id);
+    #endif
     coremap->clean_space(this);
-    delete [] pageTable;
-    delete [] swap_id;
+    // La tabla de paginas, la clave del ejecutable y el nombre del swap
+    // salieron todos del arena: se liberan juntos cuando este muere, sin
+    // recorrerlos uno por uno.
 }
 
 /// Set the initial values for the user-level register set.
@@ -148,10 +693,405 @@ AddressSpace::InitRegisters()
       numPages * PAGE_SIZE - 16);
 }
 
+unsigned
+AddressSpace::ZeroFrame()
+{
+    if (zero_frame == NOT_ASSIGNED) {
+        int frame = bitmap->Find();
+        if (frame < 0) {
+            coremap->freepage();
+            frame = bitmap->Find();
+        }
+        ASSERT(frame >= 0);
+        char * mainMemory = machine->GetMMU()->mainMemory;
+        memset(&mainMemory[frame * PAGE_SIZE], 0, PAGE_SIZE);
+        machine->GetMMU()->InvalidateCodePage(frame);
+        zero_frame = frame;
+        DEBUG('a', "Marco cero compartido reservado: %d\n", frame);
+    }
+    return zero_frame;
+}
+
+bool
+AddressSpace::IsAnonymous(unsigned vpn) const
+{
+    uint32_t VirtualAddr = vpn * PAGE_SIZE;
+    uint32_t code_begin  = noffH.code.virtualAddr;
+    uint32_t code_end    = noffH.code.virtualAddr + noffH.code.size;
+    uint32_t data_begin  = noffH.initData.virtualAddr;
+    uint32_t data_end    = noffH.initData.virtualAddr + noffH.initData.size;
+
+    return !(code_begin <= VirtualAddr && VirtualAddr <= code_end)
+           && !(data_begin <= VirtualAddr && VirtualAddr <= data_end);
+}
+
+bool
+AddressSpace::CopyZeroPage(unsigned vpn)
+{
+    if (vpn >= numPages || !pageTable[vpn].valid
+      || pageTable[vpn].physicalPage != zero_frame)
+    {
+        return false;
+    }
+
+    // Primera escritura sobre una pagina cero: darle un marco privado.
+    int frame = bitmap->Find();
+    if (frame < 0) {
+        coremap->freepage();
+        frame = bitmap->Find();
+    }
+    ASSERT(frame >= 0);
+    #ifdef VMEM
+    KickPageOutDaemon();
+    #endif
+
+    char * mainMemory = machine->GetMMU()->mainMemory;
+    memset(&mainMemory[frame * PAGE_SIZE], 0, PAGE_SIZE);
+    machine->GetMMU()->InvalidateCodePage(frame);
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].readOnly     = false;
+    coremap->store(vpn, this);
+
+    // Si la TLB tiene la copia vieja (solo lectura, marco cero),
+    // reemplazarla para que la escritura se reintente sin otro fallo.
+    for (unsigned i = 0; i < TLB_SIZE; i++) {
+        TranslationEntry e = machine->GetMMU()->Get_Entry(i);
+        if (e.valid && e.asid == asid && e.virtualPage == vpn) {
+            machine->GetMMU()->Set_Entry(pageTable[vpn], i);
+        }
+    }
+    DEBUG('a', "Copia privada de pagina cero %u en %d\n", vpn, frame);
+    return true;
+}
+
+AddressSpace::MmapRegion *
+AddressSpace::FindMmap(unsigned vpn)
+{
+    for (unsigned i = 0; i < MAX_MMAPS; i++) {
+        if (mmaps[i].valid && vpn >= mmaps[i].startVpn
+          && vpn < mmaps[i].startVpn + mmaps[i].numPgs)
+        {
+            return &mmaps[i];
+        }
+    }
+    return nullptr;
+}
+
+int
+AddressSpace::Mmap(OpenFile * mapFile)
+{
+    if (mapFile == nullptr || mapFile->Length() <= 0) {
+        return -1;
+    }
+    int slot = -1;
+    for (unsigned i = 0; i < MAX_MMAPS; i++) {
+        if (!mmaps[i].valid) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return -1;
+    }
+
+    // La region se agrega al final del espacio: extender la tabla de
+    // paginas.  Nadie guarda punteros a las entradas viejas (la TLB y el
+    // coremap trabajan con copias e indices), asi que realojarla es
+    // seguro.  La tabla vieja queda abandonada dentro del arena hasta que
+    // el espacio muera; extender es raro y el desperdicio, acotado.
+    unsigned pages = DivRoundUp(mapFile->Length(), PAGE_SIZE);
+    TranslationEntry * newTable = (TranslationEntry *)
+      arena.Alloc((numPages + pages) * sizeof (TranslationEntry));
+    for (unsigned i = 0; i < numPages; i++)
+        newTable[i] = pageTable[i];
+    for (unsigned i = numPages; i < numPages + pages; i++) {
+        newTable[i].physicalPage = NOT_ASSIGNED;
+        newTable[i].virtualPage  = i;
+        newTable[i].valid    = false;
+        newTable[i].use      = false;
+        newTable[i].dirty    = false;
+        newTable[i].readOnly = false;
+        newTable[i].asid     = asid;
+    }
+    pageTable = newTable;
+
+    mmaps[slot].startVpn = numPages;
+    mmaps[slot].numPgs   = pages;
+    mmaps[slot].file     = mapFile;
+    mmaps[slot].valid    = true;
+    numPages += pages;
+
+    DEBUG('a', "Mapeo de %u paginas desde la vpn %u\n", pages,
+      mmaps[slot].startVpn);
+    return mmaps[slot].startVpn * PAGE_SIZE;
+}
+
+int
+AddressSpace::Munmap(unsigned addr)
+{
+    unsigned startVpn  = addr / PAGE_SIZE;
+    MmapRegion * m     = nullptr;
+    for (unsigned i = 0; i < MAX_MMAPS; i++) {
+        if (mmaps[i].valid && mmaps[i].startVpn == startVpn) {
+            m = &mmaps[i];
+            break;
+        }
+    }
+    if (m == nullptr) {
+        return -1;
+    }
+
+    char * mainMemory = machine->GetMMU()->mainMemory;
+    for (unsigned vpn = m->startVpn; vpn < m->startVpn + m->numPgs; vpn++) {
+        // Sincronizar e invalidar la copia que quede en la TLB.
+        for (unsigned i = 0; i < TLB_SIZE; i++) {
+            TranslationEntry e = machine->GetMMU()->Get_Entry(i);
+            if (e.valid && e.asid == asid && e.virtualPage == vpn) {
+                pageTable[vpn] = e;
+                e.valid = false;
+                machine->GetMMU()->Set_Entry(e, i);
+            }
+        }
+        if (!pageTable[vpn].valid
+          || pageTable[vpn].physicalPage >= NUM_PHYS_PAGES)
+        {
+            continue; // Nunca cargada.
+        }
+        unsigned ppn = pageTable[vpn].physicalPage;
+        if (pageTable[vpn].dirty) {
+            // Escribir la pagina sucia de vuelta al archivo, sin pasarse
+            // de su largo en la cola.
+            unsigned off = (vpn - m->startVpn) * PAGE_SIZE;
+            unsigned n   = PAGE_SIZE;
+            if (off + n > (unsigned) m->file->Length())
+                n = m->file->Length() - off;
+            m->file->WriteAt(&mainMemory[ppn * PAGE_SIZE], n, off);
+        }
+        coremap->remove(ppn);
+        bitmap->Clear(ppn);
+        memset(&mainMemory[ppn * PAGE_SIZE], 0, PAGE_SIZE);
+        machine->GetMMU()->InvalidateCodePage(ppn);
+        pageTable[vpn].valid        = false;
+        pageTable[vpn].dirty        = false;
+        pageTable[vpn].physicalPage = NOT_ASSIGNED;
+    }
+    m->valid = false;
+    return 0;
+}
+
+int
+AddressSpace::AllocUserStack()
+{
+    unsigned pages = DivRoundUp(USER_STACK_SIZE, PAGE_SIZE);
+
+    #ifdef FILESYS
+    // El swap del espacio es una corrida contigua indexada por vpn
+    // (slot = swapBase + vpn): para crecer hay que pedir una corrida
+    // nueva del tamanio nuevo y migrar los slots de las paginas que ya
+    // estan en swap.
+    unsigned newBase = swapDisk->AllocPages(numPages + pages);
+    char migrated[PAGE_SIZE];
+    for (unsigned vpn = 0; vpn < numPages; vpn++) {
+        if (pageTable[vpn].physicalPage == IN_SWAP) {
+            swapDisk->ReadPage(swapBase + vpn, migrated);
+            swapDisk->WritePage(newBase + vpn, migrated);
+        }
+    }
+    swapBase = newBase;
+    #endif
+    // (Con el stub el archivo de swap crece solo al escribir mas alla
+    // del final; no hay nada que migrar.)
+
+    // Extender la tabla de paginas igual que en Mmap: la pila nueva se
+    // agrega al final del espacio, con paginas anonimas que el fallo de
+    // pagina resuelve contra el marco cero hasta la primera escritura.
+    TranslationEntry * newTable = (TranslationEntry *)
+      arena.Alloc((numPages + pages) * sizeof (TranslationEntry));
+    for (unsigned i = 0; i < numPages; i++)
+        newTable[i] = pageTable[i];
+    for (unsigned i = numPages; i < numPages + pages; i++) {
+        newTable[i].physicalPage = NOT_ASSIGNED;
+        newTable[i].virtualPage  = i;
+        newTable[i].valid    = false;
+        newTable[i].use      = false;
+        newTable[i].dirty    = false;
+        newTable[i].readOnly = false;
+        newTable[i].asid     = asid;
+    }
+    pageTable = newTable;
+    numPages += pages;
+
+    DEBUG('a', "Pila nueva de %u paginas, hasta la vpn %u\n", pages,
+      numPages);
+    // Mismo margen que InitRegisters deja en la pila principal.
+    return numPages * PAGE_SIZE - 16;
+}
+
+void
+AddressSpace::Ref()
+{
+    refCount++;
+}
+
+bool
+AddressSpace::Unref()
+{
+    ASSERT(refCount > 0);
+    return --refCount == 0;
+}
+
+int
+AddressSpace::ShmGet(int key, unsigned bytes)
+{
+    // Si la clave ya existe, los procesos comparten el mismo segmento.
+    for (unsigned i = 0; i < MAX_SHM_SEGS; i++) {
+        if (shmTable[i].valid && shmTable[i].key == key) {
+            return i;
+        }
+    }
+    unsigned pages = DivRoundUp(bytes, PAGE_SIZE);
+    if (pages == 0 || pages > MAX_SHM_PAGES) {
+        return -1;
+    }
+    int slot = -1;
+    for (unsigned i = 0; i < MAX_SHM_SEGS; i++) {
+        if (!shmTable[i].valid) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return -1;
+    }
+
+    ShmSegment * seg  = &shmTable[slot];
+    char * mainMemory = machine->GetMMU()->mainMemory;
+    for (unsigned i = 0; i < pages; i++) {
+        int frame = bitmap->Find();
+        if (frame < 0) {
+            coremap->freepage();
+            frame = bitmap->Find();
+        }
+        ASSERT(frame >= 0);
+        memset(&mainMemory[frame * PAGE_SIZE], 0, PAGE_SIZE);
+        machine->GetMMU()->InvalidateCodePage(frame);
+        seg->frames[i] = frame;
+    }
+    #ifdef VMEM
+    KickPageOutDaemon();
+    #endif
+    seg->key    = key;
+    seg->numPgs = pages;
+    seg->refs   = 0;
+    seg->valid  = true;
+    DEBUG('a', "Segmento compartido %d: %u paginas\n", slot, pages);
+    return slot;
+}
+
+int
+AddressSpace::ShmAttach(int segId)
+{
+    if (segId < 0 || segId >= (int) MAX_SHM_SEGS
+      || !shmTable[segId].valid)
+    {
+        return -1;
+    }
+    int slot = -1;
+    for (unsigned i = 0; i < MAX_SHM_REGIONS; i++) {
+        if (!shms[i].valid) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return -1;
+    }
+
+    // Igual que Mmap: la region se agrega al final del espacio, pero las
+    // paginas nacen validas apuntando a los marcos compartidos, asi que
+    // nunca fallan ni se desalojan.
+    ShmSegment * seg = &shmTable[segId];
+    TranslationEntry * newTable =
+      new TranslationEntry[numPages + seg->numPgs];
+    for (unsigned i = 0; i < numPages; i++)
+        newTable[i] = pageTable[i];
+    for (unsigned i = 0; i < seg->numPgs; i++) {
+        newTable[numPages + i].physicalPage = seg->frames[i];
+        newTable[numPages + i].virtualPage  = numPages + i;
+        newTable[numPages + i].valid    = true;
+        newTable[numPages + i].use      = false;
+        newTable[numPages + i].dirty    = false;
+        newTable[numPages + i].readOnly = false;
+        newTable[numPages + i].asid     = asid;
+    }
+    pageTable = newTable;
+
+    shms[slot].startVpn = numPages;
+    shms[slot].numPgs   = seg->numPgs;
+    shms[slot].segId    = segId;
+    shms[slot].valid    = true;
+    seg->refs++;
+    numPages += seg->numPgs;
+
+    DEBUG('a', "Segmento %d mapeado en la vpn %u\n", segId,
+      shms[slot].startVpn);
+    return shms[slot].startVpn * PAGE_SIZE;
+}
+
 bool
 AddressSpace::LoadPage(unsigned vpn)
 {
     if (!pageTable[vpn].valid) {
+        // Las paginas de un mapeo se traen del propio archivo; van antes
+        // que el chequeo de pagina anonima porque estan fuera de los
+        // segmentos del ejecutable.
+        MmapRegion * m = FindMmap(vpn);
+        if (m != nullptr) {
+            int frame = bitmap->Find();
+            if (frame < 0) {
+                coremap->freepage();
+                frame = bitmap->Find();
+            }
+            ASSERT(frame >= 0);
+            #ifdef VMEM
+            KickPageOutDaemon();
+            #endif
+            char * mainMemory = machine->GetMMU()->mainMemory;
+            unsigned off      = (vpn - m->startVpn) * PAGE_SIZE;
+            unsigned n        = PAGE_SIZE;
+            if (off + n > (unsigned) m->file->Length())
+                n = m->file->Length() - off;
+            memset(&mainMemory[frame * PAGE_SIZE], 0, PAGE_SIZE);
+            m->file->ReadAt(&mainMemory[frame * PAGE_SIZE], n, off);
+            machine->GetMMU()->InvalidateCodePage(frame);
+            pageTable[vpn].physicalPage = frame;
+            pageTable[vpn].valid        = true;
+            coremap->store(vpn, this);
+            return true;
+        }
+        // BSS y pila no tienen respaldo en el ejecutable: hasta la
+        // primera escritura alcanza con el marco cero compartido, sin
+        // gastar un marco propio ni copiar nada.
+        if (!swap_find(vpn) && IsAnonymous(vpn)) {
+            pageTable[vpn].physicalPage = ZeroFrame();
+            pageTable[vpn].valid        = true;
+            pageTable[vpn].readOnly     = true;
+            return true;
+        }
+        // Si otra instancia del mismo binario ya tiene esta pagina de
+        // codigo residente, compartir su marco en vez de cargar otra
+        // copia.
+        if (pageTable[vpn].readOnly && exec_key != nullptr) {
+            int t = TextLookup(exec_key, vpn);
+            if (t >= 0) {
+                textCache[t].refs++;
+                pageTable[vpn].physicalPage = textCache[t].ppn;
+                pageTable[vpn].valid        = true;
+                DEBUG('a', "Compartiendo codigo %u en %u\n", vpn,
+                  textCache[t].ppn);
+                return true;
+            }
+        }
         // Asigno una pagina en memoria
         DEBUG('a', "\tbitmap size: %u\n\tcoremap size: %u\n",
           bitmap->CountNotClear(), coremap->length());
@@ -161,6 +1101,11 @@ AddressSpace::LoadPage(unsigned vpn)
             next_page = bitmap->Find();
         }
         ASSERT(next_page >= 0);
+        #ifdef VMEM
+        // Que el demonio reponga la reserva de marcos libres mientras
+        // este fallo sigue con su lectura.
+        KickPageOutDaemon();
+        #endif
         DEBUG('a', "Cargando Pagina %u en %d\n", vpn, next_page);
         if (swap_find(vpn)) {
             DEBUG('a', "Cargando desde swap\n");
@@ -185,15 +1130,126 @@ AddressSpace::LoadPage(unsigned vpn)
                   + (VirtualAddr - data_begin);
             }
             memset(&mainMemory[PhysicalAddr], 0, PAGE_SIZE);
-            executable->ReadAt(&(mainMemory[PhysicalAddr]), PAGE_SIZE,
-              inFileAddr);
+            if (execImage != nullptr && inFileAddr < execImageSize) {
+                // Copia directa del mapeo del ejecutable; con el formato
+                // alineado los segmentos empiezan en multiplos de
+                // PAGE_SIZE y la copia es una pagina entera alineada.
+                unsigned n = PAGE_SIZE;
+                if (inFileAddr + n > execImageSize)
+                    n = execImageSize - inFileAddr;
+                memcpy(&mainMemory[PhysicalAddr], &execImage[inFileAddr],
+                  n);
+            } else {
+                executable->ReadAt(&(mainMemory[PhysicalAddr]), PAGE_SIZE,
+                  inFileAddr);
+            }
+            machine->GetMMU()->InvalidateCodePage(
+                pageTable[vpn].physicalPage);
             pageTable[vpn].valid = true;
         }
+        // Una pagina de codigo recien cargada se publica en la cache de
+        // texto para que las proximas instancias la compartan; si entro,
+        // no va al coremap (el reloj no debe desalojar marcos
+        // compartidos).
+        if (pageTable[vpn].readOnly && exec_key != nullptr
+          && TextInsert(exec_key, vpn, next_page))
+        {
+            return true;
+        }
         coremap->store(vpn, this);
     }
     return pageTable[vpn].valid;
 } // AddressSpace::LoadPage
 
+void
+AddressSpace::PrefetchAfter(unsigned vpn)
+{
+    for (unsigned p = vpn + 1;
+      p <= vpn + PREFETCH_PAGES && p < numPages; p++)
+    {
+        if (pageTable[p].valid) {
+            continue; // Ya residente.
+        }
+        if (bitmap->CountClear() == 0) {
+            break; // Solo usar marcos libres: prefetchear no desaloja.
+        }
+        DEBUG('a', "Prefetch de la pagina %u\n", p);
+        LoadPage(p);
+    }
+}
+
+/// Registrar un fallo de pagina en la estimacion de working set.
+///
+/// Fallos por ventana aproxima paginas distintas tocadas cuando el
+/// proceso pagina sano, y la sobreestima justo cuando las paginas se
+/// desalojan entre si -- que es exactamente la señal de presion que el
+/// control de admision necesita.
+void
+AddressSpace::CountFault()
+{
+    unsigned now = stats->totalTicks;
+
+    if (now - wsWindowStart >= WS_WINDOW_TICKS) {
+        // Ventana cumplida: lo acumulado pasa a ser la estimacion.  Si
+        // paso mas de una ventana entera sin fallos, lo acumulado ya
+        // esta viejo y el espacio estuvo quieto.
+        wsEstimate = now - wsWindowStart < 2 * WS_WINDOW_TICKS
+          ? wsFaults : 0;
+        wsFaults      = 0;
+        wsWindowStart = now;
+    }
+    wsFaults++;
+}
+
+unsigned
+AddressSpace::WorkingSet() const
+{
+    unsigned age = stats->totalTicks - wsWindowStart;
+
+    if (age >= 2 * WS_WINDOW_TICKS) {
+        return 0; // Dos ventanas sin fallar: el espacio esta quieto.
+    }
+    unsigned ws = age >= WS_WINDOW_TICKS ? wsFaults
+      : (wsEstimate > wsFaults ? wsEstimate : wsFaults);
+    // Un espacio nunca demanda mas marcos que paginas tiene.
+    return ws > numPages ? numPages : ws;
+}
+
+/// El mas nuevo de los espacios que paginan debe suspenderse?
+///
+/// La demanda agregada es la suma de los working sets vivos; mientras
+/// supere los marcos fisicos, los fallos de `space` (si es el mas nuevo
+/// que esta fallando, y no el unico) deben esperar en vez de desalojar
+/// paginas que los demas van a volver a pedir.  Como la estimacion del
+/// suspendido decae sola, la presion medida baja mientras duerme y el
+/// control lo deja pasar de nuevo cuando los demas aflojan.
+bool
+AddressSpace::ShouldThrottle(AddressSpace * space)
+{
+    ASSERT(space != nullptr);
+
+    unsigned total    = 0;
+    unsigned faulting = 0;
+    AddressSpace * newest = nullptr;
+
+    for (unsigned i = 0; i < MAX_LIVE_SPACES; i++) {
+        AddressSpace * s = liveSpaces[i];
+        if (s == nullptr) {
+            continue;
+        }
+        unsigned ws = s->WorkingSet();
+        if (ws == 0) {
+            continue;
+        }
+        total += ws;
+        faulting++;
+        if (newest == nullptr || s->createSeq > newest->createSeq) {
+            newest = s;
+        }
+    }
+    return total > NUM_PHYS_PAGES && faulting > 1 && newest == space;
+}
+
 bool
 AddressSpace::Update_TLB(unsigned vpn)
 {
@@ -208,19 +1264,63 @@ AddressSpace::Update_TLB(unsigned vpn)
     if (!LoadPage(vpn)) {
         DEBUG('a', "LoadPage retorno false para %u\n", vpn);
     }
-    // Busco pagina victima en TLB
-    unsigned next     = (AddressSpace::last_page++) % TLB_SIZE;
-    unsigned next_vpn = machine->GetMMU()->Get_Entry(next).virtualPage;
+    // Un recorrido lineal falla en vpn, vpn+1, ...: detectar la racha y
+    // adelantar las paginas que siguen.
+    if (vpn == seqNextVpn) {
+        seqRunLen++;
+    } else {
+        seqRunLen = 1;
+    }
+    seqNextVpn = vpn + 1;
+    if (seqRunLen >= SEQ_FAULT_THRESHOLD) {
+        PrefetchAfter(vpn);
+    }
+    tlbMisses++;
+    InstallTlbEntry(vpn);
+    return true;
+}
+
+/// Elegir la victima LRU de la TLB, devolverle sus bits a su dueño e
+/// instalar la entrada de `vpn` en su lugar.
+void
+AddressSpace::InstallTlbEntry(unsigned vpn)
+{
+    unsigned next = machine->GetMMU()->PickLruEntry();
+    TranslationEntry victim = machine->GetMMU()->Get_Entry(next);
 
-    // Guardo la pagina victima en memoria y actualizo la tlb
-    if (machine->GetMMU()->Get_Entry(next).valid) {
-        pageTable[next_vpn] = machine->GetMMU()->Get_Entry(next);
+    // Guardo la pagina victima en su tabla y actualizo la tlb.  Con la
+    // TLB etiquetada la victima puede ser de otro espacio: sus bits de
+    // uso/modificado van a la tabla de su dueño, si sigue vivo.
+    if (victim.valid) {
+        if (victim.asid == asid) {
+            pageTable[victim.virtualPage] = victim;
+        } else {
+            AddressSpace * owner = FindSpaceByAsid(victim.asid);
+            if (owner != nullptr && victim.virtualPage < owner->numPages) {
+                owner->pageTable[victim.virtualPage] = victim;
+            }
+        }
     }
     machine->GetMMU()->Set_Entry(pageTable[vpn], next);
-    coremap->access(pageTable[vpn].physicalPage);
     DEBUG('a', "Swapeando %d(%d) con %d(%d)\n", vpn,
-      pageTable[vpn].physicalPage, next_vpn,
-      pageTable[next_vpn].physicalPage);
+      pageTable[vpn].physicalPage, victim.virtualPage,
+      victim.physicalPage);
+}
+
+/// Camino rapido del fallo de TLB: si la pagina ya esta residente el
+/// fallo es una pura recarga de TLB, y alcanza con instalar la entrada.
+/// Nada de contabilidad de working set, carga de paginas ni deteccion
+/// de rachas: con 8 entradas de TLB estas recargas son el grueso de los
+/// fallos, y cada instruccion que le ahorramos al camino se nota.
+/// Devuelve false si la pagina no esta: hace falta el camino completo.
+bool
+AddressSpace::RefillTLB(unsigned vpn)
+{
+    if (vpn >= numPages || !pageTable[vpn].valid) {
+        return false;
+    }
+    tlbMisses++;
+    InstallTlbEntry(vpn);
     return true;
 }
 
@@ -237,11 +1337,24 @@ AddressSpace::SaveState()
 /// On a context switch, restore the machine state so that this address space
 /// can run.
 ///
-/// For now, tell the machine where to find the page table.
+/// Con la TLB etiquetada no hay nada que vaciar ni recargar: basta con
+/// cambiar el identificador vigente y las entradas de otros espacios dejan
+/// de matchear solas.  Las propias que hayan sobrevivido siguen valiendo,
+/// asi que el cambio de contexto no paga la rafaga de fallos de TLB.
 void
 AddressSpace::RestoreState()
 {
-    machine->GetMMU()->Set_TLB(pageTable, numPages);
+    machine->GetMMU()->SetAsid(asid);
+}
+
+void
+AddressSpace::WriteSwap(unsigned vpn, const char * buf)
+{
+    #ifdef FILESYS
+    swapDisk->WritePage(swapBase + vpn, buf);
+    #else
+    swap->WriteAt(buf, PAGE_SIZE, vpn * PAGE_SIZE);
+    #endif
 }
 
 void
@@ -251,7 +1364,13 @@ AddressSpace::save_page(unsigned vpn)
     bool dirty = false;
 
     for (unsigned i = 0; i < TLB_SIZE; i++) {
-        if (machine->GetMMU()->Get_Entry(i).virtualPage == vpn) {
+        // Sin vaciados por cambio de contexto, la TLB acumula entradas
+        // viejas: solo una valida, de este espacio y con esta vpn tiene
+        // bits frescos que sincronizar.
+        if (machine->GetMMU()->Get_Entry(i).valid
+          && machine->GetMMU()->Get_Entry(i).asid == asid
+          && machine->GetMMU()->Get_Entry(i).virtualPage == vpn)
+        {
             *page       = machine->GetMMU()->Get_Entry(i);
             dirty       = page->dirty;
             page->valid = false;
@@ -263,14 +1382,52 @@ AddressSpace::save_page(unsigned vpn)
     char * mainMemory     = machine->GetMMU()->mainMemory;
     uint32_t PhysicalAddr = page->physicalPage * PAGE_SIZE;
 
+    MmapRegion * m = FindMmap(vpn);
+    if (m != nullptr) {
+        // Pagina de un mapeo: su respaldo es el propio archivo, nunca el
+        // swap.  Solo las sucias se escriben; el resto se descarta.
+        if (dirty || page->dirty) {
+            unsigned off = (vpn - m->startVpn) * PAGE_SIZE;
+            unsigned n   = PAGE_SIZE;
+            if (off + n > (unsigned) m->file->Length())
+                n = m->file->Length() - off;
+            m->file->WriteAt(&mainMemory[PhysicalAddr], n, off);
+        }
+        bitmap->Clear(page->physicalPage);
+        memset(&mainMemory[PhysicalAddr], 0, PAGE_SIZE);
+        machine->GetMMU()->InvalidateCodePage(page->physicalPage);
+        page->valid        = false;
+        page->dirty        = false;
+        page->physicalPage = NOT_ASSIGNED;
+        return;
+    }
+
+    if (page->readOnly) {
+        // Pagina de codigo: el ejecutable ya la respalda, asi que se
+        // descarta sin escribir nada y se recarga de alli si hace falta.
+        bitmap->Clear(page->physicalPage);
+        memset(&mainMemory[PhysicalAddr], 0, PAGE_SIZE);
+        machine->GetMMU()->InvalidateCodePage(page->physicalPage);
+        page->valid        = false;
+        page->dirty        = false;
+        page->physicalPage = NOT_ASSIGNED;
+        return;
+    }
+
     if (dirty || !swap_find(vpn)) {
-        swap->WriteAt(&mainMemory[PhysicalAddr], PAGE_SIZE, vpn * PAGE_SIZE);
+        // Primero al nivel comprimido en RAM; al disco solo si la pagina
+        // no comprime (los desbordes del pool derraman solos las
+        // entradas mas viejas).
+        if (!ZswapStore(this, vpn, &mainMemory[PhysicalAddr])) {
+            WriteSwap(vpn, &mainMemory[PhysicalAddr]);
+        }
         DEBUG('a', "Enviando %u a swap con %x\n", vpn,
           ((int *) mainMemory)[PhysicalAddr]);
     }
 
     bitmap->Clear(page->physicalPage);
     memset(&mainMemory[PhysicalAddr], 0, PAGE_SIZE);
+    machine->GetMMU()->InvalidateCodePage(page->physicalPage);
     page->valid        = false;
     page->dirty        = false;
     page->physicalPage = IN_SWAP;
@@ -282,7 +1439,15 @@ AddressSpace::load_page(unsigned vpn, unsigned ppn)
     ASSERT(swap_find(vpn));
     char * mainMemory     = machine->GetMMU()->mainMemory;
     uint32_t PhysicalAddr = ppn * PAGE_SIZE;
-    swap->ReadAt(&mainMemory[PhysicalAddr], PAGE_SIZE, vpn * PAGE_SIZE);
+    // El nivel comprimido primero: un hit ahorra la lectura de disco.
+    if (!ZswapLoad(this, vpn, &mainMemory[PhysicalAddr])) {
+        #ifdef FILESYS
+        swapDisk->ReadPage(swapBase + vpn, &mainMemory[PhysicalAddr]);
+        #else
+        swap->ReadAt(&mainMemory[PhysicalAddr], PAGE_SIZE, vpn * PAGE_SIZE);
+        #endif
+    }
+    machine->GetMMU()->InvalidateCodePage(ppn);
 
     pageTable[vpn].valid        = true;
     pageTable[vpn].virtualPage  = vpn;
@@ -15,6 +15,7 @@
 
 
 #include "filesys/file_system.hh"
+#include "lib/arena.hh"
 #include "machine/translation_entry.hh"
 #include "../bin/noff.h"
 
@@ -28,7 +29,9 @@ public:
     /// the file `executable`.
     ///
     /// * `executable` is the open file that corresponds to the program.
-    AddressSpace(OpenFile * executable);
+    /// * `name`, if given, identifies the binary so that instances of the
+    ///   same program can share their read-only code frames.
+    AddressSpace(OpenFile * executable, const char * name = nullptr);
 
     /// De-allocate an address space.
     ~AddressSpace();
@@ -46,6 +49,85 @@ public:
     bool
     Update_TLB(unsigned vpn);
 
+    /// Camino rapido del fallo de TLB: si `vpn` ya esta residente,
+    /// instalar su entrada y listo.  Devuelve false si la pagina no
+    /// esta y hay que pasar por el camino completo (`Update_TLB`).
+    bool
+    RefillTLB(unsigned vpn);
+
+    /// Darle marco propio a una vpn que compartia el marco cero (fallo de
+    /// escritura sobre BSS/pila sin tocar).  Devuelve false si la vpn no
+    /// estaba mapeada al marco cero: es una violacion real.
+    bool
+    CopyZeroPage(unsigned vpn);
+
+    /// Agregar al final del espacio una pila propia para un hilo nuevo
+    /// (`SC_FORK`).  Las paginas son anonimas y lazy-zero, como la pila
+    /// principal.  Devuelve el valor inicial del puntero de pila, o -1.
+    int
+    AllocUserStack();
+
+    /// Cuenta de hilos que comparten este espacio: `Ref` suma uno, y
+    /// `Unref` devuelve true si cayo la ultima referencia y el espacio
+    /// debe destruirse (ver el destructor de `Thread`).
+    void
+    Ref();
+    bool
+    Unref();
+
+    /// Mapear `mapFile` al final del espacio de direcciones.  Las paginas
+    /// se cargan a demanda desde el archivo y las sucias vuelven a el al
+    /// desmapear.  Devuelve la direccion virtual del mapeo, o -1.
+    int
+    Mmap(OpenFile * mapFile);
+
+    /// Deshacer el mapeo que empieza en `addr`, escribiendo las paginas
+    /// sucias al archivo.  Devuelve 0, o -1 si `addr` no es un mapeo.
+    int
+    Munmap(unsigned addr);
+
+    /// Crear (u obtener, si `key` ya existe) un segmento de memoria
+    /// compartida de al menos `bytes` bytes.  Devuelve su id, o -1.
+    static int
+    ShmGet(int key, unsigned bytes);
+
+    /// Olvidar la cabecera NOFF cacheada del binario `name`, si la hay.
+    /// Hay que llamarla al borrar o recrear un ejecutable, para que el
+    /// proximo Exec vuelva a leerla del archivo.
+    static void
+    InvalidateExecCache(const char * name);
+
+    /// Mapear el segmento `segId` en este espacio.  Los marcos son
+    /// compartidos entre todos los espacios que lo mapeen y no se
+    /// desalojan.  Devuelve la direccion virtual del mapeo, o -1.
+    int
+    ShmAttach(int segId);
+
+    /// Tamanio del espacio y nombre del binario que lo respalda; los usa
+    /// el checkpoint (cf. `checkpoint.cc`) para validar que el restore
+    /// corre contra el mismo ejecutable.
+    unsigned
+    GetNumPages() const;
+    const char *
+    GetExecName() const;
+
+    /// Registrar un fallo de pagina en la estimacion de working set del
+    /// espacio (fallos sobre una ventana deslizante de ticks).
+    void
+    CountFault();
+
+    /// Estimacion vigente del working set, en paginas.  Decae sola: un
+    /// espacio que dejo de fallar (o esta suspendido) deja de contar.
+    unsigned
+    WorkingSet() const;
+
+    /// Control de admision contra el thrashing: la demanda agregada de
+    /// los espacios vivos supera los marcos fisicos, y `space` es el mas
+    /// nuevo de los que estan paginando?  Si es asi, sus hilos deben
+    /// suspenderse hasta que la presion baje.
+    static bool
+    ShouldThrottle(AddressSpace * space);
+
     void
     save_page(unsigned vpn);
     void
@@ -53,24 +135,131 @@ public:
     bool
     swap_find(unsigned vpn);
 
+    /// Escribir el respaldo en disco de `vpn` directamente, salteando el
+    /// nivel comprimido (lo usa la cache de swap al derramar).
+    void
+    WriteSwap(unsigned vpn, const char * buf);
+
     /// Assume linear page table translation for now!
     TranslationEntry * pageTable;
 
+    /// Fallos de TLB atribuidos a este espacio, para medir el trafico de
+    /// recarga por proceso (los contadores globales estan en `stats`).
+    unsigned tlbMisses;
+
 private:
 
-    static unsigned last_page;
     static unsigned next_id;
 
+    /// Marco fisico compartido, siempre en cero, al que se mapean solo
+    /// lectura las paginas de BSS/pila hasta su primera escritura.
+    /// Se reserva recien cuando hace falta; nunca entra al coremap.
+    static unsigned zero_frame;
+
+    /// Reservar (si hace falta) y devolver el marco cero.
+    static unsigned
+    ZeroFrame();
+
     /// Number of pages in the virtual address space.
     unsigned numPages;
 
+    /// Arena del que sale toda la metadata del espacio (tabla de paginas,
+    /// clave del ejecutable, nombre del swap): el destructor la libera
+    /// entera de un golpe en vez de recorrer pieza por pieza.
+    Arena arena;
+
+    /// Identificador con que se etiquetan las entradas de este espacio en
+    /// la TLB: al cambiar de contexto alcanza con cambiar el identificador
+    /// vigente en la MMU en vez de vaciar la TLB entera.
+    unsigned asid;
+
+    /// Historial de fallos para detectar recorridos lineales: la vpn que
+    /// continuaria la racha actual y cuantos fallos consecutivos lleva.
+    unsigned seqNextVpn;
+    unsigned seqRunLen;
+
+    /// Estimacion de working set: tick en que empezo la ventana vigente,
+    /// fallos acumulados en ella, y fallos de la ultima ventana cumplida
+    /// (la estimacion propiamente dicha).
+    unsigned wsWindowStart;
+    unsigned wsFaults;
+    unsigned wsEstimate;
+
+    /// Orden de creacion, monotonico (el asid se recicla modulo 4096 y
+    /// no sirve para saber quien es el mas nuevo).
+    unsigned createSeq;
+
+    /// Hilos vivos sobre este espacio (el principal mas los de
+    /// `SC_FORK`).
+    unsigned refCount;
+
     bool
     LoadPage(unsigned vpn);
+
+    /// Elegir la victima LRU de la TLB, devolverle sus bits a su dueño
+    /// e instalar la entrada de `vpn` en su lugar.
+    void
+    InstallTlbEntry(unsigned vpn);
+
+    /// La pagina no esta respaldada ni por codigo ni por datos
+    /// inicializados del ejecutable (es BSS o pila)?
+    bool
+    IsAnonymous(unsigned vpn) const;
+
+    /// Si los fallos vienen en secuencia, traer las proximas paginas a
+    /// marcos libres antes de que las pidan.
+    void
+    PrefetchAfter(unsigned vpn);
     noffHeader noffH;
     OpenFile * executable;
 
+    /// Imagen del ejecutable mapeada solo lectura en memoria del host
+    /// (solo con el filesystem stub), o null: la carga a demanda copia
+    /// la pagina directo del mapeo en vez de pasar por `ReadAt`.
+    const char * execImage;
+    unsigned     execImageSize;
+
+    #ifdef FILESYS
+    /// Primer slot de este espacio en el disco de swap dedicado (ver
+    /// `filesys/swap_disk.hh`); la pagina `vpn` vive en `swapBase + vpn`.
+    unsigned swapBase;
+    #else
     char * swap_id;
     OpenFile * swap;
+    #endif
+
+    /// Nombre del binario, o null: clave para compartir paginas de codigo
+    /// entre instancias del mismo ejecutable.
+    char * exec_key;
+
+    /// Un archivo mapeado: rango de vpns al final del espacio cuyo
+    /// respaldo es el propio archivo en vez del ejecutable o el swap.
+    typedef struct {
+        unsigned   startVpn;
+        unsigned   numPgs;
+        OpenFile * file;
+        bool       valid;
+    } MmapRegion;
+
+    static const unsigned MAX_MMAPS = 8;
+
+    MmapRegion mmaps[MAX_MMAPS];
+
+    /// Region mapeada que contiene a `vpn`, o null.
+    MmapRegion *
+    FindMmap(unsigned vpn);
+
+    /// Un segmento compartido mapeado en este espacio.
+    typedef struct {
+        unsigned startVpn;
+        unsigned numPgs;
+        int      segId;
+        bool     valid;
+    } ShmRegion;
+
+    static const unsigned MAX_SHM_REGIONS = 8;
+
+    ShmRegion shms[MAX_SHM_REGIONS];
 };
 
 
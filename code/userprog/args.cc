@@ -4,6 +4,7 @@
 
 
 #include "transfer.hh"
+#include "machine/endianness.hh"
 #include "machine/machine.hh"
 #include "threads/system.hh"
 
@@ -50,19 +51,24 @@ WriteArgs(char ** args)
 
     DEBUG('g', "Writing command line arguments into child process.\n");
     int argc, argv;
-    // Start writing the arguments where the current SP points.
+    // Lay the whole block out first (string addresses, alignment, argv
+    // array), build it in a kernel buffer, and push it onto the user
+    // stack with a single block transfer, instead of paying one address
+    // translation per character.
+    unsigned block_words[(MAX_ARG_COUNT * MAX_ARG_LENGTH
+      + (MAX_ARG_COUNT + 2) * 4) / 4];
+    char * block = (char *) block_words;
     int args_address[MAX_ARG_COUNT];
     unsigned i;
     int sp = machine->ReadRegister(STACK_REG);
+    const int top = sp; // Highest address of the block.
 
     for (i = 0; i < MAX_ARG_COUNT; i++) {
         if (args[i] == NULL) // If the last was reached, terminate.
             break;
         sp -= strlen(args[i]) + 1; // Decrease SP (leave one byte for \0).
-        DEBUG('g', "Writing argv[%d]=%s in SP: %d\n", i, args[i], sp);
-        WriteStringToUser(args[i], sp); // Write the string there.
-        args_address[i] = sp;           // Save the argument's address.
-        delete[] args[i];               // Free the memory.
+        DEBUG('g', "Placing argv[%d]=%s in SP: %d\n", i, args[i], sp);
+        args_address[i] = sp;      // Save the argument's address.
     }
 
     DEBUG('g', "We have an argc: %d\n", i);
@@ -72,18 +78,19 @@ WriteArgs(char ** args)
 
     sp -= sp % 4;    // Align the stack to a multiple of four.
     sp -= i * 4 + 4; // Make room for the array and the trailing null.
+    argv = sp;
+
+    // Fill the buffer relative to `sp`, the lowest address of the block:
+    // the argv array at the bottom, the strings above it.  The pointers
+    // go through `WordToMachine`, as `WriteMem` would have done.
+    memset(block, 0, top - sp);
     for (unsigned j = 0; j < i; j++) {
-        // getting the address memory of the first parameter
-        if (j == 0) argv = sp + 4 * j;
-        // Save the address of the j-th argument counting from the end down
-        // to the beginning.
-        DEBUG('g', "Writing value: %d in memory address: %d\n", args_address[j],
-          sp + 4 * j);
-        machine->WriteMem(sp + 4 * j, 4, args_address[j]);
+        block_words[j] = WordToMachine((unsigned) args_address[j]);
+        strcpy(block + (args_address[j] - sp), args[j]);
+        delete[] args[j]; // Free the memory.
     }
-
-    DEBUG('g', "Writing null in memory address: %d\n", sp + 4 * i);
-    machine->WriteMem(sp + 4 * i, 4, 0); // The last is null.
+    block_words[i] = 0; // The last is null.
+    WriteBufferToUser(sp, block, top - sp);
 
     sp -= 16; // Make room for the “register saves”.
     DEBUG('g', "SP points to the address: %d\n", sp);
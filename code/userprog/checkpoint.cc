@@ -0,0 +1,176 @@
+/// Checkpoint y restauracion de procesos de usuario.
+///
+/// `SaveCheckpoint` (syscall `Checkpoint`) serializa en un archivo el
+/// estado visible del proceso en un limite de syscall: los registros de
+/// la CPU (con los PC ya avanzados y el valor de retorno preseteado, de
+/// modo que la corrida original ve 0 y una restaurada ve 1), el nombre
+/// del ejecutable y el contenido de cada pagina escribible no vacia.
+/// `RestoreProcess` (opcion `-restore`) reconstruye el espacio abriendo
+/// el mismo ejecutable y reescribe ese contenido por el camino normal de
+/// fallos de pagina, asi que no depende de como estaban repartidos los
+/// marcos, el swap o la TLB en la corrida original.  Combinado con la
+/// reejecucion deterministica (`-rec`/`-rep`) permite arrancar una
+/// medicion ya "caliente" en vez de re-simular el warm-up.
+///
+/// Lo que NO se serializa, deliberadamente: hilos de kernel e
+/// interrupciones pendientes (los daemons se rearman solos al
+/// inicializar el sistema y no son estado del proceso), las paginas de
+/// codigo solo lectura (el ejecutable ya las respalda, byte a byte) y
+/// las regiones mmap/shm (su respaldo son sus propios archivos o
+/// segmentos, no el checkpoint).
+
+#include "address_space.hh"
+#include "transfer.hh"
+#include "filesys/directory_entry.hh"
+#include "threads/system.hh"
+
+#include <string.h>
+
+
+/// El archivo arranca con esta cabecera; despues vienen `nameLen` bytes
+/// de nombre de ejecutable y `savedPages` paginas, cada una como un
+/// numero de pagina virtual seguido de `PAGE_SIZE` bytes de contenido.
+static const unsigned CKPT_MAGIC = 0x434B5054; // "CKPT"
+
+struct CkptHeader {
+    unsigned magic;
+    unsigned ticks; ///< `totalTicks` al guardar; solo informativo.
+    int      registers[NUM_TOTAL_REGS];
+    unsigned numPages;
+    unsigned savedPages;
+    unsigned nameLen;
+};
+
+/// Guardar el estado del proceso actual en el archivo `name`.  Devuelve
+/// 0, o -1 si el archivo no se pudo crear o el espacio no tiene nombre
+/// de ejecutable (sin el, el restore no sabria que binario abrir).
+int
+SaveCheckpoint(const char * name)
+{
+    ASSERT(name != nullptr);
+
+    AddressSpace * space = currentThread->space;
+    if (space == nullptr || space->GetExecName() == nullptr)
+        return -1;
+
+    fileSystem->Remove(name); // Pisar un checkpoint viejo, si lo hay.
+    if (!fileSystem->Create(name))
+        return -1;
+    OpenFile * file = fileSystem->Open(name);
+    if (file == nullptr)
+        return -1;
+
+    CkptHeader hdr;
+    hdr.magic = CKPT_MAGIC;
+    hdr.ticks = stats->totalTicks;
+    for (unsigned i = 0; i < NUM_TOTAL_REGS; i++)
+        hdr.registers[i] = machine->ReadRegister(i);
+    // El despachador de syscalls avanza los PC recien despues del
+    // handler: la copia guardada los avanza aca, y deja presentado en r2
+    // el valor de retorno que vera la corrida restaurada.
+    hdr.registers[PREV_PC_REG] = hdr.registers[PC_REG];
+    hdr.registers[PC_REG]      = hdr.registers[NEXT_PC_REG];
+    hdr.registers[NEXT_PC_REG] = hdr.registers[PC_REG] + 4;
+    hdr.registers[2] = 1;
+    hdr.numPages   = space->GetNumPages();
+    hdr.savedPages = 0;
+    hdr.nameLen    = strlen(space->GetExecName());
+
+    // Las paginas van primero al archivo y la cabecera (ya con el conteo
+    // final) se escribe al terminar.
+    unsigned offset = sizeof hdr + hdr.nameLen;
+    char     page[PAGE_SIZE];
+    static const char zeros[PAGE_SIZE] = {};
+    for (unsigned vpn = 0; vpn < hdr.numPages; vpn++) {
+        // Codigo solo lectura: lo respalda el ejecutable, no hace falta
+        // copiarlo.
+        if (space->pageTable[vpn].readOnly)
+            continue;
+        while (!machine->ReadMemBlock(vpn * PAGE_SIZE, PAGE_SIZE, page));
+        // Paginas enteras de ceros (BSS o pila sin tocar) tampoco se
+        // guardan: el restore las recrea contra el marco cero.
+        if (memcmp(page, zeros, PAGE_SIZE) == 0)
+            continue;
+        file->WriteAt((char *) &vpn, sizeof vpn, offset);
+        offset += sizeof vpn;
+        file->WriteAt(page, PAGE_SIZE, offset);
+        offset += PAGE_SIZE;
+        hdr.savedPages++;
+    }
+    file->WriteAt((char *) &hdr, sizeof hdr, 0);
+    file->WriteAt(space->GetExecName(), hdr.nameLen, sizeof hdr);
+    delete file;
+    return 0;
+}
+
+/// Retomar la ejecucion desde el checkpoint `ckptName`, como
+/// `StartProcess` pero con los registros y la memoria del snapshot.
+void
+RestoreProcess(const char * ckptName)
+{
+    ASSERT(ckptName != nullptr);
+
+    OpenFile * file = fileSystem->Open(ckptName);
+    if (file == nullptr) {
+        printf("Unable to open checkpoint %s\n", ckptName);
+        return;
+    }
+
+    CkptHeader hdr;
+    if (file->ReadAt((char *) &hdr, sizeof hdr, 0) != sizeof hdr
+      || hdr.magic != CKPT_MAGIC
+      || hdr.nameLen == 0 || hdr.nameLen > FILE_NAME_MAX_LEN)
+    {
+        printf("%s is not a checkpoint file\n", ckptName);
+        delete file;
+        return;
+    }
+    char execName[FILE_NAME_MAX_LEN + 1];
+    file->ReadAt(execName, hdr.nameLen, sizeof hdr);
+    execName[hdr.nameLen] = '\0';
+
+    OpenFile * executable = fileSystem->Open(execName);
+    if (executable == nullptr) {
+        printf("Unable to open file %s\n", execName);
+        delete file;
+        return;
+    }
+
+    AddressSpace * space = new AddressSpace(executable, execName);
+    if (space->GetNumPages() != hdr.numPages) {
+        // El ejecutable cambio desde que se tomo el snapshot: el
+        // contenido guardado ya no corresponde a este binario.
+        printf("Checkpoint %s does not match executable %s\n",
+          ckptName, execName);
+        delete space;
+        delete file;
+        return;
+    }
+    currentThread->space = space;
+    space->InitRegisters();
+    space->RestoreState();
+
+    // Reescribir el contenido guardado via `WriteMemBlock`: cada pagina
+    // se trae por el fallo de pagina comun, y la primera escritura sobre
+    // una pagina anonima le da su marco propio (cf. `CopyZeroPage`).
+    unsigned offset = sizeof hdr + hdr.nameLen;
+    char     page[PAGE_SIZE];
+    for (unsigned i = 0; i < hdr.savedPages; i++) {
+        unsigned vpn;
+        file->ReadAt((char *) &vpn, sizeof vpn, offset);
+        offset += sizeof vpn;
+        file->ReadAt(page, PAGE_SIZE, offset);
+        offset += PAGE_SIZE;
+        ASSERT(vpn < hdr.numPages);
+        while (!machine->WriteMemBlock(vpn * PAGE_SIZE, PAGE_SIZE, page));
+    }
+    delete file;
+
+    // Los registros van al final: las escrituras de arriba pisan
+    // `BAD_VADDR_REG` y los PC al fallar.
+    for (unsigned i = 0; i < NUM_TOTAL_REGS; i++)
+        machine->WriteRegister(i, hdr.registers[i]);
+
+    machine->Run(); // Jump to the user progam.
+    ASSERT(false);
+}
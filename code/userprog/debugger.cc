@@ -7,6 +7,7 @@
 #include "lib/utility.hh"
 #include "machine/interrupt.hh"
 #include "machine/statistics.hh"
+#include "threads/synch.hh"
 #include "threads/system.hh"
 
 #include <ctype.h>
@@ -114,6 +115,89 @@ CommandContinue(char ** args, void * extra)
     return DCM::RUN_RESULT_NORMALIZE;
 }
 
+/// Parse a single address argument; on failure, report and return false.
+static bool
+FetchAddressArg(char ** args, unsigned * address)
+{
+    const char * arg = DCM::FetchArg(args);
+
+    if (arg == nullptr) {
+        fprintf(stderr, "ERROR: missing argument.\n");
+        return false;
+    }
+
+    char * end;
+    *address = strtoul(arg, &end, 0);
+    if (*end != '\0') {
+        fprintf(stderr, "ERROR: argument `%s` is not an address.\n", arg);
+        return false;
+    }
+    return true;
+}
+
+static DCM::RunResult
+CommandBreak(char ** args, void * extra)
+{
+    unsigned address;
+
+    if (!FetchAddressArg(args, &address))
+        return DCM::RUN_RESULT_STAY;
+
+    if (machine->SetBreakpoint(address))
+        printf("Breakpoint set at 0x%X.\n", address);
+    else
+        fprintf(stderr, "ERROR: all %u breakpoints are already in use.\n",
+          Machine::MAX_BREAKPOINTS);
+    return DCM::RUN_RESULT_STAY;
+}
+
+static DCM::RunResult
+CommandDelete(char ** args, void * extra)
+{
+    unsigned address;
+
+    if (!FetchAddressArg(args, &address))
+        return DCM::RUN_RESULT_STAY;
+
+    if (machine->ClearBreakpoint(address))
+        printf("Breakpoint at 0x%X removed.\n", address);
+    else
+        fprintf(stderr, "ERROR: no breakpoint at 0x%X.\n", address);
+    return DCM::RUN_RESULT_STAY;
+}
+
+static DCM::RunResult
+CommandRange(char ** args, void * extra)
+{
+    unsigned lo, hi;
+
+    if (!FetchAddressArg(args, &lo) || !FetchAddressArg(args, &hi))
+        return DCM::RUN_RESULT_STAY;
+
+    if (machine->SetStepRange(lo, hi))
+        printf("Stepping scoped to [0x%X, 0x%X).\n", lo, hi);
+    else
+        fprintf(stderr,
+          "ERROR: empty range, or all %u step ranges are already in use.\n",
+          Machine::MAX_STEP_RANGES);
+    return DCM::RUN_RESULT_STAY;
+}
+
+static DCM::RunResult
+CommandUnrange(char ** args, void * extra)
+{
+    unsigned lo;
+
+    if (!FetchAddressArg(args, &lo))
+        return DCM::RUN_RESULT_STAY;
+
+    if (machine->ClearStepRange(lo))
+        printf("Step range starting at 0x%X removed.\n", lo);
+    else
+        fprintf(stderr, "ERROR: no step range starting at 0x%X.\n", lo);
+    return DCM::RUN_RESULT_STAY;
+}
+
 static DCM::RunResult
 CommandDump(char ** args, void * extra)
 {
@@ -160,7 +244,11 @@ CommandHelp(char ** args, void * extra)
     printf(
         "\
 Debugger commands:\n\
-    continue, c             Run until completion.\n\
+    break, b <address>      Set a breakpoint on a (virtual) program\n\
+                            counter; the machine runs at full speed and\n\
+                            drops back here when reaching it.\n\
+    continue, c             Run until completion or the next breakpoint.\n\
+    delete <address>        Remove the breakpoint at an address.\n\
     dump <path>             Dump the simulated machine's main memory into\n\
                             a file.\n\
     flags, f                Show current flags for debug output.\n\
@@ -172,6 +260,14 @@ Debugger commands:\n\
                             Addresses can be represented in decimal,\n\
                             hexadecimal (using the prefix `0x`) and octal\n\
                             (with the prefix `0`).\n\
+    range <lo> <hi>         Drop back here on every instruction whose\n\
+                            program counter lies in [lo, hi); elsewhere\n\
+                            the machine runs at full speed.  Combine\n\
+                            with `continue` to trace one region.\n\
+    unrange <lo>            Remove the step range starting at an\n\
+                            address.\n\
+    stats                   Print the live machine statistics and\n\
+                            counters, without disturbing the run.\n\
     step, s, <return>       Execute one instruction.\n\
     setflags, setf <flags>  Set flags for debug output.\n\
     tick, t <number>        Run for a number of timer ticks.\n\
@@ -250,6 +346,14 @@ CommandSetFlags(char ** args, void * extra)
     return DCM::RUN_RESULT_STAY;
 }
 
+static DCM::RunResult
+CommandStats(char ** args, void * extra)
+{
+    stats->Report();
+    Lock::PrintStats();
+    return DCM::RUN_RESULT_STAY;
+}
+
 static DCM::RunResult
 CommandStep(char ** args, void * extra)
 {
@@ -297,8 +401,11 @@ Debugger::Debugger()
 {
     runUntilTime = 0;
     memset(previousRegisters, 0, sizeof previousRegisters);
+    manager.AddCommand("break", &CommandBreak, nullptr);
+    manager.AddCommand("b", &CommandBreak, nullptr);
     manager.AddCommand("continue", &CommandContinue, nullptr);
     manager.AddCommand("c", &CommandContinue, nullptr);
+    manager.AddCommand("delete", &CommandDelete, nullptr);
     manager.AddCommand("dump", &CommandDump, nullptr);
     manager.AddCommand("flags", &CommandFlags, nullptr);
     manager.AddCommand("f", &CommandFlags, nullptr);
@@ -307,10 +414,13 @@ Debugger::Debugger()
     manager.AddCommand("?", &CommandHelp, nullptr);
     manager.AddCommand("print", &CommandPrint, nullptr);
     manager.AddCommand("p", &CommandPrint, nullptr);
+    manager.AddCommand("range", &CommandRange, nullptr);
+    manager.AddCommand("unrange", &CommandUnrange, nullptr);
     manager.AddCommand("quit", &CommandQuit, nullptr);
     manager.AddCommand("q", &CommandQuit, nullptr);
     manager.AddCommand("setflags", &CommandSetFlags, nullptr);
     manager.AddCommand("setf", &CommandSetFlags, nullptr);
+    manager.AddCommand("stats", &CommandStats, nullptr);
     manager.AddCommand("step", &CommandStep, nullptr);
     manager.AddCommand("s", &CommandStep, nullptr);
     manager.AddCommand("tick", &CommandTick, &runUntilTime);
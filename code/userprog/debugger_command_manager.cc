@@ -13,23 +13,48 @@ typedef DebuggerCommandManager DCM;
 
 static const char SEPARATOR[] = " ";
 
+DCM::DebuggerCommandManager()
+{
+    for (unsigned i = 0; i < TABLE_SIZE; i++)
+        commands[i].name = nullptr;
+    count   = 0;
+    empty   = nullptr;
+    unknown = nullptr;
+}
+
 const char *
 DCM::FetchArg(char ** args)
 {
     return strtok_r(nullptr, SEPARATOR, args);
 }
 
+unsigned
+DCM::HashName(const char * name)
+{
+    unsigned h = 5381;
+
+    for (unsigned i = 0; name[i] != '\0'; i++)
+        h = h * 33 + (unsigned char) name[i];
+    return h & (TABLE_SIZE - 1);
+}
+
 bool
 DCM::AddCommand(const char * name, CommandFunc f, void * extra)
 {
     ASSERT(name != nullptr);
     ASSERT(f != nullptr);
 
-    if (count >= CAPACITY)
+    // Keep at least one slot free, so unsuccessful probes terminate.
+    if (count >= TABLE_SIZE - 1)
         return false;
 
+    unsigned i = HashName(name);
+    while (commands[i].name != nullptr)
+        i = (i + 1) & (TABLE_SIZE - 1);
+
     Command c = { name, f, extra };
-    commands[count++] = c;
+    commands[i] = c;
+    count++;
     return true;
 }
 
@@ -58,11 +83,10 @@ DCM::Run(char * line)
         return (*empty)();
     }
 
-    for (unsigned i = 0; i < count; i++) {
-        Command c = commands[i];
-        if (strcmp(c.name, name) == 0)
-            return (*c.func)(&saved, c.extra);
-    }
+    for (unsigned i = HashName(name); commands[i].name != nullptr;
+      i = (i + 1) & (TABLE_SIZE - 1))
+        if (strcmp(commands[i].name, name) == 0)
+            return (*commands[i].func)(&saved, commands[i].extra);
 
     // If this is reached, then the command is unknown...
     ASSERT(unknown != nullptr);
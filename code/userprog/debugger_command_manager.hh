@@ -22,6 +22,8 @@ public:
     typedef RunResult (* EmptyFunc)();
     typedef RunResult (* UnknownFunc)(const char * name);
 
+    DebuggerCommandManager();
+
     /// Fetch the next argument for a command invocation.
     static const char *
     FetchArg(char ** args);
@@ -36,19 +38,27 @@ public:
     Run(char * line);
 
 private:
-    static const unsigned CAPACITY = 20;
+    /// Slots in the command hash table; a power of two, and comfortably
+    /// more than the commands registered, so lookups stay short.
+    static const unsigned TABLE_SIZE = 64;
 
     struct Command {
-        const char * name;
+        const char * name; ///< Null marks an empty slot.
         CommandFunc  func;
         void *       extra;
     };
 
-    Command commands[CAPACITY];
+    /// Open-addressed table hashed by command name; collisions probe
+    /// forward (cf. `Profiler::Record` for the same scheme).
+    Command commands[TABLE_SIZE];
     unsigned count; ///< How many commands are added?
 
     EmptyFunc empty;
     UnknownFunc unknown;
+
+    /// Hash of a command name (djb2), reduced to a table slot.
+    static unsigned
+    HashName(const char * name);
 };
 
 
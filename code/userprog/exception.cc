@@ -24,6 +24,7 @@
 
 #include "transfer.hh"
 #include "syscall.h"
+#include "synch_pipe.hh"
 #include "filesys/directory_entry.hh"
 #include "threads/system.hh"
 #include "args.hh"
@@ -31,6 +32,8 @@
 
 void
 Copy(const char * unixFile, const char * nachosFile);
+int
+SaveCheckpoint(const char * name);
 
 static void
 IncrementPC()
@@ -100,197 +103,906 @@ run_program(void * arg)
     machine->Run();
 }
 
+/// Pipes en memoria del kernel.  Sus descriptores viven en un rango de
+/// ids reservado, global a todos los procesos, asi los hijos lanzados con
+/// `Exec` heredan los extremos sin tocar la tabla por proceso: el id de
+/// lectura del pipe `i` es `PIPE_FD_BASE + 2 * i` y el de escritura el
+/// siguiente.
+
+static const unsigned MAX_PIPES   = 16;
+static const int PIPE_FD_BASE     = 100;
+
+static SynchPipe * pipeTable[MAX_PIPES];
+
+/// Pipe correspondiente a un id, o null si el id no es de pipe o el pipe
+/// no existe.  `*isWriteEnd` dice cual extremo nombra el id.
+static SynchPipe *
+PipeFromId(int id, bool * isWriteEnd)
+{
+    if (id < PIPE_FD_BASE || id >= PIPE_FD_BASE + 2 * (int) MAX_PIPES) {
+        return nullptr;
+    }
+    *isWriteEnd = (id - PIPE_FD_BASE) % 2 != 0;
+    return pipeTable[(id - PIPE_FD_BASE) / 2];
+}
+
+/// Un handler por syscall, con los argumentos ya leidos de r4/r5/r6.
+/// `machine_ret` es el helper compartido para devolver en r2.
+
 static void
-SyscallHandler(ExceptionType _et)
+HandleHalt(int arg1, int arg2, int arg3)
 {
-    int scid = machine->ReadRegister(2);// r2
-    int arg1 = machine->ReadRegister(4);// r4
-    int arg2 = machine->ReadRegister(5);// r5
-    int arg3 = machine->ReadRegister(6);// r6
+    DEBUG('e', "Calling SC_HALT.\n");
+    DEBUG('e', "Shutdown, initiated by user program.\n");
+    interrupt->Halt();
+}
 
-    switch (scid) {
-        case SC_HALT: {// Codeado
-            DEBUG('e', "Calling SC_HALT.\n");
-            DEBUG('e', "Shutdown, initiated by user program.\n");
-            interrupt->Halt();
-            break;
+static void
+HandleCreate(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_CREATE\n");
+    int filenameAddr = arg1;
+    if (filenameAddr == 0)
+        DEBUG('e', "Error: address to filename string is null.\n");
+
+    char filename[FILE_NAME_MAX_LEN + 1];
+    if (!ReadStringFromUser(filenameAddr, filename, sizeof filename)) {
+        DEBUG('e',
+          "Error: filename string too long (maximum is %u bytes).\n",
+          FILE_NAME_MAX_LEN);
+    }
+    DEBUG('e', "Open requested for file `%s`.\n", filename);
+    // Crear pisa el contenido: si habia una cabecera cacheada con ese
+    // nombre ya no vale.
+    AddressSpace::InvalidateExecCache(filename);
+    machine_ret(fileSystem->Create(filename));
+}
+
+static void
+HandleWrite(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_WRITE.\n");
+    int buffer    = arg1;
+    int size      = arg2;
+    OpenFileId id = arg3;
+    int r         = -1;
+
+    if (size <= 0) return;
+    ASSERT(buffer);
+
+    bool isWriteEnd;
+    SynchPipe * pipe = PipeFromId(id, &isWriteEnd);
+    if (pipe != nullptr) {
+        if (isWriteEnd) {
+            char * bff = new char[size];
+            ReadBufferFromUser(buffer, bff, size);
+            r = pipe->Write(bff, size);
+            delete[] bff;
         }
-        case SC_CREATE: {// Codeado
-            DEBUG('e', "Calling SC_CREATE\n");
-            int filenameAddr = arg1;
-            if (filenameAddr == 0)
-                DEBUG('e', "Error: address to filename string is null.\n");
-
-            char filename[FILE_NAME_MAX_LEN + 1];
-            if (!ReadStringFromUser(filenameAddr, filename, sizeof filename)) {
-                DEBUG('e',
-                  "Error: filename string too long (maximum is %u bytes).\n",
-                  FILE_NAME_MAX_LEN);
-            }
-            DEBUG('e', "Open requested for file `%s`.\n", filename);
-            machine_ret(fileSystem->Create(filename));
+        machine_ret(r);
+        return;
+    }
+
+    switch (id) {
+        case CONSOLE_OUTPUT: {// STDOUT
+            char * bff = new char[size + 1];
+            ReadBufferFromUser(buffer, bff, size);
+            r = synchConsole->PutString(bff, size);
+            delete[] bff;
             break;
         }
-        case SC_WRITE: {// Codedado
-            DEBUG('e', "Calling SC_WRITE.\n");
-            int buffer    = arg1;
-            int size      = arg2;
-            OpenFileId id = arg3;
-            int r         = -1;
-
-            if (size <= 0) break;
-            ASSERT(buffer);
-
-            switch (id) {
-                case CONSOLE_OUTPUT: {// STDOUT
-                    char * bff = new char[size + 1];
-                    ReadBufferFromUser(buffer, bff, size);
-                    r = synchConsole->PutString(bff, size);
-                    delete[] bff;
-                    break;
-                }
-                default: {
-                    if (currentThread->IsOpenFile(id)) {
-                        OpenFile * file = currentThread->GetFile(id);
-                        char * bff      = new char[size];
-                        ReadBufferFromUser(buffer, bff, size);
-                        r = file->Write(bff, size);
-                        delete[] bff;
-                    }
-                    break;
-                }
+        default: {
+            OpenFile * file = currentThread->GetFile(id);
+            if (file != nullptr) {
+                char * bff = new char[size];
+                ReadBufferFromUser(buffer, bff, size);
+                r = file->Write(bff, size);
+                delete[] bff;
             }
-            machine_ret(r);
             break;
         }
-        case SC_OPEN: {// Codeado
-            DEBUG('e', "Calling SC_OPEN.\n");
-            int nameaddr = arg1;
-            int r        = -1;
-
-            char * filename = new char[FILE_NAME_MAX_LEN + 1];
-            if (ReadStringFromUser(nameaddr, filename, FILE_NAME_MAX_LEN)) {
-                OpenFile * file = fileSystem->Open(filename);
-                r = currentThread->AddFile(file);
-            }
+    }
+    machine_ret(r);
+}
 
-            delete[] filename;
-            machine_ret(r);
+static void
+HandleOpen(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_OPEN.\n");
+    int nameaddr = arg1;
+    int r        = -1;
+
+    char * filename = new char[FILE_NAME_MAX_LEN + 1];
+    if (ReadStringFromUser(nameaddr, filename, FILE_NAME_MAX_LEN)) {
+        OpenFile * file = fileSystem->Open(filename);
+        r = currentThread->AddFile(file);
+    }
+
+    delete[] filename;
+    machine_ret(r);
+}
+
+static void
+HandleClose(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_CLOSE.\n");
+    int fid = arg1;
+    int r   = -1;
+    DEBUG('e', "Close requested for id %u.\n", fid);
+
+    bool isWriteEnd;
+    SynchPipe * pipe = PipeFromId(fid, &isWriteEnd);
+    if (pipe != nullptr) {
+        // Cerrar un extremo; con los dos cerrados el pipe se destruye.
+        if (isWriteEnd)
+            pipe->CloseWrite();
+        else
+            pipe->CloseRead();
+        if (pipe->Closed()) {
+            pipeTable[(fid - PIPE_FD_BASE) / 2] = nullptr;
+            delete pipe;
+        }
+        machine_ret(0);
+        return;
+    }
+
+    if (currentThread->IsOpenFile(fid)) {
+        OpenFile * file = currentThread->RemoveFile(fid);
+        delete file;
+    }
+    machine_ret(r);
+}
+
+static void
+HandleExit(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_EXIT.\n");
+    machine_ret(arg1);
+    // Termina solo al hilo que llama; si otros hilos de SC_FORK
+    // comparten el espacio, este sobrevive hasta que salga el ultimo
+    // (ver la cuenta de referencias en el destructor de Thread).
+    currentThread->Finish(arg1);
+}
+
+static void
+HandleJoin(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_JOIN.\n");
+    SpaceId id = arg1;
+    // `Resolve` rechaza ids invalidos y tambien ids viejos de procesos
+    // ya muertos cuya ranura fue reciclada (generacion distinta); el
+    // chequeo de parentesco evita joinear procesos ajenos.
+    Thread * child = processManager->Resolve(id);
+    if (child == nullptr || !processManager->IsChildOfCurrent(id)) {
+        DEBUG('e', "Invalid pid %d.\n", id);
+        machine_ret(-1);
+        return;
+    }
+    DEBUG('e', "The userland/program is joining\n");
+    int r = child->Join();
+    machine_ret(r);
+}
+
+static void
+HandleYield(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_YIELD.\n");
+    currentThread->Yield();
+    machine_ret(0);
+}
+
+static void
+HandleExec(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_EXEC.\n");
+    int nameaddr  = arg1;
+    int argv      = arg2;
+    int join_flag = arg3;
+    int r         = -1;
+    void * argvs  = (void *) SaveArgs(argv);
+
+    char * filename = new char[FILE_NAME_MAX_LEN + 1];
+
+    if (ReadStringFromUser(nameaddr, filename, FILE_NAME_MAX_LEN)) {
+        DEBUG('e', "Opening %s file to execute\n", filename);
+        DEBUG('e', "The program is executing with join_flag=%d\n",
+          join_flag);
+        OpenFile * executable = fileSystem->Open(filename);
+        Thread * newThread    = new Thread("Child_Thread", join_flag);
+        newThread->space = new AddressSpace(executable, filename);
+        r = newThread->pid;
+        newThread->Fork(run_program, (void *) argvs);
+    }
+
+    delete[] filename;
+    machine_ret(r);
+}
+
+/// Argumentos del arranque de un hilo de SC_FORK: la rutina de usuario
+/// y el tope de la pila propia que le reservo `HandleFork`.
+typedef struct {
+    int      func;
+    unsigned stackTop;
+} UserThreadArgs;
+
+/// Cuerpo de los hilos lanzados con SC_FORK: mismo espacio que el padre
+/// (misma tabla de paginas y mismo asid en la TLB), registros limpios y
+/// pila propia.  La rutina debe terminar con Exit: un return salta
+/// fuera del espacio y muere por excepcion de direccion.
+static void
+run_user_thread(void * arg)
+{
+    UserThreadArgs * args = (UserThreadArgs *) arg;
+
+    currentThread->space->RestoreState();
+    for (unsigned i = 0; i < NUM_TOTAL_REGS; i++) {
+        machine->WriteRegister(i, 0);
+    }
+    machine->WriteRegister(PC_REG, args->func);
+    machine->WriteRegister(NEXT_PC_REG, args->func + 4);
+    machine->WriteRegister(STACK_REG, args->stackTop);
+    machine->WriteRegister(RET_ADDR_REG, args->stackTop + 16);
+
+    DEBUG('e', "Running user thread at %d, stack at %u\n", args->func,
+      args->stackTop);
+    delete args;
+    machine->Run();
+}
+
+static void
+HandleFork(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_FORK.\n");
+    int func = arg1;
+    int r    = -1;
+
+    if (func != 0) {
+        int stackTop = currentThread->space->AllocUserStack();
+        UserThreadArgs * args = new UserThreadArgs;
+        args->func     = func;
+        args->stackTop = stackTop;
+        // El hilo nuevo comparte el espacio: sumar la referencia antes
+        // de soltarlo a correr (cf. el destructor de Thread).
+        Thread * newThread = new Thread("User_Thread", 0);
+        newThread->space   = currentThread->space;
+        currentThread->space->Ref();
+        r = newThread->pid;
+        newThread->Fork(run_user_thread, (void *) args);
+    }
+    machine_ret(r);
+}
+
+static void
+HandleRead(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_READ.\n");
+    int buffer    = arg1;
+    int size      = arg2;
+    OpenFileId id = arg3;
+    int r         = -1;
+
+    ASSERT(buffer);
+    ASSERT(0 < size);
+
+    bool isWriteEnd;
+    SynchPipe * pipe = PipeFromId(id, &isWriteEnd);
+    if (pipe != nullptr) {
+        if (!isWriteEnd) {
+            char * bff = new char[size];
+            r = pipe->Read(bff, size);
+            if (r > 0)
+                WriteBufferToUser(buffer, bff, r);
+            delete[] bff;
+        }
+        machine_ret(r);
+        return;
+    }
+
+    switch (id) {
+        case CONSOLE_INPUT: {
+            char * bff = new char[size + 1];
+            r = synchConsole->GetString(bff, size);
+            WriteBufferToUser(buffer, bff, r);
+            DEBUG('e', "Read: %s[%d]\n", bff, r);
+            delete[] bff;
             break;
         }
-        case SC_CLOSE: {// Codeado
-            DEBUG('e', "Calling SC_CLOSE.\n");
-            int fid = machine->ReadRegister(4);
-            int r   = -1;
-            DEBUG('e', "Close requested for id %u.\n", fid);
-            if (currentThread->IsOpenFile(fid)) {
-                OpenFile * file = currentThread->RemoveFile(fid);
-                delete file;
+        default: {
+            OpenFile * file = currentThread->GetFile(id);
+            if (file != nullptr) {
+                char * bff = new char[size];
+                memset(bff, 0, size);
+                r = file->Read(bff, size);
+                WriteBufferToUser(buffer, bff, r);
+                DEBUG('e', "Read: %s", bff);
+                delete[] bff;
             }
-            machine_ret(r);
             break;
         }
-        case SC_EXIT: {// Codeado
-            DEBUG('e', "Calling SC_EXIT.\n");
-            machine_ret(arg1);
-            currentThread->Finish(arg1);
+    }
+    machine_ret(r);
+}
+
+static void
+HandleRemove(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_REMOVE\n");
+    int filenameAddr = arg1;
+    if (filenameAddr == 0)
+        DEBUG('e', "Error: address to filename string is null.\n");
+
+    char filename[FILE_NAME_MAX_LEN + 1];
+    if (!ReadStringFromUser(filenameAddr, filename, sizeof filename)) {
+        DEBUG('e',
+          "Error: filename string too long (maximum is %u bytes).\n",
+          FILE_NAME_MAX_LEN);
+    }
+    // Por si lo borrado era un ejecutable con cabecera cacheada.
+    AddressSpace::InvalidateExecCache(filename);
+    machine_ret(fileSystem->Remove(filename));
+}
+
+/// Lee los dos nombres de r4/r5; comun a SC_LINK y SC_RENAME.
+static bool
+ReadTwoNames(int arg1, int arg2, char * oldName, char * newName,
+  unsigned size)
+{
+    if (arg1 == 0 || arg2 == 0) {
+        DEBUG('e', "Error: address to filename string is null.\n");
+        return false;
+    }
+    if (!ReadStringFromUser(arg1, oldName, size) ||
+      !ReadStringFromUser(arg2, newName, size))
+    {
+        DEBUG('e',
+          "Error: filename string too long (maximum is %u bytes).\n",
+          size - 1);
+        return false;
+    }
+    return true;
+}
+
+static void
+HandleLink(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_LINK\n");
+    char oldName[FILE_NAME_MAX_LEN + 1], newName[FILE_NAME_MAX_LEN + 1];
+    if (!ReadTwoNames(arg1, arg2, oldName, newName, sizeof oldName)) {
+        machine_ret(0);
+        return;
+    }
+    machine_ret(fileSystem->Link(oldName, newName));
+}
+
+static void
+HandleRename(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_RENAME\n");
+    char oldName[FILE_NAME_MAX_LEN + 1], newName[FILE_NAME_MAX_LEN + 1];
+    if (!ReadTwoNames(arg1, arg2, oldName, newName, sizeof oldName)) {
+        machine_ret(0);
+        return;
+    }
+    // El ejecutable puede cambiar de nombre: su cabecera cacheada por el
+    // nombre viejo deja de valer.
+    AddressSpace::InvalidateExecCache(oldName);
+    AddressSpace::InvalidateExecCache(newName);
+    machine_ret(fileSystem->Rename(oldName, newName));
+}
+
+static void
+HandleCkpt(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_CKPT\n");
+    if (arg1 == 0) {
+        DEBUG('e', "Error: address to filename string is null.\n");
+        machine_ret(-1);
+        return;
+    }
+    char filename[FILE_NAME_MAX_LEN + 1];
+    if (!ReadStringFromUser(arg1, filename, sizeof filename)) {
+        DEBUG('e',
+          "Error: filename string too long (maximum is %u bytes).\n",
+          FILE_NAME_MAX_LEN);
+        machine_ret(-1);
+        return;
+    }
+    // La imagen guardada lleva r2 = 1 y los PC ya avanzados (ver
+    // `checkpoint.cc`); aca abajo `machine_ret`/`IncrementPC` hacen lo
+    // propio para la corrida que sigue ejecutando.
+    machine_ret(SaveCheckpoint(filename));
+}
+
+static void
+HandleSleep(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_SLEEP (%d ticks)\n", arg1);
+    if (arg1 > 0)
+        timerWheel->SleepFor(arg1);
+}
+
+static void
+HandleTicks(int arg1, int arg2, int arg3)
+{
+    machine_ret((int) stats->totalTicks);
+}
+
+static void
+HandleThreadTicks(int arg1, int arg2, int arg3)
+{
+    // Cargar la porcion corrida del slice actual, si no el contador
+    // queda congelado entre cambios de contexto.
+    currentThread->ChargeTicks();
+    machine_ret((int) currentThread->GetCpuTicks());
+}
+
+/// Maxima cantidad de fragmentos por transferencia scatter-gather.
+static const unsigned MAX_IOV = 16;
+
+static void
+HandleReadv(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_READV.\n");
+    int iovAddr   = arg1;
+    int count     = arg2;
+    OpenFileId id = arg3;
+    int r         = -1;
+
+    ASSERT(iovAddr);
+    if (count <= 0 || count > (int) MAX_IOV) {
+        machine_ret(r);
+        return;
+    }
+
+    int bases[MAX_IOV], lens[MAX_IOV];
+    if (!ReadIOVecFromUser(iovAddr, count, bases, lens)) {
+        machine_ret(r);
+        return;
+    }
+    int total = 0;
+    for (int i = 0; i < count; i++)
+        total += lens[i];
+    if (total <= 0) {
+        machine_ret(r);
+        return;
+    }
+
+    // Leer todo de una al buffer de armado y repartirlo entre los
+    // fragmentos: un solo cruce de kernel para el mensaje entero.
+    char * bff = new char[total];
+    switch (id) {
+        case CONSOLE_INPUT:
+            r = synchConsole->GetString(bff, total);
             break;
-        }
-        case SC_JOIN: {// Codeado
-            DEBUG('e', "Calling SC_JOIN.\n");
-            SpaceId id = arg1;
-            if (!(processTable->HasKey(id))) {
-                DEBUG('e', "Invalid pid %d.\n", id);
-                break;
+        default: {
+            OpenFile * file = currentThread->GetFile(id);
+            if (file != nullptr) {
+                memset(bff, 0, total);
+                r = file->Read(bff, total);
             }
-            DEBUG('e', "The userland/program is joining\n");
-            int r = (processTable->Get(id))->Join();
-            machine_ret(r);
             break;
         }
-        case SC_EXEC: {// Codeado
-            DEBUG('e', "Calling SC_EXEC.\n");
-            int nameaddr  = arg1;
-            int argv      = arg2;
-            int join_flag = arg3;
-            int r         = -1;
-            void * argvs  = (void *) SaveArgs(argv);
-
-            char * filename = new char[FILE_NAME_MAX_LEN + 1];
-
-            if (ReadStringFromUser(nameaddr, filename, FILE_NAME_MAX_LEN)) {
-                DEBUG('e', "Opening %s file to execute\n", filename);
-                DEBUG('e', "The program is executing with join_flag=%d\n",
-                  join_flag);
-                OpenFile * executable = fileSystem->Open(filename);
-                Thread * newThread    = new Thread("Child_Thread", join_flag);
-                newThread->space = new AddressSpace(executable);
-                r = newThread->pid;
-                newThread->Fork(run_program, (void *) argvs);
+    }
+    int off = 0;
+    for (int i = 0; i < count && off < r; i++) {
+        int n = lens[i] < r - off ? lens[i] : r - off;
+        if (n > 0)
+            WriteBufferToUser(bases[i], &bff[off], n);
+        off += n;
+    }
+    delete[] bff;
+    machine_ret(r);
+}
+
+static void
+HandleWritev(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_WRITEV.\n");
+    int iovAddr   = arg1;
+    int count     = arg2;
+    OpenFileId id = arg3;
+    int r         = -1;
+
+    ASSERT(iovAddr);
+    if (count <= 0 || count > (int) MAX_IOV) {
+        machine_ret(r);
+        return;
+    }
+
+    int bases[MAX_IOV], lens[MAX_IOV];
+    if (!ReadIOVecFromUser(iovAddr, count, bases, lens)) {
+        machine_ret(r);
+        return;
+    }
+    int total = 0;
+    for (int i = 0; i < count; i++)
+        total += lens[i];
+    if (total <= 0) {
+        machine_ret(r);
+        return;
+    }
+
+    // Juntar los fragmentos en el buffer de armado y escribirlos de una.
+    char * bff = new char[total];
+    int off    = 0;
+    for (int i = 0; i < count; i++) {
+        if (lens[i] > 0)
+            ReadBufferFromUser(bases[i], &bff[off], lens[i]);
+        off += lens[i];
+    }
+    switch (id) {
+        case CONSOLE_OUTPUT:
+            r = synchConsole->PutString(bff, total);
+            break;
+        default: {
+            OpenFile * file = currentThread->GetFile(id);
+            if (file != nullptr) {
+                r = file->Write(bff, total);
             }
+            break;
+        }
+    }
+    delete[] bff;
+    machine_ret(r);
+}
 
-            delete[] filename;
-            machine_ret(r);
+static void
+HandlePipe(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_PIPE.\n");
+    int fdsAddr = arg1;
+    int r       = -1;
+
+    ASSERT(fdsAddr);
+    for (unsigned i = 0; i < MAX_PIPES; i++) {
+        if (pipeTable[i] == nullptr) {
+            pipeTable[i] = new SynchPipe;
+            int readId   = PIPE_FD_BASE + 2 * i;
+            while (!machine->WriteMem(fdsAddr, 4, readId));
+            while (!machine->WriteMem(fdsAddr + 4, 4, readId + 1));
+            r = 0;
             break;
         }
-        case SC_READ: {// Codeado
-            DEBUG('e', "Calling SC_READ.\n");
-            int buffer    = arg1;
-            int size      = arg2;
-            OpenFileId id = arg3;
-            int r         = -1;
-
-            ASSERT(buffer);
-            ASSERT(0 < size);
-
-            switch (id) {
-                case CONSOLE_INPUT: {
-                    char * bff = new char[size + 1];
-                    r = synchConsole->GetString(bff, size);
-                    WriteBufferToUser(buffer, bff, r);
-                    DEBUG('e', "Read: %s[%d]\n", bff, r);
-                    delete[] bff;
-                    break;
-                }
-                default: {
-                    if (currentThread->IsOpenFile(id)) {
-                        OpenFile * file = currentThread->GetFile(id);
-                        char * bff      = new char[size];
-                        memset(bff, 0, size);
-                        r = file->Read(bff, size);
-                        WriteBufferToUser(buffer, bff, r);
-                        DEBUG('e', "Read: %s", bff);
-                        delete[] bff;
-                    }
-                    break;
-                }
-            }
-            machine_ret(r);
+    }
+    machine_ret(r);
+}
+
+static void
+HandleMmap(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_MMAP.\n");
+    OpenFileId id   = arg1;
+    OpenFile * file = currentThread->GetFile(id);
+    int r           = -1;
+
+    if (file != nullptr) {
+        r = currentThread->space->Mmap(file);
+    }
+    machine_ret(r);
+}
+
+static void
+HandleMunmap(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_MUNMAP.\n");
+    machine_ret(currentThread->space->Munmap(arg1));
+}
+
+/// Entrada/salida asincronica sobre archivos: la operacion se encola y
+/// corre en un hilo de kernel propio mientras el proceso sigue
+/// computando; `SC_AIO_WAIT` recoge el resultado.  Las escrituras copian
+/// los datos del usuario al encolar (el buffer queda libre enseguida);
+/// las lecturas copian al usuario recien al esperar, desde su propio
+/// espacio de direcciones.
+
+static const unsigned MAX_AIO = 16;
+
+typedef struct {
+    bool        inUse;
+    bool        isWrite;
+    int         result;
+    int         userBuf;
+    int         size;
+    OpenFile *  file;
+    char *      kbuf;
+    Semaphore * done;
+} AioRequest;
+
+static AioRequest aioTable[MAX_AIO];
+
+static void
+AioWorker(void * arg)
+{
+    AioRequest * rq = (AioRequest *) arg;
+
+    if (rq->isWrite) {
+        rq->result = rq->file->Write(rq->kbuf, rq->size);
+    } else {
+        rq->result = rq->file->Read(rq->kbuf, rq->size);
+    }
+    rq->done->V();
+}
+
+/// Encolar una operacion; devuelve el id para `SC_AIO_WAIT`, o -1.
+static int
+AioSubmit(bool isWrite, int userBuf, int size, OpenFileId id)
+{
+    OpenFile * file = currentThread->GetFile(id);
+
+    if (file == nullptr || size <= 0 || userBuf == 0) {
+        return -1;
+    }
+    int slot = -1;
+    for (unsigned i = 0; i < MAX_AIO; i++) {
+        if (!aioTable[i].inUse) {
+            slot = i;
             break;
         }
-        case SC_REMOVE: {// Codeado
-            DEBUG('e', "Calling SC_REMOVE\n");
-            int filenameAddr = arg1;
-            if (filenameAddr == 0)
-                DEBUG('e', "Error: address to filename string is null.\n");
-
-            char filename[FILE_NAME_MAX_LEN + 1];
-            if (!ReadStringFromUser(filenameAddr, filename, sizeof filename)) {
-                DEBUG('e',
-                  "Error: filename string too long (maximum is %u bytes).\n",
-                  FILE_NAME_MAX_LEN);
+    }
+    if (slot < 0) {
+        return -1;
+    }
+
+    AioRequest * rq = &aioTable[slot];
+    rq->inUse   = true;
+    rq->isWrite = isWrite;
+    rq->result  = -1;
+    rq->userBuf = userBuf;
+    rq->size    = size;
+    rq->file    = file;
+    rq->kbuf    = new char[size];
+    rq->done    = new Semaphore("aio done", 0);
+    if (isWrite) {
+        ReadBufferFromUser(userBuf, rq->kbuf, size);
+    } else {
+        memset(rq->kbuf, 0, size);
+    }
+
+    Thread * worker = new Thread("aio worker");
+    worker->Fork(AioWorker, (void *) rq);
+    return slot;
+}
+
+static void
+HandleAioRead(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_AIO_READ.\n");
+    machine_ret(AioSubmit(false, arg1, arg2, arg3));
+}
+
+static void
+HandleAioWrite(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_AIO_WRITE.\n");
+    machine_ret(AioSubmit(true, arg1, arg2, arg3));
+}
+
+static void
+HandleAioWait(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_AIO_WAIT.\n");
+    if (arg1 < 0 || arg1 >= (int) MAX_AIO || !aioTable[arg1].inUse) {
+        machine_ret(-1);
+        return;
+    }
+    AioRequest * rq = &aioTable[arg1];
+    rq->done->P(); // Bloquear recien aca, al cobrar el resultado.
+    if (!rq->isWrite && rq->result > 0) {
+        WriteBufferToUser(rq->userBuf, rq->kbuf, rq->result);
+    }
+    int r = rq->result;
+    delete rq->done;
+    delete [] rq->kbuf;
+    rq->inUse = false;
+    machine_ret(r);
+}
+
+/// Semaforos de usuario: una tabla global de semaforos del kernel, para
+/// que procesos que comparten memoria puedan coordinarse.  Como los
+/// pipes, los ids son globales y los hijos los heredan.
+
+static const unsigned MAX_USER_SEMS = 32;
+
+static Semaphore * userSems[MAX_USER_SEMS];
+
+static void
+HandleShmget(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_SHMGET.\n");
+    machine_ret(AddressSpace::ShmGet(arg1, arg2));
+}
+
+static void
+HandleShmat(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_SHMAT.\n");
+    machine_ret(currentThread->space->ShmAttach(arg1));
+}
+
+static void
+HandleSemInit(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_SEMINIT.\n");
+    int r = -1;
+
+    if (arg1 >= 0) {
+        for (unsigned i = 0; i < MAX_USER_SEMS; i++) {
+            if (userSems[i] == nullptr) {
+                userSems[i] = new Semaphore("user semaphore", arg1);
+                r = i;
+                break;
             }
-            machine_ret(fileSystem->Remove(filename));
-            break;
         }
-        default: {
-            fprintf(stderr, "Unexpected system call: id %d.\n", scid);
-            ASSERT(false);
+    }
+    machine_ret(r);
+}
+
+static void
+HandleSemP(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_SEMP.\n");
+    if (arg1 < 0 || arg1 >= (int) MAX_USER_SEMS
+      || userSems[arg1] == nullptr)
+    {
+        machine_ret(-1);
+        return;
+    }
+    userSems[arg1]->P();
+    machine_ret(0);
+}
+
+static void
+HandleSemV(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_SEMV.\n");
+    if (arg1 < 0 || arg1 >= (int) MAX_USER_SEMS
+      || userSems[arg1] == nullptr)
+    {
+        machine_ret(-1);
+        return;
+    }
+    userSems[arg1]->V();
+    machine_ret(0);
+}
+
+static void
+HandleSync(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_SYNC.\n");
+    #ifdef FILESYS
+    // Punto de durabilidad global: bajar todas las escrituras diferidas
+    // de la cache de disco (cf. `SynchDisk::Flush`).
+    synchDisk->Flush();
+    #endif
+    // Con el stub las escrituras van directo al archivo UNIX.
+    machine_ret(0);
+}
+
+static void
+HandleFsync(int arg1, int arg2, int arg3)
+{
+    DEBUG('e', "Calling SC_FSYNC.\n");
+    int fid = arg1;
+    int r   = -1;
+
+    if (fid == CONSOLE_INPUT || fid == CONSOLE_OUTPUT) {
+        // La consola no pasa por la cache de disco.
+        r = 0;
+    } else {
+        OpenFile * file = currentThread->GetFile(fid);
+        if (file != nullptr) {
+            r = file->Sync();
         }
     }
+    machine_ret(r);
+}
+
+/// Tabla de despacho indexada por numero de syscall: resolver una llamada
+/// es una carga en vez de una cadena de comparaciones, y agregar una
+/// syscall nueva es llenar su ranura.  Las ranuras en null caen en el
+/// camino de error.
+
+typedef void (* SyscallHandlerFn)(int arg1, int arg2, int arg3);
+
+static const unsigned MAX_SYSCALL = 37;
+
+static SyscallHandlerFn syscallTable[MAX_SYSCALL] = {
+    HandleHalt,   // SC_HALT
+    HandleExit,   // SC_EXIT
+    HandleExec,   // SC_EXEC
+    HandleJoin,   // SC_JOIN
+    HandleFork,   // SC_FORK
+    HandleYield,  // SC_YIELD
+    nullptr, nullptr, nullptr, nullptr,
+    HandleCreate, // SC_CREATE
+    HandleRemove, // SC_REMOVE
+    HandleOpen,   // SC_OPEN
+    HandleClose,  // SC_CLOSE
+    HandleRead,   // SC_READ
+    HandleWrite,  // SC_WRITE
+    HandleReadv,  // SC_READV
+    HandleWritev, // SC_WRITEV
+    HandleMmap,   // SC_MMAP
+    HandleMunmap, // SC_MUNMAP
+    HandlePipe,   // SC_PIPE
+    HandleShmget, // SC_SHMGET
+    HandleShmat,  // SC_SHMAT
+    HandleSemInit,// SC_SEMINIT
+    HandleSemP,   // SC_SEMP
+    HandleSemV,   // SC_SEMV
+    HandleAioRead, // SC_AIO_READ
+    HandleAioWrite,// SC_AIO_WRITE
+    HandleAioWait, // SC_AIO_WAIT
+    HandleLink,   // SC_LINK
+    HandleRename, // SC_RENAME
+    HandleCkpt,   // SC_CKPT
+    HandleSleep,  // SC_SLEEP
+    HandleTicks,  // SC_TICKS
+    HandleThreadTicks, // SC_THREAD_TICKS
+    HandleSync,   // SC_SYNC
+    HandleFsync,  // SC_FSYNC
+};
+
+/// Contadores por syscall, creados la primera vez que cada una se usa
+/// (un `Counter` no copia su nombre, asi que el nombre va al heap y
+/// queda vivo para siempre, igual que el contador).  Por cada syscall se
+/// llevan tres: invocaciones (`syscall.<n>`), ticks totales de ida y
+/// vuelta (`.ticks`, bloqueos incluidos: eso ES la latencia que ve el
+/// usuario) y el peor caso (`.maxticks`, que solo crece, asi sigue
+/// siendo un contador monotono del registro).  Count/total dan la media
+/// diferenciando snapshots; junto al maximo alcanza para perfilar cada
+/// syscall sin printf.
+static Counter * syscallCounters[MAX_SYSCALL];
+static Counter * syscallTicks[MAX_SYSCALL];
+static Counter * syscallMaxTicks[MAX_SYSCALL];
+
+static Counter *
+NewSyscallCounter(unsigned scid, const char * suffix)
+{
+    char * name = new char [24];
+
+    snprintf(name, 24, "syscall.%u%s", scid, suffix);
+    return new Counter(name);
+}
+
+static void
+CountSyscall(unsigned scid, unsigned ticks)
+{
+    if (syscallCounters[scid] == nullptr) {
+        syscallCounters[scid] = NewSyscallCounter(scid, "");
+        syscallTicks[scid]    = NewSyscallCounter(scid, ".ticks");
+        syscallMaxTicks[scid] = NewSyscallCounter(scid, ".maxticks");
+    }
+    syscallCounters[scid]->Inc();
+    syscallTicks[scid]->Add(ticks);
+    if (ticks > syscallMaxTicks[scid]->Value()) {
+        syscallMaxTicks[scid]->Add(ticks - syscallMaxTicks[scid]->Value());
+    }
+}
+
+static void
+SyscallHandler(ExceptionType _et)
+{
+    unsigned scid = machine->ReadRegister(2);// r2
+    int arg1      = machine->ReadRegister(4);// r4
+    int arg2      = machine->ReadRegister(5);// r5
+    int arg3      = machine->ReadRegister(6);// r6
+
+    if (scid >= MAX_SYSCALL || syscallTable[scid] == nullptr) {
+        fprintf(stderr, "Unexpected system call: id %u.\n", scid);
+        ASSERT(false);
+    }
+    unsigned startTicks = stats->totalTicks;
+    syscallTable[scid](arg1, arg2, arg3);
+    CountSyscall(scid, stats->totalTicks - startTicks);
 
     IncrementPC();
-} // SyscallHandler
+}
+
+/// Cuanto duerme un proceso suspendido por el control de admision antes
+/// de volver a medir la presion.  Una ventana entera de working set,
+/// para que al despertar su propia estimacion ya haya decaido.
+static const unsigned THROTTLE_TICKS = 10000;
 
 static void
 Page_Fault_Handler(ExceptionType _et)
@@ -298,6 +1010,24 @@ Page_Fault_Handler(ExceptionType _et)
     // buscar en la pageTable, y insertar en la TBL
     unsigned vpn = machine->ReadRegister(BAD_VADDR_REG) / PAGE_SIZE;
 
+    // Camino rapido: pagina residente, el fallo es una pura recarga de
+    // TLB.  Instalar la entrada y volver, sin pasar por la contabilidad
+    // de presion ni por la maquinaria de carga.
+    if (currentThread->space->RefillTLB(vpn)) {
+        return;
+    }
+
+    // Control de admision: si la demanda agregada supera los marcos
+    // fisicos, el mas nuevo de los procesos que paginan se suspende aca,
+    // antes de traer la pagina, hasta que la presion baje.  Correr de a
+    // menos procesos degrada con gracia; dejarlos desalojarse las
+    // paginas mutuamente colapsa el rendimiento de todos.
+    currentThread->space->CountFault();
+    while (AddressSpace::ShouldThrottle(currentThread->space)) {
+        DEBUG('a', "Presion de memoria: suspendiendo al proceso mas nuevo\n");
+        timerWheel->SleepFor(THROTTLE_TICKS);
+    }
+
     if (!currentThread->space->Update_TLB(vpn)) {
         currentThread->Finish(-1);
     }
@@ -307,6 +1037,13 @@ Page_Fault_Handler(ExceptionType _et)
 static void
 Read_Only_Handler(ExceptionType _et)
 {
+    // Una escritura sobre una pagina mapeada al marco cero compartido no
+    // es una violacion: hay que darle su copia privada y reintentar.
+    unsigned vpn = machine->ReadRegister(BAD_VADDR_REG) / PAGE_SIZE;
+
+    if (currentThread->space->CopyZeroPage(vpn)) {
+        return; // La instruccion se reejecuta con la pagina escribible.
+    }
     DEBUG('a', "Read only exception\n");
     currentThread->Finish();
 }
@@ -0,0 +1,198 @@
+/// Administrador de procesos: ids con generacion y arbol de parentesco.
+///
+/// Ver `process_manager.hh` por la interfaz y la justificacion.
+
+#include "process_manager.hh"
+#include "threads/system.hh"
+
+
+/// Capacidad inicial de los arreglos de metadata; crece al doble, como
+/// la tabla que acompanian.
+static const unsigned INITIAL_CAPACITY = 20;
+
+ProcessManager::ProcessManager()
+{
+    table    = new Table<Thread *>;
+    capacity = INITIAL_CAPACITY;
+    gen        = new unsigned [capacity];
+    parent     = new int [capacity];
+    firstChild = new int [capacity];
+    prevSib    = new int [capacity];
+    nextSib    = new int [capacity];
+    for (unsigned i = 0; i < capacity; i++) {
+        gen[i]        = 0;
+        parent[i]     = -1;
+        firstChild[i] = -1;
+        prevSib[i]    = -1;
+        nextSib[i]    = -1;
+    }
+}
+
+ProcessManager::~ProcessManager()
+{
+    delete table;
+    delete [] gen;
+    delete [] parent;
+    delete [] firstChild;
+    delete [] prevSib;
+    delete [] nextSib;
+}
+
+unsigned
+ProcessManager::IndexOf(int id)
+{
+    return (unsigned) id & ((1u << INDEX_BITS) - 1);
+}
+
+int
+ProcessManager::MakeId(unsigned index) const
+{
+    return (int) (index | ((gen[index] & GEN_MASK) << INDEX_BITS));
+}
+
+bool
+ProcessManager::IsLive(int id) const
+{
+    if (id < 0) {
+        return false;
+    }
+    unsigned index = IndexOf(id);
+    return index < capacity && table->HasKey(index)
+           && MakeId(index) == id;
+}
+
+void
+ProcessManager::EnsureCapacity(unsigned index)
+{
+    if (index < capacity) {
+        return;
+    }
+    unsigned newCapacity = capacity;
+    while (newCapacity <= index) {
+        newCapacity *= 2;
+    }
+    unsigned * newGen    = new unsigned [newCapacity];
+    int * newParent      = new int [newCapacity];
+    int * newFirstChild  = new int [newCapacity];
+    int * newPrevSib     = new int [newCapacity];
+    int * newNextSib     = new int [newCapacity];
+    for (unsigned i = 0; i < capacity; i++) {
+        newGen[i]        = gen[i];
+        newParent[i]     = parent[i];
+        newFirstChild[i] = firstChild[i];
+        newPrevSib[i]    = prevSib[i];
+        newNextSib[i]    = nextSib[i];
+    }
+    for (unsigned i = capacity; i < newCapacity; i++) {
+        newGen[i]        = 0;
+        newParent[i]     = -1;
+        newFirstChild[i] = -1;
+        newPrevSib[i]    = -1;
+        newNextSib[i]    = -1;
+    }
+    delete [] gen;
+    delete [] parent;
+    delete [] firstChild;
+    delete [] prevSib;
+    delete [] nextSib;
+    gen        = newGen;
+    parent     = newParent;
+    firstChild = newFirstChild;
+    prevSib    = newPrevSib;
+    nextSib    = newNextSib;
+    capacity   = newCapacity;
+}
+
+int
+ProcessManager::Register(Thread * thread)
+{
+    ASSERT(thread != nullptr);
+
+    unsigned index = table->Add(thread);
+    EnsureCapacity(index);
+
+    // Colgar al nuevo de la lista de hijos del proceso actual.  El
+    // hilo inicial se registra antes de que exista `currentThread` y
+    // queda sin padre.
+    parent[index]     = -1;
+    firstChild[index] = -1;
+    prevSib[index]    = -1;
+    nextSib[index]    = -1;
+    if (currentThread != nullptr && IsLive(currentThread->pid)) {
+        unsigned p = IndexOf(currentThread->pid);
+        parent[index] = currentThread->pid;
+        nextSib[index] = firstChild[p];
+        if (firstChild[p] != -1) {
+            prevSib[IndexOf(firstChild[p])] = MakeId(index);
+        }
+        firstChild[p] = MakeId(index);
+    }
+    return MakeId(index);
+}
+
+void
+ProcessManager::DetachFromParent(unsigned index)
+{
+    if (parent[index] == -1) {
+        return;
+    }
+    unsigned p = IndexOf(parent[index]);
+    if (prevSib[index] != -1) {
+        nextSib[IndexOf(prevSib[index])] = nextSib[index];
+    } else if (table->HasKey(p)) {
+        firstChild[p] = nextSib[index];
+    }
+    if (nextSib[index] != -1) {
+        prevSib[IndexOf(nextSib[index])] = prevSib[index];
+    }
+    parent[index]  = -1;
+    prevSib[index] = -1;
+    nextSib[index] = -1;
+}
+
+void
+ProcessManager::Unregister(int id)
+{
+    if (!IsLive(id)) {
+        return;
+    }
+    unsigned index = IndexOf(id);
+
+    // Los hijos quedan huerfanos: nadie mas puede joinearlos, pero sus
+    // ids siguen resolviendo hasta que mueran.
+    for (int c = firstChild[index]; c != -1; ) {
+        unsigned ci = IndexOf(c);
+        int next = nextSib[ci];
+        parent[ci]  = -1;
+        prevSib[ci] = -1;
+        nextSib[ci] = -1;
+        c = next;
+    }
+    firstChild[index] = -1;
+    DetachFromParent(index);
+
+    table->Remove(index);
+    // Avanzar la generacion: todo id viejo de esta ranura deja de
+    // resolver.  El contador da la vuelta cada 32768 reusos, riesgo
+    // que se asume (habria que retener un id exactamente ese multiplo
+    // de muertes para confundirse).
+    gen[index] = (gen[index] + 1) & GEN_MASK;
+}
+
+Thread *
+ProcessManager::Resolve(int id)
+{
+    if (!IsLive(id)) {
+        return nullptr;
+    }
+    return table->Get(IndexOf(id));
+}
+
+bool
+ProcessManager::IsChildOfCurrent(int id)
+{
+    if (!IsLive(id) || currentThread == nullptr) {
+        return false;
+    }
+    return parent[IndexOf(id)] == currentThread->pid;
+}
@@ -0,0 +1,99 @@
+/// Administrador de procesos: ids reciclables con deteccion de joins
+/// viejos, y parentesco para validar quien puede joinear a quien.
+///
+/// Los `SpaceId` que devuelve `Exec` salen de una `Table`, que recicla
+/// ranuras: sin mas, un `Join` con un id guardado de un proceso ya
+/// muerto podria resolver a un proceso nuevo que heredo la ranura.  Por
+/// eso cada id lleva, ademas del indice de ranura, un contador de
+/// generacion que se incrementa al liberar la ranura: el id viejo deja
+/// de resolver (devuelve null) en vez de apuntar a otro proceso.
+///
+/// Ademas se mantiene el arbol de parentesco con listas intrusivas
+/// sobre arreglos paralelos a las ranuras (padre, primer hijo,
+/// hermanos), todo O(1) por alta y baja: registrar un proceso lo cuelga
+/// del proceso actual, y al morir sus hijos quedan huerfanos.  `Join`
+/// usa el padre para rechazar en O(1) joins sobre procesos ajenos.
+///
+/// Sin sincronizacion interna, como `Table`: las altas y bajas ocurren
+/// en los caminos de syscall y de destruccion de hilos, ya serializados.
+///
+/// Copyright (c) 2018 Docentes de la Universidad Nacional de Rosario.
+/// All rights reserved.  See `copyright.h` for copyright notice and
+/// limitation of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_USERPROG_PROCESSMANAGER__HH
+#define NACHOS_USERPROG_PROCESSMANAGER__HH
+
+
+#include "lib/table.hh"
+
+class Thread;
+
+
+class ProcessManager {
+public:
+
+    ProcessManager();
+    ~ProcessManager();
+
+    /// Dar de alta un proceso y devolver su id, colgandolo como hijo
+    /// del proceso actual (o sin padre, si todavia no hay uno).
+    int
+    Register(Thread * thread);
+
+    /// Dar de baja un id: la ranura queda libre para reciclar, su
+    /// generacion avanza (los ids viejos dejan de resolver) y sus hijos
+    /// quedan huerfanos.
+    void
+    Unregister(int id);
+
+    /// Resolver un id a su proceso, o null si el id es invalido o
+    /// pertenece a un proceso que ya murio (generacion vieja).
+    Thread *
+    Resolve(int id);
+
+    /// Es el proceso actual el padre del proceso `id`?
+    bool
+    IsChildOfCurrent(int id);
+
+private:
+
+    /// Los ids empaquetan ranura y generacion; la generacion queda en
+    /// 15 bits para que el id nunca sea negativo (los negativos son
+    /// errores en la interfaz de syscalls).
+    static const unsigned INDEX_BITS = 16;
+    static const unsigned GEN_MASK   = 0x7FFF;
+
+    /// Procesos vivos, indexados por ranura.
+    Table < Thread * > *table;
+
+    /// Metadata por ranura, paralela a la tabla y crecida a la par:
+    /// generacion vigente y parentesco (ids empaquetados; -1 = nadie).
+    unsigned * gen;
+    int * parent;
+    int * firstChild;
+    int * prevSib;
+    int * nextSib;
+    unsigned capacity;
+
+    /// Ranura e id empaquetado.
+    static unsigned
+    IndexOf(int id);
+    int
+    MakeId(unsigned index) const;
+
+    /// La ranura `index` existe y su generacion coincide con `id`?
+    bool
+    IsLive(int id) const;
+
+    /// Agrandar los arreglos de metadata hasta cubrir `index`.
+    void
+    EnsureCapacity(unsigned index);
+
+    /// Desenganchar la ranura de la lista de hijos de su padre.
+    void
+    DetachFromParent(unsigned index);
+};
+
+
+#endif /* ifndef NACHOS_USERPROG_PROCESSMANAGER__HH */
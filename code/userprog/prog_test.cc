@@ -30,7 +30,7 @@ StartProcess(const char * filename)
         return;
     }
 
-    AddressSpace * space = new AddressSpace(executable);
+    AddressSpace * space = new AddressSpace(executable, filename);
     currentThread->space = space;
 
     space->InitRegisters(); // Set the initial register values.
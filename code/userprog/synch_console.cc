@@ -1,4 +1,5 @@
 #include "synch_console.hh"
+#include "threads/system.hh"
 
 SynchConsole::SynchConsole(const char * s, const char * read_buffer,
   const char * write_buffer)
@@ -7,18 +8,31 @@ SynchConsole::SynchConsole(const char * s, const char * read_buffer,
     console = new Console(read_buffer, write_buffer,
         SynchConsole::CheckCharAvail,
         SynchConsole::WriteDone, this);
-    can_read   = new Semaphore("read avail", 0);// Bloque al proceso hasta que alguien escriba
-    write_done = new Semaphore("write done", 0);
-    write      = new Lock("lock console write");
-    read       = new Lock("lock console read");
-    name       = s;
+    can_read  = new Semaphore("read avail", 0);// Bloque al proceso hasta que alguien escriba
+    out_space = new Semaphore("console out space", OUT_BUF_SIZE);
+    drained   = new Semaphore("console drained", 0);
+    write     = new Lock("lock console write");
+    read      = new Lock("lock console read");
+    name      = s;
+
+    outHead      = 0;
+    outTail      = 0;
+    outCount     = 0;
+    outBusy      = false;
+    flushWaiting = false;
+
+    inHead  = 0;
+    inTail  = 0;
+    inCount = 0;
 }
 
 SynchConsole::~SynchConsole()
 {
     DEBUG('w', "Borrando consola %s syncronizada\n", name);
+    Flush(); // No perder lo que quedo encolado.
     delete can_read;
-    delete write_done;
+    delete out_space;
+    delete drained;
     delete write;
     delete read;
     delete console;
@@ -28,11 +42,7 @@ void
 SynchConsole::PutChar(char ch)
 {
     DEBUG('w', "%s: Llamando a putchar\n", name);
-    write->Acquire();
-    DEBUG('w', "%s: Escribiendo...\n", name);
-    console->PutChar(ch);
-    write_done->P();
-    write->Release();
+    PutString(&ch, 1);
 }
 
 char
@@ -42,21 +52,48 @@ SynchConsole::GetChar()
     read->Acquire();
     can_read->P();
     DEBUG('w', "%s: Leyendo...\n", name);
-    char ch = console->GetChar();
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    char ch = inBuf[inHead];
+    inHead  = (inHead + 1) % IN_BUF_SIZE;
+    inCount--;
+    interrupt->SetLevel(oldLevel);
     read->Release();
 
     return ch;
 }
 
+/// Encolar el buffer entero y volver: el dispositivo se alimenta desde el
+/// anillo de a tandas contiguas, asi el que escribe no paga una vuelta de
+/// interrupcion por caracter sino una por tanda.  Solo se bloquea si el
+/// anillo se llena.
 int
 SynchConsole::PutString(char * buffer, int size)
 {
     ASSERT(buffer != NULL);
     write->Acquire();
     for (int i = 0; i < size; i++) {
-        console->PutChar(buffer[i]);
-        write_done->P();
+        IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+        if (!outBusy && outCount == OUT_BUF_SIZE) {
+            // Anillo lleno y dispositivo ocioso: arrancar la tanda antes
+            // de esperar lugar, o nadie lo va a liberar.
+            StartTransfer();
+        }
+        interrupt->SetLevel(oldLevel);
+
+        out_space->P(); // Esperar lugar en el anillo.
+        oldLevel        = interrupt->SetLevel(INT_OFF);
+        outBuf[outTail] = buffer[i];
+        outTail = (outTail + 1) % OUT_BUF_SIZE;
+        outCount++;
+        interrupt->SetLevel(oldLevel);
+    }
+    // Recien aca se despierta al dispositivo, para que la tanda cubra
+    // todo lo que acabamos de encolar y no solo el primer caracter.
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    if (!outBusy && outCount > 0) {
+        StartTransfer();
     }
+    interrupt->SetLevel(oldLevel);
     write->Release();
 
     return size;
@@ -69,27 +106,109 @@ SynchConsole::GetString(char * buffer, int size)
     read->Acquire();
     int i;
     for (i = 0; i < size; i++) {
+        // Solo el primer `P` de una linea tipeada de antemano llega a
+        // bloquear: los caracteres siguientes ya estan en el anillo y
+        // el semaforo los descuenta sin dormir.
         can_read->P();
-        buffer[i] = console->GetChar();
+        IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+        buffer[i] = inBuf[inHead];
+        inHead    = (inHead + 1) % IN_BUF_SIZE;
+        inCount--;
+        interrupt->SetLevel(oldLevel);
         if (buffer[i] == '\0')
             break;
+        if (buffer[i] == '\n') {
+            i++; // La linea se entrega con su `\n`.
+            break;
+        }
     }
-    buffer[i] = '\0';
+    if (i < size)
+        buffer[i] = '\0';
     read->Release();
 
     return i;
 }
 
+void
+SynchConsole::Flush()
+{
+    write->Acquire();
+    IntStatus oldLevel = interrupt->SetLevel(INT_OFF);
+    if (outBusy) {
+        flushWaiting = true;
+        interrupt->SetLevel(oldLevel);
+        drained->P(); // La interrupcion del ultimo caracter avisa.
+    } else {
+        interrupt->SetLevel(oldLevel);
+    }
+    write->Release();
+}
+
+/// Con interrupciones apagadas y el dispositivo ocioso: mandar en una
+/// tanda el tramo contiguo pendiente del anillo (hasta donde da la
+/// vuelta), y liberar de una los lugares consumidos.  Una escritura de
+/// 1 KB cuesta como mucho dos interrupciones (si el tramo cruza el fin
+/// del anillo) en vez de 1024.
+void
+SynchConsole::StartTransfer()
+{
+    unsigned chunk = OUT_BUF_SIZE - outHead;
+
+    if (chunk > outCount) {
+        chunk = outCount;
+    }
+    outBusy = true;
+    console->PutBuffer(&outBuf[outHead], chunk);
+    outHead   = (outHead + chunk) % OUT_BUF_SIZE;
+    outCount -= chunk;
+    for (unsigned i = 0; i < chunk; i++) {
+        out_space->V();
+    }
+}
+
+void
+SynchConsole::HandleWriteDone()
+{
+    // Corre como manejador de interrupcion, con interrupciones apagadas.
+    if (outCount > 0) {
+        StartTransfer();
+    } else {
+        outBusy = false;
+        if (flushWaiting) {
+            flushWaiting = false;
+            drained->V();
+        }
+    }
+}
+
+void
+SynchConsole::HandleCharAvail()
+{
+    // Corre como manejador de interrupcion, con interrupciones apagadas.
+    // Sacar el caracter del buffer de un lugar del dispositivo lo libera
+    // para el proximo poll, asi el tipeo se acumula aca aunque nadie
+    // este leyendo; si el type-ahead se lleno, el caracter se pierde
+    // (como en una UART real).
+    char ch = console->GetChar();
+
+    if (inCount >= IN_BUF_SIZE)
+        return;
+    inBuf[inTail] = ch;
+    inTail        = (inTail + 1) % IN_BUF_SIZE;
+    inCount++;
+    can_read->V();
+}
+
 void
 SynchConsole::CheckCharAvail(void * consol)
 {
     ASSERT(consol != NULL);
-    ((SynchConsole *) consol)->can_read->V();
+    ((SynchConsole *) consol)->HandleCharAvail();
 }
 
 void
 SynchConsole::WriteDone(void * consol)
 {
     ASSERT(consol != NULL);
-    ((SynchConsole *) consol)->write_done->V();
+    ((SynchConsole *) consol)->HandleWriteDone();
 }
@@ -17,20 +17,71 @@ public:
 
     int
     PutString(char * buffer, int size);
+
+    /// Lectura orientada a lineas: junta caracteres hasta `size`, un
+    /// `\n` (que se incluye) o un `\0`.  Gracias al type-ahead lo
+    /// tipeado mientras el proceso estaba ocupado ya espera en el
+    /// anillo, asi que una linea entera se lee bloqueando una sola vez.
     int
     GetString(char * buffer, int size);
 
+    /// Esperar a que todo lo encolado llegue al dispositivo.
+    void
+    Flush();
+
 private:
+
+    /// Tamano del anillo de salida.  Las escrituras vuelven apenas los
+    /// datos quedan encolados; el anillo alimenta al dispositivo de a un
+    /// caracter conforme llegan las interrupciones de escritura.
+    static const unsigned OUT_BUF_SIZE = 1024;
+
+    /// Tamano del anillo de type-ahead de entrada.  La interrupcion de
+    /// lectura saca cada caracter del buffer de a uno del dispositivo y
+    /// lo encola aca, asi el teclado no queda limitado a un caracter por
+    /// `CONSOLE_TIME` cuando el lector esta ocupado.
+    static const unsigned IN_BUF_SIZE = 256;
+
     static void
     CheckCharAvail(void *);
     static void
     WriteDone(void *);
+
+    /// Mandar al dispositivo el tramo contiguo pendiente del anillo, en
+    /// una sola tanda.  Llamar con interrupciones apagadas y el
+    /// dispositivo ocioso.
+    void
+    StartTransfer();
+
+    /// Despachar la proxima tanda del anillo, desde la interrupcion de
+    /// tanda completada.
+    void
+    HandleWriteDone();
+
+    /// Encolar el caracter recien llegado en el anillo de type-ahead,
+    /// desde la interrupcion de caracter disponible.
+    void
+    HandleCharAvail();
+
     Semaphore * can_read;
-    Semaphore * write_done;
+    Semaphore * out_space; ///< Lugares libres en el anillo.
+    Semaphore * drained;   ///< Aviso de anillo vacio, para `Flush`.
     Console * console;
     Lock * read;
     Lock * write;
     const char * name;
+
+    char outBuf[OUT_BUF_SIZE];
+    unsigned outHead;  ///< Proximo caracter a mandar al dispositivo.
+    unsigned outTail;  ///< Proximo lugar libre.
+    unsigned outCount;
+    bool outBusy;      ///< Hay un `PutChar` en vuelo en el dispositivo.
+    bool flushWaiting; ///< Alguien espera en `Flush`.
+
+    char inBuf[IN_BUF_SIZE];
+    unsigned inHead;  ///< Proximo caracter a entregar al lector.
+    unsigned inTail;  ///< Proximo lugar libre.
+    unsigned inCount; ///< `can_read` cuenta lo mismo, para bloquear.
 };
 
 #endif /* ifndef NACHOS_SYNCHCONSOLE__HH */
@@ -0,0 +1,90 @@
+#include "synch_pipe.hh"
+
+SynchPipe::SynchPipe()
+{
+    head      = 0;
+    tail      = 0;
+    count     = 0;
+    readOpen  = true;
+    writeOpen = true;
+    lock      = new Lock("pipe lock");
+    notEmpty  = new Condition("pipe not empty", lock);
+    notFull   = new Condition("pipe not full", lock);
+}
+
+SynchPipe::~SynchPipe()
+{
+    delete notEmpty;
+    delete notFull;
+    delete lock;
+}
+
+int
+SynchPipe::Read(char * into, unsigned numBytes)
+{
+    ASSERT(into != nullptr);
+    lock->Acquire();
+    while (count == 0 && writeOpen) {
+        notEmpty->Wait();
+    }
+    unsigned r = 0;
+    while (r < numBytes && count > 0) {
+        into[r++] = buf[head];
+        head      = (head + 1) % PIPE_BUF_SIZE;
+        count--;
+    }
+    if (r > 0) {
+        notFull->Broadcast();
+    }
+    lock->Release();
+
+    return r; // 0 es fin de archivo: escritor cerrado y anillo vacio.
+}
+
+int
+SynchPipe::Write(const char * from, unsigned numBytes)
+{
+    ASSERT(from != nullptr);
+    lock->Acquire();
+    unsigned w = 0;
+    while (w < numBytes && readOpen) {
+        while (count == PIPE_BUF_SIZE && readOpen) {
+            notFull->Wait();
+        }
+        while (w < numBytes && count < PIPE_BUF_SIZE) {
+            buf[tail] = from[w++];
+            tail      = (tail + 1) % PIPE_BUF_SIZE;
+            count++;
+        }
+        notEmpty->Broadcast();
+    }
+    lock->Release();
+
+    return w;
+}
+
+void
+SynchPipe::CloseRead()
+{
+    lock->Acquire();
+    readOpen = false;
+    // Despertar escritores bloqueados: ya no tienen a quien escribir.
+    notFull->Broadcast();
+    lock->Release();
+}
+
+void
+SynchPipe::CloseWrite()
+{
+    lock->Acquire();
+    writeOpen = false;
+    // Despertar lectores bloqueados: lo que queda y despues EOF.
+    notEmpty->Broadcast();
+    lock->Release();
+}
+
+bool
+SynchPipe::Closed() const
+{
+    return !readOpen && !writeOpen;
+}
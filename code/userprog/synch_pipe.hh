@@ -0,0 +1,54 @@
+#ifndef NACHOS_USERPROG_SYNCHPIPE__HH
+#define NACHOS_USERPROG_SYNCHPIPE__HH
+
+#include "threads/synch.hh"
+
+/// Un pipe en memoria del kernel: un anillo con un extremo de lectura y
+/// uno de escritura, para conectar productor y consumidor sin pasar por
+/// el sistema de archivos.  El bloqueo usa variables de condicion: los
+/// lectores esperan datos y los escritores esperan lugar.
+class SynchPipe {
+public:
+
+    SynchPipe();
+    ~SynchPipe();
+
+    /// Leer hasta `numBytes`.  Bloquea hasta que haya al menos un byte;
+    /// devuelve 0 (fin de archivo) si el extremo de escritura se cerro y
+    /// el anillo quedo vacio.
+    int
+    Read(char * into, unsigned numBytes);
+
+    /// Escribir `numBytes`, bloqueando cuando el anillo se llena.
+    /// Devuelve lo escrito, que es menos si el extremo de lectura se
+    /// cierra en el medio.
+    int
+    Write(const char * from, unsigned numBytes);
+
+    void
+    CloseRead();
+    void
+    CloseWrite();
+
+    /// Ambos extremos cerrados: el pipe puede destruirse.
+    bool
+    Closed() const;
+
+private:
+
+    static const unsigned PIPE_BUF_SIZE = 1024;
+
+    char buf[PIPE_BUF_SIZE];
+    unsigned head;  ///< Proximo byte a leer.
+    unsigned tail;  ///< Proximo lugar libre.
+    unsigned count;
+
+    bool readOpen;
+    bool writeOpen;
+
+    Lock * lock;
+    Condition * notEmpty;
+    Condition * notFull;
+};
+
+#endif /* ifndef NACHOS_USERPROG_SYNCHPIPE__HH */
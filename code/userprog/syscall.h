@@ -31,6 +31,27 @@
 #define SC_CLOSE  13
 #define SC_READ   14
 #define SC_WRITE  15
+#define SC_READV  16
+#define SC_WRITEV 17
+#define SC_MMAP   18
+#define SC_MUNMAP 19
+#define SC_PIPE    20
+#define SC_SHMGET  21
+#define SC_SHMAT   22
+#define SC_SEMINIT 23
+#define SC_SEMP    24
+#define SC_SEMV    25
+#define SC_AIO_READ  26
+#define SC_AIO_WRITE 27
+#define SC_AIO_WAIT  28
+#define SC_LINK   29
+#define SC_RENAME 30
+#define SC_CKPT   31
+#define SC_SLEEP  32
+#define SC_TICKS  33
+#define SC_THREAD_TICKS 34
+#define SC_SYNC   35
+#define SC_FSYNC  36
 
 #ifndef IN_ASM
 
@@ -112,6 +133,19 @@ typedef int OpenFileId;
 void
 Create(const char * name); //
 
+/// Make `newName` another name (hard link) for the existing file
+/// `oldName`.  Both names share the same data; the file is only freed
+/// when its last name is removed.  Returns nonzero on success.
+int
+Link(const char * oldName, const char * newName);
+
+/// Atomically rename `oldName` to `newName`.  Only directory entries
+/// move -- no data is copied, so the cost is independent of the file
+/// size.  Fails if `newName` already exists.  Returns nonzero on
+/// success.
+int
+Rename(const char * oldName, const char * newName);
+
 /// Remove the Nachos file/directory named `name`.
 int
 Remove(const char * name);
@@ -138,6 +172,78 @@ Read(char * buffer, int size, OpenFileId id); //
 void
 Close(OpenFileId id); //
 
+/// A fragment of a scatter-gather transfer: base address and length.
+typedef struct {
+    char * base;
+    int    len;
+} IOVec;
+
+/// Read into the `count` fragments of `iov`, in order, with a single
+/// kernel crossing.  Return the number of bytes actually read.
+int
+Readv(IOVec * iov, int count, OpenFileId id);
+
+/// Write the `count` fragments of `iov`, in order, with a single kernel
+/// crossing.  Return the number of bytes written.
+int
+Writev(IOVec * iov, int count, OpenFileId id);
+
+/// Map the open file `id` into the address space.  Pages are loaded on
+/// demand and dirty pages are written back on `Munmap`.  Returns the
+/// address of the mapping, or -1 on failure.
+int
+Mmap(OpenFileId id);
+
+/// Undo a mapping previously returned by `Mmap`.  Returns 0, or -1 if
+/// `addr` is not the start of a mapping.
+int
+Munmap(int addr);
+
+/// Create an in-kernel pipe.  `fds[0]` receives the read end id and
+/// `fds[1]` the write end; both work with `Read`/`Write`/`Close`.
+/// Returns 0, or -1 if no pipe slot is free.
+int
+Pipe(int * fds);
+
+/// Get (creating it if needed) the shared memory segment named `key`,
+/// with room for at least `size` bytes.  Returns its id, or -1.
+int
+Shmget(int key, int size);
+
+/// Map the shared segment `id` into the address space.  All processes
+/// that attach it see the same physical memory.  Returns the address of
+/// the mapping, or -1.
+int
+Shmat(int id);
+
+/// Create a kernel semaphore with the given initial value, for
+/// coordinating access to shared memory.  Returns its id, or -1.
+int
+SemInit(int initial);
+
+/// P (wait) and V (signal) on a semaphore created with `SemInit`.
+int
+SemP(int sem);
+
+int
+SemV(int sem);
+
+/// Queue an asynchronous read or write on an open file and return
+/// immediately with a handle; the operation runs on a kernel worker
+/// thread.  For writes the buffer may be reused as soon as the call
+/// returns.  Returns -1 if the queue is full or the id is invalid.
+int
+AioRead(char * buffer, int size, OpenFileId id);
+
+int
+AioWrite(const char * buffer, int size, OpenFileId id);
+
+/// Wait for the operation `handle` to complete and return the number of
+/// bytes transferred.  For reads, the data lands in the buffer given at
+/// submission.
+int
+AioWait(int handle);
+
 ///Ls to filesys
 void
 Ls();
@@ -151,6 +257,41 @@ NewDir(const char * dir);
 void
 Copy(const char * UnixFile, const char * NachosFile);
 
+/// Save a snapshot of the process (registers and memory) to `name`, so
+/// that `nachos -restore <name>` can resume execution from this exact
+/// point.  Returns 0 in the run that took the snapshot, 1 in a restored
+/// run, and -1 if the snapshot could not be written.
+int
+Checkpoint(const char * name);
+
+/// Block the calling thread for at least `ticks` simulated ticks,
+/// without burning CPU in a yield loop.
+void
+Sleep(int ticks);
+
+/// Total simulated ticks since the machine booted.  Cheap enough to
+/// call around a phase of interest; differences give elapsed simulated
+/// time, including whatever other threads ran in between.
+unsigned
+Ticks();
+
+/// Simulated ticks this thread has spent on the CPU, from the per-thread
+/// accounting.  Unlike `Ticks`, unaffected by time consumed by others.
+unsigned
+ThreadTicks();
+
+/// Force every delayed (cached) disk write to stable storage.  With the
+/// write-back disk cache, writes normally reach the disk lazily; `Sync`
+/// is the global durability point.
+void
+Sync();
+
+/// Like `Sync`, but only for the open file `id`: flushes just the
+/// sectors belonging to that file, so other files keep batching their
+/// writes.  Returns 0, or -1 if `id` is not an open file.
+int
+Fsync(OpenFileId id);
+
 #endif // ifndef IN_ASM
 
 
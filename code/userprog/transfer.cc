@@ -2,7 +2,16 @@
 #include "lib/utility.hh"
 #include "threads/system.hh"
 
+#include <string.h>
 
+
+/// Copy a C string from virtual machine to host.
+///
+/// Instead of translating and fetching one byte per character, each page
+/// the string touches is translated once, copied, and scanned with
+/// `strnlen` in host memory; the translation boundary is only crossed
+/// when the string spans pages.  Returns true if a terminator was found
+/// within `maxByteCount` bytes.
 bool
 ReadStringFromUser(int userAddress, char * outString,
   unsigned maxByteCount)
@@ -12,18 +21,24 @@ ReadStringFromUser(int userAddress, char * outString,
     ASSERT(maxByteCount != 0);
 
     unsigned count = 0;
-    do {
-        int temp;
-        while (!machine->ReadMem(userAddress, 1, &temp));
-        *outString = (unsigned char) temp;
-        userAddress++;
-        count++;
-    } while (*outString++ != '\0' && count < maxByteCount);
-
-    return *(outString - 1) == '\0';
+    while (count < maxByteCount) {
+        unsigned chunk = PAGE_SIZE - userAddress % PAGE_SIZE;
+        if (chunk > maxByteCount - count)
+            chunk = maxByteCount - count;
+        while (!machine->ReadMemBlock(userAddress, chunk, outString));
+        if (strnlen(outString, chunk) < chunk)
+            return true; // Terminator found within this page.
+        userAddress += chunk;
+        outString   += chunk;
+        count       += chunk;
+    }
+    return false;
 }
 
 /// Copy a byte array from virtual machine to host.
+///
+/// The copy proceeds page-at-a-time: each chunk is translated once and
+/// moved with `memcpy` instead of one full translation per byte.
 void
 ReadBufferFromUser(int userAddress, char * outBuffer,
   unsigned byteCount)
@@ -31,15 +46,19 @@ ReadBufferFromUser(int userAddress, char * outBuffer,
     ASSERT(userAddress != 0);
     ASSERT(outBuffer != nullptr);
     ASSERT(byteCount != 0);
-    for (unsigned count = 0; count < byteCount; count++) {
-        int tmp;
-        while (!machine->ReadMem(userAddress, 1, &tmp));
-        outBuffer[count] = (unsigned char) tmp;
-        userAddress++;
+    while (byteCount > 0) {
+        unsigned chunk = PAGE_SIZE - userAddress % PAGE_SIZE;
+        if (chunk > byteCount)
+            chunk = byteCount;
+        // Retry after a page fault, as with the byte-sized reads.
+        while (!machine->ReadMemBlock(userAddress, chunk, outBuffer));
+        userAddress += chunk;
+        outBuffer   += chunk;
+        byteCount   -= chunk;
     }
 }
 
-/// Copy a byte array from host to virtual machine.
+/// Copy a byte array from host to virtual machine, page-at-a-time.
 void
 WriteBufferToUser(int userAddress, const char * buffer, unsigned byteCount)
 {
@@ -47,21 +66,50 @@ WriteBufferToUser(int userAddress, const char * buffer, unsigned byteCount)
     ASSERT(buffer != nullptr);
     ASSERT(byteCount != 0);
 
-    for (unsigned i = 0; i < byteCount; i++) {
-        while (!machine->WriteMem(userAddress, 1, (int) buffer[i]));
-        userAddress++;
+    while (byteCount > 0) {
+        unsigned chunk = PAGE_SIZE - userAddress % PAGE_SIZE;
+        if (chunk > byteCount)
+            chunk = byteCount;
+        while (!machine->WriteMemBlock(userAddress, chunk, buffer));
+        userAddress += chunk;
+        buffer      += chunk;
+        byteCount   -= chunk;
     }
 }
 
+/// Copy an array of user iovec entries to host.
+///
+/// Each entry is two words: the fragment base address and its length,
+/// laid out as the userland `IOVec` struct.  Lengths of zero are allowed
+/// (the fragment is just skipped by the callers); a negative length makes
+/// the whole array invalid.
+bool
+ReadIOVecFromUser(int userAddress, unsigned count, int * bases, int * lens)
+{
+    ASSERT(userAddress != 0);
+    ASSERT(bases != nullptr);
+    ASSERT(lens != nullptr);
+
+    for (unsigned i = 0; i < count; i++) {
+        while (!machine->ReadMem(userAddress, 4, &bases[i]));
+        while (!machine->ReadMem(userAddress + 4, 4, &lens[i]));
+        if (lens[i] < 0)
+            return false;
+        userAddress += 8;
+    }
+    return true;
+}
+
 /// Copy a C string from host to virtual machine.
+///
+/// As before, the terminating null is *not* copied.
 void
 WriteStringToUser(const char * string, int userAddress)
 {
     ASSERT(userAddress != 0);
     ASSERT(string != nullptr);
 
-    for (unsigned i = 0; string[i] != '\0'; i++) {
-        while (!machine->WriteMem(userAddress, 1, string[i]));
-        userAddress++;
-    }
+    unsigned length = strlen(string);
+    if (length > 0)
+        WriteBufferToUser(userAddress, string, length);
 }
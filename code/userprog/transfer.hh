@@ -25,5 +25,11 @@ WriteBufferToUser(int userAddress, const char * buffer, unsigned byteCount);
 void
 WriteStringToUser(const char * string, int userAddress);
 
+/// Copy an array of `count` user iovec entries (base, length word pairs)
+/// starting at `userAddress` into the `bases`/`lens` arrays.  Returns
+/// false if any length is negative.
+bool
+ReadIOVecFromUser(int userAddress, unsigned count, int * bases, int * lens);
+
 
 #endif /* ifndef NACHOS_USERPROG_TRANSFER__HH */